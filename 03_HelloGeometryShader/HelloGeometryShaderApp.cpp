@@ -1,5 +1,6 @@
 #include "HelloGeometryShaderApp.h"
 #include "TeapotModel.h"
+#include "ShaderCompileService.h"
 
 #include "imgui.h"
 #include "examples/imgui_impl_dx12.h"
@@ -19,30 +20,11 @@ HelloGeometryShaderApp::HelloGeometryShaderApp()
   );
 }
 
-void HelloGeometryShaderApp::CreateRootSignatures()
-{
-  // RootSignature
-  array<CD3DX12_ROOT_PARAMETER, 1> rootParams;
-  rootParams[0].InitAsConstantBufferView(0);
-
-  CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
-  rootSignatureDesc.Init(
-    UINT(rootParams.size()), rootParams.data(),
-    0, nullptr,
-    D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-  ComPtr<ID3DBlob> signature, errBlob;
-  D3D12SerializeRootSignature(&rootSignatureDesc,
-    D3D_ROOT_SIGNATURE_VERSION_1_0, &signature, &errBlob);
-  m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
-}
-
 void HelloGeometryShaderApp::Prepare()
 {
   SetTitle("HelloGeometryShader");
-  CreateRootSignatures();
 
-  m_commandList->Reset(m_commandAllocators[0].Get(), nullptr);
+  m_commandList->Reset(GetCurrentFrame()->GetCommandAllocator().Get(), nullptr);
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(1, heaps);
   m_commandList->Close();
@@ -84,9 +66,6 @@ void HelloGeometryShaderApp::PrepareTeapot()
   std::vector<TeapotModel::Vertex> vertices(std::begin(TeapotModel::TeapotVerticesPN), std::end(TeapotModel::TeapotVerticesPN));
   std::vector<UINT> indices(std::begin(TeapotModel::TeapotIndices), std::end(TeapotModel::TeapotIndices));
   m_model = CreateSimpleModel(vertices, indices);
-
-  auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(ShaderParameters));
-  m_sceneParameterCB = CreateConstantBuffers(cbDesc);
 }
 
 void HelloGeometryShaderApp::PreparePipeline()
@@ -102,74 +81,78 @@ void HelloGeometryShaderApp::PreparePipeline()
     { "NORMAL",     0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
   };
 
-  HRESULT hr;
-  // ʏ탂f`̃pCvC̍\z.
+  // SẴVF[_[ɗvAɃRpC.
+  using Request = ShaderCompileService::Request;
+  auto results = GetShaderCompiler()->Compile({
+    Request{ L"shaderDefault.hlsl", Shader::Vertex, L"mainVS" },
+    Request{ L"shaderDefault.hlsl", Shader::Pixel, L"mainPS" },
+    Request{ L"shaderFlat.hlsl", Shader::Vertex, L"mainVS" },
+    Request{ L"shaderFlat.hlsl", Shader::Geometry, L"mainGS" },
+    Request{ L"shaderFlat.hlsl", Shader::Pixel, L"mainPS" },
+    Request{ L"shaderDrawNormal.hlsl", Shader::Vertex, L"mainVS" },
+    Request{ L"shaderDrawNormal.hlsl", Shader::Geometry, L"mainGS" },
+    Request{ L"shaderDrawNormal.hlsl", Shader::Pixel, L"mainPS" },
+  });
+
+  // 3 ̃pCvCŋL邽߁ASVF[_[̎QƂ܂Ƃ߂[gVOl`.
   {
-    ComPtr<ID3D12PipelineState> pipelineState;
-    Shader shaderVS, shaderPS;
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
+    std::vector<ComPtr<ID3DBlob>> shaders;
+    for (auto& v : results)
+    {
+      shaders.push_back(v.get().getCode());
+    }
+    m_rootSignature = GetRootSignatureCache()->Create(shaders);
+  }
 
-    shaderVS.load(L"shaderDefault.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    shaderPS.load(L"shaderDefault.hlsl", Shader::Pixel, L"mainPS", flags, defines);
+  // ʏ탂f`̃pCvC̍\z.
+  {
+    const auto& shaderVS = results[0].get();
+    const auto& shaderPS = results[1].get();
 
     auto psoDesc = book_util::CreateDefaultPsoDesc(
       DXGI_FORMAT_R8G8B8A8_UNORM,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignature,
+      m_rootSignature.GetRootSignature(),
       shaderVS.getCode(), shaderPS.getCode()
     );
 
-    hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState));
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
+    auto pipelineState = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["drawTeapot"] = pipelineState;
   }
 
   // tbgVF[fBOpCvC̍\z.
   {
-    ComPtr<ID3D12PipelineState> pipelineState;
-    Shader shaderVS, shaderPS, shaderGS;
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
-
-    shaderVS.load(L"shaderFlat.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    shaderGS.load(L"shaderFlat.hlsl", Shader::Geometry, L"mainGS", flags, defines);
-    shaderPS.load(L"shaderFlat.hlsl", Shader::Pixel, L"mainPS", flags, defines);
+    const auto& shaderVS = results[2].get();
+    const auto& shaderGS = results[3].get();
+    const auto& shaderPS = results[4].get();
 
     auto psoDesc = book_util::CreateDefaultPsoDesc(
       m_surfaceFormat,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignature,
+      m_rootSignature.GetRootSignature(),
       shaderVS.getCode(), shaderPS.getCode(), shaderGS.getCode()
     );
 
-    hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState));
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
+    auto pipelineState = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["drawFlat"] = pipelineState;  }
 
   // @`ppCvC̍\z.
   {
-    ComPtr<ID3D12PipelineState> pipelineState;
-    Shader shaderVS, shaderPS, shaderGS;
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
-
-    shaderVS.load(L"shaderDrawNormal.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    shaderGS.load(L"shaderDrawNormal.hlsl", Shader::Geometry, L"mainGS", flags, defines);
-    shaderPS.load(L"shaderDrawNormal.hlsl", Shader::Pixel, L"mainPS", flags, defines);
+    const auto& shaderVS = results[5].get();
+    const auto& shaderGS = results[6].get();
+    const auto& shaderPS = results[7].get();
 
     auto psoDesc = book_util::CreateDefaultPsoDesc(
       m_surfaceFormat,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignature,
+      m_rootSignature.GetRootSignature(),
       shaderVS.getCode(), shaderPS.getCode(), shaderGS.getCode()
     );
 
-    hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState));
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
+    auto pipelineState = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["drawNormalLine"] = pipelineState;
   }
 }
@@ -177,11 +160,7 @@ void HelloGeometryShaderApp::PreparePipeline()
 
 void HelloGeometryShaderApp::Render()
 {
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-  m_commandAllocators[m_frameIndex]->Reset();
-  m_commandList->Reset(
-    m_commandAllocators[m_frameIndex].Get(), nullptr
-  );
+  BeginFrame();
 
   // Xbv`FC\\烌_[^[Qbg`\
   auto barrierToRT = m_swapchain->GetBarrierToRenderTarget();
@@ -218,11 +197,11 @@ void HelloGeometryShaderApp::Render()
   m_commandList->RSSetViewports(1, &viewport);
   m_commandList->RSSetScissorRects(1, &scissorRect);
 
-  auto imageIndex = m_swapchain->GetCurrentBackBufferIndex();
   m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-  WriteToUploadHeapMemory(m_sceneParameterCB[imageIndex].Get(), sizeof(ShaderParameters), &m_scenePatameters);
-  m_commandList->SetGraphicsRootConstantBufferView(0, m_sceneParameterCB[imageIndex]->GetGPUVirtualAddress());
+  auto sceneCB = m_dynamicBuffer->Write(m_scenePatameters);
+  m_commandList->SetGraphicsRootConstantBufferView(m_rootSignature.GetRootIndex("SceneParameter"), sceneCB);
 
+  auto drawScope = m_gpuProfiler->BeginScope(m_commandList.Get(), "GeometryShader");
   if (m_mode == DrawMode_Flat)
   {
     m_commandList->SetPipelineState(m_pipelines["drawFlat"].Get());
@@ -246,8 +225,12 @@ void HelloGeometryShaderApp::Render()
     m_commandList->IASetIndexBuffer(&m_model.ibView);
     m_commandList->DrawIndexedInstanced(m_model.indexCount, 1, 0, 0, 0);
   }
+  m_gpuProfiler->EndScope(m_commandList.Get(), drawScope);
 
-  RenderHUD();
+  {
+    GpuProfiler::Scope scope(m_gpuProfiler.get(), m_commandList.Get(), "HUD");
+    RenderHUD();
+  }
 
   // _[^[QbgXbv`FC\\
   {
@@ -261,9 +244,9 @@ void HelloGeometryShaderApp::Render()
   m_commandList->Close();
   ID3D12CommandList* lists[] = { m_commandList.Get() };
   m_commandQueue->ExecuteCommandLists(1, lists);
+  FinishFrame();
 
   m_swapchain->Present(1, 0);
-  m_swapchain->WaitPreviousFrame(m_commandQueue, m_frameIndex, GpuWaitTimeout);
 }
 
 void HelloGeometryShaderApp::RenderHUD()
@@ -279,6 +262,7 @@ void HelloGeometryShaderApp::RenderHUD()
   ImGui::Text("Framerate %.3f ms", 1000.0f / framerate);
   ImGui::Combo("Mode", (int*)&m_mode, "Flat\0NormalVector\0\0");
   ImGui::End();
+  DrawProfilerHUD();
 
   ImGui::Render();
   ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_commandList.Get());
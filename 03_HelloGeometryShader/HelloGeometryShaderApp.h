@@ -27,7 +27,6 @@ public:
   ShaderParameters m_scenePatameters;
 
 private:
-  void CreateRootSignatures();
   void PrepareTeapot();
   void PreparePipeline();
 
@@ -36,8 +35,7 @@ private:
   ModelData m_model;
   Camera m_camera;
 
-  ComPtr<ID3D12RootSignature> m_rootSignature;
-  std::vector<Buffer> m_sceneParameterCB;
+  RootSignatureLayout m_rootSignature;
 
   using PipelineState = ComPtr<ID3D12PipelineState>;
   std::unordered_map<std::string, PipelineState> m_pipelines;
@@ -1,5 +1,7 @@
 #include "CubemapRenderingApp.h"
 #include "TeapotModel.h"
+#include "ShaderCompileService.h"
+#include "CubemapRenderingShaders.h"
 
 #include "imgui.h"
 #include "examples/imgui_impl_dx12.h"
@@ -27,12 +29,11 @@ void CubemapRenderingApp::Prepare()
 {
   SetTitle("CubemapRendering");
 
-  m_commandList->Reset(m_commandAllocators[0].Get(), nullptr);
+  m_commandList->Reset(GetCurrentFrame()->GetCommandAllocator().Get(), nullptr);
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(1, heaps);
   m_commandList->Close();
   
-  CreateRootSignatures();
   SetInfoQueueFilter();
 
   PrepareTeapot();
@@ -43,6 +44,8 @@ void CubemapRenderingApp::Prepare()
 
 void CubemapRenderingApp::Cleanup()
 {
+  m_heap->UnregisterBindless(m_staticCubemap.resource.Get());
+  m_heap->UnregisterBindless(m_renderCubemap.Get());
 }
 
 void CubemapRenderingApp::OnMouseButtonDown(UINT msg)
@@ -69,76 +72,6 @@ void CubemapRenderingApp::OnMouseMove(UINT msg, int dx, int dy)
   m_camera.OnMouseMove(dx, dy);
 }
 
-void CubemapRenderingApp::CreateRootSignatures()
-{
-  // L[u}bv`掞Ɏgp RootSignature.
-  {
-    std::array<CD3DX12_ROOT_PARAMETER, 2> rootParams;
-    rootParams[0].InitAsConstantBufferView(0);
-    rootParams[1].InitAsConstantBufferView(1);
-
-    CD3DX12_ROOT_SIGNATURE_DESC rsDesc{};
-    rsDesc.Init(
-      UINT(rootParams.size()), rootParams.data(),
-      0, nullptr,
-      D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
-    );
-    ComPtr<ID3DBlob> signature, errBlob;
-    HRESULT hr = D3D12SerializeRootSignature(&rsDesc, D3D_ROOT_SIGNATURE_VERSION_1_0,
-      &signature, &errBlob);
-    ThrowIfFailed(hr, "D3D12SerializeRootSignature failed.");
-
-    RootSignature rootSignature;
-    hr = m_device->CreateRootSignature(
-      0,
-      signature->GetBufferPointer(),
-      signature->GetBufferSize(),
-      IID_PPV_ARGS(&rootSignature)
-    );
-    ThrowIfFailed(hr, "CreateRootSignature failed.");
-    m_rootSignatures["teapots"] = rootSignature;
-    rootSignature->SetName(L"teapots");
-  }
-
-  // L[u}bvQƂĕ`悷邽߂ RootSignature.
-  {
-    array<CD3DX12_ROOT_PARAMETER, 2> rootParams;
-    array<D3D12_DESCRIPTOR_RANGE, 1> texRanges;
-    texRanges[0].NumDescriptors = 1;
-    texRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    texRanges[0].RegisterSpace = 0;
-    texRanges[0].OffsetInDescriptorsFromTableStart = 0;
-    texRanges[0].BaseShaderRegister = 0;
-
-    rootParams[0].InitAsConstantBufferView(0);
-    rootParams[1].InitAsDescriptorTable(UINT(texRanges.size()), texRanges.data());
-
-    array<CD3DX12_STATIC_SAMPLER_DESC, 1> samplerDesc;
-    samplerDesc[0].Init(0);
-
-    CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
-    rootSignatureDesc.Init(
-      UINT(rootParams.size()), rootParams.data(),
-      UINT(samplerDesc.size()), samplerDesc.data(),
-      D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-    ComPtr<ID3DBlob> signature, errBlob;
-    HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc,
-      D3D_ROOT_SIGNATURE_VERSION_1_0, &signature, &errBlob);
-    ThrowIfFailed(hr, "D3D12SerializeRootSignature failed.");
-
-    RootSignature rootSignature;
-    hr = m_device->CreateRootSignature(
-      0, 
-      signature->GetBufferPointer(), 
-      signature->GetBufferSize(), 
-      IID_PPV_ARGS(&rootSignature));
-    ThrowIfFailed(hr, "CreateRootSignature failed.");
-    m_rootSignatures["default"] = rootSignature;
-    rootSignature->SetName(L"default");
-  }
-}
-
 void CubemapRenderingApp::PrepareTeapot()
 {
   std::vector<TeapotModel::Vertex> vertices(std::begin(TeapotModel::TeapotVerticesPN), std::end(TeapotModel::TeapotVerticesPN));
@@ -181,21 +114,6 @@ void CubemapRenderingApp::PrepareSceneResource()
     memcpy(p, &params, sizeof(params));
     m_teapotInstanceParameters->Unmap(0, nullptr);
   }
-
-  // 萔obt@̏.
-  CD3DX12_RESOURCE_DESC cbDesc;
-  cbDesc = CD3DX12_RESOURCE_DESC::Buffer(
-    sizeof(CubeSceneParameters)
-  );
-  m_renderCubemapCB = CreateConstantBuffers(cbDesc);
-
-  cbDesc = CD3DX12_RESOURCE_DESC::Buffer(
-    sizeof(FaceSceneParameters)
-  );
-  m_renderCubemapFacesCB = CreateConstantBuffers(cbDesc, FrameBufferCount * 6);
-
-  cbDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(SceneParameters));
-  m_renderMainCB = CreateConstantBuffers(cbDesc);
 }
 
 
@@ -205,15 +123,29 @@ void CubemapRenderingApp::PrepareRenderCubemap()
     DXGI_FORMAT_R8G8B8A8_UNORM,
     CubeMapEdge, CubeMapEdge, 6, 1, 1, 0,
     D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-  const auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-  HRESULT hr = m_device->CreateCommittedResource(
-    &heapProps,
-    D3D12_HEAP_FLAG_NONE,
-    &desc,
-    D3D12_RESOURCE_STATE_RENDER_TARGET,
-    nullptr,
-    IID_PPV_ARGS(&m_renderCubemap)
-  );
+  auto cubeDepthDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+    DXGI_FORMAT_D32_FLOAT,
+    CubeMapEdge, CubeMapEdge, 6, 1, 1, 0,
+    D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+  CD3DX12_CLEAR_VALUE clearDepthValue{};
+  clearDepthValue.Format = cubeDepthDesc.Format;
+  clearDepthValue.DepthStencil.Depth = 1.0f;
+
+  // `̓pX 0(L[u}bv`)ƃpX 1(C`)AfvX̓pX 0 ݂̂Ŏgp.
+  // dȂ̂ŋL͂ꂸAq[v̕ʂ̗̈ɔzu.
+  std::vector<ResourceAllocator::TransientDesc> transientDescs = {
+    { desc, D3D12_RESOURCE_STATE_RENDER_TARGET, nullptr, 0, 1 },
+    { cubeDepthDesc, D3D12_RESOURCE_STATE_DEPTH_WRITE, &clearDepthValue, 0, 0 },
+  };
+  auto transients = m_resourceAllocator->CreateTransientResources(transientDescs);
+  m_renderCubemap = transients[0];
+  m_renderCubemapDepth = transients[1];
+
+  // zu_[^[Qbg͎gpOɏKv.
+  auto command = CreateCommandList();
+  command->DiscardResource(m_renderCubemap.Get(), nullptr);
+  command->DiscardResource(m_renderCubemapDepth.Get(), nullptr);
+  FinishCommandList(command);
 
   // Cubemap ƂĂ RTV.
   {
@@ -247,22 +179,6 @@ void CubemapRenderingApp::PrepareRenderCubemap()
     m_cubeFaceRTV[i] = handle;
   }
 
-  auto cubeDepthDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-    DXGI_FORMAT_D32_FLOAT,
-    CubeMapEdge, CubeMapEdge, 6, 1, 1, 0,
-    D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
-  CD3DX12_CLEAR_VALUE clearDepthValue{};
-  clearDepthValue.Format = cubeDepthDesc.Format;
-  clearDepthValue.DepthStencil.Depth = 1.0f;
-  
-  hr = m_device->CreateCommittedResource(
-    &heapProps,
-    D3D12_HEAP_FLAG_NONE,
-    &cubeDepthDesc,
-    D3D12_RESOURCE_STATE_DEPTH_WRITE,
-    nullptr,
-    IID_PPV_ARGS(&m_renderCubemapDepth)
-  );
   // Cubemap ƂĂ DSV.
   {
     D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
@@ -305,6 +221,7 @@ void CubemapRenderingApp::PrepareRenderCubemap()
     &srvDesc,
     m_renderCubemapSRV
   );
+  m_heap->RegisterBindless(m_renderCubemap.Get(), m_renderCubemapSRV);
 
   m_cubemapViewport = CD3DX12_VIEWPORT(0.0f, 0.0f, float(CubeMapEdge), float(CubeMapEdge));
   m_cubemapScissor = CD3DX12_RECT(0, 0, LONG(CubeMapEdge), LONG(CubeMapEdge));
@@ -312,20 +229,54 @@ void CubemapRenderingApp::PrepareRenderCubemap()
 
 void CubemapRenderingApp::CreatePipelines()
 {
-  HRESULT hr;
   D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
     { "POSITION",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     { "NORMAL",     0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
   };
 
-  // C`. L[u}bveNX`QƂpCvC.
+  // KvȃVF[_[ɑSėvAɃRpC.
+  // v(̓eB[|bgp renderCubeFace Ȃ) 1 xRpC.
+  using Request = ShaderCompileService::Request;
+  auto compiler = GetShaderCompiler();
+  auto defaultVS = compiler->Compile(Request{ L"shaderDefault.hlsl", Shader::Vertex, L"mainVS" });
+  auto defaultPS = compiler->Compile(Request{ L"shaderDefault.hlsl", Shader::Pixel, L"mainPS" });
+  ShaderCompileService::Result bindlessVS, bindlessPS;
+  if (IsBindlessEnabled())
   {
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
+    // 錾 ShaderBuild ƋL.
+    bindlessVS = compiler->Compile(cubemap_rendering::MakeBindlessRequest(Shader::Vertex, L"mainVS"));
+    bindlessPS = compiler->Compile(cubemap_rendering::MakeBindlessRequest(Shader::Pixel, L"mainPS"));
+  }
+  auto renderFaceVS = compiler->Compile(Request{ L"renderCubeFace.hlsl", Shader::Vertex, L"mainVS" });
+  auto renderFacePS = compiler->Compile(Request{ L"renderCubeFace.hlsl", Shader::Pixel, L"mainPS" });
+  auto teapotsVS = compiler->Compile(Request{ L"renderCubeFace.hlsl", Shader::Vertex, L"mainVS" });
+  auto teapotsPS = compiler->Compile(Request{ L"renderCubeFace.hlsl", Shader::Pixel, L"mainPS" });
+  auto renderCubemapVS = compiler->Compile(Request{ L"renderCubemap.hlsl", Shader::Vertex, L"mainVS" });
+  auto renderCubemapGS = compiler->Compile(Request{ L"renderCubemap.hlsl", Shader::Geometry, L"mainGS" });
+  auto renderCubemapPS = compiler->Compile(Request{ L"renderCubemap.hlsl", Shader::Pixel, L"mainPS" });
+
+  // [gVOl`͊eVF[_[̃tNV.
+  // ̓eB[|bgṕAL[u}bvւ̕`܂߂ 3 ̃pCvCŋL.
+  auto rootSignatureCache = GetRootSignatureCache();
+  RootSignatureCache::Options samplerOptions;
+  samplerOptions.staticSamplers.push_back(CD3DX12_STATIC_SAMPLER_DESC(0));
+  m_rootSignatures["teapots"] = rootSignatureCache->Create({
+    renderFaceVS.get().getCode(), renderFacePS.get().getCode(),
+    renderCubemapVS.get().getCode(), renderCubemapGS.get().getCode(), renderCubemapPS.get().getCode() });
+  m_rootSignatures["default"] = rootSignatureCache->Create({ defaultVS.get().getCode(), defaultPS.get().getCode() }, samplerOptions);
+  if (IsBindlessEnabled())
+  {
+    // b1 ̓eNX`̃CfbNXȂ̂Ń[g萔ɂ.
+    auto bindlessOptions = samplerOptions;
+    bindlessOptions.rootConstants.push_back(RootSignatureCache::RegisterSlot{ 1, 0 });
+    bindlessOptions.flags = D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED;
+    m_rootSignatures["bindless"] = rootSignatureCache->Create({ bindlessVS.get().getCode(), bindlessPS.get().getCode() }, bindlessOptions);
+  }
 
-    Shader shaderVS, shaderPS;
-    shaderVS.load(L"shaderDefault.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    shaderPS.load(L"shaderDefault.hlsl", Shader::Pixel, L"mainPS", flags, defines);
+  // C`. L[u}bveNX`QƂpCvC.
+  {
+    const auto& shaderVS = defaultVS.get();
+    const auto& shaderPS = defaultPS.get();
 
     auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -335,24 +286,39 @@ void CubemapRenderingApp::CreatePipelines()
       DXGI_FORMAT_R8G8B8A8_UNORM,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignatures["default"],
+      m_rootSignatures["default"].GetRootSignature(),
       shaderVS.getCode(), shaderPS.getCode()
     );
 
-    PipelineState pipeline;
-    hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline));
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState failed.");
+    PipelineState pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["default"] = pipeline;
     pipeline->SetName(L"default");
   }
+  // C`̃oChX.
+  if (IsBindlessEnabled())
+  {
+    const auto& shaderVS = bindlessVS.get();
+    const auto& shaderPS = bindlessPS.get();
+
+    auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    rasterizerState.FrontCounterClockwise = true;
+
+    auto psoDesc = book_util::CreateDefaultPsoDesc(
+      DXGI_FORMAT_R8G8B8A8_UNORM,
+      rasterizerState,
+      inputElementDesc, _countof(inputElementDesc),
+      m_rootSignatures["bindless"].GetRootSignature(),
+      shaderVS.getCode(), shaderPS.getCode()
+    );
+
+    PipelineState pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
+    m_pipelines["bindless"] = pipeline;
+    pipeline->SetName(L"bindless");
+  }
 
   // eʕ`ppCvC.
   {
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
-    Shader renderFaceVS, renderFacePS;
-    renderFaceVS.load(L"renderCubeFace.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    renderFacePS.load(L"renderCubeFace.hlsl", Shader::Pixel, L"mainPS", flags, defines);
 
     auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -361,26 +327,17 @@ void CubemapRenderingApp::CreatePipelines()
       DXGI_FORMAT_R8G8B8A8_UNORM,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignatures["teapots"],
-      renderFaceVS.getCode(), renderFacePS.getCode()
+      m_rootSignatures["teapots"].GetRootSignature(),
+      renderFaceVS.get().getCode(), renderFacePS.get().getCode()
     );
 
-    PipelineState pipeline;
-    hr = m_device->CreateGraphicsPipelineState(
-      &psoDesc, IID_PPV_ARGS(&pipeline)
-    );
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState failed.");
+    PipelineState pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["cubeface"] = pipeline;
     pipeline->SetName(L"MultiPass PSO");
   }
 
   // C`A̓eB[|bg`ppCvC.
   {
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
-    Shader renderFaceVS, renderFacePS;
-    renderFaceVS.load(L"renderCubeFace.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    renderFacePS.load(L"renderCubeFace.hlsl", Shader::Pixel, L"mainPS", flags, defines);
 
     auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -389,27 +346,17 @@ void CubemapRenderingApp::CreatePipelines()
       DXGI_FORMAT_R8G8B8A8_UNORM,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignatures["teapots"],
-      renderFaceVS.getCode(), renderFacePS.getCode()
+      m_rootSignatures["teapots"].GetRootSignature(),
+      teapotsVS.get().getCode(), teapotsPS.get().getCode()
     );
 
-    PipelineState pipeline;
-    hr = m_device->CreateGraphicsPipelineState(
-      &psoDesc, IID_PPV_ARGS(&pipeline)
-    );
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState failed.");
+    PipelineState pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["teapots"] = pipeline;
     pipeline->SetName(L"main Teapots PSO");
   }
 
   // L[u}bvAVOpX`ppCvC.
   {
-    std::vector<wstring> flags;
-    std::vector<Shader::DefineMacro> defines;
-    Shader renderCubemapVS, renderCubemapGS, renderCubemapPS;
-    renderCubemapVS.load(L"renderCubemap.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-    renderCubemapGS.load(L"renderCubemap.hlsl", Shader::Geometry, L"mainGS", flags, defines);
-    renderCubemapPS.load(L"renderCubemap.hlsl", Shader::Pixel, L"mainPS", flags, defines);
 
     auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -418,15 +365,11 @@ void CubemapRenderingApp::CreatePipelines()
       DXGI_FORMAT_R8G8B8A8_UNORM,
       rasterizerState,
       inputElementDesc, _countof(inputElementDesc),
-      m_rootSignatures["teapots"],
-      renderCubemapVS.getCode(), renderCubemapPS.getCode(), renderCubemapGS.getCode()
+      m_rootSignatures["teapots"].GetRootSignature(),
+      renderCubemapVS.get().getCode(), renderCubemapPS.get().getCode(), renderCubemapGS.get().getCode()
     );
 
-    PipelineState pipeline;
-    hr = m_device->CreateGraphicsPipelineState(
-      &psoDesc, IID_PPV_ARGS(&pipeline)
-    );
-    ThrowIfFailed(hr, "CreateGraphicsPipelineState failed.");
+    PipelineState pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
     m_pipelines["singleCubemap"] = pipeline;
     pipeline->SetName(L"singlePass PSO");
   }
@@ -434,63 +377,69 @@ void CubemapRenderingApp::CreatePipelines()
 
 void CubemapRenderingApp::Render()
 {
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-  m_commandAllocators[m_frameIndex]->Reset();
-  m_commandList->Reset(
-    m_commandAllocators[m_frameIndex].Get(), nullptr
-  );
+  BeginFrame();
 
-  // Xbv`FC\\烌_[^[Qbg`\
-  auto barrierToRT = m_swapchain->GetBarrierToRenderTarget();
-  m_commandList->ResourceBarrier(1, &barrierToRT);
+  // UI ̍XV͋L^OɃCXbhōs. (`惂[hL^ɕςȂ悤)
+  UpdateHUD();
+  // L^͑SăpX̃Xgōs.
+  m_commandList->Close();
 
-  ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
-  m_commandList->SetDescriptorHeaps(_countof(heaps), heaps);
+  // epXǂݏ郊\[X錾AoA̓Otɋ߂.
+  auto graph = m_renderGraph;
+  graph->Reset();
+  auto backBuffer = m_swapchain->GetImage(m_swapchain->GetCurrentBackBufferIndex());
+  auto resBackBuffer = graph->ImportResource("BackBuffer", backBuffer.Get(),
+    D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+  auto resCubemap = graph->ImportResource("Cubemap", m_renderCubemap.Get(),
+    D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  auto resCubemapDepth = graph->ImportResource("CubemapDepth", m_renderCubemapDepth.Get(),
+    D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
   if (m_mode == Mode_MultiPassCubemap)
   {
-    RenderToEachFace();
+    for (int face = 0; face < 6; ++face)
+    {
+      auto pass = graph->AddPass("CubeFace" + std::to_string(face), [this, face](ID3D12GraphicsCommandList* command) {
+        RenderToFace(command, face);
+      });
+      graph->Write(pass, resCubemap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+      graph->Write(pass, resCubemapDepth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    }
   }
   if (m_mode == Mode_SinglePassCubemap)
   {
-    RenderToCubemapSinglePass();
+    auto pass = graph->AddPass("CubemapSinglePass", [this](ID3D12GraphicsCommandList* command) {
+      RenderToCubemapSinglePass(command);
+    });
+    graph->Write(pass, resCubemap, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph->Write(pass, resCubemapDepth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
   }
-
-  // \[XoA.
-  auto barrierToSRV = CD3DX12_RESOURCE_BARRIER::Transition(
-    m_renderCubemap.Get(),
-    D3D12_RESOURCE_STATE_RENDER_TARGET,
-    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-  );
-  m_commandList->ResourceBarrier(1, &barrierToSRV);
-
-  RenderToMain();
-
-  RenderHUD();
-
-  // _[^[QbgXbv`FC\\
+  auto passMain = graph->AddPass("Main", [this](ID3D12GraphicsCommandList* command) {
+    RenderToMain(command);
+  });
+  if (m_mode != Mode_StaticCubemap)
   {
-    auto barrierToPresent = m_swapchain->GetBarrierToPresent();
-    auto barrierToCubeRT = CD3DX12_RESOURCE_BARRIER::Transition(
-      m_renderCubemap.Get(),
-      D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET
-    );
-    CD3DX12_RESOURCE_BARRIER barriers[] = {
-      barrierToPresent,
-      barrierToCubeRT,
-    };
-
-    m_commandList->ResourceBarrier(_countof(barriers), barriers);
+    graph->Read(passMain, resCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
   }
-  m_commandList->Close();
-  ID3D12CommandList* lists[] = { m_commandList.Get() };
-  m_commandQueue->ExecuteCommandLists(1, lists);
+  graph->Write(passMain, resBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  auto passHUD = graph->AddPass("HUD", [this](ID3D12GraphicsCommandList* command) {
+    RenderHUD(command);
+  });
+  graph->Write(passHUD, resBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+  // pXɕʁX̃R}hXg֕ɋL^邽߁AoA͎gȂ.
+  graph->Compile(false);
+  auto passes = graph->BuildRecordPasses();
+  auto recorded = RecordParallel(passes);
+
+  // L^Ɋ֌WȂAo^ 1 Ŕs.
+  ExecuteCommandLists(recorded);
+  FinishFrame();
 
   m_swapchain->Present(1, 0);
-  m_swapchain->WaitPreviousFrame(m_commandQueue, m_frameIndex, GpuWaitTimeout);
 }
 
-void CubemapRenderingApp::RenderToEachFace()
+void CubemapRenderingApp::RenderToFace(ID3D12GraphicsCommandList* command, int face)
 {
   float clearColor[6][4] = {
     { 1.0f, 0.0f, 0.0f, 1.0f },
@@ -501,53 +450,50 @@ void CubemapRenderingApp::RenderToEachFace()
     { 0.0f, 0.0f, 0.5f, 1.0f },
   };
 
-  m_commandList->SetGraphicsRootSignature(m_rootSignatures["teapots"].Get());
-  m_commandList->SetPipelineState(m_pipelines["cubeface"].Get());
+  // [J[XbhĂ΂邽߁ARei at() ŎQƂ̂ݍs.
+  const auto& teapotsSignature = m_rootSignatures.at("teapots");
+  command->SetGraphicsRootSignature(teapotsSignature.Get());
+  command->SetPipelineState(m_pipelines.at("cubeface").Get());
 
   // r[|[gƃVU[̃Zbg
-  m_commandList->RSSetViewports(1, &m_cubemapViewport);
-  m_commandList->RSSetScissorRects(1, &m_cubemapScissor);
+  command->RSSetViewports(1, &m_cubemapViewport);
+  command->RSSetScissorRects(1, &m_cubemapScissor);
 
-  for (int face = 0; face < 6; ++face)
-  {
-    m_commandList->ClearRenderTargetView(
-      m_cubeFaceRTV[face],
-      clearColor[face], 0, nullptr
-    );
-    m_commandList->ClearDepthStencilView(
-      m_cubeFaceDSV[face],
-      D3D12_CLEAR_FLAG_DEPTH,
-      1.0f, 0, 0, nullptr
-    );
-
-    auto mtxView = GetViewMatrix(face);
-    auto mtxProj = GetProjectionMatrix(45.0f, float(256) / float(256), 0.05f, 100.0f);
+  command->ClearRenderTargetView(
+    m_cubeFaceRTV[face],
+    clearColor[face], 0, nullptr
+  );
+  command->ClearDepthStencilView(
+    m_cubeFaceDSV[face],
+    D3D12_CLEAR_FLAG_DEPTH,
+    1.0f, 0, 0, nullptr
+  );
 
-    auto renderTarget = (D3D12_CPU_DESCRIPTOR_HANDLE)m_cubeFaceRTV[face];
-    auto dsv = (D3D12_CPU_DESCRIPTOR_HANDLE)m_cubeFaceDSV[face];
-    m_commandList->OMSetRenderTargets(1, &renderTarget, FALSE, &dsv);
+  auto mtxView = GetViewMatrix(face);
+  auto mtxProj = GetProjectionMatrix(45.0f, float(256) / float(256), 0.05f, 100.0f);
 
-    FaceSceneParameters cbParams;
-    XMStoreFloat4x4(&cbParams.world, XMMatrixIdentity());
-    XMStoreFloat4x4(&cbParams.viewProj, XMMatrixTranspose(mtxView * mtxProj));
-    XMStoreFloat4(&cbParams.cameraPos, m_camera.GetPosition());
-    XMStoreFloat4(&cbParams.lightDir, m_lightDirection);
+  auto renderTarget = (D3D12_CPU_DESCRIPTOR_HANDLE)m_cubeFaceRTV[face];
+  auto dsv = (D3D12_CPU_DESCRIPTOR_HANDLE)m_cubeFaceDSV[face];
+  command->OMSetRenderTargets(1, &renderTarget, FALSE, &dsv);
 
-    auto cb = m_renderCubemapFacesCB[m_frameIndex * 6 + face];
-    WriteToUploadHeapMemory(cb.Get(), sizeof(cbParams), &cbParams);
+  FaceSceneParameters cbParams;
+  XMStoreFloat4x4(&cbParams.world, XMMatrixIdentity());
+  XMStoreFloat4x4(&cbParams.viewProj, XMMatrixTranspose(mtxView * mtxProj));
+  XMStoreFloat4(&cbParams.cameraPos, m_camera.GetPosition());
+  XMStoreFloat4(&cbParams.lightDir, m_lightDirection);
 
-    // ͂̃eB[|bg`.
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_model.vbView);
-    m_commandList->IASetIndexBuffer(&m_model.ibView);
-    m_commandList->SetGraphicsRootConstantBufferView(0, cb->GetGPUVirtualAddress());
-    m_commandList->SetGraphicsRootConstantBufferView(1, m_teapotInstanceParameters.Get()->GetGPUVirtualAddress());
-    m_commandList->DrawIndexedInstanced(m_model.indexCount, InstanceCount, 0, 0, 0);
+  auto cb = m_dynamicBuffer->Write(cbParams);
 
-  }
+  // ͂̃eB[|bg`.
+  command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  command->IASetVertexBuffers(0, 1, &m_model.vbView);
+  command->IASetIndexBuffer(&m_model.ibView);
+  command->SetGraphicsRootConstantBufferView(teapotsSignature.GetRootIndex("sceneConstants"), cb);
+  command->SetGraphicsRootConstantBufferView(teapotsSignature.GetRootIndex("instanceParameters"), m_teapotInstanceParameters.Get()->GetGPUVirtualAddress());
+  command->DrawIndexedInstanced(m_model.indexCount, InstanceCount, 0, 0, 0);
 }
 
-void CubemapRenderingApp::RenderToCubemapSinglePass()
+void CubemapRenderingApp::RenderToCubemapSinglePass(ID3D12GraphicsCommandList* command)
 {
   float clearColor[6][4] = {
     { 0.75f, 0.75f, 1.0f, 1.0f },
@@ -557,12 +503,13 @@ void CubemapRenderingApp::RenderToCubemapSinglePass()
     { 0.0f, 0.0f, 1.0f, 1.0f },
     { 0.0f, 0.0f, 0.5f, 1.0f },
   };
-  m_commandList->SetGraphicsRootSignature(m_rootSignatures["teapots"].Get());
-  m_commandList->SetPipelineState(m_pipelines["singleCubemap"].Get());
+  const auto& teapotsSignature = m_rootSignatures.at("teapots");
+  command->SetGraphicsRootSignature(teapotsSignature.Get());
+  command->SetPipelineState(m_pipelines.at("singleCubemap").Get());
 
   // r[|[gƃVU[̃Zbg
-  m_commandList->RSSetViewports(1, &m_cubemapViewport);
-  m_commandList->RSSetScissorRects(1, &m_cubemapScissor);
+  command->RSSetViewports(1, &m_cubemapViewport);
+  command->RSSetScissorRects(1, &m_cubemapScissor);
 
   XMMATRIX mtxViews[6];
   XMMATRIX mtxProj = GetProjectionMatrix(45.0f, float(256) / float(256), 0.05f, 100.0f);
@@ -580,52 +527,49 @@ void CubemapRenderingApp::RenderToCubemapSinglePass()
   }
   XMStoreFloat4(&sceneParams.lightDir, m_lightDirection);
 
-  auto cb = m_renderCubemapCB[m_frameIndex].Get();
-
-  WriteToUploadHeapMemory(cb, sizeof(sceneParams), &sceneParams);
+  auto cb = m_dynamicBuffer->Write(sceneParams);
 
   D3D12_CPU_DESCRIPTOR_HANDLE rtv = m_cubemapRTV;
   D3D12_CPU_DESCRIPTOR_HANDLE dsv = m_renderCubemapDSV;
 
-  m_commandList->ClearRenderTargetView(rtv, clearColor[0], 0, nullptr);
-  m_commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+  command->ClearRenderTargetView(rtv, clearColor[0], 0, nullptr);
+  command->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
   
-  m_commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+  command->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
 
   // ͂̃eB[|bg`.
-  m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-  m_commandList->IASetVertexBuffers(0, 1, &m_model.vbView);
-  m_commandList->IASetIndexBuffer(&m_model.ibView);
-  m_commandList->SetGraphicsRootConstantBufferView(0, cb->GetGPUVirtualAddress());
-  m_commandList->SetGraphicsRootConstantBufferView(1, m_teapotInstanceParameters.Get()->GetGPUVirtualAddress());
-  m_commandList->DrawIndexedInstanced(m_model.indexCount, InstanceCount, 0, 0, 0);
+  command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  command->IASetVertexBuffers(0, 1, &m_model.vbView);
+  command->IASetIndexBuffer(&m_model.ibView);
+  command->SetGraphicsRootConstantBufferView(teapotsSignature.GetRootIndex("sceneConstants"), cb);
+  command->SetGraphicsRootConstantBufferView(teapotsSignature.GetRootIndex("instanceParameters"), m_teapotInstanceParameters.Get()->GetGPUVirtualAddress());
+  command->DrawIndexedInstanced(m_model.indexCount, InstanceCount, 0, 0, 0);
 }
 
-void CubemapRenderingApp::RenderToMain()
+void CubemapRenderingApp::RenderToMain(ID3D12GraphicsCommandList* command)
 {
   auto rtv = m_swapchain->GetCurrentRTV();
   auto dsv = m_defaultDepthDSV;
 
   // J[obt@(_[^[Qbgr[)̃NA
   float m_clearColor[4] = { 0.5f,0.75f,1.0f,0 };
-  m_commandList->ClearRenderTargetView(rtv, m_clearColor, 0, nullptr);
+  command->ClearRenderTargetView(rtv, m_clearColor, 0, nullptr);
 
   // fvXobt@(fvXXeVr[)̃NA
-  m_commandList->ClearDepthStencilView(
+  command->ClearDepthStencilView(
     dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
   // `Zbg
   D3D12_CPU_DESCRIPTOR_HANDLE handleRtvs[] = { rtv };
   D3D12_CPU_DESCRIPTOR_HANDLE handleDsv = dsv;
-  m_commandList->OMSetRenderTargets(1, handleRtvs, FALSE, &handleDsv);
+  command->OMSetRenderTargets(1, handleRtvs, FALSE, &handleDsv);
 
   // r[|[gƃVU[̃Zbg
   auto viewport = CD3DX12_VIEWPORT(0.0f, 0.0f, float(m_width), float(m_height));
   auto scissorRect = CD3DX12_RECT(0, 0, LONG(m_width), LONG(m_height));
-  m_commandList->RSSetViewports(1, &viewport);
-  m_commandList->RSSetScissorRects(1, &scissorRect);
+  command->RSSetViewports(1, &viewport);
+  command->RSSetScissorRects(1, &scissorRect);
 
-  auto cb = m_renderMainCB[m_frameIndex];
   auto mtxView = m_camera.GetViewMatrix();
   auto mtxProj = GetProjectionMatrix(45.0f, float(m_width) / float(m_height), 0.1f, 100.0f);
 
@@ -634,39 +578,46 @@ void CubemapRenderingApp::RenderToMain()
   XMStoreFloat4x4(&sceneParams.viewProj, XMMatrixTranspose(mtxView * mtxProj));
   XMStoreFloat4(&sceneParams.cameraPos, m_camera.GetPosition());
   XMStoreFloat4(&sceneParams.lightDir, m_lightDirection);
-  WriteToUploadHeapMemory(cb.Get(), sizeof(sceneParams), &sceneParams);
-
-  m_commandList->SetGraphicsRootSignature(m_rootSignatures["default"].Get());
+  auto cb = m_dynamicBuffer->Write(sceneParams);
 
-  if (m_mode == Mode_StaticCubemap)
+  auto cubemap = m_mode == Mode_StaticCubemap ? m_staticCubemap.resource.Get() : m_renderCubemap.Get();
+  const RootSignatureLayout* rootSignature = nullptr;
+  if (IsBindlessEnabled())
   {
-    m_commandList->SetGraphicsRootDescriptorTable(1, m_staticCubemap.descriptorSRV);
+    // e[u؂ւAQƂL[u}bṽCfbNXn.
+    rootSignature = &m_rootSignatures.at("bindless");
+    command->SetGraphicsRootSignature(rootSignature->Get());
+    command->SetGraphicsRoot32BitConstant(rootSignature->GetRootIndex("drawConstants"), m_heap->GetBindlessIndex(cubemap), 0);
+    command->SetPipelineState(m_pipelines.at("bindless").Get());
   }
   else
   {
-    m_commandList->SetGraphicsRootDescriptorTable(1, m_renderCubemapSRV);
+    rootSignature = &m_rootSignatures.at("default");
+    command->SetGraphicsRootSignature(rootSignature->Get());
+    auto srv = m_mode == Mode_StaticCubemap ? m_staticCubemap.descriptorSRV : m_renderCubemapSRV;
+    command->SetGraphicsRootDescriptorTable(rootSignature->GetRootIndex("texCube"), srv);
+    command->SetPipelineState(m_pipelines.at("default").Get());
   }
+  command->SetGraphicsRootConstantBufferView(rootSignature->GetRootIndex("sceneConstants"), cb);
 
-  m_commandList->SetGraphicsRootConstantBufferView(0, cb->GetGPUVirtualAddress());
-  m_commandList->SetPipelineState(m_pipelines["default"].Get());
-
-  m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-  m_commandList->IASetVertexBuffers(0, 1, &m_model.vbView);
-  m_commandList->IASetIndexBuffer(&m_model.ibView);
-  m_commandList->DrawIndexedInstanced(m_model.indexCount, 1, 0, 0, 0);
+  command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  command->IASetVertexBuffers(0, 1, &m_model.vbView);
+  command->IASetIndexBuffer(&m_model.ibView);
+  command->DrawIndexedInstanced(m_model.indexCount, 1, 0, 0, 0);
 
   // ͂ Teapot `悷.
-  m_commandList->SetGraphicsRootSignature(m_rootSignatures["teapots"].Get());
-  m_commandList->SetPipelineState(m_pipelines["teapots"].Get());
-  m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-  m_commandList->IASetVertexBuffers(0, 1, &m_model.vbView);
-  m_commandList->IASetIndexBuffer(&m_model.ibView);
-  m_commandList->SetGraphicsRootConstantBufferView(0, cb->GetGPUVirtualAddress());
-  m_commandList->SetGraphicsRootConstantBufferView(1, m_teapotInstanceParameters.Get()->GetGPUVirtualAddress());
-  m_commandList->DrawIndexedInstanced(m_model.indexCount, InstanceCount, 0, 0, 0);
+  const auto& teapotsSignature = m_rootSignatures.at("teapots");
+  command->SetGraphicsRootSignature(teapotsSignature.Get());
+  command->SetPipelineState(m_pipelines.at("teapots").Get());
+  command->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  command->IASetVertexBuffers(0, 1, &m_model.vbView);
+  command->IASetIndexBuffer(&m_model.ibView);
+  command->SetGraphicsRootConstantBufferView(teapotsSignature.GetRootIndex("sceneConstants"), cb);
+  command->SetGraphicsRootConstantBufferView(teapotsSignature.GetRootIndex("instanceParameters"), m_teapotInstanceParameters.Get()->GetGPUVirtualAddress());
+  command->DrawIndexedInstanced(m_model.indexCount, InstanceCount, 0, 0, 0);
 }
 
-void CubemapRenderingApp::RenderHUD()
+void CubemapRenderingApp::UpdateHUD()
 {
   ImGui_ImplDX12_NewFrame();
   ImGui_ImplWin32_NewFrame();
@@ -679,10 +630,23 @@ void CubemapRenderingApp::RenderHUD()
   XMStoreFloat3(&cameraPos, m_camera.GetPosition());
   ImGui::Text("CameraPos (%.2f, %.2f, %.2f)", cameraPos.x, cameraPos.y, cameraPos.z);
   ImGui::Combo("Mode", (int*)&m_mode, "Static\0MultiPass\0SinglePass\0\0");
+  ImGui::Text("Bindless %s", IsBindlessEnabled() ? "On" : (IsBindlessSupported() ? "Off" : "Unsupported"));
+  auto heapStats = m_resourceAllocator->GetStatistics();
+  ImGui::Text("Heap %.1f / %.1f MB (Peak %.1f MB)",
+    heapStats.usedSize / (1024.0f*1024.0f), heapStats.reservedSize / (1024.0f*1024.0f), heapStats.peakUsedSize / (1024.0f*1024.0f));
+  ImGui::Text("Fragmentation %.1f %%", heapStats.fragmentation * 100.0f);
+  ImGui::Text("Transient %.1f MB (Unaliased %.1f MB)",
+    heapStats.transientSize / (1024.0f*1024.0f), heapStats.transientUnaliasedSize / (1024.0f*1024.0f));
   ImGui::End();
+  // [h̃pX GPU Ԃrł悤\.
+  DrawProfilerHUD();
 
   ImGui::Render();
-  ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_commandList.Get());
+}
+
+void CubemapRenderingApp::RenderHUD(ID3D12GraphicsCommandList* command)
+{
+  ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), command);
 }
 
 DirectX::XMMATRIX CubemapRenderingApp::GetViewMatrix(int faceIndex)
@@ -730,20 +694,11 @@ CubemapRenderingApp::StaticCubeTexture CubemapRenderingApp::LoadCubeTextureFromF
   ComPtr<ID3D12Resource> cubemap;
   CreateTexture(m_device.Get(), metadata, &cubemap);
 
-  ComPtr<ID3D12Resource> srcBuffer;
   std::vector<D3D12_SUBRESOURCE_DATA> subresources;
   PrepareUpload(m_device.Get(), image.GetImages(), image.GetImageCount(), metadata, subresources);
-  const auto totalBytes = GetRequiredIntermediateSize(cubemap.Get(), 0, UINT(subresources.size()));
 
-  auto staging = CreateResource(CD3DX12_RESOURCE_DESC::Buffer(totalBytes), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, D3D12_HEAP_TYPE_UPLOAD);
-  auto command = CreateCommandList();
-  UpdateSubresources(command.Get(),
-    cubemap.Get(), staging.Get(), 0, 0, UINT(subresources.size()), subresources.data());
-  auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-    cubemap.Get(),
-    D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  command->ResourceBarrier(1, &barrier);
-  FinishCommandList(command);
+  // ]̓Rs[L[֐ςނ.  COMMON  SRV ֈÖقɏi.
+  m_uploadQueue->UploadTexture(cubemap.Get(), subresources.data(), UINT(subresources.size()));
 
   auto descriptorSRV = GetDescriptorManager()->Alloc();
   D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
@@ -758,6 +713,7 @@ CubemapRenderingApp::StaticCubeTexture CubemapRenderingApp::LoadCubeTextureFromF
   StaticCubeTexture ret;
   cubemap.As(&ret.resource);
   ret.descriptorSRV = descriptorSRV;
+  GetDescriptorManager()->RegisterBindless(ret.resource.Get(), descriptorSRV);
   return ret;
 }
 
@@ -18,16 +18,18 @@ public:
   virtual void OnMouseButtonUp(UINT msg);
   virtual void OnMouseMove(UINT msg, int dx, int dy);
 private:
-  void CreateRootSignatures();
   void PrepareTeapot();
   void PrepareSceneResource();
   void PrepareRenderCubemap();
   void CreatePipelines();
 
-  void RenderToMain();
-  void RenderHUD();
-  void RenderToEachFace();
-  void RenderToCubemapSinglePass();
+  // 以下はワーカースレッドで記録される.
+  void RenderToMain(ID3D12GraphicsCommandList* command);
+  void RenderHUD(ID3D12GraphicsCommandList* command);
+  void RenderToFace(ID3D12GraphicsCommandList* command, int face);
+  void RenderToCubemapSinglePass(ID3D12GraphicsCommandList* command);
+
+  void UpdateHUD();
 
   void SetInfoQueueFilter();
 
@@ -47,8 +49,7 @@ private:
   ModelData m_model;
   Camera m_camera;
 
-  using RootSignature = ComPtr<ID3D12RootSignature>;
-  std::unordered_map<std::string, RootSignature> m_rootSignatures;
+  std::unordered_map<std::string, RootSignatureLayout> m_rootSignatures;
   using PipelineState = ComPtr<ID3D12PipelineState>;
   std::unordered_map<std::string, PipelineState> m_pipelines;
 
@@ -99,10 +100,6 @@ private:
   CD3DX12_VIEWPORT m_cubemapViewport;
   CD3DX12_RECT m_cubemapScissor;
 
-  std::vector<Buffer> m_renderCubemapFacesCB;
-  std::vector<Buffer> m_renderCubemapCB;
-  std::vector<Buffer> m_renderMainCB;
-
   DirectX::XMVECTOR m_lightDirection;
 
   enum Mode {
@@ -0,0 +1,27 @@
+#pragma once
+#include "Shader.h"
+#include "ShaderManifest.h"
+
+// CubemapRenderingApp と ShaderBuild が共有するシェーダーの宣言.
+namespace cubemap_rendering
+{
+  // -bindless の描画に使う版. SM 6.6 の ResourceDescriptorHeap でテクスチャを参照する.
+  inline ShaderCompileRequest MakeBindlessRequest(Shader::Stage stage, const std::wstring& entryPoint)
+  {
+    ShaderCompileRequest request;
+    request.fileName = L"shaderDefault.hlsl";
+    request.stage = stage;
+    request.entryPoint = entryPoint;
+    request.defines = { { L"BINDLESS", L"1" } };
+    request.shaderModel = L"6_6";
+    return request;
+  }
+
+  inline ShaderManifest GetShaderManifest()
+  {
+    ShaderManifest manifest;
+    manifest.shaders.push_back(MakeBindlessRequest(Shader::Vertex, L"mainVS"));
+    manifest.shaders.push_back(MakeBindlessRequest(Shader::Pixel, L"mainPS"));
+    return manifest;
+  }
+}
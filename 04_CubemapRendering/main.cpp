@@ -24,6 +24,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wp, LPARAM lp)
   case WM_PAINT:
     if (pApp)
     {
+      CPU_PROFILE_SCOPE("Render");
       pApp->Render();
     }
     return 0;
@@ -20,7 +20,16 @@ struct SceneParameters
 };
 
 ConstantBuffer<SceneParameters> sceneConstants : register(b0);
+#if BINDLESS
+// テクスチャはテーブルではなく、ヒープ内のインデックスをルート定数で受け取る.
+struct DrawConstants
+{
+  uint textureIndex;
+};
+ConstantBuffer<DrawConstants> drawConstants : register(b1);
+#else
 TextureCube texCube : register(t0);
+#endif
 SamplerState samp : register(s0);
 
 
@@ -42,5 +51,8 @@ PSInput mainVS( VSInput In )
 
 float4 mainPS(PSInput In) : SV_TARGET
 {
+#if BINDLESS
+  TextureCube texCube = ResourceDescriptorHeap[drawConstants.textureIndex];
+#endif
   return In.Color * texCube.Sample(samp,In.Reflect);
 }
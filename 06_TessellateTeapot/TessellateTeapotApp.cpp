@@ -28,38 +28,13 @@ void TessellateTeapotApp::Prepare()
 {
   SetTitle("Tessellate Teapot");
 
-  m_commandList->Reset(m_commandAllocators[0].Get(), nullptr);
+  m_commandList->Reset(GetCurrentFrame()->GetCommandAllocator().Get(), nullptr);
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(1, heaps);
   m_commandList->Close();
   
-  CreateRootSignatures();
   PrepareTessellateTeapot();
   PreparePipeline();
-
-  auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(
-    sizeof(SceneParameters)
-  );
-  m_mainSceneCB = CreateConstantBuffers(cbDesc);
-}
-
-void TessellateTeapotApp::CreateRootSignatures()
-{
-  // RootSignature
-  array<CD3DX12_ROOT_PARAMETER, 1> rootParams;
-  rootParams[0].InitAsConstantBufferView(0);
-
-  CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
-  rootSignatureDesc.Init(
-    UINT(rootParams.size()), rootParams.data(),
-    0, nullptr,
-    D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-  ComPtr<ID3DBlob> signature, errBlob;
-  D3D12SerializeRootSignature(&rootSignatureDesc,
-    D3D_ROOT_SIGNATURE_VERSION_1_0, &signature, &errBlob);
-  m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSigunature));
-
 }
 
 void TessellateTeapotApp::Cleanup()
@@ -93,11 +68,7 @@ void TessellateTeapotApp::OnMouseMove(UINT msg, int dx, int dy)
 void TessellateTeapotApp::Render()
 {
 
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-  m_commandAllocators[m_frameIndex]->Reset();
-  m_commandList->Reset(
-    m_commandAllocators[m_frameIndex].Get(), nullptr
-  );
+  BeginFrame();
 
   // Xbv`FC\\烌_[^[Qbg`\
   auto barrierToRT = m_swapchain->GetBarrierToRenderTarget();
@@ -106,9 +77,14 @@ void TessellateTeapotApp::Render()
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(_countof(heaps), heaps);
 
-  RenderToMain();
-
-  RenderHUD();
+  {
+    GpuProfiler::Scope scope(m_gpuProfiler.get(), m_commandList.Get(), "Tessellation");
+    RenderToMain();
+  }
+  {
+    GpuProfiler::Scope scope(m_gpuProfiler.get(), m_commandList.Get(), "HUD");
+    RenderHUD();
+  }
 
   // _[^[QbgXbv`FC\\
   {
@@ -122,9 +98,9 @@ void TessellateTeapotApp::Render()
   m_commandList->Close();
   ID3D12CommandList* lists[] = { m_commandList.Get() };
   m_commandQueue->ExecuteCommandLists(1, lists);
+  FinishFrame();
 
   m_swapchain->Present(1, 0);
-  m_swapchain->WaitPreviousFrame(m_commandQueue, m_frameIndex, GpuWaitTimeout);
 }
 
 void TessellateTeapotApp::RenderToMain()
@@ -152,7 +128,6 @@ void TessellateTeapotApp::RenderToMain()
   m_commandList->RSSetViewports(1, &viewport);
   m_commandList->RSSetScissorRects(1, &scissorRect);
 
-  auto sceneCB = m_mainSceneCB[m_frameIndex];
   auto mtxView = m_camera.GetViewMatrix();
   auto mtxProj = GetProjectionMatrix(45.0f, float(m_width) / float(m_height), 0.1f, 100.0f);
 
@@ -163,11 +138,10 @@ void TessellateTeapotApp::RenderToMain()
   sceneParams.tessFactor.x = m_tessFactor;
   sceneParams.tessFactor.y = m_tessFactor;
 
-  WriteToUploadHeapMemory(sceneCB.Get(), sizeof(sceneParams), &sceneParams);
-
+  auto sceneCB = m_dynamicBuffer->Write(sceneParams);
 
   m_commandList->SetGraphicsRootSignature(m_rootSigunature.Get());
-  m_commandList->SetGraphicsRootConstantBufferView(0, sceneCB->GetGPUVirtualAddress());
+  m_commandList->SetGraphicsRootConstantBufferView(m_rootSigunature.GetRootIndex("sceneConstants"), sceneCB);
   
   if (m_isWireframe)
   {
@@ -200,6 +174,7 @@ void TessellateTeapotApp::RenderHUD()
   ImGui::SliderFloat("Tessfactor", &m_tessFactor, 1.0f, 32.0f);
   ImGui::Checkbox("WireFrame", &m_isWireframe);
   ImGui::End();
+  DrawProfilerHUD();
 
   ImGui::Render();
   ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_commandList.Get());
@@ -233,7 +208,8 @@ void TessellateTeapotApp::PreparePipeline()
   shaderPS.load(L"teapotTessellation.hlsl", Shader::Pixel, L"mainPS", flags, defines);
   shaderHS.load(L"teapotTessellation.hlsl", Shader::Hull, L"mainHS", flags, defines);
   shaderDS.load(L"teapotTessellation.hlsl", Shader::Domain, L"mainDS", flags, defines);
-
+  m_rootSigunature = GetRootSignatureCache()->Create({
+    shaderVS.getCode(), shaderPS.getCode(), shaderHS.getCode(), shaderDS.getCode() });
 
   auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
   rasterizerState.CullMode = D3D12_CULL_MODE_BACK;
@@ -242,7 +218,7 @@ void TessellateTeapotApp::PreparePipeline()
     DXGI_FORMAT_R8G8B8A8_UNORM,
     rasterizerState,
     inputElementDesc, _countof(inputElementDesc),
-    m_rootSigunature.Get(),
+    m_rootSigunature.GetRootSignature(),
     shaderVS.getCode(), 
     shaderPS.getCode(),
     nullptr,
@@ -251,17 +227,11 @@ void TessellateTeapotApp::PreparePipeline()
   );
   psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
 
-
-  HRESULT hr;
-
-  PipelineState pipeline;
-  hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline));
-  ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
+  PipelineState pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
   m_pipelines["default"] = pipeline;
 
   psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-  hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline));
-  ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
+  pipeline = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
   m_pipelines["wireframe"] = pipeline;
 }
 
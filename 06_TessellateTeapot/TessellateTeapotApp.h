@@ -19,7 +19,6 @@ public:
   virtual void OnMouseButtonUp(UINT msg);
   virtual void OnMouseMove(UINT msg, int dx, int dy);
 private:
-  void CreateRootSignatures();
   void PrepareTessellateTeapot();
   void PreparePipeline();
 
@@ -42,10 +41,7 @@ private:
   using PipelineState = ComPtr<ID3D12PipelineState>;
   std::unordered_map<std::string, PipelineState> m_pipelines;
 
-  ComPtr<ID3D12RootSignature> m_rootSigunature;
-
-  using Buffer = ComPtr<ID3D12Resource1>;
-  std::vector<Buffer> m_mainSceneCB;
+  RootSignatureLayout m_rootSigunature;
 
   float m_tessFactor;
   ModelData m_tessTeapot;
@@ -7,6 +7,8 @@
 #include <DirectXTex.h>
 #include <fstream>
 
+#include "ShaderArchive.h"
+
 using namespace std;
 using namespace DirectX;
 
@@ -18,6 +20,7 @@ TessellateGroundApp::TessellateGroundApp()
   );
 
   m_isWireframe = false;
+  m_useNormalBias = true;
   m_tessRangeNear = 16.0f;
   m_tessRangeFar = 100.0f;
   m_tessRangeNormalFactor = 4.0f;
@@ -26,9 +29,8 @@ TessellateGroundApp::TessellateGroundApp()
 void TessellateGroundApp::Prepare()
 {
   SetTitle("Ground Tessellation");
-  CreateRootSignatures();
 
-  m_commandList->Reset(m_commandAllocators[0].Get(), nullptr);
+  m_commandList->Reset(GetCurrentFrame()->GetCommandAllocator().Get(), nullptr);
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(1, heaps);
   m_commandList->Close();
@@ -36,92 +38,94 @@ void TessellateGroundApp::Prepare()
   PrepareGroundPatch();
   PreparePipeline();
 
-  auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(
-    sizeof(MainSceneParameters)
-  );
-  m_mainSceneCB = CreateConstantBuffers(cbDesc);
-
-  m_heightMap = LoadTextureFromFile(L"heightmap.png");
-  m_normalMap = LoadTextureFromFile(L"normalmap.png");
+  // }bvƖ@}bv͘ÄɒuA1 ̃e[uƂĐݒ肷.
+  m_groundTextures = m_heap->Alloc(2);
+  m_heightMap = LoadTextureFromFile(L"heightmap.png", m_groundTextures[0]);
+  m_normalMap = LoadTextureFromFile(L"normalmap.png", m_groundTextures[1]);
 }
 
-void TessellateGroundApp::CreateRootSignatures()
+void TessellateGroundApp::PreparePipeline()
 {
-  // RootSignature
-  array<CD3DX12_ROOT_PARAMETER, 3> rootParams;
-  array<CD3DX12_DESCRIPTOR_RANGE, 2> texParams;
-  rootParams[0].InitAsConstantBufferView(0);
-
-  rootParams[1].InitAsDescriptorTable(1, &texParams[0]);
-  rootParams[2].InitAsDescriptorTable(1, &texParams[1]);
-
-  texParams[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
-  texParams[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
-
-  array<CD3DX12_STATIC_SAMPLER_DESC, 1> samplerDesc;
-  samplerDesc[0].Init(0);
-
-
-  CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
-  rootSignatureDesc.Init(
-    UINT(rootParams.size()), rootParams.data(),
-    UINT(samplerDesc.size()), samplerDesc.data(),
-    D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+  // 錾 ShaderBuild ƋL.
+  m_shaderPermutations = tessellate_ground::GetShaderPermutations();
 
-  ComPtr<ID3DBlob> signature, errBlob;
-  D3D12SerializeRootSignature(&rootSignatureDesc,
-    D3D_ROOT_SIGNATURE_VERSION_1_0, &signature, &errBlob);
-  m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
+  for (auto& v : BuildPipelines(m_rootSignature))
+  {
+    m_pipelines[v.first] = v.second;
+  }
+  // VF[_[ꂽ蒼.
+  // `摤̃[gVOl`͍ւȂ߁A\[X̎QƂςꍇ͎sƂĈ.
+  GetShaderHotReload()->Watch({ L"groundTessellation.hlsl" }, [this]() {
+    RootSignatureLayout rootSignature;
+    auto pipelines = BuildPipelines(rootSignature);
+    if (rootSignature.GetHash() != m_rootSignature.GetHash())
+    {
+      throw std::runtime_error("root signature changed. restart to apply.");
+    }
+    return pipelines;
+  });
 }
 
-void TessellateGroundApp::PreparePipeline()
+ShaderHotReload::Pipelines TessellateGroundApp::BuildPipelines(RootSignatureLayout& rootSignature)
 {
   D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
     { "POSITION",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     { "TEXCOORD",   0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
   };
 
-  std::vector<wstring> flags;
-  std::vector<Shader::DefineMacro> defines;
-  defines.push_back(
-    Shader::DefineMacro{ L"PATCH_QUAD", L"1" }
-  );
+  // SoAg̓A[JCuɂ܂Ƃ߂ĂAN͎ʑ邾ōς܂.
+  auto archive = ShaderArchive::LoadOrBuild(m_shaderPermutations, tessellate_ground::ArchiveFileName, GetWorkerThreads());
+  const auto& set = m_shaderPermutations;
+  auto shaderVS = archive->Find(Shader::Vertex, L"mainVS", 0);
+  auto shaderPS = archive->Find(Shader::Pixel, L"mainPS", 0);
+  auto shaderDS = archive->Find(Shader::Domain, L"mainDS", 0);
+  std::vector<ComPtr<ID3DBlob>> shaderHS;
+  for (uint32_t key = 0; key < set.GetVariantCount(); ++key)
+  {
+    shaderHS.push_back(archive->Find(Shader::Hull, L"mainHS", key));
+  }
 
-  Shader shaderVS, shaderPS, shaderHS, shaderDS;
-  shaderVS.load(L"groundTessellation.hlsl", Shader::Vertex, L"mainVS", flags, defines);
-  shaderPS.load(L"groundTessellation.hlsl", Shader::Pixel, L"mainPS", flags, defines);
-  shaderHS.load(L"groundTessellation.hlsl", Shader::Hull, L"mainHS", flags, defines);
-  shaderDS.load(L"groundTessellation.hlsl", Shader::Domain, L"mainDS", flags, defines);
-
-
-  auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-  auto psoDesc = book_util::CreateDefaultPsoDesc(
-    DXGI_FORMAT_R8G8B8A8_UNORM,
-    rasterizerState,
-    inputElementDesc, _countof(inputElementDesc),
-    m_rootSignature.Get(),
-    shaderVS.getCode(),
-    shaderPS.getCode(),
-    nullptr,
-    shaderHS.getCode(),
-    shaderDS.getCode()
-  );
-  psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
+  // t0:}bv, t1:@}bv  1 ̃e[uɂȂ.
+  // ǂ̃oAgł[gVOl`g悤ASẴtNV.
+  RootSignatureCache::Options options;
+  options.staticSamplers.push_back(CD3DX12_STATIC_SAMPLER_DESC(0));
+  std::vector<ComPtr<ID3DBlob>> shaders = { shaderVS, shaderPS, shaderDS };
+  shaders.insert(shaders.end(), shaderHS.begin(), shaderHS.end());
+  rootSignature = GetRootSignatureCache()->Create(shaders, options);
 
-  HRESULT hr;
-  PipelineState pipeline;
-  hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline));
-  ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
-  m_pipelines["default"] = pipeline;
-  
-  psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-  hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline));
-  ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
-  m_pipelines["wireframe"] = pipeline;
+  ShaderHotReload::Pipelines pipelines;
+  for (uint32_t key = 0; key < set.GetVariantCount(); ++key)
+  {
+    auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    auto psoDesc = book_util::CreateDefaultPsoDesc(
+      DXGI_FORMAT_R8G8B8A8_UNORM,
+      rasterizerState,
+      inputElementDesc, _countof(inputElementDesc),
+      rootSignature.GetRootSignature(),
+      shaderVS,
+      shaderPS,
+      nullptr,
+      shaderHS[key],
+      shaderDS
+    );
+    psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
+
+    pipelines[GetPipelineName(false, key)] = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
+
+    psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+    pipelines[GetPipelineName(true, key)] = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
+  }
+  return pipelines;
+}
+
+std::string TessellateGroundApp::GetPipelineName(bool isWireframe, uint32_t permutationKey)
+{
+  return (isWireframe ? "wireframe#" : "default#") + std::to_string(permutationKey);
 }
 
 void TessellateGroundApp::Cleanup()
 {
+  m_heap->Free(m_groundTextures);
 }
 
 void TessellateGroundApp::OnMouseButtonDown(UINT msg)
@@ -200,11 +204,8 @@ void TessellateGroundApp::PrepareGroundPatch()
 
 void TessellateGroundApp::Render()
 {
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-  m_commandAllocators[m_frameIndex]->Reset();
-  m_commandList->Reset(
-    m_commandAllocators[m_frameIndex].Get(), nullptr
-  );
+  BeginFrame();
+  ApplyReloadedPipelines(m_pipelines);
 
   // Xbv`FC\\烌_[^[Qbg`\
   auto barrierToRT = m_swapchain->GetBarrierToRenderTarget();
@@ -213,9 +214,14 @@ void TessellateGroundApp::Render()
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(_countof(heaps), heaps);
 
-  RenderToMain();
-
-  RenderImGui();
+  {
+    GpuProfiler::Scope scope(m_gpuProfiler.get(), m_commandList.Get(), "Tessellation");
+    RenderToMain();
+  }
+  {
+    GpuProfiler::Scope scope(m_gpuProfiler.get(), m_commandList.Get(), "HUD");
+    RenderImGui();
+  }
 
   // _[^[QbgXbv`FC\\
   {
@@ -229,9 +235,9 @@ void TessellateGroundApp::Render()
   m_commandList->Close();
   ID3D12CommandList* lists[] = { m_commandList.Get() };
   m_commandQueue->ExecuteCommandLists(1, lists);
+  FinishFrame();
 
   m_swapchain->Present(1, 0);
-  m_swapchain->WaitPreviousFrame(m_commandQueue, m_frameIndex, GpuWaitTimeout);
 }
 
 void TessellateGroundApp::RenderToMain()
@@ -258,7 +264,6 @@ void TessellateGroundApp::RenderToMain()
   m_commandList->RSSetViewports(1, &viewport);
   m_commandList->RSSetScissorRects(1, &scissorRect);
 
-  auto sceneCB = m_mainSceneCB[m_frameIndex];
   auto mtxView = m_camera.GetViewMatrix();
   auto mtxProj = GetProjectionMatrix(45.0f, float(m_width) / float(m_height), 0.1f, 500.0f);
 
@@ -270,22 +275,14 @@ void TessellateGroundApp::RenderToMain()
   sceneParams.tessRange.y = m_tessRangeFar;
   sceneParams.tessRange.z = m_tessRangeNormalFactor;
 
-  WriteToUploadHeapMemory(sceneCB.Get(), sizeof(sceneParams), &sceneParams);
-
+  auto sceneCB = m_dynamicBuffer->Write(sceneParams);
 
   m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-  m_commandList->SetGraphicsRootConstantBufferView(0, sceneCB->GetGPUVirtualAddress());
-  m_commandList->SetGraphicsRootDescriptorTable(1, m_heightMap.handle);
-  m_commandList->SetGraphicsRootDescriptorTable(2, m_normalMap.handle);
+  m_commandList->SetGraphicsRootConstantBufferView(m_rootSignature.GetRootIndex("sceneConstants"), sceneCB);
+  m_commandList->SetGraphicsRootDescriptorTable(m_rootSignature.GetRootIndex("texHeightMap"), m_groundTextures);
 
-  if (m_isWireframe)
-  {
-    m_commandList->SetPipelineState(m_pipelines["wireframe"].Get());
-  }
-  else
-  {
-    m_commandList->SetPipelineState(m_pipelines["default"].Get());
-  }
+  uint32_t permutationKey = m_useNormalBias ? m_shaderPermutations.GetKey({ L"NORMAL_BIAS" }) : 0;
+  m_commandList->SetPipelineState(m_pipelines[GetPipelineName(m_isWireframe, permutationKey)].Get());
 
   m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST);
   m_commandList->IASetVertexBuffers(0, 1, &m_ground.vbView);
@@ -307,11 +304,13 @@ void TessellateGroundApp::RenderImGui()
   ImGui::Text("CameraPos (%.2f, %.2f, %.2f)", cameraPos.x, cameraPos.y, cameraPos.z);
 
   ImGui::Checkbox("WireFrame", &m_isWireframe);
+  ImGui::Checkbox("NormalBias", &m_useNormalBias);
   ImGui::Spacing();
   ImGui::InputFloat("RangeNear", &m_tessRangeNear, 0.5f, 5.0f, "%.1f");
   ImGui::InputFloat("RangeFar", &m_tessRangeFar, 0.5f, 5.0f, "%.1f");
   ImGui::InputFloat("NormalFactor", &m_tessRangeNormalFactor, 0.1f, 0.2f, "%.1f");
   ImGui::End();
+  DrawProfilerHUD();
 
   ImGui::Render();
   ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_commandList.Get());
@@ -323,7 +322,7 @@ DirectX::XMMATRIX TessellateGroundApp::GetProjectionMatrix(float fov, float aspe
   return mtxProj;
 }
 
-TessellateGroundApp::TextureData TessellateGroundApp::LoadTextureFromFile(const std::wstring& name)
+TessellateGroundApp::TextureData TessellateGroundApp::LoadTextureFromFile(const std::wstring& name, const DescriptorHandle& handle)
 {
   DirectX::TexMetadata metadata;
   DirectX::ScratchImage image;
@@ -345,24 +344,15 @@ TessellateGroundApp::TextureData TessellateGroundApp::LoadTextureFromFile(const
   ComPtr<ID3D12Resource> texture;
   CreateTexture(m_device.Get(), metadata, &texture);
 
-  Buffer srcBuffer;
   std::vector<D3D12_SUBRESOURCE_DATA> subresources;
   PrepareUpload(m_device.Get(), image.GetImages(), image.GetImageCount(), metadata, subresources);
-  const auto totalBytes = GetRequiredIntermediateSize(texture.Get(), 0, UINT(subresources.size()));
-
-  auto staging = CreateResource(CD3DX12_RESOURCE_DESC::Buffer(totalBytes), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, D3D12_HEAP_TYPE_UPLOAD);
-  auto command = CreateCommandList();
-  UpdateSubresources(command.Get(),
-    texture.Get(), staging.Get(), 0, 0, UINT(subresources.size()), subresources.data());
-  auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-    texture.Get(),
-    D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  command->ResourceBarrier(1, &barrier);
-  FinishCommandList(command);
+
+  // ]̓Rs[L[֐ςނ.  COMMON  SRV ֈÖقɏi.
+  m_uploadQueue->UploadTexture(texture.Get(), subresources.data(), UINT(subresources.size()));
 
   TextureData texData;
   texture.As(&texData.texture);
-  texData.handle = m_heap->Alloc();
+  texData.handle = handle;
 
   D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
   srvDesc.Format = metadata.format;
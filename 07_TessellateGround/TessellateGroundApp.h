@@ -2,6 +2,8 @@
 #include "D3D12AppBase.h"
 #include "DirectXMath.h"
 #include "Camera.h"
+#include "ShaderArchive.h"
+#include "TessellateGroundShaders.h"
 
 #include <array>
 #include <unordered_map>
@@ -19,9 +21,12 @@ public:
   virtual void OnMouseButtonUp(UINT msg);
   virtual void OnMouseMove(UINT msg, int dx, int dy);
 private:
-  void CreateRootSignatures();
   void PrepareGroundPatch();
   void PreparePipeline();
+  // 監視スレッドからも呼ばれる. メンバーは読むだけにすること.
+  // 使ったルートシグネチャを rootSignature に返す.
+  ShaderHotReload::Pipelines BuildPipelines(RootSignatureLayout& rootSignature);
+  static std::string GetPipelineName(bool isWireframe, uint32_t permutationKey);
 
   void RenderToMain();
   void RenderImGui();
@@ -32,7 +37,8 @@ private:
     Texture texture;
     DescriptorHandle handle;
   };
-  TextureData LoadTextureFromFile(const std::wstring& name);
+  // handle の位置に SRV を作成する.
+  TextureData LoadTextureFromFile(const std::wstring& name, const DescriptorHandle& handle);
 
 
   using Buffer = ComPtr<ID3D12Resource1>;
@@ -54,16 +60,18 @@ private:
     DirectX::XMFLOAT4   tessRange;
   };
 
-  ComPtr<ID3D12RootSignature> m_rootSignature;
+  // groundTessellation.hlsl のバリアントの宣言. 起動後は変更しない.
+  ShaderPermutationSet m_shaderPermutations;
+  RootSignatureLayout m_rootSignature;
 
   using PipelineState = ComPtr<ID3D12PipelineState>;
   std::unordered_map<std::string, PipelineState> m_pipelines;
 
-  std::vector<Buffer> m_mainSceneCB;
-
   TextureData m_heightMap;
   TextureData m_normalMap;
+  DescriptorRange m_groundTextures;
   bool m_isWireframe;
+  bool m_useNormalBias;
   float m_tessRangeNear, m_tessRangeFar;
   float m_tessRangeNormalFactor;
 
@@ -0,0 +1,32 @@
+#pragma once
+#include "ShaderArchive.h"
+#include "ShaderManifest.h"
+
+// TessellateGroundApp と ShaderBuild が共有するシェーダーの宣言.
+namespace tessellate_ground
+{
+  const wchar_t* const ArchiveFileName = L"groundTessellation.shar";
+
+  // 法線による分割数の補正はハルシェーダーのみが使う.
+  inline ShaderPermutationSet GetShaderPermutations()
+  {
+    ShaderPermutationSet set;
+    set.fileName = L"groundTessellation.hlsl";
+    set.axes = { L"NORMAL_BIAS" };
+    set.defines = { Shader::DefineMacro{ L"PATCH_QUAD", L"1" } };
+    set.entryPoints = {
+      { Shader::Vertex, L"mainVS", 0 },
+      { Shader::Pixel, L"mainPS", 0 },
+      { Shader::Hull, L"mainHS", set.GetKey({ L"NORMAL_BIAS" }) },
+      { Shader::Domain, L"mainDS", 0 },
+    };
+    return set;
+  }
+
+  inline ShaderManifest GetShaderManifest()
+  {
+    ShaderManifest manifest;
+    manifest.archives.emplace_back(ArchiveFileName, GetShaderPermutations());
+    return manifest;
+  }
+}
@@ -1,3 +1,8 @@
+// 1 ȂAn`̌ŃGbW̕␳. 0 Ȃ狗݂̂Ō߂.
+#ifndef NORMAL_BIAS
+#define NORMAL_BIAS 1
+#endif
+
 struct VSInput
 {
   float4 Position : POSITION;
@@ -95,21 +100,27 @@ HSParameters ComputePatchConstants(InputPatch<HSInput, 4> patch)
       int idx0 = indices[i][0];
       int idx1 = indices[i][1];
       v[i] = 0.5 * (patch[idx0].Position + patch[idx1].Position);
+#if NORMAL_BIAS
       float2 uv = 0.5*(patch[idx0].UV + patch[idx1].UV);
       n[i] = texNormalMap.SampleLevel(mapSampler, uv, 0).xyz;
       n[i] = normalize(n[i] - 0.5);
+#endif
     }
 
     outParams.tessFactor[0] =  CalcTessFactor(v[0]);
     outParams.tessFactor[2] =  CalcTessFactor(v[2]);
+#if NORMAL_BIAS
     outParams.tessFactor[0] += CalcNormalBias(v[0].xyz, n[0].xyz);
     outParams.tessFactor[2] += CalcNormalBias(v[2].xyz, n[2].xyz);
+#endif
     outParams.insideFactor[0] = 0.5 * (outParams.tessFactor[0] + outParams.tessFactor[2]);
 
     outParams.tessFactor[1] =  CalcTessFactor(v[1]);
     outParams.tessFactor[3] =  CalcTessFactor(v[3]);
+#if NORMAL_BIAS
     outParams.tessFactor[1] += CalcNormalBias(v[1].xyz, n[1].xyz);
     outParams.tessFactor[3] += CalcNormalBias(v[3].xyz, n[3].xyz);
+#endif
     outParams.insideFactor[1] = 0.5 * (outParams.tessFactor[1] + outParams.tessFactor[3]);
   }
   
@@ -37,48 +37,77 @@ float4 mainPS(PSInput In) : SV_TARGET
 Texture2D<float4> sourceImage : register(t0);
 RWTexture2D<float4> destinationImage : register(u0);
 
+// フィルタの演算は half で行う. -enable-16bit-types なら 16 ビット、そうでなければ float と同じ.
+// USE_WAVE_OPS ならソーベルフィルタの左右の列を隣のレーンから受け取り、テクスチャの読み込みを減らす.
+#ifndef USE_WAVE_OPS
+#define USE_WAVE_OPS 0
+#endif
+
 [numthreads(16,16,1)]
 void mainSepia( uint3 dtid : SV_DispatchThreadID)
 {
   if (dtid.x < 1280 && dtid.y < 720)
   {
-    float3x3 toSepia = float3x3(
+    half3x3 toSepia = half3x3(
       0.393, 0.349, 0.272,
       0.769, 0.686, 0.534,
       0.189, 0.168, 0.131);
-    float3 color = mul(sourceImage[dtid.xy].xyz, toSepia);
+    half3 color = mul(half3(sourceImage[dtid.xy].xyz), toSepia);
     destinationImage[dtid.xy] = float4(color, 1);
   }
 }
 
-[numthreads(1, 1, 1)]
-void mainSobel(uint3 dtid : SV_DispatchThreadID)
+// x 列の y-1 ～ y+1 の 3 画素. 範囲外は 0 になる.
+void LoadColumn(int x, int y, out half3 column[3])
 {
-  if (dtid.x < 1280 && dtid.y < 720)
+  for (int i = 0; i < 3; ++i)
   {
-    int k = 0;
-    float3 pixels[9];
-    for (int y = -1; y <= 1; ++y)
-    {
-      for (int x = -1; x <= 1; ++x)
-      {
-        float2 index = dtid.xy;
-        index += float2(x, y);
+    column[i] = half3(sourceImage[int2(x, y + i - 1)].xyz);
+  }
+}
 
-        pixels[k] = sourceImage[index].xyz;
-        k++;
-      }
-    }
+[numthreads(16, 16, 1)]
+void mainSobel(uint3 dtid : SV_DispatchThreadID)
+{
+  half3 left[3], center[3], right[3];
+  LoadColumn(dtid.x, dtid.y, center);
+#if USE_WAVE_OPS
+  // レーンの並びは決まっていないので、隣のレーンが隣の画素を処理しているときだけ受け取る.
+  // 範囲外のスレッドも含めた全レーンで実行し、無効なレーンから読まないようにする.
+  uint lane = WaveGetLaneIndex();
+  uint lastLane = WaveGetLaneCount() - 1;
+  uint2 leftPos = WaveReadLaneAt(dtid.xy, lane == 0 ? 0 : lane - 1);
+  uint2 rightPos = WaveReadLaneAt(dtid.xy, lane == lastLane ? lastLane : lane + 1);
+  bool hasLeft = lane != 0 && all(leftPos == uint2(dtid.x - 1, dtid.y));
+  bool hasRight = lane != lastLane && all(rightPos == uint2(dtid.x + 1, dtid.y));
+  for (int i = 0; i < 3; ++i)
+  {
+    left[i] = WaveReadLaneAt(center[i], lane == 0 ? 0 : lane - 1);
+    right[i] = WaveReadLaneAt(center[i], lane == lastLane ? lastLane : lane + 1);
+  }
+  if (!hasLeft)
+  {
+    LoadColumn(int(dtid.x) - 1, dtid.y, left);
+  }
+  if (!hasRight)
+  {
+    LoadColumn(dtid.x + 1, dtid.y, right);
+  }
+#else
+  LoadColumn(int(dtid.x) - 1, dtid.y, left);
+  LoadColumn(dtid.x + 1, dtid.y, right);
+#endif
 
-    float3 sobelH, sobelV;
-    sobelH = pixels[0] * -1 + pixels[2] * 1
-      + pixels[3] * -2 + pixels[5] * 2
-      + pixels[6] * -1 + pixels[8] * 1;
-    sobelV = pixels[0] * -1 + pixels[1] * -2 + pixels[2] * -1
-      + pixels[6] * 1 + pixels[7] * 2 + pixels[8] * 1;
+  if (dtid.x < 1280 && dtid.y < 720)
+  {
+    half3 sobelH, sobelV;
+    sobelH = left[0] * -1 + right[0] * 1
+      + left[1] * -2 + right[1] * 2
+      + left[2] * -1 + right[2] * 1;
+    sobelV = left[0] * -1 + center[0] * -2 + right[0] * -1
+      + left[2] * 1 + center[2] * 2 + right[2] * 1;
 
     float4 color = float4(sqrt(sobelV * sobelV + sobelH * sobelH), 1);
     destinationImage[dtid.xy] = color;
   }
 }
-
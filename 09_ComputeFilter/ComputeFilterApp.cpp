@@ -1,4 +1,5 @@
 #include "ComputeFilterApp.h"
+#include "ComputeFilterShaders.h"
 
 #include "imgui.h"
 #include "examples/imgui_impl_dx12.h"
@@ -18,9 +19,8 @@ ComputeFilterApp::ComputeFilterApp()
 void ComputeFilterApp::Prepare()
 {
   SetTitle("ComputeFilter");
-  CreateRootSignatures();
 
-  m_commandList->Reset(m_commandAllocators[0].Get(), nullptr);
+  m_commandList->Reset(GetCurrentFrame()->GetCommandAllocator().Get(), nullptr);
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(1, heaps);
   m_commandList->Close();
@@ -28,40 +28,32 @@ void ComputeFilterApp::Prepare()
   PrepareSimpleModel();
   PrepareComputeFilter();
   PreparePipeline();
-
-  auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(
-    sizeof(SceneParameters)
-  );
-  m_mainSceneCB = CreateConstantBuffers(cbDesc);
 }
 
-void ComputeFilterApp::CreateRootSignatures()
+void ComputeFilterApp::PreparePipeline()
 {
-  // RootSignature
-  D3D12_DESCRIPTOR_RANGE descSrv{};
-  descSrv.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-  descSrv.BaseShaderRegister = 0;
-  descSrv.NumDescriptors = 1;
-  array<CD3DX12_ROOT_PARAMETER, 2> rootParams;
-  rootParams[0].InitAsConstantBufferView(0);
-  rootParams[1].InitAsDescriptorTable(1, &descSrv);
-
-  array<CD3DX12_STATIC_SAMPLER_DESC, 1> samplerDesc;
-  samplerDesc[0].Init(0);
-
-  CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
-  rootSignatureDesc.Init(
-    UINT(rootParams.size()), rootParams.data(),
-    UINT(samplerDesc.size()), samplerDesc.data(),
-    D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-  ComPtr<ID3DBlob> signature, errBlob;
-  D3D12SerializeRootSignature(&rootSignatureDesc,
-    D3D_ROOT_SIGNATURE_VERSION_1_0, &signature, &errBlob);
-  m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
+  // tB^̓foCX̋@\ɍ킹łg. ł̐錾 ShaderBuild ƋL.
+  m_sepiaVariant = Shader::SelectVariant(compute_filter::GetSepiaVariants(), GetShaderFeatures());
+  m_sobelVariant = Shader::SelectVariant(compute_filter::GetSobelVariants(), GetShaderFeatures());
+
+  for (auto& v : BuildPipelines(m_rootSignature, m_csSignature))
+  {
+    m_pipelines[v.first] = v.second;
+  }
+  // `pAtB^pƂt@ĈŁAꂽ܂Ƃ߂č蒼.
+  // `摤̃[gVOl`͍ւȂ߁A\[X̎QƂςꍇ͎sƂĈ.
+  GetShaderHotReload()->Watch({ L"ComputeFilter.hlsl" }, [this]() {
+    RootSignatureLayout rootSignature, csSignature;
+    auto pipelines = BuildPipelines(rootSignature, csSignature);
+    if (rootSignature.GetHash() != m_rootSignature.GetHash() || csSignature.GetHash() != m_csSignature.GetHash())
+    {
+      throw std::runtime_error("root signature changed. restart to apply.");
+    }
+    return pipelines;
+  });
 }
 
-void ComputeFilterApp::PreparePipeline()
+ShaderHotReload::Pipelines ComputeFilterApp::BuildPipelines(RootSignatureLayout& rootSignature, RootSignatureLayout& csSignature)
 {
   D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
     { "POSITION",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -75,6 +67,9 @@ void ComputeFilterApp::PreparePipeline()
   shaderVS.load(L"ComputeFilter.hlsl", Shader::Vertex, L"mainVS", flags, defines);
   shaderPS.load(L"ComputeFilter.hlsl", Shader::Pixel, L"mainPS", flags, defines);
 
+  RootSignatureCache::Options options;
+  options.staticSamplers.push_back(CD3DX12_STATIC_SAMPLER_DESC(0));
+  rootSignature = GetRootSignatureCache()->Create({ shaderVS.getCode(), shaderPS.getCode() }, options);
 
   auto rasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
   rasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -83,19 +78,42 @@ void ComputeFilterApp::PreparePipeline()
     DXGI_FORMAT_R8G8B8A8_UNORM,
     rasterizerState,
     inputElementDesc, _countof(inputElementDesc),
-    m_rootSignature,
+    rootSignature.GetRootSignature(),
     shaderVS.getCode(), shaderPS.getCode()
   );
 
-  HRESULT hr;
-  PipelineState pipeline;
-  hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipeline));
-  ThrowIfFailed(hr, "CreateGraphicsPipelineState Failed.");
-  m_pipelines["default"] = pipeline;
+  ShaderHotReload::Pipelines pipelines;
+  pipelines["default"] = GetPipelineCache()->CreateGraphicsPipeline(psoDesc);
+
+  Shader shaderCS0, shaderCS1;
+  shaderCS0.load(compute_filter::ShaderFileName, Shader::Compute, L"mainSepia", m_sepiaVariant);
+  shaderCS1.load(compute_filter::ShaderFileName, Shader::Compute, L"mainSobel", m_sobelVariant);
+  // 2 ̃tB^ŋL. t0, u0 ̏ 1 ̃e[uɂȂ.
+  csSignature = GetRootSignatureCache()->Create({ shaderCS0.getCode(), shaderCS1.getCode() });
+  {
+    D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc{};
+    computeDesc.CS = CD3DX12_SHADER_BYTECODE(shaderCS0.getCode().Get());
+    computeDesc.pRootSignature = csSignature.Get();
+
+    pipelines["sepiaCS"] = GetPipelineCache()->CreateComputePipeline(computeDesc);
+  }
+
+  {
+    D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc{};
+    computeDesc.CS = CD3DX12_SHADER_BYTECODE(shaderCS1.getCode().Get());
+    computeDesc.pRootSignature = csSignature.Get();
+    
+    pipelines["sobelCS"] = GetPipelineCache()->CreateComputePipeline(computeDesc);
+  }
+  return pipelines;
 }
 
 void ComputeFilterApp::Cleanup()
 {
+  m_uavState.Reset();
+  m_stagingHeap->Free(m_texture.handleRead);
+  m_stagingHeap->Free(m_uavTexture.handleRead);
+  m_stagingHeap->Free(m_uavTexture.handleWrite);
 }
 
 void ComputeFilterApp::PrepareSimpleModel()
@@ -128,40 +146,64 @@ void ComputeFilterApp::PrepareSimpleModel()
 
 void ComputeFilterApp::Render()
 {
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-  m_commandAllocators[m_frameIndex]->Reset();
-  m_commandList->Reset(
-    m_commandAllocators[m_frameIndex].Get(), nullptr
-  );
-
-  // Xbv`FC\\烌_[^[Qbg`\
-  auto barrierToRT = m_swapchain->GetBarrierToRenderTarget();
-  m_commandList->ResourceBarrier(1, &barrierToRT);
+  BeginFrame();
+  ApplyReloadedPipelines(m_pipelines);
 
   ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
   m_commandList->SetDescriptorHeaps(_countof(heaps), heaps);
 
-  RenderToMain();
-
-  RenderHUD();
-
-  // _[^[QbgXbv`FC\\
-  {
-    auto barrierToPresent = m_swapchain->GetBarrierToPresent();
-    CD3DX12_RESOURCE_BARRIER barriers[] = {
-      barrierToPresent,
-    };
-
-    m_commandList->ResourceBarrier(_countof(barriers), barriers);
-  }
+  // tB^ʂ̓ǂݏ錾AoA̓Otɋ߂.
+  auto graph = m_renderGraph;
+  graph->Reset();
+  auto backBuffer = m_swapchain->GetImage(m_swapchain->GetCurrentBackBufferIndex());
+  auto resBackBuffer = graph->ImportResource("BackBuffer", backBuffer.Get(),
+    D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+  auto resFiltered = graph->ImportResource("Filtered", m_uavState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+  auto passFilter = graph->AddPass("Filter", [this](ID3D12GraphicsCommandList*) { RenderFilter(); });
+  graph->Write(passFilter, resFiltered, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+  auto passMain = graph->AddPass("Main", [this](ID3D12GraphicsCommandList*) { RenderToMain(); });
+  graph->Read(passMain, resFiltered, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+  graph->Write(passMain, resBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+  auto passHUD = graph->AddPass("HUD", [this](ID3D12GraphicsCommandList*) { RenderHUD(); });
+  graph->Write(passHUD, resBackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+  // 1 ̃Xg֋L^̂ŁAobNobt@̑Jڂ̓tB^Əd˂ĕ.
+  graph->Compile(true);
+  graph->Execute(m_commandList.Get());
 
   m_commandList->Close();
   
   ID3D12CommandList* lists[] = { m_commandList.Get() };
   m_commandQueue->ExecuteCommandLists(1, lists);
+  FinishFrame();
 
   m_swapchain->Present(1, 0);
-  m_swapchain->WaitPreviousFrame(m_commandQueue, m_frameIndex, GpuWaitTimeout);
+}
+
+void ComputeFilterApp::RenderFilter()
+{
+  m_commandList->SetComputeRootSignature(m_csSignature.Get());
+  if (m_mode == Mode_Sepia)
+  {
+    m_commandList->SetPipelineState(m_pipelines["sepiaCS"].Get());
+  }
+  if (m_mode == Mode_Sobel)
+  {
+    m_commandList->SetPipelineState(m_pipelines["sobelCS"].Get());
+  }
+
+  // t0, u0 ̃e[ũt[pɑgݗĂ.
+  D3D12_CPU_DESCRIPTOR_HANDLE filterViews[] = {
+    m_stagingHeap->GetCpuHandle(m_texture.handleRead),
+    m_stagingHeap->GetCpuHandle(m_uavTexture.handleWrite)
+  };
+  auto filterTable = m_descriptorRing->CopyToTable(filterViews);
+  m_commandList->SetComputeRootDescriptorTable(m_csSignature.GetRootIndex("sourceImage"), filterTable);
+  // ǂ̃tB^ 16x16 Xbh̃O[v.
+  int groupX = (1280 + 15) / 16;
+  int groupY = (720 + 15) / 16;
+  m_commandList->Dispatch(groupX, groupY, 1);
 }
 
 void ComputeFilterApp::RenderToMain()
@@ -188,64 +230,29 @@ void ComputeFilterApp::RenderToMain()
   m_commandList->RSSetViewports(1, &viewport);
   m_commandList->RSSetScissorRects(1, &scissorRect);
 
-  auto sceneCB = m_mainSceneCB[m_frameIndex];
   auto mtxProj = XMMatrixOrthographicLH(1280.0f, 720.0f, 0.0f, 10.0f);
 
   SceneParameters sceneParams{};
   XMStoreFloat4x4(&sceneParams.proj, XMMatrixTranspose(mtxProj));
 
-  WriteToUploadHeapMemory(sceneCB.Get(), sizeof(sceneParams), &sceneParams);
-
-  m_commandList->SetComputeRootSignature(m_csSignature.Get());
-  if (m_mode == Mode_Sepia)
-  {
-    m_commandList->SetPipelineState(m_pipelines["sepiaCS"].Get());
-  }
-  if (m_mode == Mode_Sobel)
-  {
-    m_commandList->SetPipelineState(m_pipelines["sobelCS"].Get());
-  }
-
-  m_commandList->SetComputeRootDescriptorTable(
-    0, m_texture.handleRead
-  );
-  m_commandList->SetComputeRootDescriptorTable(
-    1, m_uavTexture.handleWrite
-  );
-  int groupX = 1280 / 16 + 1;
-  int groupY = 720 / 16 + 1;
-  m_commandList->Dispatch(1280, 720, 1);
-
-  // UAV -> SRV փXe[gύX.
-  auto barrierUAVtoSRV = CD3DX12_RESOURCE_BARRIER::Transition(
-    m_uavTexture.texture.Get(),
-    D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-  );
-  m_commandList->ResourceBarrier(1, &barrierUAVtoSRV);
+  auto sceneCB = m_dynamicBuffer->Write(sceneParams);
 
   m_commandList->SetPipelineState(m_pipelines["default"].Get());
   m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
   m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
   m_commandList->IASetIndexBuffer(&m_quad.ibView);
   m_commandList->IASetVertexBuffers(0, 1, &m_quad.vbView);
-  m_commandList->SetGraphicsRootConstantBufferView(0, sceneCB->GetGPUVirtualAddress());
-  m_commandList->SetGraphicsRootDescriptorTable(1, m_texture.handleRead);
+  const auto sceneIndex = m_rootSignature.GetRootIndex("sceneConstants");
+  const auto imageIndex = m_rootSignature.GetRootIndex("imageTex");
+  m_commandList->SetGraphicsRootConstantBufferView(sceneIndex, sceneCB);
+  m_commandList->SetGraphicsRootDescriptorTable(imageIndex, m_descriptorRing->CopyRange(m_stagingHeap->GetCpuHandle(m_texture.handleRead), 1));
   m_commandList->DrawIndexedInstanced(4, 1, 0, 0, 0);
 
   m_commandList->IASetIndexBuffer(&m_quad2.ibView);
   m_commandList->IASetVertexBuffers(0, 1, &m_quad2.vbView);
-  m_commandList->SetGraphicsRootConstantBufferView(0, sceneCB->GetGPUVirtualAddress());
-  m_commandList->SetGraphicsRootDescriptorTable(1, m_uavTexture.handleRead);
+  m_commandList->SetGraphicsRootConstantBufferView(sceneIndex, sceneCB);
+  m_commandList->SetGraphicsRootDescriptorTable(imageIndex, m_descriptorRing->CopyRange(m_stagingHeap->GetCpuHandle(m_uavTexture.handleRead), 1));
   m_commandList->DrawIndexedInstanced(4, 1, 0, 0, 0);
-
-  // SRV -> UAV փXe[g߂
-  auto barrierSRVtoUAV = CD3DX12_RESOURCE_BARRIER::Transition(
-    m_uavTexture.texture.Get(),
-    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-    D3D12_RESOURCE_STATE_UNORDERED_ACCESS
-  );
-  m_commandList->ResourceBarrier(1, &barrierSRVtoUAV);
 }
 
 void ComputeFilterApp::RenderHUD()
@@ -259,8 +266,14 @@ void ComputeFilterApp::RenderHUD()
   ImGui::Text("Framerate %.3f ms", 1000.0f / framerate);
 
   ImGui::Combo("Filter", (int*)&m_mode, "Sepia Filter\0Sobel Filter\0\0");
+  const auto& features = GetShaderFeatures();
+  ImGui::Text("SM %d.%d, 16bit ops %s, wave ops %s (%u lanes)",
+    features.highestShaderModel >> 4, features.highestShaderModel & 0xF,
+    features.native16BitOps ? "Yes" : "No", features.waveOps ? "Yes" : "No", features.waveLaneCountMin);
+  ImGui::Text("Sepia: %s, Sobel: %s", m_sepiaVariant.name.c_str(), m_sobelVariant.name.c_str());
   ImGui::Spacing();
   ImGui::End();
+  DrawProfilerHUD();
 
   ImGui::Render();
   ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), m_commandList.Get());
@@ -268,34 +281,33 @@ void ComputeFilterApp::RenderHUD()
 
 void ComputeFilterApp::PrepareComputeFilter()
 {
-  m_texture = LoadTextureFromFile(L"dx12_vol1-alicia.tga");
+  // r[̓Xe[WOp̃q[vɍA`掞ɕKvȑgݍ킹Ńe[uփRs[.
+  m_texture = LoadTextureFromFile(L"dx12_vol1-alicia.tga", m_stagingHeap->AllocId());
 
   const UINT width = 1280, height = 720;
   auto texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height);
   texDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-  const auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-  HRESULT hr = m_device->CreateCommittedResource(
-    &heapProps,
-    D3D12_HEAP_FLAG_NONE,
-    &texDesc,
+  m_uavTexture.texture = CreateResource(
+    texDesc,
     D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
     nullptr,
-    IID_PPV_ARGS(&m_uavTexture.texture)
+    D3D12_HEAP_TYPE_DEFAULT
   );
-  ThrowIfFailed(hr, "CreateCommittedResource failed.");
+  // ȍ~̏Ԃ͒ǐՑŊǗ.
+  m_uavState = TrackResource(m_uavTexture.texture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
   D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
   uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
   uavDesc.Format = texDesc.Format;
   uavDesc.Texture2D.MipSlice = 0;
   uavDesc.Texture2D.PlaneSlice = 0;
-  m_uavTexture.handleWrite = m_heap->Alloc();
+  m_uavTexture.handleWrite = m_stagingHeap->AllocId();
   m_device->CreateUnorderedAccessView(
     m_uavTexture.texture.Get(),
     nullptr,
     &uavDesc,
-    m_uavTexture.handleWrite
+    m_stagingHeap->GetCpuHandle(m_uavTexture.handleWrite)
   );
 
   D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
@@ -303,68 +315,15 @@ void ComputeFilterApp::PrepareComputeFilter()
   srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
   srvDesc.Texture2D.MipLevels = 1;
   srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-  m_uavTexture.handleRead = m_heap->Alloc();
+  m_uavTexture.handleRead = m_stagingHeap->AllocId();
   m_device->CreateShaderResourceView(
     m_uavTexture.texture.Get(),
     &srvDesc,
-    m_uavTexture.handleRead
+    m_stagingHeap->GetCpuHandle(m_uavTexture.handleRead)
   );
-
-  {
-    D3D12_DESCRIPTOR_RANGE descRange0{}, descRange1{};
-    descRange0.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    descRange0.NumDescriptors = 1;
-    descRange0.BaseShaderRegister = 0;
-    descRange1.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-    descRange1.NumDescriptors = 1;
-    descRange1.BaseShaderRegister = 0;
-    array<CD3DX12_ROOT_PARAMETER, 2> rootParams;
-    rootParams[0].InitAsDescriptorTable(1, &descRange0);
-    rootParams[1].InitAsDescriptorTable(1, &descRange1);
-
-    CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc{};
-    rootSignatureDesc.Init(
-      UINT(rootParams.size()), rootParams.data(),
-      0, nullptr,
-      D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-    ComPtr<ID3DBlob> signature, errBlob;
-    D3D12SerializeRootSignature(&rootSignatureDesc,
-      D3D_ROOT_SIGNATURE_VERSION_1_0, &signature, &errBlob);
-    hr = m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_csSignature));
-    ThrowIfFailed(hr, "CreateRootSignature failed.");
-  }
-
-  std::vector<std::wstring> flags;
-  std::vector<Shader::DefineMacro> defines;
-  Shader shaderCS0;
-  shaderCS0.load(L"ComputeFilter.hlsl", Shader::Compute, L"mainSepia", flags, defines);
-  {
-    D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc{};
-    computeDesc.CS = CD3DX12_SHADER_BYTECODE(shaderCS0.getCode().Get());
-    computeDesc.pRootSignature = m_csSignature.Get();
-
-    PipelineState pipeline;
-    hr = m_device->CreateComputePipelineState(&computeDesc, IID_PPV_ARGS(&pipeline));
-    ThrowIfFailed(hr, "CreateComputePipelineState failed.");
-    m_pipelines["sepiaCS"] = pipeline;
-  }
-
-  Shader shaderCS1;
-  shaderCS1.load(L"ComputeFilter.hlsl", Shader::Compute, L"mainSobel", flags, defines);
-  {
-    D3D12_COMPUTE_PIPELINE_STATE_DESC computeDesc{};
-    computeDesc.CS = CD3DX12_SHADER_BYTECODE(shaderCS1.getCode().Get());
-    computeDesc.pRootSignature = m_csSignature.Get();
-    
-    PipelineState pipeline;
-    hr = m_device->CreateComputePipelineState(&computeDesc, IID_PPV_ARGS(&pipeline));
-    ThrowIfFailed(hr, "CreateComputePipelineState failed.");
-    m_pipelines["sobelCS"] = pipeline;
-  }
 }
 
-ComputeFilterApp::TextureData ComputeFilterApp::LoadTextureFromFile(const std::wstring& name)
+ComputeFilterApp::TextureData ComputeFilterApp::LoadTextureFromFile(const std::wstring& name, DescriptorId handle)
 {
   DirectX::TexMetadata metadata;
   DirectX::ScratchImage image;
@@ -388,24 +347,15 @@ ComputeFilterApp::TextureData ComputeFilterApp::LoadTextureFromFile(const std::w
   ComPtr<ID3D12Resource> texture;
   CreateTextureEx(m_device.Get(), metadata, resFlags,false, &texture);
 
-  Buffer srcBuffer;
   std::vector<D3D12_SUBRESOURCE_DATA> subresources;
   PrepareUpload(m_device.Get(), image.GetImages(), image.GetImageCount(), metadata, subresources);
-  const auto totalBytes = GetRequiredIntermediateSize(texture.Get(), 0, UINT(subresources.size()));
-
-  auto staging = CreateResource(CD3DX12_RESOURCE_DESC::Buffer(totalBytes), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, D3D12_HEAP_TYPE_UPLOAD);
-  auto command = CreateCommandList();
-  UpdateSubresources(command.Get(),
-    texture.Get(), staging.Get(), 0, 0, UINT(subresources.size()), subresources.data());
-  auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-    texture.Get(),
-    D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  command->ResourceBarrier(1, &barrier);
-  FinishCommandList(command);
+
+  // ]̓Rs[L[֐ςނ.  COMMON  SRV ֈÖقɏi.
+  m_uploadQueue->UploadTexture(texture.Get(), subresources.data(), UINT(subresources.size()));
 
   TextureData texData;
   texture.As(&texData.texture);
-  texData.handleRead = m_heap->Alloc();
+  texData.handleRead = handle;
 
   D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
   srvDesc.Format = metadata.format;
@@ -414,7 +364,7 @@ ComputeFilterApp::TextureData ComputeFilterApp::LoadTextureFromFile(const std::w
   srvDesc.TextureCube.ResourceMinLODClamp = 0;
   srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
   srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-  m_device->CreateShaderResourceView(texture.Get(), &srvDesc, texData.handleRead);
+  m_device->CreateShaderResourceView(texture.Get(), &srvDesc, m_stagingHeap->GetCpuHandle(texData.handleRead));
 
   return texData;
 }
@@ -17,11 +17,14 @@ public:
   virtual void Render();
 
 private:
-  void CreateRootSignatures();
   void PrepareComputeFilter();
   void PrepareSimpleModel();
   void PreparePipeline();
+  // 監視スレッドからも呼ばれる. メンバーは読むだけにすること.
+  // 使ったルートシグネチャを描画用、フィルタ用の順に返す.
+  ShaderHotReload::Pipelines BuildPipelines(RootSignatureLayout& rootSignature, RootSignatureLayout& csSignature);
 
+  void RenderFilter();
   void RenderToMain();
   void RenderHUD();
 
@@ -36,10 +39,12 @@ private:
   struct TextureData
   {
     Texture texture;
-    DescriptorHandle handleRead;
-    DescriptorHandle handleWrite;
+    // ステージング用ヒープ内のビュー.
+    DescriptorId handleRead;
+    DescriptorId handleWrite;
   };
-  TextureData LoadTextureFromFile(const std::wstring& name);
+  // handle の位置に SRV を作成する.
+  TextureData LoadTextureFromFile(const std::wstring& name, DescriptorId handle);
 
   ModelData m_quad, m_quad2;
 
@@ -49,14 +54,16 @@ private:
   };
   using PipelineState = ComPtr<ID3D12PipelineState>;
 
-  ComPtr<ID3D12RootSignature> m_rootSignature;
+  RootSignatureLayout m_rootSignature;
   std::unordered_map<std::string, PipelineState> m_pipelines;
 
-  std::vector<Buffer> m_mainSceneCB;
-
-  ComPtr<ID3D12RootSignature> m_csSignature;
+  RootSignatureLayout m_csSignature;
+  // PreparePipeline で選んだフィルタの版.
+  Shader::Variant m_sepiaVariant;
+  Shader::Variant m_sobelVariant;
   TextureData m_texture;
   TextureData m_uavTexture;
+  TrackedResource m_uavState;
 
   enum Mode
   {
@@ -0,0 +1,45 @@
+#pragma once
+#include "Shader.h"
+#include "ShaderManifest.h"
+
+// ComputeFilterApp と ShaderBuild が共有するシェーダーの宣言.
+namespace compute_filter
+{
+  const wchar_t* const ShaderFileName = L"ComputeFilter.hlsl";
+
+  // フィルタの版. デバイスの機能で選ぶので、優先する順に並べて最後に何も要求しない版を置く.
+  inline std::vector<Shader::Variant> GetFilterVariants(bool useWaveOps)
+  {
+    const Shader::DefineMacro waveOps{ L"USE_WAVE_OPS", L"1" };
+    std::vector<Shader::Variant> variants;
+    if (useWaveOps)
+    {
+      variants.push_back({ "16bit+wave", D3D_SHADER_MODEL_6_2, true, true, { waveOps } });
+    }
+    variants.push_back({ "16bit", D3D_SHADER_MODEL_6_2, true, false, {} });
+    if (useWaveOps)
+    {
+      variants.push_back({ "wave", D3D_SHADER_MODEL_6_0, false, true, { waveOps } });
+    }
+    variants.push_back({ "scalar", D3D_SHADER_MODEL_6_0, false, false, {} });
+    return variants;
+  }
+  // ソーベルフィルタのみ隣の画素を Wave 命令で受け取れる.
+  inline std::vector<Shader::Variant> GetSepiaVariants() { return GetFilterVariants(false); }
+  inline std::vector<Shader::Variant> GetSobelVariants() { return GetFilterVariants(true); }
+
+  // 実行するデバイスで選ばれる版が分からないため、全ての版を用意する.
+  inline ShaderManifest GetShaderManifest()
+  {
+    ShaderManifest manifest;
+    for (const auto& v : GetSepiaVariants())
+    {
+      manifest.shaders.push_back(Shader::MakeRequest(ShaderFileName, Shader::Compute, L"mainSepia", v));
+    }
+    for (const auto& v : GetSobelVariants())
+    {
+      manifest.shaders.push_back(Shader::MakeRequest(ShaderFileName, Shader::Compute, L"mainSobel", v));
+    }
+    return manifest;
+  }
+}
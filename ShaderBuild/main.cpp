@@ -0,0 +1,446 @@
+﻿#if _MSC_VER > 1922 && !defined(_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING)
+#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
+#endif
+#include "Shader.h"
+#include "ShaderArchive.h"
+#include "ShaderCache.h"
+#include "ShaderCompileService.h"
+#include "ShaderManifest.h"
+#include "ShaderReflectionData.h"
+#include "../04_CubemapRendering/CubemapRenderingShaders.h"
+#include "../07_TessellateGround/TessellateGroundShaders.h"
+#include "../09_ComputeFilter/ComputeFilterShaders.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+// 各サンプルの *.hlsl を全て調べてエントリポイントをコンパイルし、
+// DXIL とリフレクション(Windows のみ)をサンプルの Shader::PrecompiledDirectory に書き出す. アプリは "-precompiledShaders" でこれを読み込む.
+//
+//   ShaderBuild [-debug] [-noShaderCache] [サンプルのディレクトリ ...]
+//
+// ディレクトリを省略すると、カレントディレクトリ直下で *.hlsl を持つものを全て処理する.
+// エントリポイントは既定の条件(シェーダーモデル 6_0、フラグとマクロ無し)でコンパイルする. 見つけ方は FindEntryPoints を参照.
+// それ以外の条件の版とシェーダーアーカイブは、サンプルの <サンプル名>Shaders.h の GetShaderManifest で宣言する.
+// アプリも同じヘッダの宣言を使うので、両者の条件は食い違わない. 新しく作ったら GetShaderManifest の一覧に加える.
+// -debug はデバッグビルドのアプリ向けに、デバッグ情報付き・最適化なしでコンパイルする.
+// -noShaderCache はシェーダーアーカイブのビルドで ShaderCache を使わない. 個別のシェーダーは常にコンパイルし直す.
+// Windows 以外では DXC の Linux 版(libdxcompiler.so)でビルドする. 手順は CMakeLists.txt を参照.
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+  std::string ToNarrow(const std::wstring& text)
+  {
+    return std::string(text.begin(), text.end());
+  }
+  std::wstring ToWide(const std::string& text)
+  {
+    return std::wstring(text.begin(), text.end());
+  }
+
+  Shader::Stage ParseStage(const std::string& text)
+  {
+    if (text == "vs") return Shader::Vertex;
+    if (text == "gs") return Shader::Geometry;
+    if (text == "ps") return Shader::Pixel;
+    if (text == "ds") return Shader::Domain;
+    if (text == "hs") return Shader::Hull;
+    if (text == "cs") return Shader::Compute;
+    throw std::runtime_error("unknown stage: " + text);
+  }
+
+  // 既定の条件以外の版とアーカイブを持つサンプル. 宣言はアプリと同じヘッダから作る.
+  ShaderManifest GetShaderManifest(const fs::path& directory)
+  {
+    const std::pair<const char*, ShaderManifest(*)()> manifests[] = {
+      { "04_CubemapRendering", cubemap_rendering::GetShaderManifest },
+      { "07_TessellateGround", tessellate_ground::GetShaderManifest },
+      { "09_ComputeFilter", compute_filter::GetShaderManifest },
+    };
+    for (const auto& v : manifests)
+    {
+      if (directory.filename() == v.first)
+      {
+        return v.second();
+      }
+    }
+    return ShaderManifest();
+  }
+
+#if defined(_WIN32)
+  // RootSignatureCache が DXC を使わずに読めるよう、ルートシグネチャに必要な分を書き出す. 書き出したら true.
+  bool StoreReflection(ID3DBlob* code)
+  {
+    ShaderReflectionData reflection;
+    if (!ShaderCompiler::GetForCurrentThread().ReflectBindings(code, reflection))
+    {
+      return false;
+    }
+    const auto data = reflection.Serialize();
+    const auto key = Shader::MakeReflectionKey(code->GetBufferPointer(), code->GetBufferSize());
+    if (!Shader::GetPrecompiledReflectionStore().Store(key, data.data(), data.size()))
+    {
+      throw std::runtime_error("could not write to " + std::string(Shader::PrecompiledDirectory));
+    }
+    return true;
+  }
+#else
+  // Linux 版の DXC はリフレクションのインタフェース(d3d12shader.h)を含まないので書き出さない.
+  // アプリはこれが無ければ DXIL からリフレクションを取り出す.
+  bool StoreReflection(ID3DBlob*)
+  {
+    return false;
+  }
+#endif
+
+  bool HasShaderFiles(const fs::path& directory)
+  {
+    for (const auto& entry : fs::directory_iterator(directory))
+    {
+      if (entry.path().extension() == ".hlsl")
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 属性とエントリポイントの名前からステージを決める. 決まらなければ false.
+  bool GetEntryStage(const std::string& name, const std::vector<std::string>& attributes, Shader::Stage& stage)
+  {
+    auto hasAttribute = [&](const char* attribute) {
+      return std::find(attributes.begin(), attributes.end(), attribute) != attributes.end();
+    };
+    if (hasAttribute("numthreads"))
+    {
+      stage = Shader::Compute;
+    }
+    else if (hasAttribute("maxvertexcount"))
+    {
+      stage = Shader::Geometry;
+    }
+    else if (hasAttribute("outputcontrolpoints") || hasAttribute("patchconstantfunc"))
+    {
+      stage = Shader::Hull;
+    }
+    else if (hasAttribute("domain"))
+    {
+      stage = Shader::Domain;
+    }
+    else
+    {
+      // 属性を持たないステージは名前の末尾で区別する.
+      auto suffix = name.size() > 2 ? name.substr(name.size() - 2) : std::string();
+      std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](char c) { return char(tolower(c)); });
+      try
+      {
+        stage = ParseStage(suffix);
+      }
+      catch (std::exception&)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // コメントを空白に置き換える. 行番号は変えない.
+  std::string StripComments(const std::string& text)
+  {
+    std::string ret = text;
+    for (size_t i = 0; i + 1 < ret.size(); ++i)
+    {
+      if (ret[i] == '/' && ret[i + 1] == '/')
+      {
+        for (; i < ret.size() && ret[i] != '\n'; ++i)
+        {
+          ret[i] = ' ';
+        }
+      }
+      else if (ret[i] == '/' && ret[i + 1] == '*')
+      {
+        for (; i + 1 < ret.size() && !(ret[i] == '*' && ret[i + 1] == '/'); ++i)
+        {
+          ret[i] = ret[i] == '\n' ? '\n' : ' ';
+        }
+        if (i + 1 < ret.size())
+        {
+          ret[i] = ' ';
+          ret[++i] = ' ';
+        }
+      }
+    }
+    return ret;
+  }
+
+  // pos を含む行の終わり. 末尾が '\\' なら次の行まで続ける.
+  size_t FindLineEnd(const std::string& text, size_t pos)
+  {
+    while ((pos = text.find('\n', pos)) != std::string::npos)
+    {
+      auto last = text.find_last_not_of(" \t\r", pos - 1);
+      if (last == std::string::npos || text[last] != '\\')
+      {
+        break;
+      }
+      ++pos;
+    }
+    return pos;
+  }
+
+  // ファイルの最上位にある "main" で始まる関数をエントリポイントとして返す.
+  // ステージは直前の属性で決め、 [numthreads] は cs、 [maxvertexcount] は gs、 [outputcontrolpoints] は hs、
+  // [domain] だけなら ds とする. 属性が無ければ名前の末尾(mainVS, mainPS など)で決める.
+  // #include されるだけのファイルなど、見つからなければ空.
+  std::vector<ShaderCompileRequest> FindEntryPoints(const fs::path& fileName)
+  {
+    std::ifstream infile(fileName);
+    auto text = StripComments(std::string((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>()));
+
+    std::vector<ShaderCompileRequest> entryPoints;
+    std::vector<std::string> attributes;
+    int depth = 0;
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+      const auto c = text[pos];
+      if (c == '#')
+      {
+        // プリプロセッサの行は読み飛ばす.
+        pos = FindLineEnd(text, pos);
+        continue;
+      }
+      if (c == '{' || c == '}' || c == ';')
+      {
+        depth += (c == '{') ? 1 : (c == '}') ? -1 : 0;
+        attributes.clear();
+        ++pos;
+        continue;
+      }
+      if (depth == 0 && c == '[')
+      {
+        auto first = text.find_first_not_of(" \t\r\n", pos + 1);
+        auto last = first;
+        while (last < text.size() && (isalnum(static_cast<unsigned char>(text[last])) || text[last] == '_'))
+        {
+          ++last;
+        }
+        if (first != std::string::npos)
+        {
+          auto attribute = text.substr(first, last - first);
+          std::transform(attribute.begin(), attribute.end(), attribute.begin(), [](char v) { return char(tolower(v)); });
+          attributes.push_back(attribute);
+        }
+        pos = text.find(']', pos);
+        continue;
+      }
+      if (depth == 0 && (isalpha(static_cast<unsigned char>(c)) || c == '_'))
+      {
+        auto last = pos;
+        while (last < text.size() && (isalnum(static_cast<unsigned char>(text[last])) || text[last] == '_'))
+        {
+          ++last;
+        }
+        auto name = text.substr(pos, last - pos);
+        auto next = text.find_first_not_of(" \t\r\n", last);
+        Shader::Stage stage;
+        if (name.compare(0, 4, "main") == 0 && next != std::string::npos && text[next] == '(' &&
+          GetEntryStage(name, attributes, stage))
+        {
+          ShaderCompileRequest request;
+          request.fileName = fileName.filename().wstring();
+          request.stage = stage;
+          request.entryPoint = ToWide(name);
+          entryPoints.push_back(request);
+        }
+        pos = last;
+        continue;
+      }
+      ++pos;
+    }
+    return entryPoints;
+  }
+
+  // 成功なら true. 失敗した要求はメッセージを出して続ける.
+  bool BuildSample(const fs::path& directory, std::shared_ptr<WorkerThreadPool> threadPool)
+  {
+    printf("%s\n", directory.string().c_str());
+    // ファイル名はアプリと同じく相対パスで渡すので、サンプルのディレクトリで作業する.
+    fs::current_path(directory);
+    // 引数で渡したディレクトリの末尾に区切りがあっても名前で引けるよう、移動した先のパスを使う.
+    const auto manifest = GetShaderManifest(fs::current_path());
+
+    // アーカイブにまとめるファイルは、軸のマクロが無いとコンパイルできないことがあるので個別には扱わない.
+    std::set<std::wstring> archiveFiles;
+    for (const auto& v : manifest.archives)
+    {
+      archiveFiles.insert(v.second.fileName);
+    }
+    std::vector<ShaderCompileRequest> requests;
+    for (const auto& entry : fs::directory_iterator("."))
+    {
+      if (entry.path().extension() == ".hlsl" && archiveFiles.count(entry.path().filename().wstring()) == 0)
+      {
+        auto entryPoints = FindEntryPoints(entry.path());
+        requests.insert(requests.end(), entryPoints.begin(), entryPoints.end());
+      }
+    }
+    // ディレクトリの列挙順に依らず、毎回同じ順に出力する.
+    std::sort(requests.begin(), requests.end(), [](const ShaderCompileRequest& a, const ShaderCompileRequest& b) {
+      return a.fileName != b.fileName ? a.fileName < b.fileName : a.entryPoint < b.entryPoint;
+    });
+    requests.insert(requests.end(), manifest.shaders.begin(), manifest.shaders.end());
+
+    // 前回の出力は消し、今回の内容だけが残るようにする.
+    fs::remove_all(Shader::PrecompiledDirectory);
+    fs::create_directories(Shader::PrecompiledDirectory);
+
+    bool isSucceeded = true;
+    // Shader::load と同じ内容(MakeDesc)で DXC に渡し、リフレクションも受け取る.
+    // ファイル名はサンプル毎の相対パスなので、重複の除去はサンプルの中だけで行う.
+    BasicShaderCompileService<ShaderCompiler::Result> compiler(threadPool, [](const ShaderCompileRequest& request) {
+      auto desc = Shader::MakeDesc(request.fileName, request.stage, request.entryPoint,
+        request.flags, request.defines, request.shaderModel, Shader::IsDebugCompile());
+      return ShaderCompiler::GetForCurrentThread().Compile(desc);
+    });
+    std::set<std::wstring> compiledKeys;
+    auto results = compiler.Compile(requests);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      const auto& request = requests[i];
+      // マニフェストに既定の条件の版が書かれていても 1 度だけ出力する.
+      if (!compiledKeys.insert(compiler.MakeKey(request)).second)
+      {
+        continue;
+      }
+      auto name = ToNarrow(request.fileName) + " " + ToNarrow(request.entryPoint);
+      try
+      {
+        auto result = results[i].get();
+        if (!result.IsSucceeded())
+        {
+          throw std::runtime_error("shader compile failed.\n" + result.FormatDiagnostics());
+        }
+        for (const auto& v : result.diagnostics)
+        {
+          printf("  %s(%u): warning: %s\n", v.fileName.c_str(), v.line, v.message.c_str());
+        }
+        auto desc = Shader::MakeDesc(request.fileName, request.stage, request.entryPoint,
+          request.flags, request.defines, request.shaderModel, Shader::IsDebugCompile());
+        const auto key = Shader::MakePrecompiledKey(desc);
+        const auto& code = result.code;
+        if (!Shader::GetPrecompiledStore().Store(key, code->GetBufferPointer(), code->GetBufferSize()))
+        {
+          throw std::runtime_error("could not write to " + std::string(Shader::PrecompiledDirectory));
+        }
+        const bool hasReflection = StoreReflection(code.Get());
+        printf("  %s %s (%u bytes%s)\n", name.c_str(), ToNarrow(desc.profile).c_str(),
+          uint32_t(code->GetBufferSize()), hasReflection ? ", reflection" : "");
+      }
+      catch (std::exception& e)
+      {
+        printf("  %s: error: %s\n", name.c_str(), e.what());
+        isSucceeded = false;
+      }
+    }
+
+    for (const auto& v : manifest.archives)
+    {
+      auto name = ToNarrow(v.first);
+      try
+      {
+        auto archive = ShaderArchive::Build(v.second, ShaderArchive::GetPrecompiledPath(v.first), threadPool);
+        // 書き出せなくてもメモリ上のものが返るので、ファイルの有無で確かめる.
+        if (!fs::exists(ShaderArchive::GetPrecompiledPath(v.first)))
+        {
+          throw std::runtime_error("could not write to " + std::string(Shader::PrecompiledDirectory));
+        }
+        // リフレクションは DXIL の内容で引くので、バリアント間で同じものは 1 つにまとまる.
+        for (uint32_t key = 0; key < archive->GetVariantCount(); ++key)
+        {
+          for (const auto& entry : v.second.entryPoints)
+          {
+            StoreReflection(archive->Find(entry.stage, entry.name, key).Get());
+          }
+        }
+        printf("  %s (%u variants)\n", name.c_str(), archive->GetVariantCount());
+      }
+      catch (std::exception& e)
+      {
+        printf("  %s: error: %s\n", name.c_str(), e.what());
+        isSucceeded = false;
+      }
+    }
+    return isSucceeded;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<fs::path> directories;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "-debug")
+    {
+      Shader::SetDebugCompile(true);
+    }
+    else if (arg == "-noShaderCache")
+    {
+      ShaderCache::Get().SetEnabled(false);
+    }
+    else
+    {
+      directories.push_back(fs::absolute(arg));
+    }
+  }
+  if (directories.empty())
+  {
+    for (const auto& entry : fs::directory_iterator(fs::current_path()))
+    {
+      if (fs::is_directory(entry.path()) && HasShaderFiles(entry.path()))
+      {
+        directories.push_back(entry.path());
+      }
+    }
+    std::sort(directories.begin(), directories.end());
+  }
+  if (directories.empty())
+  {
+    printf("no *.hlsl found.\n");
+    return 1;
+  }
+
+  // 事前コンパイル済みシェーダーの格納先はアプリからは読み取り専用. ここでだけ書き込む.
+  Shader::GetPrecompiledStore().SetReadOnly(false);
+  Shader::GetPrecompiledReflectionStore().SetReadOnly(false);
+
+  // 全サンプルで 1 つのプールを使う. メインスレッドは結果を待つだけなのでコア数分用意する.
+  auto threadPool = std::make_shared<WorkerThreadPool>(std::max(std::thread::hardware_concurrency(), 1u));
+  int failureCount = 0;
+  for (const auto& v : directories)
+  {
+    try
+    {
+      if (!BuildSample(v, threadPool))
+      {
+        ++failureCount;
+      }
+    }
+    catch (std::exception& e)
+    {
+      printf("  error: %s\n", e.what());
+      ++failureCount;
+    }
+  }
+  printf("%d succeeded, %d failed.\n", int(directories.size()) - failureCount, failureCount);
+  return failureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+﻿#pragma once
+#include <cassert>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// 2 のべき乗サイズのブロックに分割して領域を管理するバディアロケータ.
+// オフセットの管理のみを行い、ヒープ(ID3D12Heap)には依存しない.
+// ブロックはそのサイズ境界に揃うため、アライメント要求はブロックサイズで満たす.
+class BuddyAllocator
+{
+public:
+  static const uint64_t InvalidOffset = ~0ull;
+
+  // minBlockSize は 2 のべき乗であること.
+  // capacity は minBlockSize の倍数に切り下げ、 2 のべき乗でなければ境界の揃ったブロックの組に分けて管理する.
+  BuddyAllocator(uint64_t capacity, uint64_t minBlockSize)
+    : m_capacity(capacity - capacity % minBlockSize), m_minBlockSize(minBlockSize),
+    m_usedSize(0), m_peakUsedSize(0), m_requestedSize(0)
+  {
+    assert(minBlockSize != 0 && (minBlockSize & (minBlockSize - 1)) == 0);
+    m_maxOrder = 0;
+    while ((m_minBlockSize << (m_maxOrder + 1)) <= m_capacity)
+    {
+      ++m_maxOrder;
+    }
+    m_freeBlocks.resize(m_maxOrder + 1);
+    // 大きいブロックから詰めると、各ブロックは自身のサイズ境界に揃う.
+    uint64_t offset = 0;
+    for (uint32_t order = m_maxOrder + 1; order > 0; --order)
+    {
+      if (offset + GetBlockSize(order - 1) <= m_capacity)
+      {
+        m_freeBlocks[order - 1].insert(offset);
+        offset += GetBlockSize(order - 1);
+      }
+    }
+  }
+
+  uint64_t Allocate(uint64_t size, uint64_t alignment)
+  {
+    if (size == 0)
+    {
+      return InvalidOffset;
+    }
+    uint32_t order = GetOrder(size > alignment ? size : alignment);
+    if (order > m_maxOrder)
+    {
+      return InvalidOffset;
+    }
+
+    // 要求サイズ以上で空いている最小のブロックを探す.
+    uint32_t found = order;
+    while (found <= m_maxOrder && m_freeBlocks[found].empty())
+    {
+      ++found;
+    }
+    if (found > m_maxOrder)
+    {
+      return InvalidOffset;
+    }
+
+    uint64_t offset = *m_freeBlocks[found].begin();
+    m_freeBlocks[found].erase(m_freeBlocks[found].begin());
+    // 必要なサイズになるまで分割し、後半を空きとして戻す.
+    while (found > order)
+    {
+      --found;
+      m_freeBlocks[found].insert(offset + GetBlockSize(found));
+    }
+
+    m_allocated[offset] = Allocation{ order, size };
+    m_usedSize += GetBlockSize(order);
+    m_requestedSize += size;
+    if (m_usedSize > m_peakUsedSize)
+    {
+      m_peakUsedSize = m_usedSize;
+    }
+    return offset;
+  }
+
+  void Free(uint64_t offset)
+  {
+    auto itr = m_allocated.find(offset);
+    if (itr == m_allocated.end())
+    {
+      return;
+    }
+    uint32_t order = itr->second.order;
+    m_usedSize -= GetBlockSize(order);
+    m_requestedSize -= itr->second.size;
+    m_allocated.erase(itr);
+
+    // バディが空いていれば結合していく.
+    while (order < m_maxOrder)
+    {
+      const uint64_t buddy = offset ^ GetBlockSize(order);
+      auto& freeList = m_freeBlocks[order];
+      auto buddyItr = freeList.find(buddy);
+      if (buddyItr == freeList.end())
+      {
+        break;
+      }
+      freeList.erase(buddyItr);
+      offset = offset < buddy ? offset : buddy;
+      ++order;
+    }
+    m_freeBlocks[order].insert(offset);
+  }
+
+  uint64_t GetCapacity() const { return m_capacity; }
+  // ブロック単位に切り上げた使用量.
+  uint64_t GetUsedSize() const { return m_usedSize; }
+  uint64_t GetPeakUsedSize() const { return m_peakUsedSize; }
+  // 要求されたサイズの合計. GetUsedSize との差が内部断片化.
+  uint64_t GetRequestedSize() const { return m_requestedSize; }
+  uint32_t GetAllocationCount() const { return uint32_t(m_allocated.size()); }
+  bool IsEmpty() const { return m_allocated.empty(); }
+
+  uint64_t GetLargestFreeBlock() const
+  {
+    for (uint32_t order = m_maxOrder + 1; order > 0; --order)
+    {
+      if (!m_freeBlocks[order - 1].empty())
+      {
+        return GetBlockSize(order - 1);
+      }
+    }
+    return 0;
+  }
+
+  // 外部断片化の指標. 空き領域のうち最大ブロックに含まれない割合 (0 で断片化なし).
+  float GetFragmentation() const
+  {
+    const uint64_t freeSize = m_capacity - m_usedSize;
+    if (freeSize == 0)
+    {
+      return 0.0f;
+    }
+    return 1.0f - float(GetLargestFreeBlock()) / float(freeSize);
+  }
+
+private:
+  uint64_t GetBlockSize(uint32_t order) const { return m_minBlockSize << order; }
+  uint32_t GetOrder(uint64_t size) const
+  {
+    uint32_t order = 0;
+    while (GetBlockSize(order) < size)
+    {
+      ++order;
+    }
+    return order;
+  }
+
+  struct Allocation
+  {
+    uint32_t order;
+    uint64_t size;
+  };
+
+  uint64_t m_capacity;
+  uint64_t m_minBlockSize;
+  uint32_t m_maxOrder;
+  uint64_t m_usedSize;
+  uint64_t m_peakUsedSize;
+  uint64_t m_requestedSize;
+  std::vector<std::set<uint64_t>> m_freeBlocks;
+  std::unordered_map<uint64_t, Allocation> m_allocated;
+};
@@ -0,0 +1,177 @@
+﻿#include "CacheFileUtil.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void StableHasher::AddBytes(const void* data, size_t size)
+{
+  auto p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i)
+  {
+    m_hash ^= p[i];
+    m_hash *= 1099511628211ull;
+  }
+}
+
+void StableHasher::AddU32(uint32_t value)
+{
+  AddBytes(&value, sizeof(value));
+}
+
+void StableHasher::AddU64(uint64_t value)
+{
+  AddBytes(&value, sizeof(value));
+}
+
+void StableHasher::AddFloat(float value)
+{
+  // -0.0 と 0.0 は同じ値として扱う.
+  if (value == 0.0f)
+  {
+    value = 0.0f;
+  }
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  AddU32(bits);
+}
+
+void StableHasher::AddString(const char* text)
+{
+  if (text == nullptr)
+  {
+    AddU32(0);
+    return;
+  }
+  const auto length = strlen(text);
+  AddU32(uint32_t(length + 1));
+  AddBytes(text, length);
+}
+
+void StableHasher::AddUtf16(const std::wstring& text)
+{
+  for (auto c : text)
+  {
+    auto code = uint32_t(c);
+    // wchar_t が 32bit の環境では BMP 外の文字をサロゲートペアに分ける.
+    if (code > 0xFFFF)
+    {
+      code -= 0x10000;
+      const uint16_t pair[2] = { uint16_t(0xD800 + (code >> 10)), uint16_t(0xDC00 + (code & 0x3FF)) };
+      AddBytes(pair, sizeof(pair));
+      continue;
+    }
+    const auto unit = uint16_t(code);
+    AddBytes(&unit, sizeof(unit));
+  }
+}
+
+uint64_t StableHasher::Hash(const void* data, size_t size, uint64_t seed)
+{
+  StableHasher hasher(seed);
+  hasher.AddBytes(data, size);
+  return hasher.GetValue();
+}
+
+uint64_t StableHasher::HashUtf16(const std::wstring& text, uint64_t seed)
+{
+  StableHasher hasher(seed);
+  hasher.AddUtf16(text);
+  return hasher.GetValue();
+}
+
+namespace
+{
+  std::atomic<uint32_t> s_tempCounter(0);
+
+  std::string GetTempSuffix()
+  {
+#if defined(_WIN32)
+    const auto processId = uint32_t(GetCurrentProcessId());
+#else
+    const auto processId = uint32_t(getpid());
+#endif
+    return "." + std::to_string(processId) + "." + std::to_string(s_tempCounter.fetch_add(1)) + ".tmp";
+  }
+
+  template<class Path>
+  bool WriteFile(const Path& fileName, const void* data, size_t size)
+  {
+    std::ofstream outfile(fileName, std::ios::binary);
+    if (!outfile)
+    {
+      return false;
+    }
+    outfile.write(static_cast<const char*>(data), std::streamsize(size));
+    outfile.close();
+    return bool(outfile);
+  }
+}
+
+namespace cache_file
+{
+  bool WriteAtomically(const std::string& fileName, const void* data, size_t size)
+  {
+    const auto tempName = fileName + GetTempSuffix();
+    if (!WriteFile(tempName, data, size))
+    {
+      std::remove(tempName.c_str());
+      return false;
+    }
+#if defined(_WIN32)
+    const bool isReplaced = MoveFileExA(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+#else
+    const bool isReplaced = std::rename(tempName.c_str(), fileName.c_str()) == 0;
+#endif
+    if (!isReplaced)
+    {
+      std::remove(tempName.c_str());
+      return false;
+    }
+    return true;
+  }
+
+#if defined(_WIN32)
+  bool WriteAtomically(const std::wstring& fileName, const void* data, size_t size)
+  {
+    const auto suffix = GetTempSuffix();
+    const auto tempName = fileName + std::wstring(suffix.begin(), suffix.end());
+    if (!WriteFile(tempName, data, size) ||
+      !MoveFileExW(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+      DeleteFileW(tempName.c_str());
+      return false;
+    }
+    return true;
+  }
+#endif
+
+  bool ReadAll(const std::string& fileName, std::vector<char>& data)
+  {
+    std::ifstream infile(fileName, std::ios::binary);
+    if (!infile)
+    {
+      return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
+    return true;
+  }
+
+  void CreateDirectoryIfNeeded(const std::string& directory)
+  {
+#if defined(_WIN32)
+    CreateDirectoryA(directory.c_str(), nullptr);
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+  }
+}
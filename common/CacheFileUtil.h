@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ディスクに保存するキャッシュ(シェーダー、パイプライン、シェーダーアーカイブ)で共有するハッシュとファイル操作.
+// Windows API への依存はファイルの置き換えとディレクトリの作成のみ.
+
+// フィールドを 1 つずつ積んでいく FNV-1a (64bit) のハッシュ.
+// 構造体をまとめて読むとパディングやポインタ値が混ざるため、値を明示的に渡して実行毎に同じ値になるようにする.
+class StableHasher
+{
+public:
+  static const uint64_t OffsetBasis = 14695981039346656037ull;
+
+  StableHasher() : m_hash(OffsetBasis) {}
+  // 途中までのハッシュ値から続ける.
+  explicit StableHasher(uint64_t seed) : m_hash(seed) {}
+
+  void AddBytes(const void* data, size_t size);
+  void AddU32(uint32_t value);
+  void AddU64(uint64_t value);
+  void AddFloat(float value);
+  // nullptr と空文字列は区別する.
+  void AddString(const char* text);
+  // wchar_t の大きさに依らないよう UTF-16 の列として積む. Windows では文字列のバイト列そのものと同じ.
+  void AddUtf16(const std::wstring& text);
+
+  uint64_t GetValue() const { return m_hash; }
+
+  // バイト列 1 つ分のハッシュ. seed に前回の値を渡すと連結したものと同じ値になる.
+  static uint64_t Hash(const void* data, size_t size, uint64_t seed = OffsetBasis);
+  static uint64_t HashUtf16(const std::wstring& text, uint64_t seed = OffsetBasis);
+private:
+  uint64_t m_hash;
+};
+
+namespace cache_file
+{
+  // 一時ファイルへ書いてから置き換えるため、途中で終了しても壊れたファイルは残らない.
+  // 一時ファイル名はプロセスと呼び出し毎に変えるので、同じファイルへ並列に書いても衝突しない.
+  bool WriteAtomically(const std::string& fileName, const void* data, size_t size);
+#if defined(_WIN32)
+  bool WriteAtomically(const std::wstring& fileName, const void* data, size_t size);
+#endif
+  bool ReadAll(const std::string& fileName, std::vector<char>& data);
+  void CreateDirectoryIfNeeded(const std::string& directory);
+}
@@ -0,0 +1,43 @@
+﻿#include "CommandListPool.h"
+
+CommandListPool::CommandListPool(ComPtr<ID3D12Device> device, D3D12_COMMAND_LIST_TYPE type)
+  : m_device(device), m_type(type), m_acquired(0)
+{
+}
+
+CommandListPool::ComPtr<ID3D12GraphicsCommandList> CommandListPool::Acquire()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  HRESULT hr;
+  if (m_acquired < m_entries.size())
+  {
+    // 前フレーム以前に作ったものを使い回す. アロケータは Reset 済み.
+    auto& entry = m_entries[m_acquired++];
+    hr = entry.commandList->Reset(entry.allocator.Get(), nullptr);
+    ThrowIfFailed(hr, "Reset failed.(CommandListPool)");
+    return entry.commandList;
+  }
+
+  Entry entry;
+  hr = m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&entry.allocator));
+  ThrowIfFailed(hr, "CreateCommandAllocator failed.(CommandListPool)");
+  hr = m_device->CreateCommandList(
+    0, m_type, entry.allocator.Get(), nullptr, IID_PPV_ARGS(&entry.commandList)
+  );
+  ThrowIfFailed(hr, "CreateCommandList failed.(CommandListPool)");
+  entry.commandList->SetName(L"PooledCommand");
+
+  m_entries.push_back(entry);
+  m_acquired++;
+  return entry.commandList;
+}
+
+void CommandListPool::Reset()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (UINT i = 0; i < m_acquired; ++i)
+  {
+    m_entries[i].allocator->Reset();
+  }
+  m_acquired = 0;
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <mutex>
+#include <vector>
+
+#include "D3D12BookUtil.h"
+
+// アロケータと組にしたコマンドリストを貸し出すプール.
+// 1 つのリストが 1 つのアロケータを占有するため、別スレッドで同時に記録できる.
+class CommandListPool
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  CommandListPool(ComPtr<ID3D12Device> device, D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
+
+  // 記録可能な状態のコマンドリストを返す. 複数スレッドから呼び出してよい.
+  ComPtr<ID3D12GraphicsCommandList> Acquire();
+
+  // 貸し出したリストを GPU が使い終えてから呼び出し、全て再利用可能にする.
+  void Reset();
+
+  UINT GetAcquiredCount() const { return m_acquired; }
+private:
+  struct Entry
+  {
+    ComPtr<ID3D12CommandAllocator> allocator;
+    ComPtr<ID3D12GraphicsCommandList> commandList;
+  };
+  ComPtr<ID3D12Device> m_device;
+  D3D12_COMMAND_LIST_TYPE m_type;
+  std::vector<Entry> m_entries;
+  UINT m_acquired;
+  std::mutex m_mutex;
+};
@@ -0,0 +1,179 @@
+﻿#include "CpuProfiler.h"
+
+#if ENABLE_CPU_PROFILER
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+CpuProfiler& CpuProfiler::Get()
+{
+  static CpuProfiler instance;
+  return instance;
+}
+
+uint64_t CpuProfiler::Now()
+{
+  using namespace std::chrono;
+  return uint64_t(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+CpuProfiler::ThreadRing* CpuProfiler::GetThreadRing()
+{
+  // スレッドが終了しても記録は残すため、所有は m_rings 側で持つ.
+  thread_local ThreadRing* ring = nullptr;
+  if (ring == nullptr)
+  {
+    auto newRing = std::make_shared<ThreadRing>();
+    newRing->events.resize(RingSize);
+    newRing->written = 0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    newRing->threadId = uint32_t(m_rings.size());
+    newRing->threadName = "Thread " + std::to_string(newRing->threadId);
+    m_rings.push_back(newRing);
+    ring = newRing.get();
+  }
+  return ring;
+}
+
+std::vector<std::shared_ptr<CpuProfiler::ThreadRing>> CpuProfiler::SnapshotRings() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_rings;
+}
+
+void CpuProfiler::Record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+  auto ring = GetThreadRing();
+  std::lock_guard<std::mutex> lock(ring->mutex);
+  ring->events[ring->written % RingSize] = Event{ name, beginNs, endNs };
+  ring->written++;
+}
+
+void CpuProfiler::SetThreadName(const std::string& name)
+{
+  auto ring = GetThreadRing();
+  std::lock_guard<std::mutex> lock(ring->mutex);
+  ring->threadName = name;
+}
+
+void CpuProfiler::Clear()
+{
+  for (auto& ring : SnapshotRings())
+  {
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    ring->written = 0;
+  }
+}
+
+std::vector<CpuProfiler::ZoneStats> CpuProfiler::ComputeStats() const
+{
+  std::map<std::string, std::vector<uint64_t>> durations;
+  for (auto& ring : SnapshotRings())
+  {
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    const auto count = std::min(ring->written, uint64_t(RingSize));
+    for (uint64_t i = 0; i < count; ++i)
+    {
+      const auto& e = ring->events[i];
+      durations[e.name].push_back(e.endNs - e.beginNs);
+    }
+  }
+
+  // 最近傍順位法で百分位数を求める.
+  auto percentile = [](const std::vector<uint64_t>& sorted, double p) {
+    auto rank = size_t(p * double(sorted.size()) + 0.999999);
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return double(sorted[rank - 1]) / 1000000.0;
+  };
+
+  std::vector<ZoneStats> stats;
+  for (auto& v : durations)
+  {
+    auto& sorted = v.second;
+    std::sort(sorted.begin(), sorted.end());
+    ZoneStats zone{};
+    zone.name = v.first;
+    zone.count = sorted.size();
+    zone.p50Ms = percentile(sorted, 0.50);
+    zone.p95Ms = percentile(sorted, 0.95);
+    zone.p99Ms = percentile(sorted, 0.99);
+    zone.maxMs = double(sorted.back()) / 1000000.0;
+    stats.push_back(zone);
+  }
+  return stats;
+}
+
+namespace
+{
+  std::string EscapeJson(const std::string& text)
+  {
+    std::string ret;
+    for (auto c : text)
+    {
+      switch (c)
+      {
+      case '"': ret += "\\\""; break;
+      case '\\': ret += "\\\\"; break;
+      case '\n': ret += "\\n"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+          ret += buf;
+        }
+        else
+        {
+          ret += c;
+        }
+        break;
+      }
+    }
+    return ret;
+  }
+}
+
+std::string CpuProfiler::ExportChromeTrace() const
+{
+  std::ostringstream ss;
+  ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool isFirst = true;
+  for (auto& ring : SnapshotRings())
+  {
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    ss << (isFirst ? "" : ",");
+    isFirst = false;
+    ss << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId
+      << ",\"args\":{\"name\":\"" << EscapeJson(ring->threadName) << "\"}}";
+
+    // 古いものから順に出力する.
+    const auto count = std::min(ring->written, uint64_t(RingSize));
+    const auto first = ring->written - count;
+    for (uint64_t i = first; i < ring->written; ++i)
+    {
+      const auto& e = ring->events[i % RingSize];
+      const auto begin = e.beginNs > m_epochNs ? e.beginNs - m_epochNs : 0;
+      ss << ",{\"name\":\"" << EscapeJson(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+        << ",\"ts\":" << begin / 1000 << "." << (begin % 1000) / 100
+        << ",\"dur\":" << (e.endNs - e.beginNs) / 1000 << "." << ((e.endNs - e.beginNs) % 1000) / 100 << "}";
+    }
+  }
+  ss << "]}";
+  return ss.str();
+}
+
+bool CpuProfiler::ExportChromeTrace(const std::string& fileName) const
+{
+  std::ofstream outfile(fileName, std::ios::binary);
+  if (!outfile)
+  {
+    return false;
+  }
+  outfile << ExportChromeTrace();
+  return bool(outfile);
+}
+#endif
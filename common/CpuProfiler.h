@@ -0,0 +1,91 @@
+﻿#pragma once
+// CPU 側の処理時間を区間(ゾーン)単位で記録する.
+// ENABLE_CPU_PROFILER を 0 で定義するとマクロは空になり、計測処理は全て取り除かれる.
+#ifndef ENABLE_CPU_PROFILER
+#define ENABLE_CPU_PROFILER 1
+#endif
+
+#if ENABLE_CPU_PROFILER
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Windows API に依存しないため、単体でビルドして確認できる.
+class CpuProfiler
+{
+public:
+  // スレッド毎に保持する区間の数. 溢れたら古いものから上書きする.
+  static const size_t RingSize = 16 * 1024;
+
+  static CpuProfiler& Get();
+  // 計測に使う時刻(ナノ秒).
+  static uint64_t Now();
+
+  // name は文字列リテラル等、プログラム終了まで有効なものを渡すこと.
+  void Record(const char* name, uint64_t beginNs, uint64_t endNs);
+  // 呼び出したスレッドの表示名.
+  void SetThreadName(const std::string& name);
+  void Clear();
+
+  struct ZoneStats
+  {
+    std::string name;
+    uint64_t count;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+  };
+  // 記録が残っている区間を名前毎に集計する. 名前順.
+  std::vector<ZoneStats> ComputeStats() const;
+
+  // Chrome の trace event 形式(chrome://tracing, Perfetto で読める)の JSON.
+  std::string ExportChromeTrace() const;
+  bool ExportChromeTrace(const std::string& fileName) const;
+
+  class Zone
+  {
+  public:
+    explicit Zone(const char* name) : m_name(name), m_begin(Now()) { }
+    ~Zone() { Get().Record(m_name, m_begin, Now()); }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+  private:
+    const char* m_name;
+    uint64_t m_begin;
+  };
+private:
+  struct Event
+  {
+    const char* name;
+    uint64_t beginNs;
+    uint64_t endNs;
+  };
+  // 書き込むのは所有スレッドのみ. 集計時の読み込みとだけ競合するのでロックはほぼ取り合わない.
+  struct ThreadRing
+  {
+    uint32_t threadId;
+    std::string threadName;
+    std::vector<Event> events;
+    uint64_t written;
+    mutable std::mutex mutex;
+  };
+  ThreadRing* GetThreadRing();
+  std::vector<std::shared_ptr<ThreadRing>> SnapshotRings() const;
+
+  mutable std::mutex m_mutex;
+  std::vector<std::shared_ptr<ThreadRing>> m_rings;
+  uint64_t m_epochNs = Now();
+};
+
+#define CPU_PROFILER_CONCAT_(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_(a, b)
+// スコープを抜けるまでを name の区間として記録する.
+#define CPU_PROFILE_SCOPE(name) CpuProfiler::Zone CPU_PROFILER_CONCAT(cpuProfileZone, __LINE__)(name)
+#define CPU_PROFILE_THREAD_NAME(name) CpuProfiler::Get().SetThreadName(name)
+#else
+#define CPU_PROFILE_SCOPE(name)
+#define CPU_PROFILE_THREAD_NAME(name)
+#endif
@@ -1,6 +1,8 @@
 ﻿#include "D3D12AppBase.h"
 #include <exception>
 #include <fstream>
+#include <algorithm>
+#include <shellapi.h>
 #if _MSC_VER > 1922 && !defined(_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING)
 #define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
 #endif
@@ -11,15 +13,9 @@
 #include "examples/imgui_impl_dx12.h"
 #include "examples/imgui_impl_win32.h"
 
-#if _MSC_VER > 1922 && !defined(_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING)
-#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
-#endif
-#include <experimental/filesystem>
-using namespace std::experimental::filesystem;
-
-// シェーダーのコンパイル用.
-#include <dxcapi.h>
-#pragma comment(lib, "dxcompiler.lib")
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderCompileService.h"
 
 using namespace std;
 using namespace Microsoft::WRL;
@@ -27,13 +23,14 @@ using namespace Microsoft::WRL;
 D3D12AppBase::D3D12AppBase()
 {
   m_frameIndex = 0;
-  m_waitFence = CreateEvent(NULL, FALSE, FALSE, NULL);
+  m_frameLatency = DefaultFrameLatency;
+  m_isBindlessRequested = false;
+  m_isBindlessSupported = false;
 }
 
 
 D3D12AppBase::~D3D12AppBase()
 {
-  CloseHandle(m_waitFence);
 }
 
 void D3D12AppBase::SetTitle(const std::string& title)
@@ -46,6 +43,57 @@ void D3D12AppBase::Initialize(HWND hwnd, DXGI_FORMAT format, bool isFullscreen)
   m_hwnd = hwnd;
   HRESULT hr;
   UINT dxgiFlags = 0;
+
+  // 起動引数でフレームレイテンシ、バインドレス描画、シェーダー/パイプラインキャッシュの無効化、ホットリロード、
+  // 事前コンパイル済みシェーダーの使用、シェーダーの版の固定を指定できるようにする.
+  bool usePipelineCache = true;
+  bool useBaselineShaders = false;
+#if defined(_DEBUG)
+  bool useHotReload = true;
+#else
+  bool useHotReload = false;
+#endif
+  {
+    int argc = 0;
+    auto argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    for (int i = 1; argv && i < argc; ++i)
+    {
+      if (wcscmp(argv[i], L"-frameLatency") == 0 && i + 1 < argc)
+      {
+        SetFrameLatency(UINT(_wtoi(argv[i + 1])));
+      }
+      if (wcscmp(argv[i], L"-bindless") == 0)
+      {
+        m_isBindlessRequested = true;
+      }
+      if (wcscmp(argv[i], L"-noShaderCache") == 0)
+      {
+        ShaderCache::Get().SetEnabled(false);
+      }
+      if (wcscmp(argv[i], L"-noPipelineCache") == 0)
+      {
+        usePipelineCache = false;
+      }
+      if (wcscmp(argv[i], L"-hotReload") == 0)
+      {
+        useHotReload = true;
+      }
+      if (wcscmp(argv[i], L"-precompiledShaders") == 0)
+      {
+        Shader::SetPrecompiledMode(true);
+      }
+      if (wcscmp(argv[i], L"-baselineShaders") == 0)
+      {
+        useBaselineShaders = true;
+      }
+    }
+    LocalFree(argv);
+  }
+  // 事前コンパイル済みのものはソースを変えても作り直せない.
+  if (Shader::IsPrecompiledMode())
+  {
+    useHotReload = false;
+  }
 #if defined(_DEBUG)
   ComPtr<ID3D12Debug> debug;
   if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debug))))
@@ -85,6 +133,62 @@ void D3D12AppBase::Initialize(HWND hwnd, DXGI_FORMAT format, bool isFullscreen)
   hr = D3D12CreateDevice(useAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&m_device));
   ThrowIfFailed(hr, "D3D12CreateDevice 失敗");
 
+  // アダプタとドライバのバージョンが変わったら、保存済みの PSO は使わない.
+  {
+    DXGI_ADAPTER_DESC1 adapterDesc{};
+    useAdapter->GetDesc1(&adapterDesc);
+    LARGE_INTEGER driverVersion{};
+    useAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
+    PipelineCacheAdapterIdentity adapter{};
+    adapter.vendorId = adapterDesc.VendorId;
+    adapter.deviceId = adapterDesc.DeviceId;
+    adapter.subSysId = adapterDesc.SubSysId;
+    adapter.revision = adapterDesc.Revision;
+    adapter.driverVersion = uint64_t(driverVersion.QuadPart);
+    m_pipelineCache = std::make_shared<PipelineCache>(m_device, adapter, "PipelineCache.bin", usePipelineCache);
+  }
+  m_rootSignatureCache = std::make_shared<RootSignatureCache>(m_device);
+
+  // シェーダーの版を選ぶための機能を調べる. "-baselineShaders" なら SM 6.0 の機能のみとして扱う.
+  if (!useBaselineShaders)
+  {
+    // ランタイムが知らないシェーダーモデルを渡すと失敗するので、新しいものから順に試す.
+    const D3D_SHADER_MODEL shaderModels[] = {
+      D3D_SHADER_MODEL_6_6, D3D_SHADER_MODEL_6_5, D3D_SHADER_MODEL_6_4,
+      D3D_SHADER_MODEL_6_3, D3D_SHADER_MODEL_6_2, D3D_SHADER_MODEL_6_1,
+    };
+    for (auto model : shaderModels)
+    {
+      D3D12_FEATURE_DATA_SHADER_MODEL shaderModel{ model };
+      if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel))))
+      {
+        m_shaderFeatures.highestShaderModel = shaderModel.HighestShaderModel;
+        break;
+      }
+    }
+    D3D12_FEATURE_DATA_D3D12_OPTIONS1 options1{};
+    if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS1, &options1, sizeof(options1))))
+    {
+      m_shaderFeatures.waveOps = options1.WaveOps != FALSE;
+      m_shaderFeatures.waveLaneCountMin = options1.WaveLaneCountMin;
+    }
+    D3D12_FEATURE_DATA_D3D12_OPTIONS4 options4{};
+    if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS4, &options4, sizeof(options4))))
+    {
+      m_shaderFeatures.native16BitOps = options4.Native16BitShaderOpsSupported != FALSE;
+    }
+  }
+
+  // バインドレス描画には SM 6.6 とリソースバインディング Tier 3 が必要.
+  {
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+    m_isBindlessSupported =
+      m_shaderFeatures.highestShaderModel >= D3D_SHADER_MODEL_6_6 &&
+      SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))) &&
+      options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_3;
+  }
+
   // コマンドキューの生成
   D3D12_COMMAND_QUEUE_DESC queueDesc{
     D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -94,6 +198,19 @@ void D3D12AppBase::Initialize(HWND hwnd, DXGI_FORMAT format, bool isFullscreen)
   };
   hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue));
   ThrowIfFailed(hr, "CreateCommandQueue 失敗");
+  m_queueFence = std::make_shared<TimelineFence>(m_device, L"DirectQueueFence");
+
+  // アセット転送用のコピーキューの準備.
+  m_uploadQueue = std::make_shared<UploadQueue>(m_device);
+  m_resourceAllocator = std::make_shared<ResourceAllocator>(m_device);
+  m_workerThreads = std::make_shared<WorkerThreadPool>();
+  m_renderGraph = std::make_shared<RenderGraphExecutor>(m_device, m_resourceAllocator);
+  m_stateTracker = std::make_shared<ResourceStateTracker>();
+  m_gpuProfiler = std::make_shared<GpuProfiler>(m_device, m_commandQueue, MaxFrameLatency);
+  m_shaderCompiler = std::make_shared<ShaderCompileService>(m_workerThreads, &Shader::Compile);
+  m_shaderHotReload = std::make_shared<ShaderHotReload>(useHotReload);
+  CPU_PROFILE_THREAD_NAME("Main");
+  m_renderGraph->SetProfiler(m_gpuProfiler);
 
   // 各ディスクリプタヒープの準備.
   PrepareDescriptorHeaps();
@@ -140,7 +257,7 @@ void D3D12AppBase::Initialize(HWND hwnd, DXGI_FORMAT format, bool isFullscreen)
   // スワップチェインの生成
   {
     DXGI_SWAP_CHAIN_DESC1 scDesc{};
-    scDesc.BufferCount = FrameBufferCount;
+    scDesc.BufferCount = std::max(m_frameLatency, 2u);
     scDesc.Width = m_width;
     scDesc.Height = m_height;
     scDesc.Format = format;
@@ -176,12 +293,13 @@ void D3D12AppBase::Initialize(HWND hwnd, DXGI_FORMAT format, bool isFullscreen)
 
   // コマンドアロケータ－の準備.
   CreateCommandAllocators();
+  CreateFrameContexts();
 
   // コマンドリストの生成.
   hr = m_device->CreateCommandList(
     0,
     D3D12_COMMAND_LIST_TYPE_DIRECT,
-    m_commandAllocators[0].Get(),
+    m_frames[0]->GetCommandAllocator().Get(),
     nullptr,
     IID_PPV_ARGS(&m_commandList)
   );
@@ -192,14 +310,19 @@ void D3D12AppBase::Initialize(HWND hwnd, DXGI_FORMAT format, bool isFullscreen)
   m_scissorRect = CD3DX12_RECT(0, 0, LONG(m_width), LONG(m_height));
 
   Prepare();
+  FlushUploads();
+  m_pipelineCache->Save();
 
   PrepareImGui();
 }
 
 void D3D12AppBase::Terminate()
 {
+  // 再構築中のものがあれば終わるのを待ってから破棄に進む.
+  m_shaderHotReload->Stop();
   WaitForIdleGPU();
   Cleanup();
+  m_pipelineCache->Save();
 
   CleanupImGui();
 }
@@ -207,13 +330,7 @@ void D3D12AppBase::Terminate()
 
 void D3D12AppBase::Render()
 {
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-
-  m_commandAllocators[m_frameIndex]->Reset();
-  m_commandList->Reset(
-    m_commandAllocators[m_frameIndex].Get(),
-    nullptr
-  );
+  BeginFrame();
 
   // スワップチェイン表示可能からレンダーターゲット描画可能へ
   auto barrierToRT = m_swapchain->GetBarrierToRenderTarget();
@@ -247,10 +364,9 @@ void D3D12AppBase::Render()
   ID3D12CommandList* lists[] = { m_commandList.Get() };
 
   m_commandQueue->ExecuteCommandLists(1, lists);
+  FinishFrame();
 
   m_swapchain->Present(1, 0);
-  m_swapchain->WaitPreviousFrame(m_commandQueue, m_frameIndex, GpuWaitTimeout);
-
 }
 
 D3D12AppBase::ComPtr<ID3D12Resource1> D3D12AppBase::CreateResource(
@@ -259,33 +375,18 @@ D3D12AppBase::ComPtr<ID3D12Resource1> D3D12AppBase::CreateResource(
   const D3D12_CLEAR_VALUE* clearValue,
   D3D12_HEAP_TYPE heapType )
 {
-  HRESULT hr;
-  ComPtr<ID3D12Resource1> ret;
-  const auto heapProps = CD3DX12_HEAP_PROPERTIES(heapType);
-  hr = m_device->CreateCommittedResource(
-    &heapProps,
-    D3D12_HEAP_FLAG_NONE,
-    &desc,
-    resourceStates,
-    clearValue,
-    IID_PPV_ARGS(&ret)
-  );
-  ThrowIfFailed(hr, "CreateCommittedResource Failed.");
-  return ret;
+  return m_resourceAllocator->CreateResource(desc, resourceStates, clearValue, heapType);
 }
 
-std::vector<ComPtr<ID3D12Resource1>> D3D12AppBase::CreateConstantBuffers(const CD3DX12_RESOURCE_DESC& desc, int count)
+TrackedResource D3D12AppBase::TrackResource(const ComPtr<ID3D12Resource1>& resource, D3D12_RESOURCE_STATES initialState)
 {
-  vector<ComPtr<ID3D12Resource1>> buffers;
-  for (int i = 0; i < count; ++i)
-  {
-    buffers.emplace_back(
-      CreateResource(desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, D3D12_HEAP_TYPE_UPLOAD)
-    );
-  }
-  return buffers;
+  return TrackedResource(resource, m_stateTracker, initialState);
 }
 
+void D3D12AppBase::FlushResourceBarriers(ID3D12GraphicsCommandList* command)
+{
+  TrackedResource::FlushBarriers(*m_stateTracker, command);
+}
 
 D3D12AppBase::ComPtr<ID3D12GraphicsCommandList> D3D12AppBase::CreateCommandList()
 {
@@ -305,15 +406,7 @@ void D3D12AppBase::FinishCommandList(ComPtr<ID3D12GraphicsCommandList>& command)
   };
   command->Close();
   m_commandQueue->ExecuteCommandLists(1, commandList);
-  HRESULT hr;
-  ComPtr<ID3D12Fence1> fence;
-  hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
-  ThrowIfFailed(hr, "CreateFence Failed.");
-  const UINT64 expectValue = 1;
-  m_commandQueue->Signal(fence.Get(), expectValue);
-  do
-  {
-  } while (fence->GetCompletedValue() != expectValue);
+  m_queueFence->Wait(m_queueFence->Signal(m_commandQueue));
   m_oneshotCommandAllocator->Reset();
 }
 
@@ -328,21 +421,104 @@ ComPtr<ID3D12GraphicsCommandList> D3D12AppBase::CreateBundleCommandList()
   return command;
 }
 
-void D3D12AppBase::WriteToUploadHeapMemory(ID3D12Resource1* resource, uint32_t size, const void* data)
+std::vector<ComPtr<ID3D12GraphicsCommandList>> D3D12AppBase::RecordParallel(const std::vector<RecordPass>& passes)
 {
-  void* mapped;
-  HRESULT hr = resource->Map(0, nullptr, &mapped);
-  if (SUCCEEDED(hr))
+  CPU_PROFILE_SCOPE("RecordParallel");
+  auto frame = GetCurrentFrame();
+  std::vector<ComPtr<ID3D12GraphicsCommandList>> lists(passes.size());
+  m_workerThreads->ParallelFor(UINT(passes.size()), [&](UINT index) {
+    CPU_PROFILE_SCOPE("RecordPass");
+    auto command = frame->AcquireCommandList();
+    ID3D12DescriptorHeap* heaps[] = { m_heap->GetHeap().Get() };
+    command->SetDescriptorHeaps(_countof(heaps), heaps);
+
+    passes[index](command.Get());
+    command->Close();
+    lists[index] = command;
+  });
+  return lists;
+}
+
+void D3D12AppBase::ExecuteCommandLists(const std::vector<ComPtr<ID3D12GraphicsCommandList>>& lists)
+{
+  CPU_PROFILE_SCOPE("ExecuteCommandLists");
+  std::vector<ID3D12CommandList*> commandLists;
+  for (auto& v : lists)
   {
-    memcpy(mapped, data, size);
-    resource->Unmap(0, nullptr);
+    commandLists.push_back(v.Get());
   }
-  ThrowIfFailed(hr, "Map Failed.");
+  m_commandQueue->ExecuteCommandLists(UINT(commandLists.size()), commandLists.data());
+}
+
+UploadQueue::Token D3D12AppBase::FlushUploads()
+{
+  auto token = m_uploadQueue->Submit();
+  m_uploadQueue->WaitOnQueue(m_commandQueue, token);
+  return token;
+}
+
+void D3D12AppBase::BeginFrame()
+{
+  auto frame = m_frames[m_frameIndex];
+  frame->Begin(GpuWaitTimeout);
+  m_dynamicBuffer = frame->GetDynamicBuffer();
+  // 待ち終えたフレームの計測結果を回収する.
+  m_gpuProfiler->BeginFrame(m_frameIndex);
+
+  m_commandList->Reset(frame->GetCommandAllocator().Get(), nullptr);
+}
+
+void D3D12AppBase::FinishFrame()
+{
+  // 計測結果のコピーは、このフレームの全コマンドの後に実行する.
+  if (m_gpuProfiler->HasScopes())
+  {
+    auto command = m_frames[m_frameIndex]->AcquireCommandList();
+    m_gpuProfiler->Resolve(command.Get());
+    command->Close();
+    ID3D12CommandList* lists[] = { command.Get() };
+    m_commandQueue->ExecuteCommandLists(1, lists);
+  }
+
+  auto fenceValue = m_queueFence->Signal(m_commandQueue);
+  m_frames[m_frameIndex]->Finish(fenceValue);
+  m_descriptorRing->FinishFrame(fenceValue);
+  // グラフの構成変化で外れた一時リソースは、このフレームの完了後に解放する.
+  for (auto& resource : m_renderGraph->TakeRetiredResources())
+  {
+    m_frames[m_frameIndex]->DeferRelease(resource);
+  }
+  m_frameIndex = (m_frameIndex + 1) % m_frameLatency;
+
+  m_uploadQueue->ReleaseCompleted();
+}
+
+void D3D12AppBase::SetFrameLatency(UINT frameLatency)
+{
+  frameLatency = std::min(std::max(frameLatency, 1u), MaxFrameLatency);
+  if (frameLatency == m_frameLatency)
+  {
+    return;
+  }
+  m_frameLatency = frameLatency;
+  if (!m_swapchain)
+  {
+    return;
+  }
+
+  // 処理中のフレームを全て待ってから作り直す.
+  WaitForIdleGPU();
+  CreateFrameContexts();
+  m_swapchain->ResizeBuffers(m_width, m_height, std::max(m_frameLatency, 2u));
 }
 
 void D3D12AppBase::PrepareDescriptorHeaps()
 {
-  const int MaxDescriptorCount = 2048; // SRV,CBV,UAV など.
+  const int MaxDescriptorCount = 4096; // SRV,CBV,UAV など.
+  const int DescriptorRangeCapacity = 2048; // うちディスクリプタテーブル用の連続領域.
+  const int DescriptorRingCapacity = 1024; // 連続領域のうちフレーム毎のテーブル用.
+  // CPU からのみ参照するヒープは 1 ページの数. 足りなければページを追加して拡張する.
+  const int MaxDescriptorCountStaging = 1024;
   const int MaxDescriptorCountRTV = 100;
   const int MaxDescriptorCountDSV = 100;
 
@@ -371,7 +547,18 @@ void D3D12AppBase::PrepareDescriptorHeaps()
     D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
     0
   };
-  m_heap = std::make_shared<DescriptorManager>(m_device, heapDesc);
+  m_heap = std::make_shared<DescriptorManager>(m_device, heapDesc, DescriptorRangeCapacity);
+  m_descriptorRing = std::make_shared<DescriptorRing>(
+    m_device, heapDesc.Type, m_heap->Alloc(DescriptorRingCapacity), m_queueFence);
+
+  // ステージング用のディスクリプタヒープ (CPU からのみ参照)
+  D3D12_DESCRIPTOR_HEAP_DESC heapDescStaging{
+    D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+    MaxDescriptorCountStaging,
+    D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+    0
+  };
+  m_stagingHeap = std::make_shared<DescriptorManager>(m_device, heapDescStaging);
 }
 
 void D3D12AppBase::CreateDefaultDepthBuffer(int width, int height)
@@ -390,18 +577,12 @@ void D3D12AppBase::CreateDefaultDepthBuffer(int width, int height)
   depthClearValue.DepthStencil.Depth = 1.0f;
   depthClearValue.DepthStencil.Stencil = 0;
 
-  const auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-
-  HRESULT hr;
-  hr = m_device->CreateCommittedResource(
-    &heapProps,
-    D3D12_HEAP_FLAG_NONE,
-    &depthBufferDesc,
+  m_depthBuffer = CreateResource(
+    depthBufferDesc,
     D3D12_RESOURCE_STATE_DEPTH_WRITE,
     &depthClearValue,
-    IID_PPV_ARGS(&m_depthBuffer)
+    D3D12_HEAP_TYPE_DEFAULT
   );
-  ThrowIfFailed(hr, "CreateCommittedResource 失敗");
 
   // デプスステンシルビュー生成
   m_defaultDepthDSV = m_heapDSV->Alloc();
@@ -420,18 +601,6 @@ void D3D12AppBase::CreateDefaultDepthBuffer(int width, int height)
 void D3D12AppBase::CreateCommandAllocators()
 {
   HRESULT hr;
-  m_commandAllocators.resize(FrameBufferCount);
-  for (UINT i = 0; i < FrameBufferCount; ++i)
-  {
-    hr = m_device->CreateCommandAllocator(
-      D3D12_COMMAND_LIST_TYPE_DIRECT,
-      IID_PPV_ARGS(&m_commandAllocators[i])
-    );
-    if (FAILED(hr))
-    {
-      throw std::runtime_error("Failed CreateCommandAllocator");
-    }
-  }
   hr = m_device->CreateCommandAllocator(
     D3D12_COMMAND_LIST_TYPE_DIRECT,
     IID_PPV_ARGS(&m_oneshotCommandAllocator)
@@ -444,21 +613,24 @@ void D3D12AppBase::CreateCommandAllocators()
   );
   ThrowIfFailed(hr, "CreateCommandAllocator Failed(bundle)");
 }
+
+void D3D12AppBase::CreateFrameContexts()
+{
+  m_frames.clear();
+  for (UINT i = 0; i < m_frameLatency; ++i)
+  {
+    m_frames.emplace_back(
+      std::make_shared<FrameContext>(m_device, m_queueFence, DynamicBufferSize)
+    );
+  }
+  m_frameIndex = 0;
+  m_dynamicBuffer = m_frames[m_frameIndex]->GetDynamicBuffer();
+}
  
 void D3D12AppBase::WaitForIdleGPU()
 {
   // 全ての発行済みコマンドの終了を待つ.
-  ComPtr<ID3D12Fence1> fence;
-  const UINT64 expectValue = 1;
-  HRESULT hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
-  ThrowIfFailed(hr, "CreateFence 失敗");
-
-  m_commandQueue->Signal(fence.Get(), expectValue);
-  if (fence->GetCompletedValue() != expectValue)
-  {
-    fence->SetEventOnCompletion(expectValue, m_waitFence);
-    WaitForSingleObject(m_waitFence, INFINITE);
-  }
+  m_queueFence->Wait(m_queueFence->Signal(m_commandQueue));
 }
 void D3D12AppBase::OnSizeChanged(UINT width, UINT height, bool isMinimized)
 {
@@ -471,13 +643,11 @@ void D3D12AppBase::OnSizeChanged(UINT width, UINT height, bool isMinimized)
   WaitForIdleGPU();
   m_swapchain->ResizeBuffers(width, height);
 
-  // デプスバッファの作り直し.
+  // デプスバッファの作り直し. GPU の完了は待ったので、領域は参照を外せば返却される.
   m_depthBuffer.Reset();
   m_heapDSV->Free(m_defaultDepthDSV);
   CreateDefaultDepthBuffer(m_width, m_height);
 
-  m_frameIndex = m_swapchain->GetCurrentBackBufferIndex();
-
   m_viewport.Width = float(m_width);
   m_viewport.Height = float(m_height);
   m_scissorRect.right = m_width;
@@ -509,6 +679,116 @@ void D3D12AppBase::ToggleFullscreen()
   OnSizeChanged(m_width, m_height, false);
 }
 
+void D3D12AppBase::DrawProfilerHUD()
+{
+  m_gpuProfiler->DrawImGui();
+
+  // ヒープサイズを決める目安として、ディスクリプタの使用状況を表示する.
+  ImGui::Begin("Descriptor Heaps");
+  ImGui::Columns(6, "DescriptorHeaps");
+  ImGui::Text("Heap"); ImGui::NextColumn();
+  ImGui::Text("Live"); ImGui::NextColumn();
+  ImGui::Text("Peak"); ImGui::NextColumn();
+  ImGui::Text("FreeList"); ImGui::NextColumn();
+  ImGui::Text("Capacity"); ImGui::NextColumn();
+  ImGui::Text("Range"); ImGui::NextColumn();
+  ImGui::Separator();
+  const std::pair<const char*, std::shared_ptr<DescriptorManager>> heaps[] = {
+    { "CBV/SRV/UAV", m_heap },
+    { "Staging", m_stagingHeap },
+    { "RTV", m_heapRTV },
+    { "DSV", m_heapDSV },
+  };
+  for (const auto& heap : heaps)
+  {
+    auto stats = heap.second->GetStatistics();
+    ImGui::Text("%s", heap.first); ImGui::NextColumn();
+    ImGui::Text("%u", stats.liveCount); ImGui::NextColumn();
+    ImGui::Text("%u", stats.peakCount); ImGui::NextColumn();
+    ImGui::Text("%u", stats.freeListCount); ImGui::NextColumn();
+    ImGui::Text("%u (%u pages)", stats.capacity, stats.pageCount); ImGui::NextColumn();
+    ImGui::Text("%u / %u", stats.rangeUsed, stats.rangeCapacity); ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  ImGui::Text("Ring %u / %u", m_descriptorRing->GetUsedCount(), m_descriptorRing->GetCapacity());
+  ImGui::End();
+
+  auto cacheStats = ShaderCache::Get().GetStatistics();
+  ImGui::Begin("Shader Cache");
+  if (Shader::IsPrecompiledMode())
+  {
+    cacheStats = Shader::GetPrecompiledStore().GetStatistics();
+    ImGui::Text("Precompiled (%s)", Shader::PrecompiledDirectory);
+  }
+  else
+  {
+    ImGui::Text("%s", ShaderCache::Get().IsEnabled() ? "Enabled" : "Disabled (-noShaderCache)");
+  }
+  ImGui::Text("Hits %u, Misses %u (Corrupted %u), Writes %u",
+    cacheStats.hits, cacheStats.misses, cacheStats.corrupted, cacheStats.writes);
+  const auto sourceStats = ShaderSourceCache::Get().GetStatistics();
+  ImGui::Text("Source files loaded %u, reused %u", sourceStats.loads, sourceStats.hits);
+  const auto pipelineStats = m_pipelineCache->GetStatistics();
+  ImGui::Text("Pipelines %s: Hits %u, Misses %u (Rejected %u), Uncached %u",
+    !m_pipelineCache->IsEnabled() ? "(disabled)" : m_pipelineCache->IsUsingLibrary() ? "(library)" : "(blobs)",
+    pipelineStats.hits, pipelineStats.misses, pipelineStats.rejected, pipelineStats.uncached);
+  const auto rootSignatureStats = m_rootSignatureCache->GetStatistics();
+  ImGui::Text("Root signatures %u (requests %u, version %s)",
+    rootSignatureStats.created, rootSignatureStats.requests,
+    m_rootSignatureCache->GetVersion() == D3D_ROOT_SIGNATURE_VERSION_1_1 ? "1.1" : "1.0");
+  if (m_shaderHotReload->IsEnabled())
+  {
+    const auto reloadStatus = m_shaderHotReload->GetStatus();
+    ImGui::Text("Hot reload: %u reloaded, %u failed", reloadStatus.reloadCount, reloadStatus.failureCount);
+    if (!reloadStatus.lastError.empty())
+    {
+      ImGui::TextWrapped("%s", reloadStatus.lastError.c_str());
+    }
+  }
+  ImGui::Text("Compiler threads %u, Requests %u, Compiled %u",
+    m_shaderCompiler->GetThreadCount(), m_shaderCompiler->GetRequestCount(), m_shaderCompiler->GetCompileCount());
+  ImGui::End();
+
+#if ENABLE_CPU_PROFILER
+  const uint64_t updateInterval = 500 * 1000 * 1000; // 0.5s
+  auto& profiler = CpuProfiler::Get();
+  const auto now = CpuProfiler::Now();
+  if (now - m_cpuZoneStatsTime > updateInterval)
+  {
+    m_cpuZoneStats = profiler.ComputeStats();
+    m_cpuZoneStatsTime = now;
+  }
+
+  ImGui::Begin("CPU Profiler");
+  ImGui::Columns(5, "CpuZones");
+  ImGui::Text("Zone"); ImGui::NextColumn();
+  ImGui::Text("p50(ms)"); ImGui::NextColumn();
+  ImGui::Text("p95(ms)"); ImGui::NextColumn();
+  ImGui::Text("p99(ms)"); ImGui::NextColumn();
+  ImGui::Text("Max(ms)"); ImGui::NextColumn();
+  ImGui::Separator();
+  for (const auto& zone : m_cpuZoneStats)
+  {
+    ImGui::Text("%s", zone.name.c_str()); ImGui::NextColumn();
+    ImGui::Text("%.3f", zone.p50Ms); ImGui::NextColumn();
+    ImGui::Text("%.3f", zone.p95Ms); ImGui::NextColumn();
+    ImGui::Text("%.3f", zone.p99Ms); ImGui::NextColumn();
+    ImGui::Text("%.3f", zone.maxMs); ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  if (ImGui::Button("Export Trace"))
+  {
+    profiler.ExportChromeTrace("cpu_trace.json");
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear"))
+  {
+    profiler.Clear();
+  }
+  ImGui::End();
+#endif
+}
+
 void D3D12AppBase::PrepareImGui()
 {
   auto descriptorImGui = m_heap->Alloc();
@@ -521,7 +801,7 @@ void D3D12AppBase::PrepareImGui()
 
   ImGui_ImplDX12_Init(
     m_device.Get(),
-    FrameBufferCount,
+    MaxFrameLatency,  // 後からレイテンシを変更しても足りるように最大数で確保.
     m_surfaceFormat,
     hCpu, hGpu);
 }
@@ -532,106 +812,3 @@ void D3D12AppBase::CleanupImGui()
   ImGui_ImplWin32_Shutdown();
   ImGui::DestroyContext();
 }
-
-
-void Shader::load(const std::wstring& fileName, Stage stage,
-  const std::wstring& entryPoint,
-  const std::vector<std::wstring>& flags,
-  const std::vector<DefineMacro>& defines)
-{
-  path filePath(fileName);
-  std::ifstream infile(filePath, std::ios::binary);
-  std::vector<char> sourceCode;
-  if (!infile)
-    throw std::runtime_error("shader not found");
-  sourceCode.resize(uint32_t(infile.seekg(0, infile.end).tellg()));
-  infile.seekg(0, infile.beg).read(sourceCode.data(), sourceCode.size());
-
-  // DXC によるコンパイル処理
-  ComPtr<IDxcLibrary> library;
-  ComPtr<IDxcCompiler> compiler;
-  ComPtr<IDxcBlobEncoding> source;
-  ComPtr<IDxcOperationResult> dxcResult;
-
-  DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library));
-  library->CreateBlobWithEncodingFromPinned(sourceCode.data(), UINT(sourceCode.size()), CP_UTF8, &source);
-  DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-
-  wstring profile;
-  switch (stage)
-  {
-  default:
-  case Shader::Vertex:
-    profile = L"vs_6_0";
-    break;
-  case Shader::Geometry:
-    profile = L"gs_6_0";
-    break;
-  case Shader::Pixel:
-    profile = L"ps_6_0";
-    break;
-  case Shader::Domain:
-    profile = L"ds_6_0";
-    break;
-  case Shader::Hull:
-    profile = L"hs_6_0";
-    break;
-  case Shader::Compute:
-    profile = L"cs_6_0";
-    break;
-  }
-  vector<LPCWSTR> compilerFlags;
-  for (auto& v : flags)
-  {
-    compilerFlags.push_back(v.c_str());
-  }
-#if _DEBUG
-  compilerFlags.push_back(L"/Zi");
-  compilerFlags.push_back(L"/O0");
-#else
-  compilerFlags.push_back(L"/O2");
-#endif
-  vector<DxcDefine> defineMacros;
-  for (const auto & v : defines)
-  {
-    defineMacros.push_back(
-      DxcDefine{
-        v.Name.c_str(),
-        v.Value.c_str()
-      });
-  }
-
-  compiler->Compile(
-    source.Get(), filePath.wstring().c_str(),
-    entryPoint.c_str(),
-    profile.c_str(),
-    compilerFlags.data(), UINT(compilerFlags.size()),
-    defineMacros.data(), UINT(defineMacros.size()),
-    nullptr,
-    &dxcResult
-  );
-
-  ComPtr<IDxcBlobEncoding> errBlob;
-  HRESULT hr;
-
-  hr = dxcResult->GetErrorBuffer(&errBlob);
-  if (SUCCEEDED(hr))
-  {
-    ComPtr<IDxcBlobEncoding> msgBlob;
-    library->GetBlobAsUtf16(errBlob.Get(), &msgBlob);
-
-    std::wstring msg((const wchar_t*)msgBlob->GetBufferPointer());
-    OutputDebugStringW(msg.c_str());
-  }
-
-  dxcResult->GetStatus(&hr);
-  if (SUCCEEDED(hr)) {
-    hr = dxcResult->GetResult(
-      reinterpret_cast<IDxcBlob**>(m_code.GetAddressOf())
-    );
-  }
-  if (FAILED(hr))
-  {
-    throw runtime_error("shader compile failed.");
-  }
-}
@@ -8,8 +8,27 @@
 #include <wrl.h>
 
 #include "DescriptorManager.h"
+#include "DescriptorRing.h"
 #include "Swapchain.h"
+#include "UploadRingBuffer.h"
+#include "UploadQueue.h"
+#include "TimelineFence.h"
+#include "ResourceAllocator.h"
+#include "FrameContext.h"
+#include "WorkerThreadPool.h"
+#include "ShaderCompileService.h"
+#include "RenderGraphExecutor.h"
+#include "TrackedResource.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "ShaderCompiler.h"
+#include "Shader.h"
+#include "PipelineCache.h"
+#include "RootSignatureCache.h"
+#include "ShaderHotReload.h"
 #include <memory>
+#include <functional>
+
 
 
 #pragma comment(lib, "d3d12.lib")
@@ -33,7 +52,9 @@ public:
   virtual void Cleanup() { }
 
   const UINT GpuWaitTimeout = (10 * 1000);  // 10s
-  static const UINT FrameBufferCount = 2;
+  static const UINT DefaultFrameLatency = 2;
+  static const UINT MaxFrameLatency = 4;
+  const UINT64 DynamicBufferSize = 4 * 1024 * 1024; // t[.
 
   virtual void OnSizeChanged(UINT width, UINT height, bool isMinimized);
   virtual void OnMouseButtonDown(UINT msg) { }
@@ -47,6 +68,20 @@ public:
   ComPtr<ID3D12Device> GetDevice() { return m_device; }
   std::shared_ptr<Swapchain> GetSwapchain() { return m_swapchain; }
 
+  // ɏƂt[ (1`MaxFrameLatency).
+  // Initialize OȂN̒lAォĂԂ GPU ̊҂Ă蒼.
+  // N "-frameLatency N" łwł. t[̋L^ɂ͌Ă΂Ȃ.
+  void SetFrameLatency(UINT frameLatency);
+  UINT GetFrameLatency() const { return m_frameLatency; }
+  std::shared_ptr<FrameContext> GetCurrentFrame() { return m_frames[m_frameIndex]; }
+
+  // SM 6.6  ResourceDescriptorHeap ŃeNX`QƂ(oChX)`g.
+  // N "-bindless" ŗvAfoCXΉĂƂ̂ݗLɂȂ.
+  bool IsBindlessSupported() const { return m_isBindlessSupported; }
+  bool IsBindlessEnabled() const { return m_isBindlessRequested && m_isBindlessSupported; }
+  // Shader::SelectVariant ɓn. N "-baselineShaders" Ȃ SM 6.0 ̔łg悤A@\𖳂̂Ƃ.
+  const ShaderFeatures& GetShaderFeatures() const { return m_shaderFeatures; }
+
   // \[X
   ComPtr<ID3D12Resource1> CreateResource(
     const CD3DX12_RESOURCE_DESC& desc, 
@@ -54,19 +89,71 @@ public:
     const D3D12_CLEAR_VALUE* clearValue,
     D3D12_HEAP_TYPE heapType
   );
-  std::vector<ComPtr<ID3D12Resource1>> CreateConstantBuffers(
-    const CD3DX12_RESOURCE_DESC& desc,
-    int count = FrameBufferCount
-  );
 
   // R}hobt@֘A
   ComPtr<ID3D12GraphicsCommandList>  CreateCommandList();
   void FinishCommandList(ComPtr<ID3D12GraphicsCommandList>& command);
   ComPtr<ID3D12GraphicsCommandList> CreateBundleCommandList();
 
-  void WriteToUploadHeapMemory(ID3D12Resource1* resource, uint32_t size, const void* pData);
+  // `pX[J[XbhŕɋL^.
+  // epX͐p̃Xg󂯎(fBXNv^q[vݒς)A߂l passes ̏ Close ς.
+  using RecordPass = std::function<void(ID3D12GraphicsCommandList* command)>;
+  std::vector<ComPtr<ID3D12GraphicsCommandList>> RecordParallel(const std::vector<RecordPass>& passes);
+  // L^ς݂̃Xgя̂܂ 1  ExecuteCommandLists Ŕs.
+  void ExecuteCommandLists(const std::vector<ComPtr<ID3D12GraphicsCommandList>>& lists);
+
+  // ݂̃t[̃R}hgI܂ŉx点.
+  template<class T>
+  void DeferRelease(const ComPtr<T>& object)
+  {
+    GetCurrentFrame()->DeferRelease(object);
+  }
 
   std::shared_ptr<DescriptorManager> GetDescriptorManager() { return m_heap; }
+  // iIȃr[Ă CPU p̃q[v. e[uւ GetDescriptorRing ŃRs[Ďg.
+  std::shared_ptr<DescriptorManager> GetStagingDescriptorManager() { return m_stagingHeap; }
+  std::shared_ptr<DescriptorRing> GetDescriptorRing() { return m_descriptorRing; }
+  std::shared_ptr<UploadRingBuffer> GetDynamicBuffer() { return GetCurrentFrame()->GetDynamicBuffer(); }
+  std::shared_ptr<UploadQueue> GetUploadQueue() { return m_uploadQueue; }
+  std::shared_ptr<ResourceAllocator> GetResourceAllocator() { return m_resourceAllocator; }
+  std::shared_ptr<RenderGraphExecutor> GetRenderGraph() { return m_renderGraph; }
+  std::shared_ptr<ResourceStateTracker> GetStateTracker() { return m_stateTracker; }
+  std::shared_ptr<GpuProfiler> GetGpuProfiler() { return m_gpuProfiler; }
+  // t[̕񏈗ƃVF[_[̃RpCŋL郏[J[Xbh.
+  std::shared_ptr<WorkerThreadPool> GetWorkerThreads() { return m_workerThreads; }
+  // VF[_[ GetWorkerThreads ̃XbhŕɃRpC. v 1 xRpC.
+  std::shared_ptr<ShaderCompileService> GetShaderCompiler() { return m_shaderCompiler; }
+  // PSO  CreateGraphicsPipelineState ̑ɂʂčƁAN琶Ȃ.
+  // N "-noPipelineCache" Ŗɂł.
+  std::shared_ptr<PipelineCache> GetPipelineCache() { return m_pipelineCache; }
+  // VF[_[̃tNV烋[gVOl`. ê͋L.
+  std::shared_ptr<RootSignatureCache> GetRootSignatureCache() { return m_rootSignatureCache; }
+  // VF[_[̍XV PSO 蒼. fobOrhA܂͋N "-hotReload" ŗLɂȂ.
+  std::shared_ptr<ShaderHotReload> GetShaderHotReload() { return m_shaderHotReload; }
+  // BeginFrame ̌ɌĂ. 蒼ꂽ PSO  pipelines ֍ւAÂ̂͂̃t[̊ɉ.
+  template<class PipelineMap>
+  void ApplyReloadedPipelines(PipelineMap& pipelines)
+  {
+    for (auto& v : m_shaderHotReload->TakeCompleted())
+    {
+      auto& pipeline = pipelines[v.first];
+      if (pipeline)
+      {
+        GetCurrentFrame()->DeferRelease(pipeline);
+      }
+      pipeline = v.second;
+    }
+  }
+  // GPU ̃pX̎Ԃ CPU ̋Ԃ̓v ImGui ŕ\. ImGui::NewFrame  Render ̊ԂŌĂ.
+  void DrawProfilerHUD();
+
+  // ԂǐՂ郊\[XƂĕ.
+  TrackedResource TrackResource(const ComPtr<ID3D12Resource1>& resource, D3D12_RESOURCE_STATES initialState);
+  // TrackedResource::Transition Őς܂ꂽJڂ܂Ƃ߂ċL^.
+  void FlushResourceBarriers(ID3D12GraphicsCommandList* command);
+
+  // ς܂ꂽ]𔭍sA`pL[ GPU Ŋ҂.
+  UploadQueue::Token FlushUploads();
 
   using Buffer = ComPtr<ID3D12Resource1>;
   using Texture = ComPtr<ID3D12Resource1>;
@@ -87,35 +174,17 @@ public:
     ModelData model;
     auto bufferSize = uint32_t(sizeof(T)*vertices.size());
     auto vbDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-    auto srcHeapType = D3D12_HEAP_TYPE_UPLOAD;
     auto dstHeapType = D3D12_HEAP_TYPE_DEFAULT;
 
-    model.resourceVB = CreateResource(vbDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, dstHeapType);
-    auto uploadVB = CreateResource(vbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, srcHeapType);
-    WriteToUploadHeapMemory(uploadVB.Get(), bufferSize, vertices.data());
+    // ] COPY L[ɂ܂Ƃ߂Đς݁A FlushUploads Ŕs.
+    // obt@ COMMON 璸_ECfbNXobt@ֈÖقɏi.
+    model.resourceVB = CreateResource(vbDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, dstHeapType);
+    m_uploadQueue->UploadBuffer(model.resourceVB.Get(), vertices.data(), bufferSize);
 
     bufferSize = UINT(sizeof(UINT)*indices.size());
     auto ibDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-    model.resourceIB = CreateResource(ibDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, dstHeapType);
-    auto uploadIB = CreateResource(ibDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, srcHeapType);
-    WriteToUploadHeapMemory(uploadIB.Get(), bufferSize, indices.data());
-
-    auto command = CreateCommandList();
-    command->CopyResource(model.resourceVB.Get(), uploadVB.Get());
-    command->CopyResource(model.resourceIB.Get(), uploadIB.Get());
-
-    D3D12_RESOURCE_BARRIER barriers[] = {
-      CD3DX12_RESOURCE_BARRIER::Transition(
-        model.resourceVB.Get(), 
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
-      CD3DX12_RESOURCE_BARRIER::Transition(
-        model.resourceIB.Get(),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        D3D12_RESOURCE_STATE_INDEX_BUFFER)
-    };
-    command->ResourceBarrier(_countof(barriers), barriers);
-    FinishCommandList(command);
+    model.resourceIB = CreateResource(ibDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, dstHeapType);
+    m_uploadQueue->UploadBuffer(model.resourceIB.Get(), indices.data(), bufferSize);
 
     model.indexCount = UINT(indices.size());
     model.vertexCount = UINT(vertices.size());
@@ -136,7 +205,12 @@ protected:
   
   void CreateDefaultDepthBuffer(int width, int height);
   void CreateCommandAllocators();
+  void CreateFrameContexts();
   void WaitForIdleGPU();
+  // t[̋L^JnɌĂяo. gpt[̊҂AR}hXgZbg.
+  void BeginFrame();
+  // R}hsɌĂяo. tFXlt[ɋL^Ãt[֐i߂.
+  void FinishFrame();
 
   // ImGui
   void PrepareImGui();
@@ -155,17 +229,44 @@ protected:
   DXGI_FORMAT  m_surfaceFormat;
 
   
-  std::vector<ComPtr<ID3D12CommandAllocator>> m_commandAllocators;
   ComPtr<ID3D12CommandAllocator> m_oneshotCommandAllocator;
   ComPtr<ID3D12CommandAllocator> m_bundleCommandAllocator;
 
   std::shared_ptr<DescriptorManager> m_heapRTV;
   std::shared_ptr<DescriptorManager> m_heapDSV;
   std::shared_ptr<DescriptorManager> m_heap;
+  std::shared_ptr<DescriptorManager> m_stagingHeap;
+  // m_heap ̈ꕔgAt[̃fBXNv^e[up̃O.
+  std::shared_ptr<DescriptorRing> m_descriptorRing;
 
   DescriptorHandle m_defaultDepthDSV;
   ComPtr<ID3D12GraphicsCommandList> m_commandList;
-  HANDLE m_waitFence;
+
+  // m_commandQueue ̐is\tFX.
+  std::shared_ptr<TimelineFence> m_queueFence;
+
+  std::vector<std::shared_ptr<FrameContext>> m_frames;
+  std::shared_ptr<WorkerThreadPool> m_workerThreads;
+  UINT m_frameLatency;
+  // ݂̃t[At[萔obt@p̃O.
+  std::shared_ptr<UploadRingBuffer> m_dynamicBuffer;
+  std::shared_ptr<UploadQueue> m_uploadQueue;
+  // `p\[X̓q[vւ܂Ƃ߂Ĕzu.
+  std::shared_ptr<ResourceAllocator> m_resourceAllocator;
+  // t[ɃpXo^AoAŋ߂.
+  std::shared_ptr<RenderGraphExecutor> m_renderGraph;
+  std::shared_ptr<ResourceStateTracker> m_stateTracker;
+  // pX GPU Ԃ̌v.
+  std::shared_ptr<GpuProfiler> m_gpuProfiler;
+  std::shared_ptr<ShaderCompileService> m_shaderCompiler;
+  std::shared_ptr<PipelineCache> m_pipelineCache;
+  std::shared_ptr<RootSignatureCache> m_rootSignatureCache;
+  std::shared_ptr<ShaderHotReload> m_shaderHotReload;
+#if ENABLE_CPU_PROFILER
+  // Wv͏d̂ňԊuōXV.
+  std::vector<CpuProfiler::ZoneStats> m_cpuZoneStats;
+  uint64_t m_cpuZoneStatsTime = 0;
+#endif
 
   UINT m_frameIndex;
 
@@ -173,32 +274,8 @@ protected:
   UINT m_width;
   UINT m_height;
   bool m_isAllowTearing;
+  bool m_isBindlessRequested;
+  bool m_isBindlessSupported;
+  ShaderFeatures m_shaderFeatures;
   HWND m_hwnd;
 };
-
-class Shader
-{
-public:
-  Shader() = default;
-  enum Stage
-  {
-    Vertex, Geometry, Pixel,
-    Domain, Hull,
-    Compute,
-  };
-
-  struct DefineMacro {
-    std::wstring Name;
-    std::wstring Value;
-  };
-
-  void load(const std::wstring& fileName, Stage stage,
-    const std::wstring& entryPoint,
-    const std::vector<std::wstring>& flags,
-    const std::vector<DefineMacro>& defines);
-
-  const Microsoft::WRL::ComPtr<ID3DBlob>& getCode() const { return m_code; }
-
-private:
-  Microsoft::WRL::ComPtr<ID3DBlob> m_code;
-};
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// ディスクリプタヒープ内のインデックスを管理する空きリスト. 複数スレッドから同時に使える.
+// 解放されたインデックスを、そのインデックス自身を添字とする配列で繋ぐ(侵入型スタック)ため、
+// 確保・解放のどちらでもメモリ確保を行わない.
+// 先頭はインデックスと更新回数を 64bit にまとめて CAS で書き換え、ABA 問題を避ける.
+class LockFreeDescriptorFreeList
+{
+public:
+  static const uint32_t InvalidIndex = ~0u;
+
+  explicit LockFreeDescriptorFreeList(uint32_t capacity)
+    : m_next(new std::atomic<uint32_t>[capacity]), m_head(Pack(InvalidIndex, 0)), m_used(0), m_capacity(capacity)
+  {
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+      m_next[i].store(InvalidIndex, std::memory_order_relaxed);
+    }
+  }
+
+  uint32_t Alloc()
+  {
+    auto head = m_head.load(std::memory_order_acquire);
+    while (GetIndex(head) != InvalidIndex)
+    {
+      const auto index = GetIndex(head);
+      const auto next = m_next[index].load(std::memory_order_relaxed);
+      if (m_head.compare_exchange_weak(head, Pack(next, GetTag(head) + 1), std::memory_order_acquire, std::memory_order_acquire))
+      {
+        return index;
+      }
+    }
+
+    // 空きリストが空なら未使用領域から切り出す.
+    auto used = m_used.load(std::memory_order_relaxed);
+    while (used < m_capacity)
+    {
+      if (m_used.compare_exchange_weak(used, used + 1, std::memory_order_relaxed))
+      {
+        return used;
+      }
+    }
+    return InvalidIndex;
+  }
+
+  void Free(uint32_t index)
+  {
+    auto head = m_head.load(std::memory_order_relaxed);
+    do
+    {
+      m_next[index].store(GetIndex(head), std::memory_order_relaxed);
+    } while (!m_head.compare_exchange_weak(head, Pack(index, GetTag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  uint32_t GetCapacity() const { return m_capacity; }
+  // 一度でも払い出したインデックスの数. 使用中の数との差が空きリストに積まれている数.
+  uint32_t GetTouchedCount() const { return m_used.load(std::memory_order_relaxed); }
+private:
+  static uint64_t Pack(uint32_t index, uint32_t tag) { return (uint64_t(tag) << 32) | index; }
+  static uint32_t GetIndex(uint64_t v) { return uint32_t(v); }
+  static uint32_t GetTag(uint64_t v) { return uint32_t(v >> 32); }
+
+  std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+  std::atomic<uint64_t> m_head;
+  std::atomic<uint32_t> m_used;
+  uint32_t m_capacity;
+};
@@ -0,0 +1,81 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// ヒープの識別子、ヒープ内の位置、世代を 32bit にまとめたディスクリプタの参照.
+// CPU/GPU ハンドルは払い出した DescriptorManager から必要な時に求める.
+// 世代はスロットを確保・解放する度に進むため、解放後の参照や二重解放を検出できる.
+class DescriptorId
+{
+public:
+  static const uint32_t HeapBits = 4;
+  static const uint32_t IndexBits = 20;
+  static const uint32_t GenerationBits = 8;
+  static const uint32_t MaxIndex = (1u << IndexBits) - 1;
+  static const uint32_t MaxHeapId = (1u << HeapBits) - 1;
+
+  DescriptorId() : m_value(~0u) {}
+  DescriptorId(uint32_t heapId, uint32_t index, uint32_t generation)
+    : m_value((heapId << (IndexBits + GenerationBits)) | (index << GenerationBits) | (generation & 0xFF))
+  {
+  }
+
+  bool IsValid() const { return m_value != ~0u; }
+  uint32_t GetHeapId() const { return m_value >> (IndexBits + GenerationBits); }
+  uint32_t GetIndex() const { return (m_value >> GenerationBits) & MaxIndex; }
+  uint32_t GetGeneration() const { return m_value & 0xFF; }
+  uint32_t GetValue() const { return m_value; }
+
+  bool operator==(const DescriptorId& rhs) const { return m_value == rhs.m_value; }
+  bool operator!=(const DescriptorId& rhs) const { return m_value != rhs.m_value; }
+private:
+  uint32_t m_value;
+};
+
+// スロット毎の世代. 偶数なら空き、奇数なら使用中. 確保と解放で 1 ずつ進める.
+// DescriptorManager のページが持つ. D3D12 に依存しないので単体でテストできる.
+class DescriptorGenerationTable
+{
+public:
+  explicit DescriptorGenerationTable(uint32_t capacity)
+    : m_generations(new std::atomic<uint8_t>[capacity])
+  {
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+      m_generations[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // 空きから使用中へ進め、使用中の世代を返す. 空きリストから得たスロットに対して呼ぶ.
+  uint8_t Acquire(uint32_t index)
+  {
+    return uint8_t(m_generations[index].fetch_add(1, std::memory_order_acq_rel) + 1);
+  }
+
+  // 使用中で世代が expected と一致すれば空きへ進めて true.
+  // 既に空いている(二重解放)、世代が異なる(解放後に再利用されたスロットへの古い参照)なら false.
+  bool Release(uint32_t index, uint8_t expected)
+  {
+    auto& generation = m_generations[index];
+    auto current = generation.load(std::memory_order_acquire);
+    do
+    {
+      if ((current & 1) == 0 || current != expected)
+      {
+        return false;
+      }
+    } while (!generation.compare_exchange_weak(current, uint8_t(current + 1), std::memory_order_acq_rel));
+    return true;
+  }
+
+  // generation がスロットの使用中の世代と一致するか.
+  bool IsCurrent(uint32_t index, uint8_t generation) const
+  {
+    const auto current = m_generations[index].load(std::memory_order_acquire);
+    return (current & 1) != 0 && current == generation;
+  }
+  uint8_t Get(uint32_t index) const { return m_generations[index].load(std::memory_order_acquire); }
+private:
+  std::unique_ptr<std::atomic<uint8_t>[]> m_generations;
+};
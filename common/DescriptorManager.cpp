@@ -0,0 +1,185 @@
+﻿#include "DescriptorManager.h"
+
+namespace
+{
+  // DescriptorId に埋め込むヒープの識別子. 16 個を超えると再利用されるため、それ以降の取り違えは検出できない.
+  std::atomic<uint32_t> s_nextHeapId(0);
+
+  UINT GetRangeBase(const D3D12_DESCRIPTOR_HEAP_DESC& desc, UINT rangeCapacity)
+  {
+    if (rangeCapacity > desc.NumDescriptors)
+    {
+      throw book_util::DX12Exception("rangeCapacity exceeds NumDescriptors.(DescriptorManager)");
+    }
+    return desc.NumDescriptors - rangeCapacity;
+  }
+}
+
+DescriptorManager::DescriptorManager(ComPtr<ID3D12Device> device, const D3D12_DESCRIPTOR_HEAP_DESC& desc, UINT rangeCapacity)
+  : m_device(device), m_desc(desc), m_incrementSize(0),
+  m_pageCount(0), m_liveCount(0), m_peakCount(0),
+  m_rangeBase(GetRangeBase(desc, rangeCapacity)),
+  m_rangeAllocator(rangeCapacity, 1)
+{
+  m_incrementSize = device->GetDescriptorHandleIncrementSize(desc.Type);
+  m_isGrowable = (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) == 0;
+  m_heapId = s_nextHeapId.fetch_add(1) % (DescriptorId::MaxHeapId + 1);
+  AddPage(m_rangeBase);
+}
+
+void DescriptorManager::AddPage(UINT freeListCapacity)
+{
+  const auto pageIndex = m_pageCount.load(std::memory_order_relaxed);
+  if (pageIndex >= MaxPageCount || (pageIndex + 1) * m_desc.NumDescriptors > DescriptorId::MaxIndex)
+  {
+    throw book_util::DX12Exception("DescriptorHeap page limit reached.");
+  }
+  auto page = std::make_unique<Page>(m_desc.NumDescriptors, freeListCapacity);
+  HRESULT hr = m_device->CreateDescriptorHeap(&m_desc, IID_PPV_ARGS(&page->heap));
+  ThrowIfFailed(hr, "CreateDescriptorHeap に失敗.");
+
+  page->handleCpu = page->heap->GetCPUDescriptorHandleForHeapStart();
+  // シェーダーから見えないヒープ(ステージング用、RTV/DSV)は GPU ハンドルを持たない.
+  page->handleGpu.ptr = 0;
+  if (!m_isGrowable)
+  {
+    page->handleGpu = page->heap->GetGPUDescriptorHandleForHeapStart();
+  }
+  m_pages[pageIndex] = std::move(page);
+  m_pageCount.store(pageIndex + 1, std::memory_order_release);
+}
+
+DescriptorHandle DescriptorManager::Alloc()
+{
+  return Resolve(AllocId());
+}
+
+void DescriptorManager::Free(const DescriptorHandle& handle)
+{
+  Free(handle.GetId());
+}
+
+DescriptorId DescriptorManager::AllocId()
+{
+  while (true)
+  {
+    const auto pageCount = m_pageCount.load(std::memory_order_acquire);
+    for (UINT i = 0; i < pageCount; ++i)
+    {
+      auto index = m_pages[i]->freeList.Alloc();
+      if (index != LockFreeDescriptorFreeList::InvalidIndex)
+      {
+        const auto live = m_liveCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto peak = m_peakCount.load(std::memory_order_relaxed);
+        while (live > peak && !m_peakCount.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+        const auto generation = m_pages[i]->generations.Acquire(index);
+        return DescriptorId(m_heapId, i * m_desc.NumDescriptors + index, generation);
+      }
+    }
+
+    // 全ページが埋まっている.
+    if (!m_isGrowable)
+    {
+      throw book_util::DX12Exception("Shader visible DescriptorHeap is full.");
+    }
+    std::lock_guard<std::mutex> lock(m_growMutex);
+    // 他のスレッドが先に追加していなければ追加する.
+    if (m_pageCount.load(std::memory_order_acquire) == pageCount)
+    {
+      AddPage(m_desc.NumDescriptors);
+    }
+  }
+}
+
+void DescriptorManager::Free(DescriptorId id)
+{
+  if (!id.IsValid() || id.GetHeapId() != m_heapId)
+  {
+    throw book_util::DX12Exception("DescriptorId does not belong to this heap.");
+  }
+  const auto pageIndex = id.GetIndex() / m_desc.NumDescriptors;
+  if (pageIndex >= m_pageCount.load(std::memory_order_acquire))
+  {
+    throw book_util::DX12Exception("DescriptorId is out of range.");
+  }
+  FreeSlot(pageIndex, id.GetIndex() % m_desc.NumDescriptors, uint8_t(id.GetGeneration()));
+}
+
+DescriptorHandle DescriptorManager::Resolve(DescriptorId id) const
+{
+  const auto pageIndex = id.GetIndex() / m_desc.NumDescriptors;
+  const auto localIndex = id.GetIndex() % m_desc.NumDescriptors;
+#if DESCRIPTOR_ID_VALIDATION
+  if (!id.IsValid() || id.GetHeapId() != m_heapId || pageIndex >= m_pageCount.load(std::memory_order_acquire))
+  {
+    throw book_util::DX12Exception("Invalid DescriptorId.");
+  }
+  if (!m_pages[pageIndex]->generations.IsCurrent(localIndex, uint8_t(id.GetGeneration())))
+  {
+    throw book_util::DX12Exception("DescriptorId is used after free.");
+  }
+#endif
+  return GetHandle(*m_pages[pageIndex], localIndex, id);
+}
+
+void DescriptorManager::FreeSlot(UINT pageIndex, UINT localIndex, uint8_t generation)
+{
+  auto& page = *m_pages[pageIndex];
+  // 空きリストの範囲外は連続領域(DescriptorRange)のスロット.
+  if (localIndex >= page.freeList.GetCapacity())
+  {
+    throw book_util::DX12Exception("Descriptor is not allocated from the free list.");
+  }
+  if (!page.generations.Release(localIndex, generation))
+  {
+    throw book_util::DX12Exception("Descriptor is freed twice or after reuse.");
+  }
+
+  page.freeList.Free(localIndex);
+  m_liveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+DescriptorRange DescriptorManager::Alloc(UINT count)
+{
+  uint64_t offset = BuddyAllocator::InvalidOffset;
+  if (m_rangeAllocator.GetCapacity() > 0)
+  {
+    std::lock_guard<std::mutex> lock(m_rangeMutex);
+    offset = m_rangeAllocator.Allocate(count, 1);
+  }
+  if (offset == BuddyAllocator::InvalidOffset)
+  {
+    throw book_util::DX12Exception("DescriptorHeap has no contiguous range.");
+  }
+  auto first = GetHandle(*m_pages[0], m_rangeBase + UINT(offset));
+  return DescriptorRange(first, count, m_incrementSize);
+}
+
+void DescriptorManager::Free(const DescriptorRange& range)
+{
+  std::lock_guard<std::mutex> lock(m_rangeMutex);
+  m_rangeAllocator.Free(GetIndex(range[0]) - m_rangeBase);
+}
+
+DescriptorManager::Statistics DescriptorManager::GetStatistics() const
+{
+  Statistics stats{};
+  stats.pageCount = m_pageCount.load(std::memory_order_acquire);
+  stats.capacity = stats.pageCount * m_desc.NumDescriptors;
+  stats.liveCount = m_liveCount.load(std::memory_order_relaxed);
+  stats.peakCount = m_peakCount.load(std::memory_order_relaxed);
+  UINT touched = 0;
+  for (UINT i = 0; i < stats.pageCount; ++i)
+  {
+    touched += m_pages[i]->freeList.GetTouchedCount();
+  }
+  stats.freeListCount = touched > stats.liveCount ? touched - stats.liveCount : 0;
+  {
+    std::lock_guard<std::mutex> lock(m_rangeMutex);
+    stats.rangeUsed = UINT(m_rangeAllocator.GetUsedSize());
+    stats.rangeCapacity = UINT(m_rangeAllocator.GetCapacity());
+  }
+  return stats;
+}
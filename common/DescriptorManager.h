@@ -1,76 +1,202 @@
 #pragma once
 #include <wrl.h>
-#include <list>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "D3D12BookUtil.h"
 #include "d3dx12.h"
+#include "DescriptorFreeList.h"
+#include "DescriptorId.h"
+#include "BuddyAllocator.h"
 
+// 1 ɂ DescriptorId nh߂xɐ؂Aς݂̎QƂo.
+#ifndef DESCRIPTOR_ID_VALIDATION
+#if defined(_DEBUG)
+#define DESCRIPTOR_ID_VALIDATION 1
+#else
+#define DESCRIPTOR_ID_VALIDATION 0
+#endif
+#endif
+
+// DescriptorManager::Alloc() œ͕̂o DescriptorId Aɐ؂.
 class DescriptorHandle
 {
 public:
-  DescriptorHandle() : m_handleCpu(), m_handleGpu() {}
+  DescriptorHandle() : m_handleCpu(), m_handleGpu(), m_id() {}
 
-  DescriptorHandle(D3D12_CPU_DESCRIPTOR_HANDLE hCpu, D3D12_GPU_DESCRIPTOR_HANDLE hGpu)
-    : m_handleCpu(hCpu), m_handleGpu(hGpu)
+  DescriptorHandle(D3D12_CPU_DESCRIPTOR_HANDLE hCpu, D3D12_GPU_DESCRIPTOR_HANDLE hGpu, DescriptorId id = DescriptorId())
+    : m_handleCpu(hCpu), m_handleGpu(hGpu), m_id(id)
   {
   }
 
   operator D3D12_CPU_DESCRIPTOR_HANDLE() const { return m_handleCpu; }
   operator D3D12_GPU_DESCRIPTOR_HANDLE() const { return m_handleGpu; }
+  // Ä̈ꕔȂǁA1 ôłȂΖ.
+  DescriptorId GetId() const { return m_id; }
 
 private:
   D3D12_CPU_DESCRIPTOR_HANDLE m_handleCpu;
   D3D12_GPU_DESCRIPTOR_HANDLE m_handleGpu;
+  DescriptorId m_id;
 };
 
+// q[vŘAfBXNv^. 擪̃nĥ܂܃e[uƂĐݒł.
+class DescriptorRange
+{
+public:
+  DescriptorRange() : m_first(), m_count(0), m_incrementSize(0) {}
+  DescriptorRange(const DescriptorHandle& first, UINT count, UINT incrementSize)
+    : m_first(first), m_count(count), m_incrementSize(incrementSize)
+  {
+  }
+
+  DescriptorHandle operator[](UINT index) const
+  {
+    return DescriptorHandle(
+      CD3DX12_CPU_DESCRIPTOR_HANDLE(m_first, index, m_incrementSize),
+      CD3DX12_GPU_DESCRIPTOR_HANDLE(m_first, index, m_incrementSize)
+    );
+  }
+  // index  count ͈̕.
+  DescriptorRange GetSubRange(UINT index, UINT count) const
+  {
+    return DescriptorRange((*this)[index], count, m_incrementSize);
+  }
+  UINT GetCount() const { return m_count; }
+  bool IsValid() const { return m_count > 0; }
+
+  operator D3D12_CPU_DESCRIPTOR_HANDLE() const { return m_first; }
+  operator D3D12_GPU_DESCRIPTOR_HANDLE() const { return m_first; }
+private:
+  DescriptorHandle m_first;
+  UINT m_count;
+  UINT m_incrementSize;
+};
+
+// fBXNv^q[v略o. Alloc/Free ͕XbhĂяoĂ悢.
+// 擪y[W̑O 1 ̕opA㔼 rangeCapacity ͘Ä(fBXNv^e[u)pƂĕĊǗ.
+// VF[_[猩Ȃq[v́A܂ƓTCỸq[vy[WƂĒǉĊg.
+// VF[_[猩q[v͕`撆ɍւȂߊgAꂽO𓊂.
 class DescriptorManager
 {
 public:
   template<class T>
   using ComPtr = Microsoft::WRL::ComPtr<T>;
 
-  DescriptorManager(ComPtr<ID3D12Device> device, const D3D12_DESCRIPTOR_HEAP_DESC& desc)
-    : m_index(0), m_incrementSize(0)
-  {
-    HRESULT hr = device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&m_heap));
-    ThrowIfFailed(hr, "CreateDescriptorHeap Ɏs.");
+  static const UINT MaxPageCount = 32;
+
+  // rangeCapacity  2 ׂ̂ NumDescriptors ȉł邱. ꍇ͗O.
+  DescriptorManager(ComPtr<ID3D12Device> device, const D3D12_DESCRIPTOR_HEAP_DESC& desc, UINT rangeCapacity = 0);
+  // 擪y[W̃q[v. SetDescriptorHeaps ɂ͂n.
+  ComPtr<ID3D12DescriptorHeap> GetHeap() const { return m_pages[0]->heap; }
+
+  DescriptorHandle Alloc();
+  // Free(handle.GetId()) Ɠ. Alloc() œnhȊO(̃q[vAÄ)A
+  // ς݂̃nh(XbgėpĂĂ)nƗO.
+  void Free(const DescriptorHandle& handle);
+
+  // 32bit ̎QƂƂĕo. dƌÂQƂ̉͏ɁA̎QƂ DESCRIPTOR_ID_VALIDATION Ōo.
+  DescriptorId AllocId();
+  void Free(DescriptorId id);
+  DescriptorHandle Resolve(DescriptorId id) const;
+  D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(DescriptorId id) const { return Resolve(id); }
+  D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(DescriptorId id) const { return Resolve(id); }
+
+  // A count 𕥂o. ̈̓ofBŊǗAɗאڂ󂫂ƌ.
+  DescriptorRange Alloc(UINT count);
+  void Free(const DescriptorRange& range);
 
-    m_handleCpu = m_heap->GetCPUDescriptorHandleForHeapStart();
-    m_handleGpu = m_heap->GetGPUDescriptorHandleForHeapStart();
-    m_incrementSize = device->GetDescriptorHandleIncrementSize(desc.Type);
+  // 擪y[W̐擪̈ʒu.
+  UINT GetIndex(const DescriptorHandle& handle) const
+  {
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu = handle;
+    return UINT((cpu.ptr - m_pages[0]->handleCpu.ptr) / m_incrementSize);
   }
-  ComPtr<ID3D12DescriptorHeap> GetHeap() const { return m_heap; }
 
-  DescriptorHandle Alloc()
+  struct Statistics
+  {
+    UINT capacity;      // Sy[W̍v (Ä܂).
+    UINT pageCount;
+    UINT liveCount;     // 1 oĎgp̐.
+    UINT peakCount;
+    UINT freeListCount; // čėp҂̐.
+    UINT rangeUsed;     // Ä̎gp (ubNPʂɐ؂グ).
+    UINT rangeCapacity;
+  };
+  Statistics GetStatistics() const;
+
+  // oChX`p. \[XƂ̃r[̃q[v̈ʒuΉtĂA
+  // VF[_[ւ̓e[ȗɂ̃CfbNXn (ResourceDescriptorHeap[index]).
+  static const UINT InvalidIndex = ~0u;
+  UINT RegisterBindless(const void* resource, const DescriptorHandle& handle)
+  {
+    const auto index = GetIndex(handle);
+    std::lock_guard<std::mutex> lock(m_bindlessMutex);
+    m_bindlessIndices[resource] = index;
+    return index;
+  }
+  void UnregisterBindless(const void* resource)
   {
-    if (!m_freeList.empty())
+    std::lock_guard<std::mutex> lock(m_bindlessMutex);
+    m_bindlessIndices.erase(resource);
+  }
+  // o^Ȃ InvalidIndex.
+  UINT GetBindlessIndex(const void* resource) const
+  {
+    std::lock_guard<std::mutex> lock(m_bindlessMutex);
+    auto itr = m_bindlessIndices.find(resource);
+    if (itr == m_bindlessIndices.end())
     {
-      auto ret = m_freeList.front();
-      m_freeList.pop_front();
-      return ret;
+      return InvalidIndex;
     }
-
-    UINT use = m_index++;
-    auto ret = DescriptorHandle(
-      m_handleCpu.Offset(use, m_incrementSize),
-      m_handleGpu.Offset(use, m_incrementSize)
-    );
-
-    return ret;
+    return itr->second;
   }
 
-  void Free(const DescriptorHandle& handle)
+private:
+  struct Page
   {
-    m_freeList.push_back(handle);
+    Page(UINT capacity, UINT freeListCapacity)
+      : freeList(freeListCapacity), generations(capacity)
+    {
+    }
+    ComPtr<ID3D12DescriptorHeap> heap;
+    CD3DX12_CPU_DESCRIPTOR_HANDLE handleCpu;
+    CD3DX12_GPU_DESCRIPTOR_HANDLE handleGpu;
+    LockFreeDescriptorFreeList freeList;
+    DescriptorGenerationTable generations;
+  };
+  void AddPage(UINT freeListCapacity);
+  // i߂ċ󂫃Xg֖߂. 󂫃Xg͈̔͊OAgeneration gp̐ƈقȂΗO.
+  void FreeSlot(UINT pageIndex, UINT localIndex, uint8_t generation);
+  DescriptorHandle GetHandle(const Page& page, UINT index, DescriptorId id = DescriptorId()) const
+  {
+    return DescriptorHandle(
+      CD3DX12_CPU_DESCRIPTOR_HANDLE(page.handleCpu, index, m_incrementSize),
+      CD3DX12_GPU_DESCRIPTOR_HANDLE(page.handleGpu, index, m_incrementSize),
+      id
+    );
   }
 
-
-private:
-  ComPtr<ID3D12DescriptorHeap> m_heap;
-  CD3DX12_CPU_DESCRIPTOR_HANDLE m_handleCpu;
-  CD3DX12_GPU_DESCRIPTOR_HANDLE m_handleGpu;
-  UINT m_index;
+  ComPtr<ID3D12Device> m_device;
+  D3D12_DESCRIPTOR_HEAP_DESC m_desc;
   UINT m_incrementSize;
+  bool m_isGrowable;
+  uint32_t m_heapId;
+
+  // ǂݏo̓bNs߁Aǉς݂̃y[W͓Ȃ.
+  std::unique_ptr<Page> m_pages[MaxPageCount];
+  std::atomic<UINT> m_pageCount;
+  std::mutex m_growMutex;
+
+  std::atomic<UINT> m_liveCount;
+  std::atomic<UINT> m_peakCount;
+
+  UINT m_rangeBase;
+  BuddyAllocator m_rangeAllocator;
+  mutable std::mutex m_rangeMutex;
 
-  std::list<DescriptorHandle> m_freeList;
+  std::unordered_map<const void*, UINT> m_bindlessIndices;
+  mutable std::mutex m_bindlessMutex;
 };
\ No newline at end of file
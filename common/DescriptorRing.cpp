@@ -0,0 +1,58 @@
+﻿#include "DescriptorRing.h"
+#include <vector>
+
+DescriptorRing::DescriptorRing(ComPtr<ID3D12Device> device, D3D12_DESCRIPTOR_HEAP_TYPE type, const DescriptorRange& region, std::shared_ptr<TimelineFence> fence)
+  : m_device(device), m_type(type), m_region(region), m_fence(fence), m_allocator(region.GetCount())
+{
+}
+
+DescriptorRange DescriptorRing::Allocate(UINT count)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_allocator.ReleaseCompleted(m_fence->GetCompletedValue());
+
+  auto offset = m_allocator.Allocate(count, 1);
+  while (offset == RingAllocator::InvalidOffset)
+  {
+    // 空きが無いので、最も古いフレームの完了を待つ.
+    WaitForSpace();
+    offset = m_allocator.Allocate(count, 1);
+  }
+  return m_region.GetSubRange(UINT(offset), count);
+}
+
+DescriptorRange DescriptorRing::CopyToTable(const D3D12_CPU_DESCRIPTOR_HANDLE* srcHandles, UINT count)
+{
+  auto table = Allocate(count);
+  // コピー元は 1 個ずつの範囲、コピー先は 1 つの連続した範囲として渡す.
+  std::vector<UINT> srcSizes(count, 1);
+  D3D12_CPU_DESCRIPTOR_HANDLE dst = table;
+  m_device->CopyDescriptors(
+    1, &dst, &count,
+    count, srcHandles, srcSizes.data(),
+    m_type);
+  return table;
+}
+
+DescriptorRange DescriptorRing::CopyRange(D3D12_CPU_DESCRIPTOR_HANDLE srcStart, UINT count)
+{
+  auto table = Allocate(count);
+  m_device->CopyDescriptorsSimple(count, table, srcStart, m_type);
+  return table;
+}
+
+void DescriptorRing::FinishFrame(UINT64 fenceValue)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_allocator.FinishFrame(fenceValue);
+}
+
+void DescriptorRing::WaitForSpace()
+{
+  if (!m_allocator.HasPendingFrames())
+  {
+    throw std::runtime_error("DescriptorRing overflow.");
+  }
+  m_fence->Wait(m_allocator.GetOldestPendingFenceValue());
+  m_allocator.ReleaseCompleted(m_fence->GetCompletedValue());
+}
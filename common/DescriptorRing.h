@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <memory>
+#include <mutex>
+
+#include "DescriptorManager.h"
+#include "RingAllocator.h"
+#include "TimelineFence.h"
+
+// シェーダーから見えるヒープの一部をリングとして使い、フレーム毎のディスクリプタテーブルを組み立てる.
+// ビュー本体は CPU 専用のステージングヒープに作っておき、使う分だけ CopyDescriptors で並べる.
+// 使った領域はフレーム終端の Signal 値に紐付け、 GPU の完了後に再利用する.
+class DescriptorRing
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  // region はリングに使うシェーダーから見えるヒープ内の連続領域.
+  DescriptorRing(ComPtr<ID3D12Device> device, D3D12_DESCRIPTOR_HEAP_TYPE type, const DescriptorRange& region, std::shared_ptr<TimelineFence> fence);
+
+  // このフレームでのみ有効な連続領域を確保する. 並列記録中のワーカースレッドから呼び出してよい.
+  DescriptorRange Allocate(UINT count);
+
+  // srcHandles (ステージングヒープ上) を順に並べたテーブルを返す.
+  DescriptorRange CopyToTable(const D3D12_CPU_DESCRIPTOR_HANDLE* srcHandles, UINT count);
+  template<size_t N>
+  DescriptorRange CopyToTable(const D3D12_CPU_DESCRIPTOR_HANDLE(&srcHandles)[N])
+  {
+    return CopyToTable(srcHandles, UINT(N));
+  }
+  // 連続した count 個をそのまま写す.
+  DescriptorRange CopyRange(D3D12_CPU_DESCRIPTOR_HANDLE srcStart, UINT count);
+
+  // フレームのコマンド発行後に呼び出し、確保済み領域を Signal したフェンス値に紐付ける.
+  void FinishFrame(UINT64 fenceValue);
+
+  UINT GetUsedCount() const { return UINT(m_allocator.GetUsedSize()); }
+  UINT GetCapacity() const { return UINT(m_allocator.GetCapacity()); }
+
+private:
+  void WaitForSpace();
+
+  ComPtr<ID3D12Device> m_device;
+  D3D12_DESCRIPTOR_HEAP_TYPE m_type;
+  DescriptorRange m_region;
+  std::shared_ptr<TimelineFence> m_fence;
+
+  RingAllocator m_allocator;
+  std::mutex m_mutex;
+};
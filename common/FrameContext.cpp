@@ -0,0 +1,36 @@
+﻿#include "FrameContext.h"
+#include "CpuProfiler.h"
+
+FrameContext::FrameContext(ComPtr<ID3D12Device> device, std::shared_ptr<TimelineFence> fence, UINT64 dynamicBufferSize)
+  : m_fence(fence), m_commandListPool(device), m_fenceValue(0)
+{
+  HRESULT hr = device->CreateCommandAllocator(
+    D3D12_COMMAND_LIST_TYPE_DIRECT,
+    IID_PPV_ARGS(&m_commandAllocator)
+  );
+  ThrowIfFailed(hr, "CreateCommandAllocator failed.(FrameContext)");
+
+  m_dynamicBuffer = std::make_shared<UploadRingBuffer>(device, dynamicBufferSize, fence);
+}
+
+FrameContext::~FrameContext()
+{
+  m_fence->Wait(m_fenceValue);
+}
+
+void FrameContext::Begin(DWORD timeout)
+{
+  {
+    CPU_PROFILE_SCOPE("WaitForFrame");
+    m_fence->Wait(m_fenceValue, timeout);
+  }
+  m_deferredRelease.clear();
+  m_commandAllocator->Reset();
+  m_commandListPool.Reset();
+}
+
+void FrameContext::Finish(UINT64 fenceValue)
+{
+  m_fenceValue = fenceValue;
+  m_dynamicBuffer->FinishFrame(fenceValue);
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <memory>
+#include <vector>
+
+#include "TimelineFence.h"
+#include "UploadRingBuffer.h"
+#include "CommandListPool.h"
+#include "D3D12BookUtil.h"
+
+// 1 フレーム分のコマンド記録に必要なものをまとめたもの.
+// コマンドアロケータ、並列記録用のコマンドリストプール、定数バッファ用リング、
+// 遅延解放リスト、発行時のフェンス値を持つ.
+class FrameContext
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  FrameContext(ComPtr<ID3D12Device> device, std::shared_ptr<TimelineFence> fence, UINT64 dynamicBufferSize);
+  ~FrameContext();
+
+  // 前回このコンテキストで発行したコマンドの完了を待ち、再利用できる状態にする.
+  void Begin(DWORD timeout = INFINITE);
+  // コマンド発行後に Signal したフェンス値を記録する.
+  void Finish(UINT64 fenceValue);
+
+  // このフレームのコマンドが使い終わるまで解放を遅らせる.
+  template<class T>
+  void DeferRelease(const ComPtr<T>& object)
+  {
+    ComPtr<IUnknown> unknown;
+    object.As(&unknown);
+    m_deferredRelease.push_back(unknown);
+  }
+
+  ComPtr<ID3D12CommandAllocator> GetCommandAllocator() const { return m_commandAllocator; }
+  // ワーカースレッドで記録するためのリストを借りる. スレッドセーフ.
+  ComPtr<ID3D12GraphicsCommandList> AcquireCommandList() { return m_commandListPool.Acquire(); }
+  std::shared_ptr<UploadRingBuffer> GetDynamicBuffer() const { return m_dynamicBuffer; }
+  UINT64 GetFenceValue() const { return m_fenceValue; }
+
+private:
+  std::shared_ptr<TimelineFence> m_fence;
+  ComPtr<ID3D12CommandAllocator> m_commandAllocator;
+  CommandListPool m_commandListPool;
+  std::shared_ptr<UploadRingBuffer> m_dynamicBuffer;
+  std::vector<ComPtr<IUnknown>> m_deferredRelease;
+  UINT64 m_fenceValue;
+};
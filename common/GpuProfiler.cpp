@@ -0,0 +1,253 @@
+﻿#include "GpuProfiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+
+#include "imgui.h"
+
+GpuProfiler::GpuProfiler(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> queue, UINT frameCount)
+  : m_frequency(0), m_frameIndex(0), m_collectedFrames(0), m_exportResult(Export_None)
+{
+  const UINT queryCount = MaxScopesPerFrame * 2 * frameCount;
+  D3D12_QUERY_HEAP_DESC heapDesc{};
+  heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+  heapDesc.Count = queryCount;
+  HRESULT hr = device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&m_queryHeap));
+  ThrowIfFailed(hr, "CreateQueryHeap failed.(GpuProfiler)");
+
+  const auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+  auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(UINT64) * queryCount);
+  hr = device->CreateCommittedResource(
+    &heapProps,
+    D3D12_HEAP_FLAG_NONE,
+    &bufferDesc,
+    D3D12_RESOURCE_STATE_COPY_DEST,
+    nullptr,
+    IID_PPV_ARGS(&m_readback)
+  );
+  ThrowIfFailed(hr, "CreateCommittedResource failed.(GpuProfiler)");
+  m_readback->SetName(L"GpuProfilerReadback");
+
+  hr = queue->GetTimestampFrequency(&m_frequency);
+  ThrowIfFailed(hr, "GetTimestampFrequency failed.(GpuProfiler)");
+
+  m_frames.resize(frameCount, Frame{ {}, false });
+}
+
+void GpuProfiler::BeginFrame(UINT frameIndex)
+{
+  m_frameIndex = frameIndex;
+  if (m_frames[frameIndex].resolved)
+  {
+    CollectResults(frameIndex);
+  }
+  m_frames[frameIndex].names.clear();
+  m_frames[frameIndex].resolved = false;
+}
+
+UINT GpuProfiler::BeginScope(ID3D12GraphicsCommandList* command, const std::string& name)
+{
+  UINT scope = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& names = m_frames[m_frameIndex].names;
+    if (names.size() >= MaxScopesPerFrame)
+    {
+      return InvalidScope;
+    }
+    scope = UINT(names.size());
+    names.push_back(name);
+  }
+  const UINT query = (m_frameIndex * MaxScopesPerFrame + scope) * 2;
+  command->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+  return scope;
+}
+
+void GpuProfiler::EndScope(ID3D12GraphicsCommandList* command, UINT scope)
+{
+  if (scope == InvalidScope)
+  {
+    return;
+  }
+  const UINT query = (m_frameIndex * MaxScopesPerFrame + scope) * 2 + 1;
+  command->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void GpuProfiler::Resolve(ID3D12GraphicsCommandList* command)
+{
+  auto& frame = m_frames[m_frameIndex];
+  if (frame.names.empty())
+  {
+    return;
+  }
+  const UINT first = m_frameIndex * MaxScopesPerFrame * 2;
+  const UINT count = UINT(frame.names.size()) * 2;
+  command->ResolveQueryData(
+    m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+    first, count,
+    m_readback.Get(), sizeof(UINT64) * first);
+  frame.resolved = true;
+}
+
+GpuProfiler::PassStats& GpuProfiler::FindStats(const std::string& name)
+{
+  auto itr = std::find_if(m_stats.begin(), m_stats.end(), [&](const PassStats& v) { return v.name == name; });
+  if (itr != m_stats.end())
+  {
+    return *itr;
+  }
+  // 途中から現れたパスは、これまでのフレームを 0 として履歴を揃える.
+  PassStats stats{};
+  stats.name = name;
+  stats.history.assign(m_stats.empty() ? 0 : m_stats.front().history.size(), 0.0f);
+  m_stats.push_back(stats);
+  return m_stats.back();
+}
+
+void GpuProfiler::CollectResults(UINT frameIndex)
+{
+  const auto& names = m_frames[frameIndex].names;
+  const UINT first = frameIndex * MaxScopesPerFrame * 2;
+  const UINT count = UINT(names.size()) * 2;
+  D3D12_RANGE range{ sizeof(UINT64) * first, sizeof(UINT64) * (first + count) };
+  void* p = nullptr;
+  HRESULT hr = m_readback->Map(0, &range, &p);
+  ThrowIfFailed(hr, "Map failed.(GpuProfiler)");
+  auto timestamps = reinterpret_cast<const UINT64*>(static_cast<const char*>(p) + range.Begin);
+
+  // 同じ名前の区間は合計する.
+  std::vector<std::pair<std::string, float>> samples;
+  for (UINT i = 0; i < UINT(names.size()); ++i)
+  {
+    const auto begin = timestamps[i * 2];
+    const auto end = timestamps[i * 2 + 1];
+    const float ms = end > begin ? float(double(end - begin) * 1000.0 / double(m_frequency)) : 0.0f;
+    auto itr = std::find_if(samples.begin(), samples.end(), [&](const std::pair<std::string, float>& v) { return v.first == names[i]; });
+    if (itr == samples.end())
+    {
+      samples.emplace_back(names[i], ms);
+    }
+    else
+    {
+      itr->second += ms;
+    }
+  }
+  D3D12_RANGE writeRange{ 0, 0 };
+  m_readback->Unmap(0, &writeRange);
+
+  for (const auto& v : samples)
+  {
+    FindStats(v.first);
+  }
+  for (auto& stats : m_stats)
+  {
+    float ms = 0.0f;
+    for (const auto& v : samples)
+    {
+      if (v.first == stats.name)
+      {
+        ms = v.second;
+      }
+    }
+    stats.lastMs = ms;
+    stats.history.push_back(ms);
+    if (stats.history.size() > HistoryLength)
+    {
+      stats.history.erase(stats.history.begin());
+    }
+
+    float sum = 0.0f;
+    UINT measured = 0;
+    stats.maxMs = 0.0f;
+    for (auto v : stats.history)
+    {
+      if (v > 0.0f)
+      {
+        sum += v;
+        measured++;
+      }
+      stats.maxMs = std::max(stats.maxMs, v);
+    }
+    stats.averageMs = measured > 0 ? sum / measured : 0.0f;
+  }
+  m_collectedFrames++;
+}
+
+void GpuProfiler::DrawImGui()
+{
+  ImGui::Begin("GPU Profiler");
+
+  ImGui::Columns(4, "GpuPasses");
+  ImGui::Text("Pass"); ImGui::NextColumn();
+  ImGui::Text("Last(ms)"); ImGui::NextColumn();
+  ImGui::Text("Avg(ms)"); ImGui::NextColumn();
+  ImGui::Text("Max(ms)"); ImGui::NextColumn();
+  ImGui::Separator();
+  float totalLast = 0.0f, totalAverage = 0.0f;
+  for (const auto& stats : m_stats)
+  {
+    ImGui::Text("%s", stats.name.c_str()); ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.lastMs); ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.averageMs); ImGui::NextColumn();
+    ImGui::Text("%.3f", stats.maxMs); ImGui::NextColumn();
+    totalLast += stats.lastMs;
+    totalAverage += stats.averageMs;
+  }
+  ImGui::Separator();
+  ImGui::Text("Total"); ImGui::NextColumn();
+  ImGui::Text("%.3f", totalLast); ImGui::NextColumn();
+  ImGui::Text("%.3f", totalAverage); ImGui::NextColumn();
+  ImGui::NextColumn();
+  ImGui::Columns(1);
+
+  for (const auto& stats : m_stats)
+  {
+    if (!stats.history.empty())
+    {
+      ImGui::PlotLines(stats.name.c_str(), stats.history.data(), int(stats.history.size()),
+        0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+    }
+  }
+
+  if (ImGui::Button("Export CSV"))
+  {
+    m_exportResult = ExportCsv("gpu_profile.csv") ? Export_Succeeded : Export_Failed;
+  }
+  if (m_exportResult != Export_None)
+  {
+    ImGui::SameLine();
+    ImGui::Text("%s", m_exportResult == Export_Succeeded ? "gpu_profile.csv" : "failed.");
+  }
+  ImGui::End();
+}
+
+bool GpuProfiler::ExportCsv(const std::string& fileName) const
+{
+  std::ofstream outfile(fileName);
+  if (!outfile)
+  {
+    return false;
+  }
+
+  outfile << "frame";
+  for (const auto& stats : m_stats)
+  {
+    outfile << "," << stats.name;
+  }
+  outfile << ",total\n";
+
+  const size_t rows = m_stats.empty() ? 0 : m_stats.front().history.size();
+  const size_t firstFrame = m_collectedFrames - rows;
+  for (size_t i = 0; i < rows; ++i)
+  {
+    float total = 0.0f;
+    outfile << (firstFrame + i);
+    for (const auto& stats : m_stats)
+    {
+      outfile << "," << stats.history[i];
+      total += stats.history[i];
+    }
+    outfile << "," << total << "\n";
+  }
+  return bool(outfile);
+}
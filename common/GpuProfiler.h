@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "d3dx12.h"
+#include "D3D12BookUtil.h"
+
+// タイムスタンプクエリによる GPU 時間の計測.
+// フレーム毎にクエリとリードバックの領域を分け、GPU が使い終えたフレームの結果だけを読むので待ちは発生しない.
+class GpuProfiler
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  static const UINT MaxScopesPerFrame = 128;
+  static const UINT HistoryLength = 120;
+
+  GpuProfiler(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> queue, UINT frameCount);
+
+  // frameIndex のフレームを開始する. そのフレームの前回の結果(GPU 完了済み)を回収する.
+  void BeginFrame(UINT frameIndex);
+  // 計測区間の開始と終了. 複数スレッドのコマンドリストから呼び出してよい.
+  UINT BeginScope(ID3D12GraphicsCommandList* command, const std::string& name);
+  void EndScope(ID3D12GraphicsCommandList* command, UINT scope);
+  // フレーム内の全区間を記録したリストの後に実行されるリストへ、結果のコピーを記録する.
+  void Resolve(ID3D12GraphicsCommandList* command);
+  bool HasScopes() const { return !m_frames[m_frameIndex].names.empty(); }
+
+  struct PassStats
+  {
+    std::string name;
+    float lastMs;
+    float averageMs;
+    float maxMs;
+    std::vector<float> history;   // 古い順. 計測されなかったフレームは 0.
+  };
+  // 最初に計測された順.
+  const std::vector<PassStats>& GetStats() const { return m_stats; }
+
+  // パス毎の時間の表とグラフを ImGui のウィンドウに表示する.
+  void DrawImGui();
+  // 履歴を 1 行 1 フレームの CSV で書き出す.
+  bool ExportCsv(const std::string& fileName) const;
+
+  // 区間を自動で閉じるヘルパ.
+  class Scope
+  {
+  public:
+    Scope(GpuProfiler* profiler, ID3D12GraphicsCommandList* command, const std::string& name)
+      : m_profiler(profiler), m_command(command), m_index(profiler->BeginScope(command, name)) { }
+    ~Scope() { m_profiler->EndScope(m_command, m_index); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  private:
+    GpuProfiler* m_profiler;
+    ID3D12GraphicsCommandList* m_command;
+    UINT m_index;
+  };
+private:
+  static const UINT InvalidScope = ~0u;
+  struct Frame
+  {
+    std::vector<std::string> names;
+    bool resolved;
+  };
+  void CollectResults(UINT frameIndex);
+  PassStats& FindStats(const std::string& name);
+
+  ComPtr<ID3D12QueryHeap> m_queryHeap;
+  ComPtr<ID3D12Resource> m_readback;
+  UINT64 m_frequency;
+
+  std::vector<Frame> m_frames;
+  UINT m_frameIndex;
+  std::mutex m_mutex;
+
+  std::vector<PassStats> m_stats;
+  UINT m_collectedFrames;
+
+  enum ExportResult
+  {
+    Export_None,
+    Export_Succeeded,
+    Export_Failed,
+  };
+  ExportResult m_exportResult;
+};
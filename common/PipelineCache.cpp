@@ -0,0 +1,218 @@
+﻿#include "PipelineCache.h"
+#include "PipelineStateHash.h"
+#include "D3D12BookUtil.h"
+#include <cstdio>
+
+namespace
+{
+  // ルートシグネチャへ持たせるハッシュのプライベートデータ.
+  // {A2900305-E3AF-4796-8DB0-5D2D2D17C068}
+  const GUID RootSignatureHashGuid =
+  { 0xa2900305, 0xe3af, 0x4796, { 0x8d, 0xb0, 0x5d, 0x2d, 0x2d, 0x17, 0xc0, 0x68 } };
+
+  std::wstring MakePipelineName(uint64_t key)
+  {
+    wchar_t buf[32];
+    swprintf_s(buf, L"pso_%016llx", static_cast<unsigned long long>(key));
+    return buf;
+  }
+}
+
+PipelineCache::PipelineCache(ComPtr<ID3D12Device> device, const PipelineCacheAdapterIdentity& adapter,
+  const std::string& fileName, bool isEnabled)
+  : m_device(device), m_adapter(adapter), m_fileName(fileName), m_isEnabled(isEnabled), m_isDirty(false), m_stats()
+{
+  m_file.Reset(PipelineCacheFile::Blobs, m_adapter);
+  if (!m_isEnabled)
+  {
+    return;
+  }
+
+  std::vector<char> data;
+  PipelineCacheFile::ReadFile(m_fileName, data);
+
+  ComPtr<ID3D12Device1> device1;
+  if (SUCCEEDED(m_device.As(&device1)))
+  {
+    HRESULT hr = E_FAIL;
+    if (m_file.Deserialize(data, PipelineCacheFile::Library, m_adapter) && !m_file.GetLibraryData().empty())
+    {
+      const auto& libraryData = m_file.GetLibraryData();
+      hr = device1->CreatePipelineLibrary(libraryData.data(), libraryData.size(), IID_PPV_ARGS(&m_library));
+    }
+    if (FAILED(hr))
+    {
+      // ドライバ側の不一致(D3D12_ERROR_DRIVER_VERSION_MISMATCH など)の場合も空から作り直す.
+      m_file.Reset(PipelineCacheFile::Library, m_adapter);
+      hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library));
+    }
+    if (FAILED(hr))
+    {
+      m_library.Reset();
+    }
+  }
+  if (!m_library)
+  {
+    m_file.Deserialize(data, PipelineCacheFile::Blobs, m_adapter);
+  }
+}
+
+ComPtr<ID3D12PipelineState> PipelineCache::CreateGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+  return CreatePipeline(desc);
+}
+
+ComPtr<ID3D12PipelineState> PipelineCache::CreateComputePipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+{
+  return CreatePipeline(desc);
+}
+
+template<class Desc>
+PipelineCache::ComPtr<ID3D12PipelineState> PipelineCache::CreatePipeline(const Desc& desc)
+{
+  ComPtr<ID3D12PipelineState> pipeline;
+  HRESULT hr;
+  const auto rootSignatureHash = GetRootSignatureHash(desc.pRootSignature);
+  if (!m_isEnabled || rootSignatureHash == 0)
+  {
+    hr = CreateDirect(desc, pipeline);
+    ThrowIfFailed(hr, "CreatePipelineState failed.");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.uncached++;
+    return pipeline;
+  }
+
+  const auto key = pipeline_hash::Hash(desc, rootSignatureHash);
+  if (m_library)
+  {
+    const auto name = MakePipelineName(key);
+    if (SUCCEEDED(LoadFromLibrary(name.c_str(), desc, pipeline)))
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stats.hits++;
+      return pipeline;
+    }
+    hr = CreateDirect(desc, pipeline);
+    ThrowIfFailed(hr, "CreatePipelineState failed.");
+    hr = m_library->StorePipeline(name.c_str(), pipeline.Get());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.misses++;
+    m_isDirty |= SUCCEEDED(hr);
+    return pipeline;
+  }
+
+  std::vector<char> cached;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (auto blob = m_file.FindBlob(key))
+    {
+      cached = *blob;
+    }
+  }
+  bool isRejected = false;
+  if (!cached.empty())
+  {
+    auto cachedDesc = desc;
+    cachedDesc.CachedPSO = { cached.data(), cached.size() };
+    if (SUCCEEDED(CreateDirect(cachedDesc, pipeline)))
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stats.hits++;
+      return pipeline;
+    }
+    isRejected = true;
+  }
+
+  hr = CreateDirect(desc, pipeline);
+  ThrowIfFailed(hr, "CreatePipelineState failed.");
+  ComPtr<ID3DBlob> blob;
+  hr = pipeline->GetCachedBlob(&blob);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (SUCCEEDED(hr))
+  {
+    m_file.SetBlob(key, blob->GetBufferPointer(), blob->GetBufferSize());
+    m_isDirty = true;
+  }
+  m_stats.misses++;
+  if (isRejected)
+  {
+    m_stats.rejected++;
+  }
+  return pipeline;
+}
+
+void PipelineCache::Save()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_isEnabled || !m_isDirty)
+  {
+    return;
+  }
+  if (m_library)
+  {
+    std::vector<char> data(m_library->GetSerializedSize());
+    if (FAILED(m_library->Serialize(data.data(), data.size())))
+    {
+      return;
+    }
+    PipelineCacheFile file;
+    file.Reset(PipelineCacheFile::Library, m_adapter);
+    file.SetLibraryData(std::move(data));
+    PipelineCacheFile::WriteFile(m_fileName, file.Serialize());
+  }
+  else
+  {
+    PipelineCacheFile::WriteFile(m_fileName, m_file.Serialize());
+  }
+  m_isDirty = false;
+}
+
+void PipelineCache::TagRootSignature(ID3D12RootSignature* rootSignature, const void* data, size_t size)
+{
+  StableHasher hasher;
+  hasher.AddBytes(data, size);
+  // 0 は未設定を表すので避ける.
+  auto hash = hasher.GetValue();
+  hash = hash ? hash : 1;
+  rootSignature->SetPrivateData(RootSignatureHashGuid, sizeof(hash), &hash);
+}
+
+uint64_t PipelineCache::GetRootSignatureHash(ID3D12RootSignature* rootSignature)
+{
+  uint64_t hash = 0;
+  UINT size = sizeof(hash);
+  if (rootSignature == nullptr ||
+    FAILED(rootSignature->GetPrivateData(RootSignatureHashGuid, &size, &hash)) || size != sizeof(hash))
+  {
+    return 0;
+  }
+  return hash;
+}
+
+PipelineCache::Statistics PipelineCache::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+HRESULT PipelineCache::CreateDirect(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline)
+{
+  return m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipeline));
+}
+
+HRESULT PipelineCache::CreateDirect(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline)
+{
+  return m_device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pipeline));
+}
+
+HRESULT PipelineCache::LoadFromLibrary(LPCWSTR name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline)
+{
+  return m_library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(&pipeline));
+}
+
+HRESULT PipelineCache::LoadFromLibrary(LPCWSTR name, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline)
+{
+  return m_library->LoadComputePipeline(name, &desc, IID_PPV_ARGS(&pipeline));
+}
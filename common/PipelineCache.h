@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <mutex>
+#include <string>
+
+#include "PipelineCacheFile.h"
+
+// PSO の生成結果をファイルに保存し、次回起動時の生成を省く.
+// ID3D12PipelineLibrary が使えればそれを、使えなければ PSO 毎の GetCachedBlob を保存する.
+// キーは PSO 記述子の内容から求めるため、シェーダーやステートが変われば別の PSO として扱われる.
+// アダプタやドライバが変わった場合、保存済みのファイルは読み捨てる.
+// 生成は複数スレッドから呼び出してよい.
+class PipelineCache
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  PipelineCache(ComPtr<ID3D12Device> device, const PipelineCacheAdapterIdentity& adapter,
+    const std::string& fileName, bool isEnabled = true);
+
+  // ルートシグネチャが TagRootSignature されていなければキャッシュせず生成する. 失敗したら例外.
+  ComPtr<ID3D12PipelineState> CreateGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+  ComPtr<ID3D12PipelineState> CreateComputePipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+
+  // 新しく生成した PSO があればファイルへ書き出す.
+  void Save();
+
+  // ルートシグネチャは中身を取り出せないため、生成に使ったシリアライズ結果のハッシュを持たせておく.
+  static void TagRootSignature(ID3D12RootSignature* rootSignature, const void* data, size_t size);
+  static void TagRootSignature(ComPtr<ID3D12RootSignature> rootSignature, ComPtr<ID3DBlob> serialized)
+  {
+    if (!rootSignature || !serialized)
+    {
+      return;
+    }
+    TagRootSignature(rootSignature.Get(), serialized->GetBufferPointer(), serialized->GetBufferSize());
+  }
+  // 未設定なら 0.
+  static uint64_t GetRootSignatureHash(ID3D12RootSignature* rootSignature);
+
+  struct Statistics
+  {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t uncached;  // 無効、またはルートシグネチャが未設定で直接生成したもの.
+    uint32_t rejected;  // 保存済みのものがドライバに拒否されたもの. misses にも数える.
+  };
+  Statistics GetStatistics() const;
+  bool IsEnabled() const { return m_isEnabled; }
+  bool IsUsingLibrary() const { return m_library != nullptr; }
+private:
+  template<class Desc>
+  ComPtr<ID3D12PipelineState> CreatePipeline(const Desc& desc);
+  HRESULT CreateDirect(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline);
+  HRESULT CreateDirect(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline);
+  HRESULT LoadFromLibrary(LPCWSTR name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline);
+  HRESULT LoadFromLibrary(LPCWSTR name, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ComPtr<ID3D12PipelineState>& pipeline);
+
+  ComPtr<ID3D12Device> m_device;
+  ComPtr<ID3D12PipelineLibrary> m_library;
+  PipelineCacheAdapterIdentity m_adapter;
+  std::string m_fileName;
+  bool m_isEnabled;
+
+  // ライブラリ形式ではライブラリが読み込み元のメモリを参照し続けるため、破棄まで保持する.
+  PipelineCacheFile m_file;
+  bool m_isDirty;
+  mutable std::mutex m_mutex;
+  Statistics m_stats;
+};
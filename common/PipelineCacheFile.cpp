@@ -0,0 +1,183 @@
+﻿#include "PipelineCacheFile.h"
+#include <cstring>
+
+namespace
+{
+  const char FileMagic[4] = { 'P', 'S', 'O', 'C' };
+  const uint32_t FileVersion = 1;
+
+  class Writer
+  {
+  public:
+    explicit Writer(std::vector<char>& data) : m_data(data) {}
+    void Bytes(const void* data, size_t size)
+    {
+      auto p = static_cast<const char*>(data);
+      m_data.insert(m_data.end(), p, p + size);
+    }
+    void U32(uint32_t value) { Bytes(&value, sizeof(value)); }
+    void U64(uint64_t value) { Bytes(&value, sizeof(value)); }
+  private:
+    std::vector<char>& m_data;
+  };
+
+  // 範囲外を読もうとしたら以降は全て失敗する.
+  class Reader
+  {
+  public:
+    Reader(const char* data, size_t size) : m_data(data), m_size(size), m_offset(0), m_isValid(true) {}
+    bool Bytes(void* dst, size_t size)
+    {
+      if (!m_isValid || m_size - m_offset < size)
+      {
+        m_isValid = false;
+        return false;
+      }
+      memcpy(dst, m_data + m_offset, size);
+      m_offset += size;
+      return true;
+    }
+    uint32_t U32() { uint32_t v = 0; Bytes(&v, sizeof(v)); return v; }
+    uint64_t U64() { uint64_t v = 0; Bytes(&v, sizeof(v)); return v; }
+    bool Vector(std::vector<char>& dst, uint64_t size)
+    {
+      if (!m_isValid || m_size - m_offset < size)
+      {
+        m_isValid = false;
+        return false;
+      }
+      dst.assign(m_data + m_offset, m_data + m_offset + size_t(size));
+      m_offset += size_t(size);
+      return true;
+    }
+    bool IsValid() const { return m_isValid; }
+    bool IsEnd() const { return m_offset == m_size; }
+  private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_offset;
+    bool m_isValid;
+  };
+}
+
+void PipelineCacheFile::Reset(Format format, const PipelineCacheAdapterIdentity& adapter)
+{
+  m_format = format;
+  m_adapter = adapter;
+  m_library.clear();
+  m_blobs.clear();
+}
+
+bool PipelineCacheFile::Deserialize(const std::vector<char>& data, Format format, const PipelineCacheAdapterIdentity& adapter)
+{
+  Reset(format, adapter);
+  if (data.size() < sizeof(FileMagic) + sizeof(uint64_t))
+  {
+    return false;
+  }
+  const auto bodySize = data.size() - sizeof(uint64_t);
+  uint64_t storedHash;
+  memcpy(&storedHash, data.data() + bodySize, sizeof(storedHash));
+  if (storedHash != StableHasher::Hash(data.data(), bodySize))
+  {
+    return false;
+  }
+
+  Reader reader(data.data(), bodySize);
+  char magic[4];
+  reader.Bytes(magic, sizeof(magic));
+  const auto version = reader.U32();
+  const auto storedFormat = reader.U32();
+  PipelineCacheAdapterIdentity storedAdapter;
+  storedAdapter.vendorId = reader.U32();
+  storedAdapter.deviceId = reader.U32();
+  storedAdapter.subSysId = reader.U32();
+  storedAdapter.revision = reader.U32();
+  storedAdapter.driverVersion = reader.U64();
+  if (!reader.IsValid() || memcmp(magic, FileMagic, sizeof(FileMagic)) != 0 ||
+    version != FileVersion || storedFormat != uint32_t(format) || storedAdapter != adapter)
+  {
+    return false;
+  }
+
+  if (format == Library)
+  {
+    reader.Vector(m_library, reader.U64());
+  }
+  else
+  {
+    const auto count = reader.U32();
+    for (uint32_t i = 0; i < count && reader.IsValid(); ++i)
+    {
+      const auto key = reader.U64();
+      std::vector<char> blob;
+      if (reader.Vector(blob, reader.U64()))
+      {
+        m_blobs[key] = std::move(blob);
+      }
+    }
+  }
+  if (!reader.IsValid() || !reader.IsEnd())
+  {
+    Reset(format, adapter);
+    return false;
+  }
+  return true;
+}
+
+std::vector<char> PipelineCacheFile::Serialize() const
+{
+  std::vector<char> data;
+  Writer writer(data);
+  writer.Bytes(FileMagic, sizeof(FileMagic));
+  writer.U32(FileVersion);
+  writer.U32(uint32_t(m_format));
+  writer.U32(m_adapter.vendorId);
+  writer.U32(m_adapter.deviceId);
+  writer.U32(m_adapter.subSysId);
+  writer.U32(m_adapter.revision);
+  writer.U64(m_adapter.driverVersion);
+  if (m_format == Library)
+  {
+    writer.U64(m_library.size());
+    writer.Bytes(m_library.data(), m_library.size());
+  }
+  else
+  {
+    writer.U32(uint32_t(m_blobs.size()));
+    for (const auto& v : m_blobs)
+    {
+      writer.U64(v.first);
+      writer.U64(v.second.size());
+      writer.Bytes(v.second.data(), v.second.size());
+    }
+  }
+  writer.U64(StableHasher::Hash(data.data(), data.size()));
+  return data;
+}
+
+bool PipelineCacheFile::ReadFile(const std::string& fileName, std::vector<char>& data)
+{
+  return cache_file::ReadAll(fileName, data);
+}
+
+bool PipelineCacheFile::WriteFile(const std::string& fileName, const std::vector<char>& data)
+{
+  return cache_file::WriteAtomically(fileName, data.data(), data.size());
+}
+
+const std::vector<char>* PipelineCacheFile::FindBlob(uint64_t key) const
+{
+  auto itr = m_blobs.find(key);
+  if (itr == m_blobs.end())
+  {
+    return nullptr;
+  }
+  return &itr->second;
+}
+
+void PipelineCacheFile::SetBlob(uint64_t key, const void* data, size_t size)
+{
+  auto p = static_cast<const char*>(data);
+  m_blobs[key].assign(p, p + size);
+}
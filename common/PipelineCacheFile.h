@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CacheFileUtil.h"
+
+// キャッシュを作ったアダプタとドライバ. どれかが変われば保存済みのキャッシュは使わない.
+struct PipelineCacheAdapterIdentity
+{
+  uint32_t vendorId;
+  uint32_t deviceId;
+  uint32_t subSysId;
+  uint32_t revision;
+  uint64_t driverVersion;
+
+  bool operator==(const PipelineCacheAdapterIdentity& rhs) const
+  {
+    return vendorId == rhs.vendorId && deviceId == rhs.deviceId && subSysId == rhs.subSysId &&
+      revision == rhs.revision && driverVersion == rhs.driverVersion;
+  }
+  bool operator!=(const PipelineCacheAdapterIdentity& rhs) const { return !(*this == rhs); }
+};
+
+// パイプラインキャッシュのファイル形式. D3D12 に依存しない.
+// ID3D12PipelineLibrary をシリアライズしたもの 1 つ、または PSO 毎の GetCachedBlob をキーと組で保持する.
+// 末尾に全体のハッシュを置き、壊れたファイルは読み込まない.
+class PipelineCacheFile
+{
+public:
+  enum Format
+  {
+    Library = 1,
+    Blobs = 2,
+  };
+  PipelineCacheFile() : m_format(Blobs), m_adapter() {}
+
+  void Reset(Format format, const PipelineCacheAdapterIdentity& adapter);
+
+  // 形式が異なる、アダプタやドライバが異なる、壊れている場合は false を返して空になる.
+  bool Deserialize(const std::vector<char>& data, Format format, const PipelineCacheAdapterIdentity& adapter);
+  std::vector<char> Serialize() const;
+
+  // 一時ファイルへ書いてから置き換える.
+  static bool ReadFile(const std::string& fileName, std::vector<char>& data);
+  static bool WriteFile(const std::string& fileName, const std::vector<char>& data);
+
+  Format GetFormat() const { return m_format; }
+  const PipelineCacheAdapterIdentity& GetAdapter() const { return m_adapter; }
+
+  // Library 形式.
+  const std::vector<char>& GetLibraryData() const { return m_library; }
+  void SetLibraryData(std::vector<char> data) { m_library = std::move(data); }
+
+  // Blobs 形式. 見つからなければ nullptr.
+  const std::vector<char>* FindBlob(uint64_t key) const;
+  void SetBlob(uint64_t key, const void* data, size_t size);
+  size_t GetBlobCount() const { return m_blobs.size(); }
+private:
+  Format m_format;
+  PipelineCacheAdapterIdentity m_adapter;
+  std::vector<char> m_library;
+  std::map<uint64_t, std::vector<char>> m_blobs;
+};
@@ -0,0 +1,154 @@
+﻿#pragma once
+#include "PipelineStatePlatform.h"
+#include "PipelineCacheFile.h"
+
+// PSO の記述子から実行毎に変わらないハッシュ値を求める.
+// シェーダーはバイトコードの内容、入力レイアウトはセマンティクス名の文字列で積み、ポインタ値は使わない.
+// ルートシグネチャはシリアライズ結果のハッシュを呼び出し側から渡す. CachedPSO は含めない.
+namespace pipeline_hash
+{
+  inline void AddShader(StableHasher& hasher, const D3D12_SHADER_BYTECODE& shader)
+  {
+    hasher.AddU64(shader.pShaderBytecode ? shader.BytecodeLength : 0);
+    if (shader.pShaderBytecode)
+    {
+      hasher.AddBytes(shader.pShaderBytecode, shader.BytecodeLength);
+    }
+  }
+
+  inline void AddStreamOutput(StableHasher& hasher, const D3D12_STREAM_OUTPUT_DESC& desc)
+  {
+    const auto entryCount = desc.pSODeclaration ? desc.NumEntries : 0;
+    hasher.AddU32(entryCount);
+    for (UINT i = 0; i < entryCount; ++i)
+    {
+      const auto& v = desc.pSODeclaration[i];
+      hasher.AddU32(v.Stream);
+      hasher.AddString(v.SemanticName);
+      hasher.AddU32(v.SemanticIndex);
+      hasher.AddU32(v.StartComponent);
+      hasher.AddU32(v.ComponentCount);
+      hasher.AddU32(v.OutputSlot);
+    }
+    const auto strideCount = desc.pBufferStrides ? desc.NumStrides : 0;
+    hasher.AddU32(strideCount);
+    for (UINT i = 0; i < strideCount; ++i)
+    {
+      hasher.AddU32(desc.pBufferStrides[i]);
+    }
+    hasher.AddU32(desc.RasterizedStream);
+  }
+
+  inline void AddBlend(StableHasher& hasher, const D3D12_BLEND_DESC& desc)
+  {
+    hasher.AddU32(desc.AlphaToCoverageEnable);
+    hasher.AddU32(desc.IndependentBlendEnable);
+    for (const auto& v : desc.RenderTarget)
+    {
+      hasher.AddU32(v.BlendEnable);
+      hasher.AddU32(v.LogicOpEnable);
+      hasher.AddU32(v.SrcBlend);
+      hasher.AddU32(v.DestBlend);
+      hasher.AddU32(v.BlendOp);
+      hasher.AddU32(v.SrcBlendAlpha);
+      hasher.AddU32(v.DestBlendAlpha);
+      hasher.AddU32(v.BlendOpAlpha);
+      hasher.AddU32(v.LogicOp);
+      hasher.AddU32(v.RenderTargetWriteMask);
+    }
+  }
+
+  inline void AddRasterizer(StableHasher& hasher, const D3D12_RASTERIZER_DESC& desc)
+  {
+    hasher.AddU32(desc.FillMode);
+    hasher.AddU32(desc.CullMode);
+    hasher.AddU32(desc.FrontCounterClockwise);
+    hasher.AddU32(uint32_t(desc.DepthBias));
+    hasher.AddFloat(desc.DepthBiasClamp);
+    hasher.AddFloat(desc.SlopeScaledDepthBias);
+    hasher.AddU32(desc.DepthClipEnable);
+    hasher.AddU32(desc.MultisampleEnable);
+    hasher.AddU32(desc.AntialiasedLineEnable);
+    hasher.AddU32(desc.ForcedSampleCount);
+    hasher.AddU32(desc.ConservativeRaster);
+  }
+
+  inline void AddStencilOp(StableHasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& desc)
+  {
+    hasher.AddU32(desc.StencilFailOp);
+    hasher.AddU32(desc.StencilDepthFailOp);
+    hasher.AddU32(desc.StencilPassOp);
+    hasher.AddU32(desc.StencilFunc);
+  }
+
+  inline void AddDepthStencil(StableHasher& hasher, const D3D12_DEPTH_STENCIL_DESC& desc)
+  {
+    hasher.AddU32(desc.DepthEnable);
+    hasher.AddU32(desc.DepthWriteMask);
+    hasher.AddU32(desc.DepthFunc);
+    hasher.AddU32(desc.StencilEnable);
+    hasher.AddU32(desc.StencilReadMask);
+    hasher.AddU32(desc.StencilWriteMask);
+    AddStencilOp(hasher, desc.FrontFace);
+    AddStencilOp(hasher, desc.BackFace);
+  }
+
+  inline void AddInputLayout(StableHasher& hasher, const D3D12_INPUT_LAYOUT_DESC& desc)
+  {
+    const auto count = desc.pInputElementDescs ? desc.NumElements : 0;
+    hasher.AddU32(count);
+    for (UINT i = 0; i < count; ++i)
+    {
+      const auto& v = desc.pInputElementDescs[i];
+      hasher.AddString(v.SemanticName);
+      hasher.AddU32(v.SemanticIndex);
+      hasher.AddU32(v.Format);
+      hasher.AddU32(v.InputSlot);
+      hasher.AddU32(v.AlignedByteOffset);
+      hasher.AddU32(v.InputSlotClass);
+      hasher.AddU32(v.InstanceDataStepRate);
+    }
+  }
+
+  inline uint64_t Hash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+  {
+    StableHasher hasher;
+    hasher.AddU32('G');
+    hasher.AddU64(rootSignatureHash);
+    AddShader(hasher, desc.VS);
+    AddShader(hasher, desc.PS);
+    AddShader(hasher, desc.DS);
+    AddShader(hasher, desc.HS);
+    AddShader(hasher, desc.GS);
+    AddStreamOutput(hasher, desc.StreamOutput);
+    AddBlend(hasher, desc.BlendState);
+    hasher.AddU32(desc.SampleMask);
+    AddRasterizer(hasher, desc.RasterizerState);
+    AddDepthStencil(hasher, desc.DepthStencilState);
+    AddInputLayout(hasher, desc.InputLayout);
+    hasher.AddU32(desc.IBStripCutValue);
+    hasher.AddU32(desc.PrimitiveTopologyType);
+    hasher.AddU32(desc.NumRenderTargets);
+    for (const auto& v : desc.RTVFormats)
+    {
+      hasher.AddU32(v);
+    }
+    hasher.AddU32(desc.DSVFormat);
+    hasher.AddU32(desc.SampleDesc.Count);
+    hasher.AddU32(desc.SampleDesc.Quality);
+    hasher.AddU32(desc.NodeMask);
+    hasher.AddU32(desc.Flags);
+    return hasher.GetValue();
+  }
+
+  inline uint64_t Hash(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+  {
+    StableHasher hasher;
+    hasher.AddU32('C');
+    hasher.AddU64(rootSignatureHash);
+    AddShader(hasher, desc.CS);
+    hasher.AddU32(desc.NodeMask);
+    hasher.AddU32(desc.Flags);
+    return hasher.GetValue();
+  }
+}
@@ -0,0 +1,209 @@
+﻿#pragma once
+// PSO の記述子のハッシュ(PipelineStateHash.h)が使う D3D12 の型.
+// Windows では d3d12.h をそのまま使う.
+// それ以外では単体テストをビルドできるよう、ハッシュが読むメンバだけを同じ名前と並びで定義する.
+#if defined(_WIN32)
+#include <d3d12.h>
+#else
+#include <cstddef>
+#include <cstdint>
+
+typedef uint8_t UINT8;
+typedef uint32_t UINT;
+typedef int32_t INT;
+typedef int32_t BOOL;
+typedef float FLOAT;
+typedef size_t SIZE_T;
+typedef const char* LPCSTR;
+
+struct ID3D12RootSignature;
+
+enum DXGI_FORMAT
+{
+  DXGI_FORMAT_UNKNOWN = 0,
+  DXGI_FORMAT_R32G32B32_FLOAT = 6,
+  DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+  DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+  DXGI_FORMAT_D32_FLOAT = 40,
+};
+
+// 値を使わない列挙は型だけを用意する.
+enum D3D12_BLEND : int {};
+enum D3D12_BLEND_OP : int {};
+enum D3D12_LOGIC_OP : int {};
+enum D3D12_STENCIL_OP : int {};
+enum D3D12_COMPARISON_FUNC : int {};
+enum D3D12_DEPTH_WRITE_MASK : int {};
+enum D3D12_CONSERVATIVE_RASTERIZATION_MODE : int {};
+enum D3D12_INDEX_BUFFER_STRIP_CUT_VALUE : int {};
+enum D3D12_PIPELINE_STATE_FLAGS : int {};
+
+enum D3D12_FILL_MODE
+{
+  D3D12_FILL_MODE_WIREFRAME = 2,
+  D3D12_FILL_MODE_SOLID = 3,
+};
+enum D3D12_CULL_MODE
+{
+  D3D12_CULL_MODE_NONE = 1,
+  D3D12_CULL_MODE_FRONT = 2,
+  D3D12_CULL_MODE_BACK = 3,
+};
+enum D3D12_PRIMITIVE_TOPOLOGY_TYPE
+{
+  D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED = 0,
+  D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT = 1,
+  D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE = 2,
+  D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE = 3,
+  D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH = 4,
+};
+enum D3D12_INPUT_CLASSIFICATION
+{
+  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA = 0,
+  D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA = 1,
+};
+
+struct D3D12_SHADER_BYTECODE
+{
+  const void* pShaderBytecode;
+  SIZE_T BytecodeLength;
+};
+
+struct D3D12_SO_DECLARATION_ENTRY
+{
+  UINT Stream;
+  LPCSTR SemanticName;
+  UINT SemanticIndex;
+  UINT8 StartComponent;
+  UINT8 ComponentCount;
+  UINT8 OutputSlot;
+};
+
+struct D3D12_STREAM_OUTPUT_DESC
+{
+  const D3D12_SO_DECLARATION_ENTRY* pSODeclaration;
+  UINT NumEntries;
+  const UINT* pBufferStrides;
+  UINT NumStrides;
+  UINT RasterizedStream;
+};
+
+struct D3D12_RENDER_TARGET_BLEND_DESC
+{
+  BOOL BlendEnable;
+  BOOL LogicOpEnable;
+  D3D12_BLEND SrcBlend;
+  D3D12_BLEND DestBlend;
+  D3D12_BLEND_OP BlendOp;
+  D3D12_BLEND SrcBlendAlpha;
+  D3D12_BLEND DestBlendAlpha;
+  D3D12_BLEND_OP BlendOpAlpha;
+  D3D12_LOGIC_OP LogicOp;
+  UINT8 RenderTargetWriteMask;
+};
+
+struct D3D12_BLEND_DESC
+{
+  BOOL AlphaToCoverageEnable;
+  BOOL IndependentBlendEnable;
+  D3D12_RENDER_TARGET_BLEND_DESC RenderTarget[8];
+};
+
+struct D3D12_RASTERIZER_DESC
+{
+  D3D12_FILL_MODE FillMode;
+  D3D12_CULL_MODE CullMode;
+  BOOL FrontCounterClockwise;
+  INT DepthBias;
+  FLOAT DepthBiasClamp;
+  FLOAT SlopeScaledDepthBias;
+  BOOL DepthClipEnable;
+  BOOL MultisampleEnable;
+  BOOL AntialiasedLineEnable;
+  UINT ForcedSampleCount;
+  D3D12_CONSERVATIVE_RASTERIZATION_MODE ConservativeRaster;
+};
+
+struct D3D12_DEPTH_STENCILOP_DESC
+{
+  D3D12_STENCIL_OP StencilFailOp;
+  D3D12_STENCIL_OP StencilDepthFailOp;
+  D3D12_STENCIL_OP StencilPassOp;
+  D3D12_COMPARISON_FUNC StencilFunc;
+};
+
+struct D3D12_DEPTH_STENCIL_DESC
+{
+  BOOL DepthEnable;
+  D3D12_DEPTH_WRITE_MASK DepthWriteMask;
+  D3D12_COMPARISON_FUNC DepthFunc;
+  BOOL StencilEnable;
+  UINT8 StencilReadMask;
+  UINT8 StencilWriteMask;
+  D3D12_DEPTH_STENCILOP_DESC FrontFace;
+  D3D12_DEPTH_STENCILOP_DESC BackFace;
+};
+
+struct D3D12_INPUT_ELEMENT_DESC
+{
+  LPCSTR SemanticName;
+  UINT SemanticIndex;
+  DXGI_FORMAT Format;
+  UINT InputSlot;
+  UINT AlignedByteOffset;
+  D3D12_INPUT_CLASSIFICATION InputSlotClass;
+  UINT InstanceDataStepRate;
+};
+
+struct D3D12_INPUT_LAYOUT_DESC
+{
+  const D3D12_INPUT_ELEMENT_DESC* pInputElementDescs;
+  UINT NumElements;
+};
+
+struct D3D12_CACHED_PIPELINE_STATE
+{
+  const void* pCachedBlob;
+  SIZE_T CachedBlobSizeInBytes;
+};
+
+struct DXGI_SAMPLE_DESC
+{
+  UINT Count;
+  UINT Quality;
+};
+
+struct D3D12_GRAPHICS_PIPELINE_STATE_DESC
+{
+  ID3D12RootSignature* pRootSignature;
+  D3D12_SHADER_BYTECODE VS;
+  D3D12_SHADER_BYTECODE PS;
+  D3D12_SHADER_BYTECODE DS;
+  D3D12_SHADER_BYTECODE HS;
+  D3D12_SHADER_BYTECODE GS;
+  D3D12_STREAM_OUTPUT_DESC StreamOutput;
+  D3D12_BLEND_DESC BlendState;
+  UINT SampleMask;
+  D3D12_RASTERIZER_DESC RasterizerState;
+  D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+  D3D12_INPUT_LAYOUT_DESC InputLayout;
+  D3D12_INDEX_BUFFER_STRIP_CUT_VALUE IBStripCutValue;
+  D3D12_PRIMITIVE_TOPOLOGY_TYPE PrimitiveTopologyType;
+  UINT NumRenderTargets;
+  DXGI_FORMAT RTVFormats[8];
+  DXGI_FORMAT DSVFormat;
+  DXGI_SAMPLE_DESC SampleDesc;
+  UINT NodeMask;
+  D3D12_CACHED_PIPELINE_STATE CachedPSO;
+  D3D12_PIPELINE_STATE_FLAGS Flags;
+};
+
+struct D3D12_COMPUTE_PIPELINE_STATE_DESC
+{
+  ID3D12RootSignature* pRootSignature;
+  D3D12_SHADER_BYTECODE CS;
+  UINT NodeMask;
+  D3D12_CACHED_PIPELINE_STATE CachedPSO;
+  D3D12_PIPELINE_STATE_FLAGS Flags;
+};
+#endif
@@ -0,0 +1,419 @@
+﻿#include "RenderGraph.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+bool RenderGraph::IsReadOnlyState(uint32_t state)
+{
+  // COMMON (PRESENT) は 0 で、他の読み込み状態とはまとめられないので含めない.
+  const uint32_t writeStates =
+    State_RenderTarget | State_UnorderedAccess | State_DepthWrite | State_CopyDest;
+  return state != State_Common && (state & writeStates) == 0;
+}
+
+RenderGraph::ResourceId RenderGraph::ImportResource(const std::string& name, uint32_t initialState, uint32_t finalState)
+{
+  Resource res{};
+  res.name = name;
+  res.transient = false;
+  res.initialState = initialState;
+  res.finalState = finalState;
+  m_resources.push_back(res);
+  return ResourceId(m_resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::CreateTransient(const std::string& name, const TransientDesc& desc, uint32_t initialState)
+{
+  Resource res{};
+  res.name = name;
+  res.transient = true;
+  res.desc = desc;
+  // 次のフレームでも同じ状態から始められるよう、終了時には生成時の状態へ戻す.
+  res.initialState = initialState;
+  res.finalState = initialState;
+  m_resources.push_back(res);
+  return ResourceId(m_resources.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::AddPass(const std::string& name, bool hasSideEffect)
+{
+  Pass pass{};
+  pass.name = name;
+  pass.hasSideEffect = hasSideEffect;
+  m_passes.push_back(pass);
+  return PassId(m_passes.size() - 1);
+}
+
+void RenderGraph::Read(PassId pass, ResourceId resource, uint32_t state)
+{
+  m_passes[pass].accesses.push_back(Access{ resource, state, false });
+}
+
+void RenderGraph::Write(PassId pass, ResourceId resource, uint32_t state)
+{
+  m_passes[pass].accesses.push_back(Access{ resource, state, true });
+}
+
+void RenderGraph::Reset()
+{
+  m_passes.clear();
+  m_resources.clear();
+  m_schedule.clear();
+  m_finalBarriers.clear();
+  m_transientHeapSize = 0;
+}
+
+void RenderGraph::Compile(const CompileOptions& options)
+{
+  m_schedule.clear();
+  m_finalBarriers.clear();
+  m_transientHeapSize = 0;
+
+  CullPasses(options.cullPasses);
+  for (PassId i = 0; i < m_passes.size(); ++i)
+  {
+    if (!m_passes[i].culled)
+    {
+      m_schedule.push_back(CompiledPass{ i, {} });
+    }
+  }
+
+  // 寿命の算出.
+  for (auto& res : m_resources)
+  {
+    res.firstUse = InvalidId;
+    res.lastUse = InvalidId;
+    res.offset = 0;
+  }
+  for (uint32_t pos = 0; pos < m_schedule.size(); ++pos)
+  {
+    for (const auto& access : m_passes[m_schedule[pos].pass].accesses)
+    {
+      auto& res = m_resources[access.resource];
+      if (res.firstUse == InvalidId)
+      {
+        res.firstUse = pos;
+      }
+      res.lastUse = pos;
+    }
+  }
+
+  PlanTransients();
+  BuildBarriers(options.allowSplitBarriers);
+}
+
+void RenderGraph::CullPasses(bool enable)
+{
+  for (auto& pass : m_passes)
+  {
+    pass.culled = false;
+  }
+  if (!enable)
+  {
+    return;
+  }
+
+  // 後ろから辿り、結果が外部に出るパスと、その入力を作るパスだけを残す.
+  std::vector<bool> needed(m_resources.size(), false);
+  for (size_t i = m_passes.size(); i > 0; --i)
+  {
+    auto& pass = m_passes[i - 1];
+    bool isLive = pass.hasSideEffect;
+    for (const auto& access : pass.accesses)
+    {
+      if (access.isWrite && (!m_resources[access.resource].transient || needed[access.resource]))
+      {
+        isLive = true;
+      }
+    }
+    pass.culled = !isLive;
+    if (isLive)
+    {
+      for (const auto& access : pass.accesses)
+      {
+        if (!access.isWrite)
+        {
+          needed[access.resource] = true;
+        }
+      }
+    }
+  }
+}
+
+void RenderGraph::PlanTransients()
+{
+  TransientAliasPlanner planner;
+  std::vector<ResourceId> planned;
+  for (ResourceId i = 0; i < m_resources.size(); ++i)
+  {
+    const auto& res = m_resources[i];
+    if (!res.transient || res.firstUse == InvalidId)
+    {
+      continue;
+    }
+    planner.Add(TransientAliasPlanner::Request{ res.desc.size, res.desc.alignment, res.firstUse, res.lastUse });
+    planned.push_back(i);
+  }
+  m_transientHeapSize = planner.Plan();
+  for (uint32_t i = 0; i < planned.size(); ++i)
+  {
+    m_resources[planned[i]].offset = planner.GetOffset(i);
+  }
+}
+
+std::vector<RenderGraph::Access> RenderGraph::MergeAccesses(const Pass& pass) const
+{
+  std::vector<Access> merged;
+  for (const auto& access : pass.accesses)
+  {
+    auto itr = std::find_if(merged.begin(), merged.end(),
+      [&](const Access& v) { return v.resource == access.resource; });
+    if (itr == merged.end())
+    {
+      merged.push_back(access);
+    }
+    else if (itr->state == access.state)
+    {
+      itr->isWrite |= access.isWrite;
+    }
+    else if (IsReadOnlyState(itr->state) && IsReadOnlyState(access.state))
+    {
+      // 読み込み同士なら、両方を満たす状態へまとめられる.
+      itr->state |= access.state;
+    }
+    else
+    {
+      // 書き込み状態は他の状態と同時には取れない.
+      throw std::invalid_argument("conflicting states in pass " + pass.name + ".(RenderGraph)");
+    }
+  }
+  return merged;
+}
+
+void RenderGraph::BuildBarriers(bool allowSplit)
+{
+  struct Tracking
+  {
+    uint32_t state;
+    uint32_t lastUse;   // 直前に使用したスケジュール位置. フレーム開始前は InvalidId.
+    bool hasUavWrite;   // 最後の同期の後に UAV 書き込みがある.
+  };
+  std::vector<Tracking> tracking(m_resources.size());
+  for (ResourceId i = 0; i < m_resources.size(); ++i)
+  {
+    tracking[i] = Tracking{ m_resources[i].initialState, InvalidId, false };
+  }
+
+  std::vector<std::vector<Access>> merged;
+  for (const auto& v : m_schedule)
+  {
+    merged.push_back(MergeAccesses(m_passes[v.pass]));
+  }
+
+  for (uint32_t pos = 0; pos < m_schedule.size(); ++pos)
+  {
+    for (const auto& access : merged[pos])
+    {
+      const auto id = access.resource;
+      const auto& res = m_resources[id];
+      auto& track = tracking[id];
+      auto& barriers = m_schedule[pos].barriers;
+
+      // 一時リソースの使い始めはメモリの所有を切り替える.
+      if (res.transient && res.firstUse == pos)
+      {
+        ResourceId previous = InvalidId;
+        uint32_t previousLastUse = 0;
+        for (ResourceId other = 0; other < m_resources.size(); ++other)
+        {
+          const auto& o = m_resources[other];
+          if (other == id || !o.transient || o.firstUse == InvalidId || o.lastUse >= pos)
+          {
+            continue;
+          }
+          const bool overlap = res.offset < o.offset + o.desc.size && o.offset < res.offset + res.desc.size;
+          if (overlap && (previous == InvalidId || o.lastUse >= previousLastUse))
+          {
+            previous = other;
+            previousLastUse = o.lastUse;
+          }
+        }
+        barriers.push_back(Barrier{ Barrier_Aliasing, id, previous, 0, 0, Split_None });
+      }
+
+      uint32_t target = access.state;
+      if (!access.isWrite && IsReadOnlyState(access.state))
+      {
+        // 次の書き込みまで読み込みが続くなら、まとめて 1 回で遷移させる.
+        for (uint32_t next = pos + 1; next < m_schedule.size(); ++next)
+        {
+          auto itr = std::find_if(merged[next].begin(), merged[next].end(),
+            [=](const Access& v) { return v.resource == id; });
+          if (itr == merged[next].end())
+          {
+            continue;
+          }
+          if (itr->isWrite || !IsReadOnlyState(itr->state))
+          {
+            break;
+          }
+          target |= itr->state;
+        }
+        if (IsReadOnlyState(track.state) && (track.state & access.state) == access.state && access.state != State_Common)
+        {
+          target = track.state; // 既に読める状態.
+        }
+      }
+
+      if (track.state == target)
+      {
+        // UAV のままでも、直前の UAV 書き込みの完了は待つ必要がある.
+        if (target == State_UnorderedAccess && track.hasUavWrite)
+        {
+          barriers.push_back(Barrier{ Barrier_UAV, id, InvalidId, target, target, Split_None });
+          track.hasUavWrite = false;
+        }
+      }
+      else
+      {
+        // 前回の使用から間が空いていれば、遷移を分割して前倒しで開始する.
+        // 一時リソースはメモリの切り替え前に遷移を始められないので分割しない.
+        const uint32_t beginPos = track.lastUse == InvalidId ? 0 : track.lastUse + 1;
+        const bool isFirstUseOfTransient = res.transient && res.firstUse == pos;
+        if (allowSplit && beginPos < pos && !isFirstUseOfTransient)
+        {
+          m_schedule[beginPos].barriers.push_back(Barrier{ Barrier_Transition, id, InvalidId, track.state, target, Split_Begin });
+          barriers.push_back(Barrier{ Barrier_Transition, id, InvalidId, track.state, target, Split_End });
+        }
+        else
+        {
+          barriers.push_back(Barrier{ Barrier_Transition, id, InvalidId, track.state, target, Split_None });
+        }
+        track.state = target;
+        // 遷移で書き込みの完了も待つ.
+        track.hasUavWrite = false;
+      }
+      if (access.isWrite && access.state == State_UnorderedAccess)
+      {
+        track.hasUavWrite = true;
+      }
+      track.lastUse = pos;
+    }
+
+    // 一時リソースはメモリを次の所有者へ渡す前に、使用後すぐ初期状態へ戻す.
+    for (ResourceId id = 0; id < m_resources.size(); ++id)
+    {
+      const auto& res = m_resources[id];
+      auto& track = tracking[id];
+      if (!res.transient || res.lastUse != pos || track.state == res.finalState)
+      {
+        continue;
+      }
+      auto& barriers = (pos + 1 < m_schedule.size()) ? m_schedule[pos + 1].barriers : m_finalBarriers;
+      barriers.push_back(Barrier{ Barrier_Transition, id, InvalidId, track.state, res.finalState, Split_None });
+      track.state = res.finalState;
+    }
+  }
+
+  for (ResourceId i = 0; i < m_resources.size(); ++i)
+  {
+    if (tracking[i].state != m_resources[i].finalState)
+    {
+      m_finalBarriers.push_back(Barrier{ Barrier_Transition, i, InvalidId, tracking[i].state, m_resources[i].finalState, Split_None });
+    }
+  }
+}
+
+uint32_t RenderGraph::GetBarrierCount() const
+{
+  size_t count = m_finalBarriers.size();
+  for (const auto& v : m_schedule)
+  {
+    count += v.barriers.size();
+  }
+  return uint32_t(count);
+}
+
+std::string RenderGraph::StateToString(uint32_t state)
+{
+  static const struct { uint32_t bit; const char* name; } names[] = {
+    { State_VertexAndConstantBuffer, "VERTEX_AND_CONSTANT_BUFFER" },
+    { State_IndexBuffer, "INDEX_BUFFER" },
+    { State_RenderTarget, "RENDER_TARGET" },
+    { State_UnorderedAccess, "UNORDERED_ACCESS" },
+    { State_DepthWrite, "DEPTH_WRITE" },
+    { State_DepthRead, "DEPTH_READ" },
+    { State_NonPixelShaderResource, "NON_PIXEL_SHADER_RESOURCE" },
+    { State_PixelShaderResource, "PIXEL_SHADER_RESOURCE" },
+    { State_IndirectArgument, "INDIRECT_ARGUMENT" },
+    { State_CopyDest, "COPY_DEST" },
+    { State_CopySource, "COPY_SOURCE" },
+  };
+  if (state == State_Common)
+  {
+    return "COMMON";
+  }
+  std::string ret;
+  for (const auto& v : names)
+  {
+    if (state & v.bit)
+    {
+      ret += ret.empty() ? "" : "|";
+      ret += v.name;
+    }
+  }
+  return ret;
+}
+
+std::string RenderGraph::Dump() const
+{
+  auto barrierToString = [this](const Barrier& b) {
+    std::ostringstream ss;
+    switch (b.type)
+    {
+    case Barrier_Transition:
+      ss << "Transition " << m_resources[b.resource].name << " "
+        << StateToString(b.before) << " -> " << StateToString(b.after);
+      if (b.split == Split_Begin) { ss << " (begin)"; }
+      if (b.split == Split_End) { ss << " (end)"; }
+      break;
+    case Barrier_Aliasing:
+      ss << "Aliasing "
+        << (b.aliasBefore == InvalidId ? std::string("(none)") : m_resources[b.aliasBefore].name)
+        << " -> " << m_resources[b.resource].name;
+      break;
+    case Barrier_UAV:
+      ss << "UAV " << m_resources[b.resource].name;
+      break;
+    }
+    return ss.str();
+  };
+
+  std::ostringstream ss;
+  for (uint32_t pos = 0; pos < m_schedule.size(); ++pos)
+  {
+    const auto& compiled = m_schedule[pos];
+    ss << "[" << pos << "] " << m_passes[compiled.pass].name << "\n";
+    for (const auto& b : compiled.barriers)
+    {
+      ss << "    " << barrierToString(b) << "\n";
+    }
+  }
+  ss << "[final]\n";
+  for (const auto& b : m_finalBarriers)
+  {
+    ss << "    " << barrierToString(b) << "\n";
+  }
+  for (PassId i = 0; i < m_passes.size(); ++i)
+  {
+    if (m_passes[i].culled)
+    {
+      ss << "culled: " << m_passes[i].name << "\n";
+    }
+  }
+  if (m_transientHeapSize > 0)
+  {
+    ss << "transient heap: " << m_transientHeapSize << " bytes\n";
+  }
+  return ss.str();
+}
@@ -0,0 +1,151 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TransientAliasPlanner.h"
+
+// パスが読み書きするリソースを宣言し、必要なバリアを求めるレンダーグラフ.
+// コンパイル処理は D3D12 に依存せず、記録は RenderGraphExecutor が行う.
+class RenderGraph
+{
+public:
+  using ResourceId = uint32_t;
+  using PassId = uint32_t;
+  static const uint32_t InvalidId = ~0u;
+
+  // 値は D3D12_RESOURCE_STATES と同じ.
+  enum ResourceState : uint32_t
+  {
+    State_Common = 0,
+    State_Present = 0,
+    State_VertexAndConstantBuffer = 0x1,
+    State_IndexBuffer = 0x2,
+    State_RenderTarget = 0x4,
+    State_UnorderedAccess = 0x8,
+    State_DepthWrite = 0x10,
+    State_DepthRead = 0x20,
+    State_NonPixelShaderResource = 0x40,
+    State_PixelShaderResource = 0x80,
+    State_IndirectArgument = 0x200,
+    State_CopyDest = 0x400,
+    State_CopySource = 0x800,
+  };
+  static bool IsReadOnlyState(uint32_t state);
+
+  enum BarrierType
+  {
+    Barrier_Transition,
+    Barrier_Aliasing,
+    Barrier_UAV,
+  };
+  enum BarrierSplit
+  {
+    Split_None,
+    Split_Begin,  // 前回の使用直後に開始.
+    Split_End,    // 使用直前に完了.
+  };
+  struct Barrier
+  {
+    BarrierType type;
+    ResourceId resource;
+    ResourceId aliasBefore; // Aliasing の時、直前にメモリを使っていたリソース. 無ければ InvalidId.
+    uint32_t before;
+    uint32_t after;
+    BarrierSplit split;
+  };
+
+  struct TransientDesc
+  {
+    uint64_t size;
+    uint64_t alignment;
+  };
+
+  // 外部で管理するリソース. フレーム開始時と終了時の状態を指定する.
+  ResourceId ImportResource(const std::string& name, uint32_t initialState, uint32_t finalState);
+  // グラフ内だけで使うリソース. 寿命が重ならないもの同士でメモリを共有する.
+  ResourceId CreateTransient(const std::string& name, const TransientDesc& desc, uint32_t initialState);
+
+  // hasSideEffect のパスは出力が読まれなくても削除しない.
+  PassId AddPass(const std::string& name, bool hasSideEffect = false);
+  // 1 つのパスで同じリソースを複数の状態で使えるのは、読み込み専用の状態同士だけ(COMMON は含まない).
+  // 書き込み状態を他の状態と合わせると Compile が std::invalid_argument を投げる.
+  void Read(PassId pass, ResourceId resource, uint32_t state);
+  void Write(PassId pass, ResourceId resource, uint32_t state);
+
+  struct CompileOptions
+  {
+    bool allowSplitBarriers;
+    bool cullPasses;
+  };
+  void Compile(const CompileOptions& options = CompileOptions{ true, true });
+  // 宣言とコンパイル結果を全て破棄する.
+  void Reset();
+
+  // コンパイル結果. パスの実行前に発行するバリアを、実行順に並べたもの.
+  struct CompiledPass
+  {
+    PassId pass;
+    std::vector<Barrier> barriers;
+  };
+  const std::vector<CompiledPass>& GetSchedule() const { return m_schedule; }
+  // 全パスの後に発行するバリア.
+  const std::vector<Barrier>& GetFinalBarriers() const { return m_finalBarriers; }
+  bool IsCulled(PassId pass) const { return m_passes[pass].culled; }
+
+  uint32_t GetResourceCount() const { return uint32_t(m_resources.size()); }
+  uint32_t GetPassCount() const { return uint32_t(m_passes.size()); }
+  const std::string& GetResourceName(ResourceId resource) const { return m_resources[resource].name; }
+  const std::string& GetPassName(PassId pass) const { return m_passes[pass].name; }
+  bool IsTransient(ResourceId resource) const { return m_resources[resource].transient; }
+  uint32_t GetInitialState(ResourceId resource) const { return m_resources[resource].initialState; }
+  // 寿命はスケジュール上の位置. 使われないリソースは InvalidId.
+  uint32_t GetFirstUse(ResourceId resource) const { return m_resources[resource].firstUse; }
+  uint32_t GetLastUse(ResourceId resource) const { return m_resources[resource].lastUse; }
+  uint64_t GetTransientOffset(ResourceId resource) const { return m_resources[resource].offset; }
+  uint64_t GetTransientHeapSize() const { return m_transientHeapSize; }
+  uint32_t GetBarrierCount() const;
+
+  // コンパイル済みのバリアスケジュールを文字列にする.
+  std::string Dump() const;
+  static std::string StateToString(uint32_t state);
+
+private:
+  struct Access
+  {
+    ResourceId resource;
+    uint32_t state;
+    bool isWrite;
+  };
+  struct Pass
+  {
+    std::string name;
+    bool hasSideEffect;
+    bool culled;
+    std::vector<Access> accesses;
+  };
+  struct Resource
+  {
+    std::string name;
+    bool transient;
+    TransientDesc desc;
+    uint32_t initialState;
+    uint32_t finalState;
+    uint32_t firstUse;
+    uint32_t lastUse;
+    uint64_t offset;
+  };
+
+  void CullPasses(bool enable);
+  void PlanTransients();
+  void BuildBarriers(bool allowSplit);
+  // pass 内の同じリソースへの宣言をまとめる.
+  std::vector<Access> MergeAccesses(const Pass& pass) const;
+
+  std::vector<Pass> m_passes;
+  std::vector<Resource> m_resources;
+
+  std::vector<CompiledPass> m_schedule;
+  std::vector<Barrier> m_finalBarriers;
+  uint64_t m_transientHeapSize = 0;
+};
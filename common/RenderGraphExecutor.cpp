@@ -0,0 +1,263 @@
+﻿#include "RenderGraphExecutor.h"
+#include <cstring>
+
+RenderGraphExecutor::RenderGraphExecutor(ComPtr<ID3D12Device> device, std::shared_ptr<ResourceAllocator> allocator)
+  : m_device(device), m_allocator(allocator)
+{
+}
+
+RenderGraphExecutor::ResourceId RenderGraphExecutor::ImportResource(const std::string& name, ID3D12Resource* resource,
+  D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState)
+{
+  auto id = m_graph.ImportResource(name, initialState, finalState);
+  m_resources.push_back(resource);
+  return id;
+}
+
+RenderGraphExecutor::ResourceId RenderGraphExecutor::ImportResource(const std::string& name, TrackedResource& resource,
+  D3D12_RESOURCE_STATES finalState)
+{
+  auto initialState = resource.GetState();
+  for (UINT i = 1; i < resource.GetSubresourceCount(); ++i)
+  {
+    if (resource.GetState(i) != initialState)
+    {
+      throw book_util::DX12Exception("Subresource states must be uniform.(RenderGraphExecutor)");
+    }
+  }
+  auto id = ImportResource(name, resource.Get(), initialState, finalState);
+  // グラフの最終バリアで finalState になる.
+  resource.SetState(finalState);
+  return id;
+}
+
+RenderGraphExecutor::ResourceId RenderGraphExecutor::CreateTransient(const std::string& name, const D3D12_RESOURCE_DESC& desc,
+  D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+  // グラフの配置計画をそのままアロケータへ渡すので、アロケータと同じサイズと境界で計画する.
+  auto resDesc = desc;
+  auto info = m_allocator->GetAllocationInfo(resDesc);
+  auto id = m_graph.CreateTransient(name, RenderGraph::TransientDesc{ info.SizeInBytes, info.Alignment }, initialState);
+  m_resources.push_back(nullptr);
+
+  TransientEntry entry{};
+  entry.id = id;
+  entry.desc = resDesc;
+  entry.initialState = initialState;
+  entry.hasClearValue = clearValue != nullptr;
+  if (clearValue)
+  {
+    entry.clearValue = *clearValue;
+  }
+  m_transients.push_back(entry);
+  return id;
+}
+
+RenderGraphExecutor::PassId RenderGraphExecutor::AddPass(const std::string& name, ExecuteFunc func, bool hasSideEffect)
+{
+  auto id = m_graph.AddPass(name, hasSideEffect);
+  m_passFuncs.push_back(func);
+  return id;
+}
+
+void RenderGraphExecutor::Read(PassId pass, ResourceId resource, D3D12_RESOURCE_STATES state)
+{
+  m_graph.Read(pass, resource, state);
+}
+
+void RenderGraphExecutor::Write(PassId pass, ResourceId resource, D3D12_RESOURCE_STATES state)
+{
+  m_graph.Write(pass, resource, state);
+}
+
+void RenderGraphExecutor::Compile(bool allowSplitBarriers)
+{
+  m_graph.Compile(RenderGraph::CompileOptions{ allowSplitBarriers, true });
+  PrepareTransients();
+}
+
+void RenderGraphExecutor::Reset()
+{
+  m_graph.Reset();
+  m_resources.clear();
+  m_passFuncs.clear();
+  m_transients.clear();
+}
+
+bool RenderGraphExecutor::IsSameTransient(const TransientEntry& a, const TransientEntry& b)
+{
+  if (std::memcmp(&a.desc, &b.desc, sizeof(a.desc)) != 0)
+  {
+    return false;
+  }
+  if (a.hasClearValue != b.hasClearValue)
+  {
+    return false;
+  }
+  if (a.hasClearValue && std::memcmp(&a.clearValue, &b.clearValue, sizeof(a.clearValue)) != 0)
+  {
+    return false;
+  }
+  return a.initialState == b.initialState && a.firstUse == b.firstUse && a.lastUse == b.lastUse;
+}
+
+void RenderGraphExecutor::PrepareTransients()
+{
+  // カリングで使われなくなったものは実体を作らない.
+  std::vector<TransientEntry> used;
+  for (auto& v : m_transients)
+  {
+    v.firstUse = m_graph.GetFirstUse(v.id);
+    v.lastUse = m_graph.GetLastUse(v.id);
+    if (v.firstUse != RenderGraph::InvalidId)
+    {
+      used.push_back(v);
+    }
+  }
+
+  bool isSame = used.size() == m_cachedTransients.size();
+  for (size_t i = 0; isSame && i < used.size(); ++i)
+  {
+    isSame = IsSameTransient(used[i], m_cachedTransients[i]);
+  }
+  if (!isSame)
+  {
+    m_retired.insert(m_retired.end(), m_cachedResources.begin(), m_cachedResources.end());
+
+    // 配置はグラフで計画したものを使い、エイリアスバリアと Dump の内容を実際の配置と一致させる.
+    std::vector<ResourceAllocator::TransientDesc> descs;
+    ResourceAllocator::TransientPlacement placement{};
+    placement.heapSize = m_graph.GetTransientHeapSize();
+    for (const auto& v : used)
+    {
+      descs.push_back(ResourceAllocator::TransientDesc{
+        v.desc, v.initialState, v.hasClearValue ? &v.clearValue : nullptr, v.firstUse, v.lastUse });
+      placement.offsets.push_back(m_graph.GetTransientOffset(v.id));
+    }
+    m_cachedResources = m_allocator->CreateTransientResources(descs, placement);
+    m_cachedTransients = used;
+  }
+
+  for (size_t i = 0; i < used.size(); ++i)
+  {
+    m_resources[used[i].id] = m_cachedResources[i].Get();
+  }
+}
+
+D3D12_RESOURCE_BARRIER RenderGraphExecutor::ToResourceBarrier(const RenderGraph::Barrier& barrier) const
+{
+  auto resource = m_resources[barrier.resource];
+  switch (barrier.type)
+  {
+  case RenderGraph::Barrier_Aliasing:
+    return CD3DX12_RESOURCE_BARRIER::Aliasing(
+      barrier.aliasBefore == RenderGraph::InvalidId ? nullptr : m_resources[barrier.aliasBefore], resource);
+  case RenderGraph::Barrier_UAV:
+    return CD3DX12_RESOURCE_BARRIER::UAV(resource);
+  default:
+    break;
+  }
+
+  auto flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+  if (barrier.split == RenderGraph::Split_Begin)
+  {
+    flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+  }
+  if (barrier.split == RenderGraph::Split_End)
+  {
+    flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+  }
+  return CD3DX12_RESOURCE_BARRIER::Transition(
+    resource,
+    D3D12_RESOURCE_STATES(barrier.before),
+    D3D12_RESOURCE_STATES(barrier.after),
+    D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+    flags);
+}
+
+void RenderGraphExecutor::RecordBarriers(ID3D12GraphicsCommandList* command, const std::vector<RenderGraph::Barrier>& barriers)
+{
+  // メモリを切り替えたリソースは、他のバリアより先に内容を破棄(初期化)する.
+  std::vector<D3D12_RESOURCE_BARRIER> aliasing, others;
+  std::vector<ID3D12Resource*> discards;
+  for (const auto& v : barriers)
+  {
+    if (v.type != RenderGraph::Barrier_Aliasing)
+    {
+      others.push_back(ToResourceBarrier(v));
+      continue;
+    }
+    aliasing.push_back(ToResourceBarrier(v));
+    const auto flags = m_resources[v.resource]->GetDesc().Flags;
+    const auto state = m_graph.GetInitialState(v.resource);
+    const bool isRT = (flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) && state == D3D12_RESOURCE_STATE_RENDER_TARGET;
+    const bool isDS = (flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) && state == D3D12_RESOURCE_STATE_DEPTH_WRITE;
+    if (isRT || isDS)
+    {
+      discards.push_back(m_resources[v.resource]);
+    }
+  }
+
+  if (!aliasing.empty())
+  {
+    command->ResourceBarrier(UINT(aliasing.size()), aliasing.data());
+  }
+  for (auto resource : discards)
+  {
+    command->DiscardResource(resource, nullptr);
+  }
+  if (!others.empty())
+  {
+    command->ResourceBarrier(UINT(others.size()), others.data());
+  }
+}
+
+void RenderGraphExecutor::ExecutePass(ID3D12GraphicsCommandList* command, PassId pass)
+{
+  if (m_profiler)
+  {
+    GpuProfiler::Scope scope(m_profiler.get(), command, m_graph.GetPassName(pass));
+    m_passFuncs[pass](command);
+  }
+  else
+  {
+    m_passFuncs[pass](command);
+  }
+}
+
+void RenderGraphExecutor::Execute(ID3D12GraphicsCommandList* command)
+{
+  for (const auto& compiled : m_graph.GetSchedule())
+  {
+    RecordBarriers(command, compiled.barriers);
+    ExecutePass(command, compiled.pass);
+  }
+  RecordBarriers(command, m_graph.GetFinalBarriers());
+}
+
+std::vector<RenderGraphExecutor::ExecuteFunc> RenderGraphExecutor::BuildRecordPasses()
+{
+  std::vector<ExecuteFunc> passes;
+  const auto& schedule = m_graph.GetSchedule();
+  for (size_t i = 0; i < schedule.size(); ++i)
+  {
+    const bool isLast = (i + 1) == schedule.size();
+    passes.push_back([this, i, isLast](ID3D12GraphicsCommandList* command) {
+      const auto& compiled = m_graph.GetSchedule()[i];
+      RecordBarriers(command, compiled.barriers);
+      ExecutePass(command, compiled.pass);
+      if (isLast)
+      {
+        RecordBarriers(command, m_graph.GetFinalBarriers());
+      }
+    });
+  }
+  return passes;
+}
+
+std::vector<RenderGraphExecutor::ComPtr<ID3D12Resource1>> RenderGraphExecutor::TakeRetiredResources()
+{
+  std::vector<ComPtr<ID3D12Resource1>> retired;
+  retired.swap(m_retired);
+  return retired;
+}
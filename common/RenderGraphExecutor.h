@@ -0,0 +1,90 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "d3dx12.h"
+#include "RenderGraph.h"
+#include "ResourceAllocator.h"
+#include "TrackedResource.h"
+#include "GpuProfiler.h"
+
+// RenderGraph のコンパイル結果を D3D12 のコマンドとして記録する.
+// 毎フレーム Reset してパスを登録し直し、Compile の後に Execute (または BuildRecordPasses) を呼ぶ.
+class RenderGraphExecutor
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+  using ResourceId = RenderGraph::ResourceId;
+  using PassId = RenderGraph::PassId;
+  using ExecuteFunc = std::function<void(ID3D12GraphicsCommandList* command)>;
+
+  RenderGraphExecutor(ComPtr<ID3D12Device> device, std::shared_ptr<ResourceAllocator> allocator);
+
+  ResourceId ImportResource(const std::string& name, ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState);
+  // 開始時の状態は追跡中の状態を使い、追跡側は finalState へ更新する.
+  // 全サブリソースが同じ状態で、未発行の遷移が無いこと.
+  ResourceId ImportResource(const std::string& name, TrackedResource& resource, D3D12_RESOURCE_STATES finalState);
+  // 実体は Compile 時に作られ、構成が前フレームと同じなら使い回す.
+  // 全ての一時リソースは同じヒープ種別(バッファ/RT・DS テクスチャ/その他)であること.
+  ResourceId CreateTransient(const std::string& name, const D3D12_RESOURCE_DESC& desc,
+    D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+  PassId AddPass(const std::string& name, ExecuteFunc func, bool hasSideEffect = false);
+  void Read(PassId pass, ResourceId resource, D3D12_RESOURCE_STATES state);
+  void Write(PassId pass, ResourceId resource, D3D12_RESOURCE_STATES state);
+
+  // 複数のリストへ分けて記録する場合は分割バリアを使わないこと.
+  void Compile(bool allowSplitBarriers = true);
+  void Reset();
+
+  // 一時リソースは Compile 後に有効.
+  ID3D12Resource* GetResource(ResourceId resource) const { return m_resources[resource]; }
+
+  // 全パスを 1 つのリストへ順に記録する.
+  void Execute(ID3D12GraphicsCommandList* command);
+  // パス毎に記録する関数を返す. D3D12AppBase::RecordParallel へ渡す想定.
+  std::vector<ExecuteFunc> BuildRecordPasses();
+
+  // 構成の変化で不要になった一時リソース. GPU の完了後に解放すること.
+  std::vector<ComPtr<ID3D12Resource1>> TakeRetiredResources();
+
+  const RenderGraph& GetGraph() const { return m_graph; }
+  // 設定すると各パスをパス名で計測する.
+  void SetProfiler(std::shared_ptr<GpuProfiler> profiler) { m_profiler = profiler; }
+private:
+  struct TransientEntry
+  {
+    ResourceId id;
+    D3D12_RESOURCE_DESC desc;
+    D3D12_RESOURCE_STATES initialState;
+    bool hasClearValue;
+    D3D12_CLEAR_VALUE clearValue;
+    UINT firstUse;
+    UINT lastUse;
+  };
+  static bool IsSameTransient(const TransientEntry& a, const TransientEntry& b);
+  void PrepareTransients();
+  void RecordBarriers(ID3D12GraphicsCommandList* command, const std::vector<RenderGraph::Barrier>& barriers);
+  D3D12_RESOURCE_BARRIER ToResourceBarrier(const RenderGraph::Barrier& barrier) const;
+  void ExecutePass(ID3D12GraphicsCommandList* command, PassId pass);
+
+  ComPtr<ID3D12Device> m_device;
+  std::shared_ptr<ResourceAllocator> m_allocator;
+  RenderGraph m_graph;
+
+  std::vector<ID3D12Resource*> m_resources;
+  std::vector<ExecuteFunc> m_passFuncs;
+
+  std::vector<TransientEntry> m_transients;
+  // 前回 Compile 時の一時リソースの構成と実体.
+  std::vector<TransientEntry> m_cachedTransients;
+  std::vector<ComPtr<ID3D12Resource1>> m_cachedResources;
+  std::vector<ComPtr<ID3D12Resource1>> m_retired;
+  std::shared_ptr<GpuProfiler> m_profiler;
+};
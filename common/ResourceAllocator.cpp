@@ -0,0 +1,377 @@
+﻿#include "ResourceAllocator.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+  // 配置したリソースのプライベートデータとして持たせ、リソースと共に解放されたときに領域を返却する.
+  // {6B0A5C2E-3F4D-4E8A-9C71-2D5B8E4F1A93}
+  const GUID ReleaseCallbackGuid = { 0x6b0a5c2e, 0x3f4d, 0x4e8a, { 0x9c, 0x71, 0x2d, 0x5b, 0x8e, 0x4f, 0x1a, 0x93 } };
+
+  class ReleaseCallback : public IUnknown
+  {
+  public:
+    ReleaseCallback(Microsoft::WRL::ComPtr<ID3D12Heap> heap, std::function<void()> onRelease)
+      : m_refCount(1), m_heap(heap), m_onRelease(onRelease)
+    {
+    }
+    ~ReleaseCallback()
+    {
+      m_onRelease();
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+      if (ppvObject == nullptr)
+      {
+        return E_POINTER;
+      }
+      if (riid == __uuidof(IUnknown))
+      {
+        *ppvObject = static_cast<IUnknown*>(this);
+        AddRef();
+        return S_OK;
+      }
+      *ppvObject = nullptr;
+      return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+      return ++m_refCount;
+    }
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+      auto count = --m_refCount;
+      if (count == 0)
+      {
+        delete this;
+      }
+      return count;
+    }
+  private:
+    std::atomic<ULONG> m_refCount;
+    Microsoft::WRL::ComPtr<ID3D12Heap> m_heap;
+    std::function<void()> m_onRelease;
+  };
+}
+
+ResourceAllocator::ResourceAllocator(ComPtr<ID3D12Device> device, UINT64 blockSize)
+  : m_device(device), m_blockSize(blockSize), m_peakUsedSize(0), m_nextId(0)
+{
+  D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+  HRESULT hr = m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+  m_heapTier = SUCCEEDED(hr) ? options.ResourceHeapTier : D3D12_RESOURCE_HEAP_TIER_1;
+}
+
+ResourceAllocator::ComPtr<ID3D12Resource1> ResourceAllocator::CreateResource(
+  const D3D12_RESOURCE_DESC& desc,
+  D3D12_RESOURCE_STATES resourceStates,
+  const D3D12_CLEAR_VALUE* clearValue,
+  D3D12_HEAP_TYPE heapType)
+{
+  auto resDesc = desc;
+  const auto info = GetAllocationInfo(resDesc);
+  const auto category = GetCategory(resDesc);
+
+  ComPtr<ID3D12Resource1> resource;
+  AllocationId id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& pool = m_pools[UINT(heapType) * 4 + UINT(category)];
+    pool.heapType = heapType;
+    pool.category = category;
+
+    // 既存のヒープから探し、空きがなければヒープを追加する.
+    HeapBlock* block = nullptr;
+    UINT64 offset = BuddyAllocator::InvalidOffset;
+    for (auto& v : pool.blocks)
+    {
+      offset = v->allocator.Allocate(info.SizeInBytes, info.Alignment);
+      if (offset != BuddyAllocator::InvalidOffset)
+      {
+        block = v.get();
+        break;
+      }
+    }
+    if (block == nullptr)
+    {
+      // ブロックより大きいリソースは専用のヒープとする.
+      UINT64 heapSize = m_blockSize;
+      while (heapSize < info.SizeInBytes)
+      {
+        heapSize *= 2;
+      }
+      auto newBlock = std::make_unique<HeapBlock>(heapSize);
+      newBlock->heap = CreateHeap(heapSize, heapType, category);
+      offset = newBlock->allocator.Allocate(info.SizeInBytes, info.Alignment);
+      block = newBlock.get();
+      pool.blocks.push_back(std::move(newBlock));
+    }
+
+    HRESULT hr = m_device->CreatePlacedResource(
+      block->heap.Get(),
+      offset,
+      &resDesc,
+      resourceStates,
+      clearValue,
+      IID_PPV_ARGS(&resource)
+    );
+    if (FAILED(hr))
+    {
+      block->allocator.Free(offset);
+    }
+    ThrowIfFailed(hr, "CreatePlacedResource failed.");
+
+    id = m_nextId++;
+    m_allocations[id] = Allocation{ &pool, block, offset };
+    m_peakUsedSize = std::max(m_peakUsedSize, GetUsedSize());
+  }
+
+  // ロックの外で行う. 失敗した場合はここで領域が返却される.
+  std::weak_ptr<ResourceAllocator> owner = shared_from_this();
+  AttachReleaseCallback({ resource.Get() }, nullptr, [owner, id]() {
+    if (auto allocator = owner.lock())
+    {
+      allocator->FreeAllocation(id);
+    }
+  });
+  return resource;
+}
+
+void ResourceAllocator::FreeAllocation(AllocationId id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto itr = m_allocations.find(id);
+  if (itr == m_allocations.end())
+  {
+    return;
+  }
+  auto pool = itr->second.pool;
+  auto block = itr->second.block;
+  block->allocator.Free(itr->second.offset);
+  m_allocations.erase(itr);
+
+  // 先頭以外の空になったヒープは解放する.
+  if (block->allocator.IsEmpty() && pool->blocks.front().get() != block)
+  {
+    pool->blocks.erase(
+      std::find_if(pool->blocks.begin(), pool->blocks.end(),
+        [=](const std::unique_ptr<HeapBlock>& v) { return v.get() == block; }));
+  }
+}
+
+void ResourceAllocator::FreeTransientHeap(AllocationId id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_transientHeaps.erase(id);
+}
+
+void ResourceAllocator::AttachReleaseCallback(const std::vector<ID3D12Resource*>& resources,
+  ComPtr<ID3D12Heap> heap, std::function<void()> onRelease)
+{
+  // 各リソースが参照を 1 つずつ持つ. 最後のリソースの破棄で onRelease が呼ばれる.
+  ComPtr<IUnknown> callback;
+  callback.Attach(new ReleaseCallback(heap, onRelease));
+  for (auto resource : resources)
+  {
+    HRESULT hr = resource->SetPrivateDataInterface(ReleaseCallbackGuid, callback.Get());
+    ThrowIfFailed(hr, "SetPrivateDataInterface failed.(ResourceAllocator)");
+  }
+}
+
+std::vector<ResourceAllocator::ComPtr<ID3D12Resource1>> ResourceAllocator::CreateTransientResources(const std::vector<TransientDesc>& descs)
+{
+  TransientAliasPlanner planner;
+  for (const auto& v : descs)
+  {
+    auto resDesc = v.desc;
+    const auto info = GetAllocationInfo(resDesc);
+    planner.Add(TransientAliasPlanner::Request{ info.SizeInBytes, info.Alignment, v.firstPass, v.lastPass });
+  }
+  TransientPlacement placement{};
+  placement.heapSize = planner.Plan();
+  for (UINT i = 0; i < UINT(descs.size()); ++i)
+  {
+    placement.offsets.push_back(planner.GetOffset(i));
+  }
+  return CreateTransientResources(descs, placement);
+}
+
+std::vector<ResourceAllocator::ComPtr<ID3D12Resource1>> ResourceAllocator::CreateTransientResources(
+  const std::vector<TransientDesc>& descs, const TransientPlacement& placement)
+{
+  std::vector<ComPtr<ID3D12Resource1>> resources;
+  if (descs.empty())
+  {
+    return resources;
+  }
+
+  std::vector<D3D12_RESOURCE_DESC> resDescs;
+  TransientAliasPlanner planner;
+  const auto category = GetCategory(descs.front().desc);
+  for (const auto& v : descs)
+  {
+    if (GetCategory(v.desc) != category)
+    {
+      throw book_util::DX12Exception("Transient resources must share a heap category.");
+    }
+    auto resDesc = v.desc;
+    const auto info = GetAllocationInfo(resDesc);
+    planner.Add(TransientAliasPlanner::Request{ info.SizeInBytes, info.Alignment, v.firstPass, v.lastPass });
+    resDescs.push_back(resDesc);
+  }
+
+  // 配置は計画どおりに行い、ここで決め直さない.
+  if (!planner.IsValidPlacement(placement.offsets, placement.heapSize))
+  {
+    throw book_util::DX12Exception("Invalid transient placement.(ResourceAllocator)");
+  }
+  const auto heapSize = placement.heapSize;
+  auto heap = CreateHeap(heapSize, D3D12_HEAP_TYPE_DEFAULT, category);
+
+  std::vector<ID3D12Resource*> placed;
+  for (UINT i = 0; i < UINT(descs.size()); ++i)
+  {
+    ComPtr<ID3D12Resource1> resource;
+    HRESULT hr = m_device->CreatePlacedResource(
+      heap.Get(),
+      placement.offsets[i],
+      &resDescs[i],
+      descs[i].initialState,
+      descs[i].clearValue,
+      IID_PPV_ARGS(&resource)
+    );
+    ThrowIfFailed(hr, "CreatePlacedResource failed.(Transient)");
+    resources.push_back(resource);
+    placed.push_back(resource.Get());
+  }
+
+  AllocationId id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    id = m_nextId++;
+    m_transientHeaps[id] = TransientHeap{ heapSize, planner.GetUnaliasedSize() };
+  }
+  // ヒープはリソースと同じ寿命とし、全て解放されたら統計からも外す.
+  std::weak_ptr<ResourceAllocator> owner = shared_from_this();
+  AttachReleaseCallback(placed, heap, [owner, id]() {
+    if (auto allocator = owner.lock())
+    {
+      allocator->FreeTransientHeap(id);
+    }
+  });
+  return resources;
+}
+
+UINT64 ResourceAllocator::GetUsedSize() const
+{
+  UINT64 usedSize = 0;
+  for (const auto& pool : m_pools)
+  {
+    for (const auto& block : pool.second.blocks)
+    {
+      usedSize += block->allocator.GetUsedSize();
+    }
+  }
+  return usedSize;
+}
+
+ResourceAllocator::Statistics ResourceAllocator::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Statistics stats{};
+  UINT64 fragmentedSize = 0;
+  for (const auto& pool : m_pools)
+  {
+    for (const auto& block : pool.second.blocks)
+    {
+      const auto& allocator = block->allocator;
+      stats.heapCount++;
+      stats.allocationCount += allocator.GetAllocationCount();
+      stats.reservedSize += allocator.GetCapacity();
+      stats.usedSize += allocator.GetUsedSize();
+      stats.requestedSize += allocator.GetRequestedSize();
+      fragmentedSize += UINT64(allocator.GetFragmentation() * (allocator.GetCapacity() - allocator.GetUsedSize()));
+    }
+  }
+  for (const auto& v : m_transientHeaps)
+  {
+    stats.heapCount++;
+    stats.transientSize += v.second.size;
+    stats.transientUnaliasedSize += v.second.unaliasedSize;
+  }
+  const auto freeSize = stats.reservedSize - stats.usedSize;
+  stats.fragmentation = freeSize > 0 ? float(fragmentedSize) / float(freeSize) : 0.0f;
+  stats.peakUsedSize = std::max(m_peakUsedSize, stats.usedSize);
+  return stats;
+}
+
+ResourceAllocator::HeapCategory ResourceAllocator::GetCategory(const D3D12_RESOURCE_DESC& desc) const
+{
+  // Tier2 以降はバッファとテクスチャを同じヒープに混在できる.
+  if (m_heapTier != D3D12_RESOURCE_HEAP_TIER_1)
+  {
+    return HeapCategory_All;
+  }
+  if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+  {
+    return HeapCategory_Buffer;
+  }
+  const auto rtds = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+  return (desc.Flags & rtds) ? HeapCategory_RtDsTexture : HeapCategory_NonRtDsTexture;
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO ResourceAllocator::GetAllocationInfo(D3D12_RESOURCE_DESC& desc) const
+{
+  // RT/DS でない小さなテクスチャは 4KB 境界での配置を試みる.
+  const auto rtds = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+  if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && !(desc.Flags & rtds) && desc.Alignment == 0)
+  {
+    desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+    auto info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+    if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+    {
+      return info;
+    }
+    desc.Alignment = 0;
+  }
+  // 通常は 64KB 、 MSAA は 4MB 境界となる.
+  auto info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+  if (info.SizeInBytes == UINT64_MAX)
+  {
+    throw book_util::DX12Exception("GetResourceAllocationInfo failed.");
+  }
+  return info;
+}
+
+ResourceAllocator::ComPtr<ID3D12Heap> ResourceAllocator::CreateHeap(UINT64 size, D3D12_HEAP_TYPE heapType, HeapCategory category)
+{
+  D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_NONE;
+  switch (category)
+  {
+  case HeapCategory_Buffer:
+    flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    break;
+  case HeapCategory_NonRtDsTexture:
+    flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    break;
+  case HeapCategory_RtDsTexture:
+    flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+    break;
+  default:
+    break;
+  }
+
+  // MSAA のリソースも置けるよう、ヒープ自体は 4MB 境界で確保する.
+  const UINT64 alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+  D3D12_HEAP_DESC heapDesc{};
+  heapDesc.SizeInBytes = (size + alignment - 1) & ~(alignment - 1);
+  heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(heapType);
+  heapDesc.Alignment = alignment;
+  heapDesc.Flags = flags;
+
+  ComPtr<ID3D12Heap> heap;
+  HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+  ThrowIfFailed(hr, "CreateHeap failed.");
+  return heap;
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "d3dx12.h"
+#include "D3D12BookUtil.h"
+#include "BuddyAllocator.h"
+#include "TransientAliasPlanner.h"
+
+// 大きな ID3D12Heap をまとめて確保し、その中にリソースを配置(Placed)するアロケータ.
+// 領域の管理は BuddyAllocator 、一時的なリソースのエイリアス配置は TransientAliasPlanner で行う.
+// 領域はリソースの最後の参照が外れたときに返却されるので、 GPU が参照中のものは
+// DeferRelease でフレームの完了まで参照を保持すること. shared_ptr で保持して使う.
+class ResourceAllocator : public std::enable_shared_from_this<ResourceAllocator>
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  static const UINT64 DefaultBlockSize = 64 * 1024 * 1024;
+
+  ResourceAllocator(ComPtr<ID3D12Device> device, UINT64 blockSize = DefaultBlockSize);
+
+  ComPtr<ID3D12Resource1> CreateResource(
+    const D3D12_RESOURCE_DESC& desc,
+    D3D12_RESOURCE_STATES resourceStates,
+    const D3D12_CLEAR_VALUE* clearValue,
+    D3D12_HEAP_TYPE heapType
+  );
+  // 寿命の重ならないリソース同士が同じメモリを共有するよう 1 つのヒープへ配置する.
+  // 共有相手から切り替えて使う前には ALIASING バリアと Clear/Discard による初期化が必要.
+  // ヒープは返したリソースが全て解放されたときに解放される.
+  struct TransientDesc
+  {
+    D3D12_RESOURCE_DESC desc;
+    D3D12_RESOURCE_STATES initialState;
+    const D3D12_CLEAR_VALUE* clearValue;
+    UINT firstPass;
+    UINT lastPass;
+  };
+  std::vector<ComPtr<ID3D12Resource1>> CreateTransientResources(const std::vector<TransientDesc>& descs);
+  // 配置を呼び出し側で決めた場合. offsets は descs と同じ順で、 RenderGraph の計画をそのまま渡す.
+  // 寿命の重なるもの同士が重なる、境界に合わないなど、配置できない計画は例外.
+  struct TransientPlacement
+  {
+    std::vector<UINT64> offsets;
+    UINT64 heapSize;
+  };
+  std::vector<ComPtr<ID3D12Resource1>> CreateTransientResources(const std::vector<TransientDesc>& descs, const TransientPlacement& placement);
+  // 配置に使うサイズと境界. 小さなテクスチャは desc.Alignment を 4KB に書き換える.
+  // 配置を呼び出し側で決める場合は、これで求めたサイズと書き換えた desc を使うこと.
+  D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(D3D12_RESOURCE_DESC& desc) const;
+
+  struct Statistics
+  {
+    UINT heapCount;
+    UINT allocationCount;
+    UINT64 reservedSize;    // 確保済みヒープの合計.
+    UINT64 usedSize;        // ブロック単位で使用中の合計.
+    UINT64 peakUsedSize;
+    UINT64 requestedSize;   // リソースが要求したサイズの合計.
+    float  fragmentation;   // 各ヒープの外部断片化を容量で重み付けした平均.
+    UINT64 transientSize;   // エイリアス配置後のヒープサイズ.
+    UINT64 transientUnaliasedSize; // エイリアスしなかった場合のサイズ.
+  };
+  Statistics GetStatistics() const;
+
+private:
+  enum HeapCategory
+  {
+    HeapCategory_All,
+    HeapCategory_Buffer,
+    HeapCategory_NonRtDsTexture,
+    HeapCategory_RtDsTexture,
+  };
+  struct HeapBlock
+  {
+    ComPtr<ID3D12Heap> heap;
+    BuddyAllocator allocator;
+    HeapBlock(UINT64 size) : allocator(size, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) { }
+  };
+  struct Pool
+  {
+    D3D12_HEAP_TYPE heapType;
+    HeapCategory category;
+    std::vector<std::unique_ptr<HeapBlock>> blocks;
+  };
+  // 割り当て毎に振る番号. リソースのアドレスは解放後に再利用されるためキーにしない.
+  using AllocationId = UINT64;
+  struct Allocation
+  {
+    Pool* pool;
+    HeapBlock* block;
+    UINT64 offset;
+  };
+  // エイリアス配置したヒープの統計. ヒープ自体はリソースに持たせる.
+  struct TransientHeap
+  {
+    UINT64 size;
+    UINT64 unaliasedSize;
+  };
+
+  HeapCategory GetCategory(const D3D12_RESOURCE_DESC& desc) const;
+  ComPtr<ID3D12Heap> CreateHeap(UINT64 size, D3D12_HEAP_TYPE heapType, HeapCategory category);
+  // resources が全て解放されたときに onRelease を呼ぶ. heap はそれまで解放しない.
+  static void AttachReleaseCallback(const std::vector<ID3D12Resource*>& resources,
+    ComPtr<ID3D12Heap> heap, std::function<void()> onRelease);
+  void FreeAllocation(AllocationId id);
+  void FreeTransientHeap(AllocationId id);
+  UINT64 GetUsedSize() const;
+
+  ComPtr<ID3D12Device> m_device;
+  UINT64 m_blockSize;
+  D3D12_RESOURCE_HEAP_TIER m_heapTier;
+  UINT64 m_peakUsedSize;
+  AllocationId m_nextId;
+  // リソースの解放はどのスレッドからでも起こりうる.
+  mutable std::mutex m_mutex;
+
+  std::unordered_map<UINT, Pool> m_pools;
+  std::unordered_map<AllocationId, Allocation> m_allocations;
+  std::unordered_map<AllocationId, TransientHeap> m_transientHeaps;
+};
@@ -0,0 +1,206 @@
+﻿#include "ResourceStateTracker.h"
+#include <algorithm>
+#include <stdexcept>
+
+bool ResourceStateTracker::IsReadOnlyState(uint32_t state)
+{
+  // RENDER_TARGET | UNORDERED_ACCESS | DEPTH_WRITE | COPY_DEST | STREAM_OUT.
+  const uint32_t writeStates = 0x4 | 0x8 | 0x10 | 0x400 | 0x100;
+  return state != 0 && (state & writeStates) == 0;
+}
+
+void ResourceStateTracker::Register(ResourceKey resource, uint32_t subresourceCount, uint32_t initialState)
+{
+  Entry entry{};
+  entry.states.assign(subresourceCount, initialState);
+  entry.pending.assign(subresourceCount, Pending{ 0, 0 });
+  m_resources[resource] = entry;
+}
+
+void ResourceStateTracker::Unregister(ResourceKey resource)
+{
+  m_resources.erase(resource);
+  m_pendingOrder.erase(std::remove(m_pendingOrder.begin(), m_pendingOrder.end(), resource), m_pendingOrder.end());
+  m_pendingUAV.erase(std::remove(m_pendingUAV.begin(), m_pendingUAV.end(), resource), m_pendingUAV.end());
+}
+
+ResourceStateTracker::Entry& ResourceStateTracker::GetEntry(ResourceKey resource)
+{
+  auto itr = m_resources.find(resource);
+  if (itr == m_resources.end())
+  {
+    throw std::out_of_range("resource is not registered.(ResourceStateTracker)");
+  }
+  return itr->second;
+}
+
+const ResourceStateTracker::Entry& ResourceStateTracker::GetEntry(ResourceKey resource) const
+{
+  auto itr = m_resources.find(resource);
+  if (itr == m_resources.end())
+  {
+    throw std::out_of_range("resource is not registered.(ResourceStateTracker)");
+  }
+  return itr->second;
+}
+
+void ResourceStateTracker::TransitionSubresource(Entry& entry, uint32_t subresource, uint32_t state)
+{
+  auto current = entry.states[subresource];
+  if (current == state)
+  {
+    return;
+  }
+  // 読み込み状態を既に含んでいれば遷移は不要. COMMON (PRESENT) は 0 なので常に遷移する.
+  if (state != 0 && IsReadOnlyState(current) && (current & state) == state)
+  {
+    return;
+  }
+
+  auto& pending = entry.pending[subresource];
+  const bool wasPending = pending.before != pending.after;
+  if (!wasPending)
+  {
+    pending.before = current;
+  }
+  pending.after = state;
+  entry.states[subresource] = state;
+
+  // 未発行の遷移同士は 1 つにまとめ、元の状態に戻ったものは取り消す.
+  const bool isPending = pending.before != pending.after;
+  if (wasPending && !isPending)
+  {
+    entry.pendingCount--;
+  }
+  if (!wasPending && isPending)
+  {
+    entry.pendingCount++;
+  }
+}
+
+void ResourceStateTracker::Transition(ResourceKey resource, uint32_t subresource, uint32_t state)
+{
+  auto& entry = GetEntry(resource);
+  if (subresource == AllSubresources)
+  {
+    for (uint32_t i = 0; i < uint32_t(entry.states.size()); ++i)
+    {
+      TransitionSubresource(entry, i, state);
+    }
+  }
+  else
+  {
+    TransitionSubresource(entry, subresource, state);
+  }
+
+  if (entry.pendingCount > 0 && !entry.queued)
+  {
+    entry.queued = true;
+    m_pendingOrder.push_back(resource);
+  }
+}
+
+void ResourceStateTracker::UAVBarrier(ResourceKey resource)
+{
+  if (std::find(m_pendingUAV.begin(), m_pendingUAV.end(), resource) == m_pendingUAV.end())
+  {
+    m_pendingUAV.push_back(resource);
+  }
+}
+
+void ResourceStateTracker::SetState(ResourceKey resource, uint32_t subresource, uint32_t state)
+{
+  auto& entry = GetEntry(resource);
+  const uint32_t first = subresource == AllSubresources ? 0 : subresource;
+  const uint32_t last = subresource == AllSubresources ? uint32_t(entry.states.size()) : subresource + 1;
+  for (uint32_t i = first; i < last; ++i)
+  {
+    auto& pending = entry.pending[i];
+    if (pending.before != pending.after)
+    {
+      // 未発行の遷移の結果を上書きする場合、遷移先だけを差し替える.
+      pending.after = state;
+      if (pending.before == pending.after)
+      {
+        entry.pendingCount--;
+      }
+    }
+    entry.states[i] = state;
+  }
+}
+
+bool ResourceStateTracker::HasPending() const
+{
+  if (!m_pendingUAV.empty())
+  {
+    return true;
+  }
+  return std::any_of(m_pendingOrder.begin(), m_pendingOrder.end(), [this](ResourceKey key) {
+    return GetEntry(key).pendingCount > 0;
+  });
+}
+
+uint32_t ResourceStateTracker::GetState(ResourceKey resource, uint32_t subresource) const
+{
+  return GetEntry(resource).states[subresource];
+}
+
+bool ResourceStateTracker::GetUniformState(ResourceKey resource, uint32_t& state) const
+{
+  const auto& states = GetEntry(resource).states;
+  state = states.empty() ? 0 : states.front();
+  return std::all_of(states.begin(), states.end(), [=](uint32_t v) { return v == state; });
+}
+
+uint32_t ResourceStateTracker::GetSubresourceCount(ResourceKey resource) const
+{
+  return uint32_t(GetEntry(resource).states.size());
+}
+
+std::vector<ResourceStateTracker::Barrier> ResourceStateTracker::Flush()
+{
+  std::vector<Barrier> barriers;
+  for (auto key : m_pendingOrder)
+  {
+    auto& entry = GetEntry(key);
+    entry.queued = false;
+    if (entry.pendingCount == 0)
+    {
+      continue;
+    }
+
+    const auto& front = entry.pending.front();
+    const bool isUniform = entry.pendingCount == entry.pending.size() &&
+      std::all_of(entry.pending.begin(), entry.pending.end(), [&](const Pending& v) {
+        return v.before == front.before && v.after == front.after;
+      });
+    if (isUniform)
+    {
+      barriers.push_back(Barrier{ Barrier_Transition, key, AllSubresources, front.before, front.after });
+    }
+    else
+    {
+      for (uint32_t i = 0; i < uint32_t(entry.pending.size()); ++i)
+      {
+        const auto& v = entry.pending[i];
+        if (v.before != v.after)
+        {
+          barriers.push_back(Barrier{ Barrier_Transition, key, i, v.before, v.after });
+        }
+      }
+    }
+    for (auto& v : entry.pending)
+    {
+      v = Pending{ 0, 0 };
+    }
+    entry.pendingCount = 0;
+  }
+  m_pendingOrder.clear();
+
+  for (auto key : m_pendingUAV)
+  {
+    barriers.push_back(Barrier{ Barrier_UAV, key, AllSubresources, 0, 0 });
+  }
+  m_pendingUAV.clear();
+  return barriers;
+}
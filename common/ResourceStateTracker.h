@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// リソースの現在の状態をサブリソース単位で記録し、必要な遷移だけを積んでおく.
+// 状態の値は D3D12_RESOURCE_STATES と同じ. D3D12 には依存しない.
+// 積んだ遷移は Flush でまとめて取り出し、1 回の ResourceBarrier で発行する想定.
+class ResourceStateTracker
+{
+public:
+  using ResourceKey = const void*;
+  static const uint32_t AllSubresources = 0xffffffff;
+
+  enum BarrierType
+  {
+    Barrier_Transition,
+    Barrier_UAV,
+  };
+  struct Barrier
+  {
+    BarrierType type;
+    ResourceKey resource;
+    uint32_t subresource;   // 全サブリソースが同じ遷移なら AllSubresources.
+    uint32_t before;
+    uint32_t after;
+  };
+
+  void Register(ResourceKey resource, uint32_t subresourceCount, uint32_t initialState);
+  void Unregister(ResourceKey resource);
+  bool IsRegistered(ResourceKey resource) const { return m_resources.count(resource) != 0; }
+
+  // state にする遷移を積む. 既にその状態(読み込み同士なら包含)であれば何もしない.
+  void Transition(ResourceKey resource, uint32_t subresource, uint32_t state);
+  // UAV 書き込み同士の順序付け. 同じリソースへは 1 フラッシュに 1 回だけ積む.
+  void UAVBarrier(ResourceKey resource);
+  // バリアを介さずに変わった状態(グラフの最終状態など)を反映する.
+  void SetState(ResourceKey resource, uint32_t subresource, uint32_t state);
+
+  uint32_t GetState(ResourceKey resource, uint32_t subresource) const;
+  // 全サブリソースが同じ状態なら true を返し、その状態を state に入れる.
+  bool GetUniformState(ResourceKey resource, uint32_t& state) const;
+  uint32_t GetSubresourceCount(ResourceKey resource) const;
+
+  // 積んだ後に取り消された遷移は含まない.
+  bool HasPending() const;
+  // 積まれた遷移を取り出す. 同じリソースの全サブリソースが同じ遷移なら 1 つにまとめる.
+  std::vector<Barrier> Flush();
+
+  static bool IsReadOnlyState(uint32_t state);
+private:
+  struct Pending
+  {
+    uint32_t before;
+    uint32_t after;
+  };
+  struct Entry
+  {
+    std::vector<uint32_t> states;
+    // 未発行の遷移. 添字はサブリソース、遷移が無い所は before == after.
+    std::vector<Pending> pending;
+    uint32_t pendingCount;
+    bool queued;  // m_pendingOrder に登録済み.
+  };
+  Entry& GetEntry(ResourceKey resource);
+  const Entry& GetEntry(ResourceKey resource) const;
+  void TransitionSubresource(Entry& entry, uint32_t subresource, uint32_t state);
+
+  std::unordered_map<ResourceKey, Entry> m_resources;
+  // Flush で出力する順序を登録順に保つため、遷移を積んだリソースを記録しておく.
+  std::vector<ResourceKey> m_pendingOrder;
+  std::vector<ResourceKey> m_pendingUAV;
+};
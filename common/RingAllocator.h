@@ -0,0 +1,109 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+
+// リング状に領域を切り出す線形アロケータ.
+// オフセットの管理のみを行い、 GPU リソースには依存しない.
+// 割り当てた領域はフレーム終端でフェンス値と紐付け、完了したフェンス値を受け取って解放する.
+class RingAllocator
+{
+public:
+  static const uint64_t InvalidOffset = ~0ull;
+
+  explicit RingAllocator(uint64_t capacity)
+    : m_capacity(capacity), m_head(0), m_tail(0), m_used(0), m_currentFrameSize(0)
+  {
+  }
+
+  // 確保できないときは InvalidOffset を返す.
+  uint64_t Allocate(uint64_t size, uint64_t alignment)
+  {
+    if (size == 0 || size > m_capacity)
+    {
+      return InvalidOffset;
+    }
+    if (m_used > 0 && m_head == m_tail)
+    {
+      return InvalidOffset; // 満杯.
+    }
+
+    uint64_t offset = AlignUp(m_head, alignment);
+    if (m_used == 0 || m_head > m_tail)
+    {
+      // 末尾側 [head, capacity) に収まるか.
+      if (offset + size <= m_capacity)
+      {
+        Commit(offset + size - m_head);
+        m_head = offset + size;
+        return offset;
+      }
+      // 先頭側 [0, tail) に折り返して収まるか. 末尾の残りは捨てる.
+      if (size <= m_tail)
+      {
+        Commit(m_capacity - m_head + size);
+        m_head = size;
+        return 0;
+      }
+      return InvalidOffset;
+    }
+
+    // head < tail の場合は [head, tail) のみが空き.
+    if (offset + size <= m_tail)
+    {
+      Commit(offset + size - m_head);
+      m_head = offset + size;
+      return offset;
+    }
+    return InvalidOffset;
+  }
+
+  // ここまでに確保した領域を fenceValue の完了で解放されるよう登録する.
+  void FinishFrame(uint64_t fenceValue)
+  {
+    m_pendingFrames.push_back(FrameMarker{ fenceValue, m_head, m_currentFrameSize });
+    m_currentFrameSize = 0;
+  }
+
+  // completedValue までのフェンスが完了したフレームの領域を解放する.
+  void ReleaseCompleted(uint64_t completedValue)
+  {
+    while (!m_pendingFrames.empty() && m_pendingFrames.front().fenceValue <= completedValue)
+    {
+      const auto& frame = m_pendingFrames.front();
+      m_tail = frame.head;
+      m_used -= frame.size;
+      m_pendingFrames.pop_front();
+    }
+  }
+
+  bool HasPendingFrames() const { return !m_pendingFrames.empty(); }
+  uint64_t GetOldestPendingFenceValue() const { return m_pendingFrames.front().fenceValue; }
+
+  uint64_t GetCapacity() const { return m_capacity; }
+  uint64_t GetUsedSize() const { return m_used; }
+
+  static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+private:
+  void Commit(uint64_t size)
+  {
+    m_used += size;
+    m_currentFrameSize += size;
+  }
+
+  struct FrameMarker
+  {
+    uint64_t fenceValue;
+    uint64_t head;
+    uint64_t size;
+  };
+
+  uint64_t m_capacity;
+  uint64_t m_head;
+  uint64_t m_tail;
+  uint64_t m_used;
+  uint64_t m_currentFrameSize;
+  std::deque<FrameMarker> m_pendingFrames;
+};
@@ -0,0 +1,481 @@
+﻿#include "RootSignatureCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+#include "Shader.h"
+#include "PipelineCache.h"
+#include "D3D12BookUtil.h"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace
+{
+  // 全ステージの参照をまとめたリソース.
+  struct ShaderBinding
+  {
+    std::string name;
+    D3D12_DESCRIPTOR_RANGE_TYPE rangeType;
+    UINT shaderRegister;
+    UINT registerSpace;
+    UINT count;           // 非有界なら UINT_MAX.
+    UINT constantCount;   // ルート定数にする場合の 32bit 値の数.
+    uint32_t stageMask;   // 1 << D3D12_SHADER_VISIBILITY_xxx. コンピュートは ALL の位置.
+  };
+
+  struct Parameter
+  {
+    D3D12_ROOT_PARAMETER_TYPE type;
+    std::vector<size_t> bindings;
+    uint32_t stageMask;
+  };
+
+  const uint32_t ComputeStageBit = 1u << D3D12_SHADER_VISIBILITY_ALL;
+
+  D3D12_SHADER_VISIBILITY GetStageVisibility(UINT version)
+  {
+    switch (D3D12_SHVER_GET_TYPE(version))
+    {
+    case D3D12_SHVER_VERTEX_SHADER: return D3D12_SHADER_VISIBILITY_VERTEX;
+    case D3D12_SHVER_HULL_SHADER: return D3D12_SHADER_VISIBILITY_HULL;
+    case D3D12_SHVER_DOMAIN_SHADER: return D3D12_SHADER_VISIBILITY_DOMAIN;
+    case D3D12_SHVER_GEOMETRY_SHADER: return D3D12_SHADER_VISIBILITY_GEOMETRY;
+    case D3D12_SHVER_PIXEL_SHADER: return D3D12_SHADER_VISIBILITY_PIXEL;
+    default: return D3D12_SHADER_VISIBILITY_ALL;
+    }
+  }
+
+  // 1 つのステージだけが参照していればそのステージに限定する.
+  D3D12_SHADER_VISIBILITY ToVisibility(uint32_t stageMask)
+  {
+    const D3D12_SHADER_VISIBILITY stages[] = {
+      D3D12_SHADER_VISIBILITY_VERTEX, D3D12_SHADER_VISIBILITY_HULL, D3D12_SHADER_VISIBILITY_DOMAIN,
+      D3D12_SHADER_VISIBILITY_GEOMETRY, D3D12_SHADER_VISIBILITY_PIXEL,
+    };
+    for (auto v : stages)
+    {
+      if (stageMask == (1u << v))
+      {
+        return v;
+      }
+    }
+    return D3D12_SHADER_VISIBILITY_ALL;
+  }
+
+  D3D12_DESCRIPTOR_RANGE_TYPE GetRangeType(D3D_SHADER_INPUT_TYPE type)
+  {
+    switch (type)
+    {
+    case D3D_SIT_CBUFFER:
+      return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+    case D3D_SIT_SAMPLER:
+      return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+    case D3D_SIT_UAV_RWTYPED:
+    case D3D_SIT_UAV_RWSTRUCTURED:
+    case D3D_SIT_UAV_RWBYTEADDRESS:
+    case D3D_SIT_UAV_APPEND_STRUCTURED:
+    case D3D_SIT_UAV_CONSUME_STRUCTURED:
+    case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+    case D3D_SIT_UAV_FEEDBACKTEXTURE:
+      return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    default:
+      return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    }
+  }
+
+  // テーブル内は CBV, SRV, UAV の順に並べる.
+  int GetTableOrder(D3D12_DESCRIPTOR_RANGE_TYPE type)
+  {
+    switch (type)
+    {
+    case D3D12_DESCRIPTOR_RANGE_TYPE_CBV: return 0;
+    case D3D12_DESCRIPTOR_RANGE_TYPE_SRV: return 1;
+    case D3D12_DESCRIPTOR_RANGE_TYPE_UAV: return 2;
+    default: return 3;
+    }
+  }
+
+  D3D12_DESCRIPTOR_RANGE_FLAGS GetRangeFlags(const ShaderBinding& binding)
+  {
+    // 非有界配列はテーブルを設定した後もディスクリプタを書き足す使い方を想定する.
+    auto flags = binding.count == UINT_MAX ?
+      D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+    switch (binding.rangeType)
+    {
+    case D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER:
+      return flags;
+    case D3D12_DESCRIPTOR_RANGE_TYPE_UAV:
+      // シェーダーから書き込まれるため.
+      return flags | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE;
+    default:
+      return flags | D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+    }
+  }
+
+  // 事前コンパイル済みのシェーダーは ShaderBuild が書き出したものを読み、 DXC を使わない.
+  // 見つからなければ(Windows 以外でビルドしたものなど) DXIL から取り出す.
+  bool LoadReflection(ID3DBlob* code, ShaderReflectionData& data)
+  {
+    if (Shader::IsPrecompiledMode())
+    {
+      std::vector<char> stored;
+      const auto key = Shader::MakeReflectionKey(code->GetBufferPointer(), code->GetBufferSize());
+      if (Shader::GetPrecompiledReflectionStore().Load(key, stored) && data.Deserialize(stored))
+      {
+        return true;
+      }
+    }
+    return ShaderCompiler::GetForCurrentThread().ReflectBindings(code, data);
+  }
+
+  bool HasSlot(const std::vector<RootSignatureCache::RegisterSlot>& slots, UINT shaderRegister, UINT registerSpace)
+  {
+    for (const auto& v : slots)
+    {
+      if (v.shaderRegister == shaderRegister && v.registerSpace == registerSpace)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool IsStaticSampler(const std::vector<D3D12_STATIC_SAMPLER_DESC>& samplers, UINT shaderRegister, UINT registerSpace)
+  {
+    for (const auto& v : samplers)
+    {
+      if (v.ShaderRegister == shaderRegister && v.RegisterSpace == registerSpace)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+const RootSignatureLayout::Binding* RootSignatureLayout::FindBinding(const std::string& name) const
+{
+  for (const auto& v : m_bindings)
+  {
+    if (v.name == name)
+    {
+      return &v;
+    }
+  }
+  return nullptr;
+}
+
+UINT RootSignatureLayout::GetRootIndex(const std::string& name) const
+{
+  auto binding = FindBinding(name);
+  if (binding == nullptr)
+  {
+    throw std::runtime_error("root signature has no binding: " + name);
+  }
+  return binding->rootIndex;
+}
+
+RootSignatureCache::RootSignatureCache(ComPtr<ID3D12Device> device)
+  : m_device(device), m_version(D3D_ROOT_SIGNATURE_VERSION_1_0), m_stats()
+{
+  D3D12_FEATURE_DATA_ROOT_SIGNATURE feature{ D3D_ROOT_SIGNATURE_VERSION_1_1 };
+  if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &feature, sizeof(feature))) &&
+    feature.HighestVersion >= D3D_ROOT_SIGNATURE_VERSION_1_1)
+  {
+    m_version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+  }
+}
+
+RootSignatureLayout RootSignatureCache::Create(const std::vector<ComPtr<ID3DBlob>>& shaders, const Options& options)
+{
+  // 各ステージのリフレクションを集め、同じレジスタの参照を 1 つにまとめる.
+  std::vector<ShaderBinding> bindings;
+  uint32_t allStages = 0;
+  bool hasInputLayout = false;
+  for (const auto& shader : shaders)
+  {
+    if (!shader)
+    {
+      continue;
+    }
+    ShaderReflectionData reflection;
+    if (!LoadReflection(shader.Get(), reflection))
+    {
+      throw book_util::DX12Exception("shader has no reflection data.");
+    }
+
+    const auto visibility = GetStageVisibility(reflection.shaderVersion);
+    const auto stageBit = 1u << visibility;
+    allStages |= stageBit;
+    if (visibility == D3D12_SHADER_VISIBILITY_VERTEX && reflection.inputParameters > 0)
+    {
+      hasInputLayout = true;
+    }
+
+    for (const auto& resource : reflection.resources)
+    {
+      ShaderBinding binding{};
+      binding.name = resource.name;
+      binding.rangeType = GetRangeType(D3D_SHADER_INPUT_TYPE(resource.type));
+      binding.shaderRegister = resource.bindPoint;
+      binding.registerSpace = resource.space;
+      binding.count = (resource.bindCount == 0 || resource.bindCount == UINT_MAX) ? UINT_MAX : resource.bindCount;
+      binding.stageMask = stageBit;
+      if (binding.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER &&
+        IsStaticSampler(options.staticSamplers, binding.shaderRegister, binding.registerSpace))
+      {
+        continue;
+      }
+      if (binding.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV &&
+        HasSlot(options.rootConstants, binding.shaderRegister, binding.registerSpace))
+      {
+        binding.constantCount = resource.constantCount;
+      }
+
+      auto itr = std::find_if(bindings.begin(), bindings.end(), [&](const ShaderBinding& v) {
+        return v.rangeType == binding.rangeType && v.shaderRegister == binding.shaderRegister && v.registerSpace == binding.registerSpace;
+      });
+      if (itr == bindings.end())
+      {
+        bindings.push_back(binding);
+      }
+      else
+      {
+        itr->stageMask |= stageBit;
+        itr->count = (std::max)(itr->count, binding.count);
+        itr->constantCount = (std::max)(itr->constantCount, binding.constantCount);
+      }
+    }
+  }
+  std::sort(bindings.begin(), bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+    if (a.registerSpace != b.registerSpace)
+    {
+      return a.registerSpace < b.registerSpace;
+    }
+    if (a.rangeType != b.rangeType)
+    {
+      return GetTableOrder(a.rangeType) < GetTableOrder(b.rangeType);
+    }
+    return a.shaderRegister < b.shaderRegister;
+  });
+
+  // ルートパラメータの割り当て. 更新頻度の高いものから並べる.
+  std::vector<Parameter> parameters;
+  std::vector<bool> isRootParameter(bindings.size(), false);
+  for (size_t i = 0; i < bindings.size(); ++i)
+  {
+    if (bindings[i].constantCount > 0)
+    {
+      parameters.push_back(Parameter{ D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS, { i }, bindings[i].stageMask });
+      isRootParameter[i] = true;
+    }
+  }
+  for (size_t i = 0; i < bindings.size(); ++i)
+  {
+    if (!isRootParameter[i] && bindings[i].rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_CBV && bindings[i].count == 1)
+    {
+      parameters.push_back(Parameter{ D3D12_ROOT_PARAMETER_TYPE_CBV, { i }, bindings[i].stageMask });
+      isRootParameter[i] = true;
+    }
+  }
+  std::vector<UINT> spaces;
+  for (const auto& v : bindings)
+  {
+    if (spaces.empty() || spaces.back() != v.registerSpace)
+    {
+      spaces.push_back(v.registerSpace);
+    }
+  }
+  for (auto isSampler : { false, true })
+  {
+    for (auto space : spaces)
+    {
+      Parameter table{ D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, {}, 0 };
+      std::vector<Parameter> unboundedTables;
+      for (size_t i = 0; i < bindings.size(); ++i)
+      {
+        const auto& v = bindings[i];
+        if (isRootParameter[i] || v.registerSpace != space ||
+          (v.rangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER) != isSampler)
+        {
+          continue;
+        }
+        if (v.count == UINT_MAX)
+        {
+          unboundedTables.push_back(Parameter{ D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE, { i }, v.stageMask });
+          continue;
+        }
+        table.bindings.push_back(i);
+        table.stageMask |= v.stageMask;
+      }
+      if (!table.bindings.empty())
+      {
+        parameters.push_back(table);
+      }
+      parameters.insert(parameters.end(), unboundedTables.begin(), unboundedTables.end());
+    }
+  }
+
+  RootSignatureLayout layout;
+  std::vector<D3D12_ROOT_PARAMETER1> rootParams(parameters.size());
+  std::vector<std::vector<D3D12_DESCRIPTOR_RANGE1>> ranges(parameters.size());
+  for (UINT index = 0; index < UINT(parameters.size()); ++index)
+  {
+    const auto& parameter = parameters[index];
+    auto& rootParam = rootParams[index];
+    rootParam.ParameterType = parameter.type;
+    rootParam.ShaderVisibility = ToVisibility(parameter.stageMask);
+
+    UINT offset = 0;
+    for (auto i : parameter.bindings)
+    {
+      const auto& v = bindings[i];
+      layout.m_bindings.push_back(RootSignatureLayout::Binding{
+        v.name, v.rangeType, v.shaderRegister, v.registerSpace, v.count, index, offset });
+      if (parameter.type == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+      {
+        rootParam.Constants.ShaderRegister = v.shaderRegister;
+        rootParam.Constants.RegisterSpace = v.registerSpace;
+        rootParam.Constants.Num32BitValues = v.constantCount;
+      }
+      else if (parameter.type == D3D12_ROOT_PARAMETER_TYPE_CBV)
+      {
+        // 書き込んだ定数バッファは、コマンドの実行が終わるまで書き換えない.
+        rootParam.Descriptor.ShaderRegister = v.shaderRegister;
+        rootParam.Descriptor.RegisterSpace = v.registerSpace;
+        rootParam.Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+      }
+      else
+      {
+        D3D12_DESCRIPTOR_RANGE1 range{};
+        range.RangeType = v.rangeType;
+        range.NumDescriptors = v.count;
+        range.BaseShaderRegister = v.shaderRegister;
+        range.RegisterSpace = v.registerSpace;
+        range.Flags = GetRangeFlags(v);
+        range.OffsetInDescriptorsFromTableStart = offset;
+        ranges[index].push_back(range);
+        offset += v.count;
+      }
+    }
+    if (parameter.type == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+    {
+      rootParam.DescriptorTable.NumDescriptorRanges = UINT(ranges[index].size());
+      rootParam.DescriptorTable.pDescriptorRanges = ranges[index].data();
+    }
+  }
+
+  auto flags = options.flags;
+  if (hasInputLayout)
+  {
+    flags |= D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+  }
+  // 使わないグラフィックスステージにはルート引数を見せない.
+  if ((allStages & ComputeStageBit) == 0 && allStages != 0)
+  {
+    const std::pair<D3D12_SHADER_VISIBILITY, D3D12_ROOT_SIGNATURE_FLAGS> denyFlags[] = {
+      { D3D12_SHADER_VISIBILITY_VERTEX, D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS },
+      { D3D12_SHADER_VISIBILITY_HULL, D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS },
+      { D3D12_SHADER_VISIBILITY_DOMAIN, D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS },
+      { D3D12_SHADER_VISIBILITY_GEOMETRY, D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS },
+      { D3D12_SHADER_VISIBILITY_PIXEL, D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS },
+    };
+    for (const auto& v : denyFlags)
+    {
+      if ((allStages & (1u << v.first)) == 0)
+      {
+        flags |= v.second;
+      }
+    }
+  }
+
+  D3D12_VERSIONED_ROOT_SIGNATURE_DESC desc{};
+  desc.Version = m_version;
+  std::vector<D3D12_ROOT_PARAMETER> rootParams10;
+  std::vector<std::vector<D3D12_DESCRIPTOR_RANGE>> ranges10;
+  if (m_version == D3D_ROOT_SIGNATURE_VERSION_1_1)
+  {
+    desc.Desc_1_1.NumParameters = UINT(rootParams.size());
+    desc.Desc_1_1.pParameters = rootParams.data();
+    desc.Desc_1_1.NumStaticSamplers = UINT(options.staticSamplers.size());
+    desc.Desc_1_1.pStaticSamplers = options.staticSamplers.data();
+    desc.Desc_1_1.Flags = flags;
+  }
+  else
+  {
+    // 1.0 では範囲とルート CBV のフラグを落とす.
+    rootParams10.resize(rootParams.size());
+    ranges10.resize(rootParams.size());
+    for (size_t i = 0; i < rootParams.size(); ++i)
+    {
+      const auto& src = rootParams[i];
+      auto& dst = rootParams10[i];
+      dst.ParameterType = src.ParameterType;
+      dst.ShaderVisibility = src.ShaderVisibility;
+      switch (src.ParameterType)
+      {
+      case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+        dst.Constants = src.Constants;
+        break;
+      case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+        for (const auto& range : ranges[i])
+        {
+          ranges10[i].push_back(D3D12_DESCRIPTOR_RANGE{
+            range.RangeType, range.NumDescriptors, range.BaseShaderRegister,
+            range.RegisterSpace, range.OffsetInDescriptorsFromTableStart });
+        }
+        dst.DescriptorTable.NumDescriptorRanges = UINT(ranges10[i].size());
+        dst.DescriptorTable.pDescriptorRanges = ranges10[i].data();
+        break;
+      default:
+        dst.Descriptor.ShaderRegister = src.Descriptor.ShaderRegister;
+        dst.Descriptor.RegisterSpace = src.Descriptor.RegisterSpace;
+        break;
+      }
+    }
+    desc.Desc_1_0.NumParameters = UINT(rootParams10.size());
+    desc.Desc_1_0.pParameters = rootParams10.data();
+    desc.Desc_1_0.NumStaticSamplers = UINT(options.staticSamplers.size());
+    desc.Desc_1_0.pStaticSamplers = options.staticSamplers.data();
+    desc.Desc_1_0.Flags = flags;
+  }
+
+  ComPtr<ID3DBlob> signature, errBlob;
+  HRESULT hr = D3D12SerializeVersionedRootSignature(&desc, &signature, &errBlob);
+  if (FAILED(hr))
+  {
+    std::string message = "D3D12SerializeVersionedRootSignature failed.";
+    if (errBlob)
+    {
+      message += "\n";
+      message.append(static_cast<const char*>(errBlob->GetBufferPointer()), errBlob->GetBufferSize());
+    }
+    throw book_util::DX12Exception(message);
+  }
+
+  StableHasher hasher;
+  hasher.AddBytes(signature->GetBufferPointer(), signature->GetBufferSize());
+  layout.m_hash = hasher.GetValue();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.requests++;
+  auto& rootSignature = m_rootSignatures[layout.m_hash];
+  if (!rootSignature)
+  {
+    hr = m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
+    if (FAILED(hr))
+    {
+      m_rootSignatures.erase(layout.m_hash);
+      ThrowIfFailed(hr, "CreateRootSignature failed.");
+    }
+    PipelineCache::TagRootSignature(rootSignature, signature);
+    m_stats.created++;
+  }
+  layout.m_rootSignature = rootSignature;
+  return layout;
+}
+
+RootSignatureCache::Statistics RootSignatureCache::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
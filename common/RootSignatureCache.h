@@ -0,0 +1,96 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// シェーダーのリフレクションから作ったルートシグネチャと、各リソースのバインド先.
+class RootSignatureLayout
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  struct Binding
+  {
+    std::string name;
+    D3D12_DESCRIPTOR_RANGE_TYPE rangeType;
+    UINT shaderRegister;
+    UINT registerSpace;
+    UINT count;         // 配列の要素数. 非有界なら UINT_MAX.
+    UINT rootIndex;
+    UINT tableOffset;   // テーブル先頭からのディスクリプタ数. テーブル以外では 0.
+  };
+
+  RootSignatureLayout() : m_hash(0) {}
+
+  ID3D12RootSignature* Get() const { return m_rootSignature.Get(); }
+  const ComPtr<ID3D12RootSignature>& GetRootSignature() const { return m_rootSignature; }
+  // シリアライズ結果のハッシュ. 同じ値なら同じルートシグネチャ.
+  uint64_t GetHash() const { return m_hash; }
+  // 静的サンプラーは含まない.
+  const std::vector<Binding>& GetBindings() const { return m_bindings; }
+
+  // シェーダー内の変数名で探す. 見つからなければ nullptr.
+  const Binding* FindBinding(const std::string& name) const;
+  // 見つからなければ例外.
+  UINT GetRootIndex(const std::string& name) const;
+private:
+  friend class RootSignatureCache;
+  ComPtr<ID3D12RootSignature> m_rootSignature;
+  uint64_t m_hash;
+  std::vector<Binding> m_bindings;
+};
+
+// パイプラインの全ステージのリフレクションからルートシグネチャを作る.
+// ルートパラメータは更新頻度の高い順に、ルート定数、ルート CBV、 CBV/SRV/UAV テーブル、サンプラーテーブルと並べる.
+// 同じ種類の中ではレジスタスペースの小さいものほど頻繁に更新するものとして前に置く.
+// 配列でない定数バッファはルート CBV に、それ以外はスペース毎に 1 つのテーブルにまとめる(非有界配列は単独のテーブル).
+// Root Signature 1.1 に対応していれば、範囲に static/volatile のフラグを付ける.
+// 内容が同じものは 1 つの ID3D12RootSignature を共有する. 複数スレッドから呼び出してよい.
+// 事前コンパイル済みのシェーダーは、 ShaderBuild が書き出したリフレクションを使う.
+class RootSignatureCache
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  struct RegisterSlot
+  {
+    UINT shaderRegister;
+    UINT registerSpace;
+  };
+  struct Options
+  {
+    Options() : flags(D3D12_ROOT_SIGNATURE_FLAG_NONE) {}
+    // レジスタが一致するサンプラーはテーブルに入れず、これを使う.
+    std::vector<D3D12_STATIC_SAMPLER_DESC> staticSamplers;
+    // ルート定数にする定数バッファ. 値の数はリフレクションから求める.
+    std::vector<RegisterSlot> rootConstants;
+    // リフレクションから求めたものに加えるフラグ.
+    D3D12_ROOT_SIGNATURE_FLAGS flags;
+  };
+
+  explicit RootSignatureCache(ComPtr<ID3D12Device> device);
+
+  // グラフィックスとコンピュートのシェーダーは混ぜないこと. 失敗したら例外.
+  // 複数のパイプラインで共有する場合は、それらの全シェーダーを渡す.
+  RootSignatureLayout Create(const std::vector<ComPtr<ID3DBlob>>& shaders, const Options& options = Options());
+
+  struct Statistics
+  {
+    uint32_t requests;
+    uint32_t created;
+  };
+  Statistics GetStatistics() const;
+  D3D_ROOT_SIGNATURE_VERSION GetVersion() const { return m_version; }
+private:
+  ComPtr<ID3D12Device> m_device;
+  D3D_ROOT_SIGNATURE_VERSION m_version;
+  std::unordered_map<uint64_t, ComPtr<ID3D12RootSignature>> m_rootSignatures;
+  mutable std::mutex m_mutex;
+  Statistics m_stats;
+};
@@ -0,0 +1,376 @@
+﻿#include "Shader.h"
+#include "ShaderCache.h"
+#include "CacheFileUtil.h"
+#include "ShaderCompiler.h"
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#if _MSC_VER > 1922 && !defined(_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING)
+#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
+#endif
+#include <experimental/filesystem>
+using namespace std::experimental::filesystem;
+
+// シェーダーのコンパイル用.
+#if defined(_WIN32)
+#include <d3dcompiler.h>
+#pragma comment(lib, "d3dcompiler.lib")
+#endif
+
+using namespace std;
+using namespace Microsoft::WRL;
+
+namespace
+{
+  std::string HashString(const std::wstring& text)
+  {
+    return ShaderCache::ToHex(StableHasher::HashUtf16(text));
+  }
+
+  // #include "..." で参照されるファイルの内容をキーへ加える. 見つからないものは名前のみ.
+  void AppendIncludeHashes(const path& baseDir, const std::vector<char>& source, std::string& key, int depth)
+  {
+    const int MaxIncludeDepth = 16;
+    if (depth > MaxIncludeDepth)
+    {
+      return;
+    }
+    std::string text(source.begin(), source.end());
+    size_t pos = 0;
+    while ((pos = text.find("#include", pos)) != std::string::npos)
+    {
+      auto first = text.find_first_of("\"<", pos);
+      auto lineEnd = text.find('\n', pos);
+      pos += 8;
+      if (first == std::string::npos || first > lineEnd)
+      {
+        continue;
+      }
+      auto last = text.find_first_of("\">", first + 1);
+      if (last == std::string::npos || last > lineEnd)
+      {
+        continue;
+      }
+      auto name = text.substr(first + 1, last - first - 1);
+      key += "|inc:" + name;
+
+      auto include = ShaderSourceCache::Get().Load((baseDir / name).wstring());
+      if (include)
+      {
+        key += ":" + ShaderCache::ToHex(StableHasher::Hash(include->data(), include->size()));
+        AppendIncludeHashes((baseDir / name).parent_path(), *include, key, depth + 1);
+      }
+    }
+  }
+
+  std::string MakeSourceKey(const path& filePath, const std::vector<char>& sourceCode)
+  {
+    auto key = "src:" + ShaderCache::ToHex(StableHasher::Hash(sourceCode.data(), sourceCode.size()));
+    key += "|file:" + HashString(filePath.wstring());
+    AppendIncludeHashes(filePath.parent_path(), sourceCode, key, 0);
+    return key;
+  }
+
+  // コンパイル条件(ファイル名以降)をキーへ加える.
+  void AppendDescKey(const ShaderCompiler::Desc& desc, std::string& key)
+  {
+    key += "|entry:" + HashString(desc.entryPoint);
+    key += "|profile:" + HashString(desc.profile);
+    for (auto& v : desc.arguments)
+    {
+      key += "|flag:" + HashString(v);
+    }
+    for (auto& v : desc.defines)
+    {
+      key += "|define:" + HashString(v.first) + "=" + HashString(v.second);
+    }
+  }
+
+  ComPtr<ID3DBlob> CreateBlob(const std::vector<char>& data)
+  {
+#if defined(_WIN32)
+    ComPtr<ID3DBlob> blob;
+    if (FAILED(D3DCreateBlob(data.size(), &blob)))
+    {
+      return nullptr;
+    }
+    memcpy(blob->GetBufferPointer(), data.data(), data.size());
+    return blob;
+#else
+    return ShaderCompiler::GetForCurrentThread().CreateBlob(data.data(), data.size());
+#endif
+  }
+
+  std::atomic<bool>& DebugCompileFlag()
+  {
+#if _DEBUG
+    static std::atomic<bool> value(true);
+#else
+    static std::atomic<bool> value(false);
+#endif
+    return value;
+  }
+  std::atomic<bool>& PrecompiledModeFlag()
+  {
+    static std::atomic<bool> value(false);
+    return value;
+  }
+}
+
+std::string Shader::MakeSourceKey(const std::wstring& fileName)
+{
+  auto source = ShaderSourceCache::Get().Load(fileName);
+  if (!source)
+  {
+    return std::string();
+  }
+  return ::MakeSourceKey(path(fileName), *source);
+}
+
+const char* Shader::PrecompiledDirectory = "CompiledShaders";
+
+std::string Shader::MakePrecompiledKey(const ShaderCompiler::Desc& desc)
+{
+  // 配布先ではソースもコンパイラも無いことがあるので、要求の内容だけで作る.
+  std::string key = "precompiled|file:" + HashString(desc.fileName);
+  AppendDescKey(desc, key);
+  return key;
+}
+
+std::string Shader::MakeReflectionKey(const void* code, size_t size)
+{
+  return "reflection|dxil:" + ShaderCache::ToHex(StableHasher::Hash(code, size)) + "|size:" + std::to_string(size);
+}
+
+ShaderCompiler::Desc Shader::MakeDesc(const std::wstring& fileName, Stage stage,
+  const std::wstring& entryPoint,
+  const std::vector<std::wstring>& flags,
+  const std::vector<DefineMacro>& defines,
+  const std::wstring& shaderModel,
+  bool isDebug)
+{
+  wstring profile;
+  switch (stage)
+  {
+  default:
+  case Shader::Vertex:
+    profile = L"vs_";
+    break;
+  case Shader::Geometry:
+    profile = L"gs_";
+    break;
+  case Shader::Pixel:
+    profile = L"ps_";
+    break;
+  case Shader::Domain:
+    profile = L"ds_";
+    break;
+  case Shader::Hull:
+    profile = L"hs_";
+    break;
+  case Shader::Compute:
+    profile = L"cs_";
+    break;
+  }
+  profile += shaderModel;
+
+  ShaderCompiler::Desc desc;
+  desc.fileName = fileName;
+  desc.entryPoint = entryPoint;
+  desc.profile = profile;
+  desc.arguments = flags;
+  if (isDebug)
+  {
+    desc.arguments.push_back(L"/Zi");
+    desc.arguments.push_back(L"/Qembed_debug");
+    desc.arguments.push_back(L"/O0");
+  }
+  else
+  {
+    desc.arguments.push_back(L"/O2");
+  }
+  for (const auto & v : defines)
+  {
+    desc.defines.emplace_back(v.Name, v.Value);
+  }
+  return desc;
+}
+
+bool Shader::Variant::IsSupported(const ShaderFeatures& features) const
+{
+  if (features.highestShaderModel < shaderModel)
+  {
+    return false;
+  }
+  if (requires16BitOps && !features.native16BitOps)
+  {
+    return false;
+  }
+  if (requiresWaveOps && !features.waveOps)
+  {
+    return false;
+  }
+  return true;
+}
+
+const Shader::Variant& Shader::SelectVariant(const std::vector<Variant>& variants, const ShaderFeatures& features)
+{
+  for (const auto& v : variants)
+  {
+    if (v.IsSupported(features))
+    {
+      return v;
+    }
+  }
+  throw runtime_error("no supported shader variant.");
+}
+
+std::wstring Shader::GetShaderModelName(D3D_SHADER_MODEL shaderModel)
+{
+  return std::to_wstring(shaderModel >> 4) + L"_" + std::to_wstring(shaderModel & 0xF);
+}
+
+void Shader::SetDebugCompile(bool enabled)
+{
+  DebugCompileFlag() = enabled;
+}
+
+bool Shader::IsDebugCompile()
+{
+  return DebugCompileFlag();
+}
+
+void Shader::SetPrecompiledMode(bool enabled)
+{
+  PrecompiledModeFlag() = enabled;
+}
+
+bool Shader::IsPrecompiledMode()
+{
+  return PrecompiledModeFlag();
+}
+
+namespace
+{
+  // 事前コンパイル済みシェーダーは ShaderBuild の成果物なので、アプリからは読むだけにする.
+  ShaderCache& MakeReadOnly(ShaderCache& store)
+  {
+    store.SetReadOnly(true);
+    return store;
+  }
+}
+
+ShaderCache& Shader::GetPrecompiledStore()
+{
+  static ShaderCache store(PrecompiledDirectory);
+  static ShaderCache& readOnlyStore = MakeReadOnly(store);
+  return readOnlyStore;
+}
+
+ShaderCache& Shader::GetPrecompiledReflectionStore()
+{
+  static ShaderCache store(PrecompiledDirectory, ".refl");
+  static ShaderCache& readOnlyStore = MakeReadOnly(store);
+  return readOnlyStore;
+}
+
+void Shader::load(const std::wstring& fileName, Stage stage,
+  const std::wstring& entryPoint,
+  const std::vector<std::wstring>& flags,
+  const std::vector<DefineMacro>& defines,
+  const std::wstring& shaderModel)
+{
+  m_diagnostics.clear();
+  auto desc = MakeDesc(fileName, stage, entryPoint, flags, defines, shaderModel, IsDebugCompile());
+
+  // ShaderBuild で書き出したものだけを使い、ソースとコンパイラには触れない.
+  if (IsPrecompiledMode())
+  {
+    std::vector<char> code;
+    if (!GetPrecompiledStore().Load(MakePrecompiledKey(desc), code))
+    {
+      throw runtime_error("precompiled shader not found: " +
+        std::string(fileName.begin(), fileName.end()) + " " + std::string(entryPoint.begin(), entryPoint.end()));
+    }
+    m_code = CreateBlob(code);
+    if (!m_code)
+    {
+      throw runtime_error("D3DCreateBlob failed.");
+    }
+    return;
+  }
+
+  path filePath(fileName);
+  auto source = ShaderSourceCache::Get().Load(fileName);
+  if (!source)
+    throw std::runtime_error("shader not found");
+  const auto& sourceCode = *source;
+  auto& compiler = ShaderCompiler::GetForCurrentThread();
+
+  // ソースとコンパイル条件が同じならキャッシュ済みの DXIL を使う.
+  auto& cache = ShaderCache::Get();
+  std::string cacheKey;
+  if (cache.IsEnabled())
+  {
+    cacheKey = ::MakeSourceKey(filePath, sourceCode);
+    AppendDescKey(desc, cacheKey);
+    // コンパイラが更新されたらキャッシュを使わないよう、キーに DXC のバージョンを含める.
+    cacheKey += "|dxc:" + compiler.GetVersion();
+
+    std::vector<char> cached;
+    if (cache.Load(cacheKey, cached))
+    {
+      auto blob = CreateBlob(cached);
+      if (blob)
+      {
+        m_code = blob;
+        return;
+      }
+    }
+  }
+
+  auto result = compiler.Compile(desc, source);
+  if (!result.IsSucceeded())
+  {
+    throw runtime_error("shader compile failed.\n" + result.FormatDiagnostics());
+  }
+  m_diagnostics = std::move(result.diagnostics);
+  m_code = result.code;
+
+  if (cache.IsEnabled())
+  {
+    cache.Store(cacheKey, m_code->GetBufferPointer(), m_code->GetBufferSize());
+  }
+}
+
+void Shader::load(const std::wstring& fileName, Stage stage,
+  const std::wstring& entryPoint,
+  const Variant& variant)
+{
+  auto request = MakeRequest(fileName, stage, entryPoint, variant);
+  load(request.fileName, request.stage, request.entryPoint, request.flags, request.defines, request.shaderModel);
+}
+
+ShaderCompileRequest Shader::MakeRequest(const std::wstring& fileName, Stage stage,
+  const std::wstring& entryPoint, const Variant& variant)
+{
+  ShaderCompileRequest request;
+  request.fileName = fileName;
+  request.stage = stage;
+  request.entryPoint = entryPoint;
+  if (variant.requires16BitOps)
+  {
+    request.flags.push_back(L"-enable-16bit-types");
+  }
+  request.defines = variant.defines;
+  request.shaderModel = GetShaderModelName(variant.shaderModel);
+  return request;
+}
+
+Shader Shader::Compile(const ShaderCompileRequest& request)
+{
+  Shader shader;
+  shader.load(request.fileName, request.stage, request.entryPoint, request.flags, request.defines, request.shaderModel);
+  return shader;
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <string>
+#include <vector>
+
+#include "ShaderPlatform.h"
+#include "ShaderCompiler.h"
+#include "ShaderTypes.h"
+
+class ShaderCache;
+
+// デバイスが対応するシェーダーの機能. D3D12AppBase が CheckFeatureSupport で調べる.
+struct ShaderFeatures
+{
+  D3D_SHADER_MODEL highestShaderModel = D3D_SHADER_MODEL_6_0;
+  bool native16BitOps = false;  // -enable-16bit-types の half を 16 ビットのまま演算できる.
+  bool waveOps = false;         // Wave* 組み込み関数を使える.
+  UINT waveLaneCountMin = 0;
+};
+
+// HLSL を DXIL にコンパイルして保持する.
+// D3D12AppBase に依存しないため、オフラインのビルドツール(ShaderBuild)からも使う.
+class Shader : public ShaderTypes
+{
+public:
+  Shader() = default;
+
+  // 同じエントリポイントを、デバイスの機能に合わせて条件を変えてコンパイルする版.
+  struct Variant
+  {
+    std::string name;                 // 表示用.
+    D3D_SHADER_MODEL shaderModel;     // プロファイルに使い、デバイスにも要求する.
+    bool requires16BitOps;            // -enable-16bit-types を付けてコンパイルする.
+    bool requiresWaveOps;
+    std::vector<DefineMacro> defines;
+
+    bool IsSupported(const ShaderFeatures& features) const;
+  };
+
+  void load(const std::wstring& fileName, Stage stage,
+    const std::wstring& entryPoint,
+    const std::vector<std::wstring>& flags,
+    const std::vector<DefineMacro>& defines,
+    const std::wstring& shaderModel = L"6_0");
+  void load(const std::wstring& fileName, Stage stage,
+    const std::wstring& entryPoint,
+    const Variant& variant);
+  // variant の条件で load する場合と同じ内容の要求. ShaderCompileService や ShaderBuild に渡す.
+  static ShaderCompileRequest MakeRequest(const std::wstring& fileName, Stage stage,
+    const std::wstring& entryPoint, const Variant& variant);
+  // request の内容で load したものを返す. ShaderCompileService に渡すコンパイル処理.
+  static Shader Compile(const ShaderCompileRequest& request);
+
+  // variants は優先する順に並べ、最後に何も要求しない版を置くこと.
+  // 対応しているもののうち最初のものを返す. どれも対応していなければ例外.
+  static const Variant& SelectVariant(const std::vector<Variant>& variants, const ShaderFeatures& features);
+  // D3D_SHADER_MODEL_6_2 なら "6_2".
+  static std::wstring GetShaderModelName(D3D_SHADER_MODEL shaderModel);
+
+  // ソースと #include されるファイルの内容から作るキー. 内容が変われば別の値になる.
+  // ファイルが見つからなければ空.
+  static std::string MakeSourceKey(const std::wstring& fileName);
+
+  // load が DXC に渡す内容. isDebug ならデバッグ情報を埋め込み、最適化しない.
+  static ShaderCompiler::Desc MakeDesc(const std::wstring& fileName, Stage stage,
+    const std::wstring& entryPoint,
+    const std::vector<std::wstring>& flags,
+    const std::vector<DefineMacro>& defines,
+    const std::wstring& shaderModel,
+    bool isDebug);
+
+  // 事前コンパイル済みのシェーダーを引くキー. ソースの内容とコンパイラには依存しない.
+  static std::string MakePrecompiledKey(const ShaderCompiler::Desc& desc);
+
+  // デバッグ情報付きでコンパイルするか. 既定はデバッグビルドなら true.
+  static void SetDebugCompile(bool enabled);
+  static bool IsDebugCompile();
+
+  // 有効にすると実行時にコンパイルせず、 ShaderBuild が PrecompiledDirectory に書き出したものだけを使う.
+  // 見つからなければ load は例外を投げる. 起動引数 "-precompiledShaders" で有効にできる.
+  static void SetPrecompiledMode(bool enabled);
+  static bool IsPrecompiledMode();
+  static const char* PrecompiledDirectory;
+  // 既定では読み取り専用. 書き出す ShaderBuild だけが SetReadOnly(false) にする.
+  static ShaderCache& GetPrecompiledStore();
+  // ShaderBuild が書き出すリフレクション(拡張子 .refl). 内容は ShaderReflectionData で、キーは MakeReflectionKey.
+  // RootSignatureCache は事前コンパイル済みのシェーダーについてこれを読み、 DXC を使わない.
+  static ShaderCache& GetPrecompiledReflectionStore();
+  // DXIL の内容から作るキー. アーカイブから取り出したものも同じように引ける.
+  static std::string MakeReflectionKey(const void* code, size_t size);
+
+  const Microsoft::WRL::ComPtr<ID3DBlob>& getCode() const { return m_code; }
+  // コンパイル時の警告. エラーは load が投げる例外のメッセージに含まれる.
+  const std::vector<ShaderDiagnostic>& getDiagnostics() const { return m_diagnostics; }
+
+private:
+  Microsoft::WRL::ComPtr<ID3DBlob> m_code;
+  std::vector<ShaderDiagnostic> m_diagnostics;
+};
@@ -0,0 +1,478 @@
+﻿#include "ShaderArchive.h"
+#include "CacheFileUtil.h"
+#include "ShaderCompileService.h"
+#include "CpuProfiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <codecvt>
+#include <cstdio>
+#include <locale>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  const char FileMagic[4] = { 'D', 'X', 'A', 'R' };
+  const uint32_t FileVersion = 1;
+  const uint64_t DataAlignment = 16;
+
+  // ファイル先頭に置くヘッダ. 続けてエントリの表、 DXIL の順に格納する.
+  struct FileHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint64_t buildKey;
+    uint32_t entryCount;
+    uint32_t reserved;
+  };
+  // (nameHash, key) の順に並べ、二分探索で引く.
+  struct FileEntry
+  {
+    uint64_t nameHash;  // ステージとエントリポイント名から求める.
+    uint32_t key;       // axisMask を適用済み.
+    uint32_t axisMask;
+    uint64_t offset;    // ファイル先頭から.
+    uint64_t size;
+  };
+
+  uint64_t HashEntryName(Shader::Stage stage, const std::wstring& entryPoint)
+  {
+    uint32_t stageValue = uint32_t(stage);
+    auto hash = StableHasher::Hash(&stageValue, sizeof(stageValue));
+    return StableHasher::HashUtf16(entryPoint, hash);
+  }
+
+  bool operator<(const FileEntry& a, const FileEntry& b)
+  {
+    return a.nameHash != b.nameHash ? a.nameHash < b.nameHash : a.key < b.key;
+  }
+
+#if !defined(_WIN32)
+  // Windows 以外のファイル名は UTF-8.
+  std::string ToFileName(const std::wstring& fileName)
+  {
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+    return converter.to_bytes(fileName);
+  }
+#endif
+}
+
+// 写像したファイル、またはコンパイル直後のメモリ.
+struct ShaderArchive::Storage
+{
+  Storage() : view(nullptr), size(0) {}
+  ~Storage()
+  {
+    if (view)
+    {
+#if defined(_WIN32)
+      UnmapViewOfFile(view);
+#else
+      munmap(view, size_t(size));
+#endif
+    }
+  }
+  const char* GetData() const { return view ? static_cast<const char*>(view) : memory.data(); }
+  const FileHeader* GetHeader() const { return reinterpret_cast<const FileHeader*>(GetData()); }
+  const FileEntry* GetEntries() const { return reinterpret_cast<const FileEntry*>(GetData() + sizeof(FileHeader)); }
+
+  // ヘッダとエントリがファイルに収まっているか.
+  bool Validate() const
+  {
+    if (size < sizeof(FileHeader))
+    {
+      return false;
+    }
+    auto header = GetHeader();
+    if (memcmp(header->magic, FileMagic, sizeof(FileMagic)) != 0 || header->version != FileVersion)
+    {
+      return false;
+    }
+    if (size < sizeof(FileHeader) + uint64_t(header->entryCount) * sizeof(FileEntry))
+    {
+      return false;
+    }
+    auto entries = GetEntries();
+    for (uint32_t i = 0; i < header->entryCount; ++i)
+    {
+      if (entries[i].offset > size || entries[i].size > size - entries[i].offset)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void* view;
+  uint64_t size;
+  std::vector<char> memory;
+};
+
+namespace
+{
+  // アーカイブ内の DXIL をコピーせずに指す Blob. 参照している間は写像を解放しない.
+  class ArchiveBlob : public ID3DBlob
+  {
+  public:
+    ArchiveBlob(std::shared_ptr<const ShaderArchive::Storage> storage, const void* data, SIZE_T size)
+      : m_refCount(1), m_storage(storage), m_data(data), m_size(size)
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+      if (ppvObject == nullptr)
+      {
+        return E_POINTER;
+      }
+      if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3DBlob))
+      {
+        *ppvObject = static_cast<ID3DBlob*>(this);
+        AddRef();
+        return S_OK;
+      }
+      *ppvObject = nullptr;
+      return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+      return ++m_refCount;
+    }
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+      auto count = --m_refCount;
+      if (count == 0)
+      {
+        delete this;
+      }
+      return count;
+    }
+    LPVOID STDMETHODCALLTYPE GetBufferPointer() override { return const_cast<void*>(m_data); }
+    SIZE_T STDMETHODCALLTYPE GetBufferSize() override { return m_size; }
+  private:
+    std::atomic<ULONG> m_refCount;
+    std::shared_ptr<const ShaderArchive::Storage> m_storage;
+    const void* m_data;
+    SIZE_T m_size;
+  };
+}
+
+uint32_t ShaderPermutationSet::GetKey(const std::vector<std::wstring>& enabledAxes) const
+{
+  uint32_t key = 0;
+  for (const auto& name : enabledAxes)
+  {
+    auto itr = std::find(axes.begin(), axes.end(), name);
+    if (itr == axes.end())
+    {
+      throw std::runtime_error("unknown permutation axis: " + std::string(name.begin(), name.end()));
+    }
+    key |= 1u << uint32_t(itr - axes.begin());
+  }
+  return key;
+}
+
+std::vector<Shader::DefineMacro> ShaderPermutationSet::GetDefines(uint32_t key) const
+{
+  auto result = defines;
+  for (uint32_t i = 0; i < uint32_t(axes.size()); ++i)
+  {
+    result.push_back(Shader::DefineMacro{ axes[i], (key & (1u << i)) ? L"1" : L"0" });
+  }
+  return result;
+}
+
+uint64_t ShaderArchive::MakeBuildKey(const ShaderPermutationSet& set)
+{
+  auto sourceKey = Shader::MakeSourceKey(set.fileName);
+  if (sourceKey.empty())
+  {
+    return 0;
+  }
+  // 宣言、コンパイラ、ビルド構成のどれかが変われば別のキーにする.
+  std::wstring text;
+  text += L"|model:" + set.shaderModel;
+  for (const auto& v : set.axes)
+  {
+    text += L"|axis:" + v;
+  }
+  for (const auto& v : set.entryPoints)
+  {
+    text += L"|entry:" + std::to_wstring(int(v.stage)) + L":" + v.name + L":" + std::to_wstring(v.axisMask);
+  }
+  for (const auto& v : set.flags)
+  {
+    text += L"|flag:" + v;
+  }
+  for (const auto& v : set.defines)
+  {
+    text += L"|define:" + v.Name + L"=" + v.Value;
+  }
+  if (Shader::IsDebugCompile())
+  {
+    text += L"|debug";
+  }
+  sourceKey += "|dxc:" + ShaderCompiler::GetForCurrentThread().GetVersion();
+  auto hash = StableHasher::Hash(sourceKey.data(), sourceKey.size());
+  hash = StableHasher::HashUtf16(text, hash);
+  // 0 は「ソース無し」を表すので避ける.
+  return hash != 0 ? hash : 1;
+}
+
+std::shared_ptr<ShaderArchive> ShaderArchive::LoadOrBuild(const ShaderPermutationSet& set, const std::wstring& archiveFile,
+  std::shared_ptr<WorkerThreadPool> threadPool)
+{
+  // ShaderBuild が書き出したものをそのまま使う.
+  if (Shader::IsPrecompiledMode())
+  {
+    auto precompiledFile = GetPrecompiledPath(archiveFile);
+    auto archive = Open(precompiledFile);
+    if (!archive)
+    {
+      throw std::runtime_error("precompiled shader archive not found: " + std::string(precompiledFile.begin(), precompiledFile.end()));
+    }
+    return archive;
+  }
+  auto buildKey = MakeBuildKey(set);
+  auto archive = Open(archiveFile);
+  if (buildKey == 0)
+  {
+    if (!archive)
+    {
+      throw std::runtime_error("shader archive not found: " + std::string(archiveFile.begin(), archiveFile.end()));
+    }
+    return archive;
+  }
+  if (archive && archive->GetBuildKey() == buildKey)
+  {
+    return archive;
+  }
+  // 置き換えられるよう、作り直す前に写像を外す.
+  archive.reset();
+  return Build(set, archiveFile, threadPool);
+}
+
+std::shared_ptr<ShaderArchive> ShaderArchive::Build(const ShaderPermutationSet& set, const std::wstring& archiveFile,
+  std::shared_ptr<WorkerThreadPool> threadPool)
+{
+  CPU_PROFILE_SCOPE("BuildShaderArchive");
+  if (set.axes.size() > ShaderPermutationSet::MaxAxisCount)
+  {
+    throw std::runtime_error("too many permutation axes.");
+  }
+  auto buildKey = MakeBuildKey(set);
+  if (buildKey == 0)
+  {
+    throw std::runtime_error("shader not found");
+  }
+
+  // 各エントリについて、影響する軸の組み合わせだけをコンパイルする.
+  struct Variant
+  {
+    FileEntry entry;
+    ShaderCompileService::Result result;
+  };
+  std::vector<Variant> variants;
+  {
+    // 結果の共有はこのビルドの中だけにし、ソースが変わった後の作り直しで古い結果を使わないようにする.
+    ShaderCompileService compiler(threadPool, &Shader::Compile);
+    for (const auto& v : set.entryPoints)
+    {
+      auto axisMask = v.axisMask & (set.GetVariantCount() - 1);
+      for (uint32_t key = 0; key < set.GetVariantCount(); ++key)
+      {
+        if ((key & ~axisMask) != 0)
+        {
+          continue;
+        }
+        ShaderCompileService::Request request;
+        request.fileName = set.fileName;
+        request.stage = v.stage;
+        request.entryPoint = v.name;
+        request.flags = set.flags;
+        request.defines = set.GetDefines(key);
+        request.shaderModel = set.shaderModel;
+
+        Variant variant{};
+        variant.entry.nameHash = HashEntryName(v.stage, v.name);
+        variant.entry.key = key;
+        variant.entry.axisMask = axisMask;
+        variant.result = compiler.Compile(request);
+        variants.push_back(variant);
+      }
+    }
+    // 全て終わるまで待つ. 失敗したものがあれば get が例外を投げる.
+    for (auto& v : variants)
+    {
+      v.result.wait();
+    }
+  }
+
+  std::sort(variants.begin(), variants.end(), [](const Variant& a, const Variant& b) { return a.entry < b.entry; });
+  for (size_t i = 1; i < variants.size(); ++i)
+  {
+    if (variants[i - 1].entry.nameHash == variants[i].entry.nameHash && variants[i - 1].entry.key == variants[i].entry.key)
+    {
+      throw std::runtime_error("duplicated entry point in shader permutation set.");
+    }
+  }
+
+  auto storage = std::make_shared<Storage>();
+  auto& data = storage->memory;
+  uint64_t offset = sizeof(FileHeader) + sizeof(FileEntry) * variants.size();
+  std::vector<FileEntry> entries;
+  for (auto& v : variants)
+  {
+    auto code = v.result.get().getCode();
+    offset = (offset + DataAlignment - 1) & ~(DataAlignment - 1);
+    v.entry.offset = offset;
+    v.entry.size = code->GetBufferSize();
+    entries.push_back(v.entry);
+    offset += v.entry.size;
+  }
+  data.resize(size_t(offset));
+
+  FileHeader header{};
+  memcpy(header.magic, FileMagic, sizeof(FileMagic));
+  header.version = FileVersion;
+  header.buildKey = buildKey;
+  header.entryCount = uint32_t(entries.size());
+  memcpy(data.data(), &header, sizeof(header));
+  if (!entries.empty())
+  {
+    memcpy(data.data() + sizeof(header), entries.data(), sizeof(FileEntry) * entries.size());
+  }
+  for (size_t i = 0; i < variants.size(); ++i)
+  {
+    auto code = variants[i].result.get().getCode();
+    memcpy(data.data() + entries[i].offset, code->GetBufferPointer(), code->GetBufferSize());
+  }
+  storage->size = data.size();
+
+#if defined(_WIN32)
+  if (!cache_file::WriteAtomically(archiveFile, data.data(), data.size()))
+  {
+    OutputDebugStringW((L"shader archive could not be written: " + archiveFile + L"\n").c_str());
+  }
+#else
+  if (!cache_file::WriteAtomically(ToFileName(archiveFile), data.data(), data.size()))
+  {
+    fprintf(stderr, "shader archive could not be written: %s\n", ToFileName(archiveFile).c_str());
+  }
+#endif
+  return std::shared_ptr<ShaderArchive>(new ShaderArchive(storage));
+}
+
+std::shared_ptr<ShaderArchive> ShaderArchive::Open(const std::wstring& archiveFile)
+{
+  CPU_PROFILE_SCOPE("OpenShaderArchive");
+#if defined(_WIN32)
+  // 写像中でも作り直したファイルで置き換えられるよう、削除の共有を許す.
+  auto file = CreateFileW(archiveFile.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return nullptr;
+  }
+  LARGE_INTEGER fileSize{};
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return nullptr;
+  }
+  auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr)
+  {
+    return nullptr;
+  }
+  // ビューが残っていればハンドルは閉じてよい.
+  auto storage = std::make_shared<Storage>();
+  storage->view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  storage->size = uint64_t(fileSize.QuadPart);
+  CloseHandle(mapping);
+#else
+  // 置き換えは rename で行うので、写像中のものは元の内容のまま残る.
+  auto file = open(ToFileName(archiveFile).c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    return nullptr;
+  }
+  struct stat status{};
+  if (fstat(file, &status) != 0 || status.st_size == 0)
+  {
+    close(file);
+    return nullptr;
+  }
+  auto storage = std::make_shared<Storage>();
+  auto view = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (view != MAP_FAILED)
+  {
+    storage->view = view;
+    storage->size = uint64_t(status.st_size);
+  }
+#endif
+  if (storage->view == nullptr || !storage->Validate())
+  {
+    return nullptr;
+  }
+  return std::shared_ptr<ShaderArchive>(new ShaderArchive(storage));
+}
+
+std::wstring ShaderArchive::GetPrecompiledPath(const std::wstring& archiveFile)
+{
+  std::string directory = Shader::PrecompiledDirectory;
+  return std::wstring(directory.begin(), directory.end()) + L"/" + archiveFile;
+}
+
+ShaderArchive::ShaderArchive(std::shared_ptr<const Storage> storage)
+  : m_storage(storage)
+{
+}
+
+ShaderArchive::ComPtr<ID3DBlob> ShaderArchive::Find(Shader::Stage stage, const std::wstring& entryPoint, uint32_t key) const
+{
+  auto header = m_storage->GetHeader();
+  auto first = m_storage->GetEntries();
+  auto last = first + header->entryCount;
+
+  // 同じエントリのバリアントは連続しているので、先頭の axisMask でキーを絞ってから引く.
+  FileEntry target{};
+  target.nameHash = HashEntryName(stage, entryPoint);
+  auto itr = std::lower_bound(first, last, target);
+  if (itr != last && itr->nameHash == target.nameHash)
+  {
+    target.key = key & itr->axisMask;
+    itr = std::lower_bound(itr, last, target);
+    if (itr != last && itr->nameHash == target.nameHash && itr->key == target.key)
+    {
+      ComPtr<ID3DBlob> blob;
+      blob.Attach(new ArchiveBlob(m_storage, m_storage->GetData() + itr->offset, SIZE_T(itr->size)));
+      return blob;
+    }
+  }
+  throw std::runtime_error("shader variant not found in archive: " + std::string(entryPoint.begin(), entryPoint.end()));
+}
+
+uint64_t ShaderArchive::GetBuildKey() const
+{
+  return m_storage->GetHeader()->buildKey;
+}
+
+uint32_t ShaderArchive::GetVariantCount() const
+{
+  return m_storage->GetHeader()->entryCount;
+}
+
+bool ShaderArchive::IsMapped() const
+{
+  return m_storage->view != nullptr;
+}
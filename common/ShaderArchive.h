@@ -0,0 +1,75 @@
+﻿#pragma once
+#include "Shader.h"
+#include "WorkerThreadPool.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 1 つのシェーダーファイルについて、切り替えるマクロ(軸)とエントリポイントを宣言する.
+// 軸 i はキーのビット i に対応し、ビットが立っていれば 1、なければ 0 として定義する.
+struct ShaderPermutationSet
+{
+  static const uint32_t MaxAxisCount = 16;
+
+  struct EntryPoint
+  {
+    Shader::Stage stage;
+    std::wstring name;
+    uint32_t axisMask;  // このエントリに影響する軸. それ以外のビットが違っても同じバリアントを使う.
+  };
+
+  std::wstring fileName;
+  std::vector<std::wstring> axes;
+  std::vector<EntryPoint> entryPoints;
+  std::vector<std::wstring> flags;
+  std::vector<Shader::DefineMacro> defines;   // 全バリアント共通.
+  std::wstring shaderModel = L"6_0";
+
+  uint32_t GetVariantCount() const { return 1u << uint32_t(axes.size()); }
+  // 有効にする軸の名前からキーを作る. 宣言されていない名前は例外.
+  uint32_t GetKey(const std::vector<std::wstring>& enabledAxes) const;
+  // 共通のマクロに、キーで決まる各軸の値を加えたもの.
+  std::vector<Shader::DefineMacro> GetDefines(uint32_t key) const;
+};
+
+// ShaderPermutationSet の全バリアントをコンパイルし、 DXIL を 1 つのファイルにまとめたもの.
+// 読み込みはファイルを写像するだけで、 Find が返す Blob は写像したメモリを直接指す.
+// ファイルには宣言とソースから求めたビルドキーを持たせ、一致しなければ作り直す.
+class ShaderArchive
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  // 保存済みのアーカイブが宣言とソースに一致すれば写像して使い、そうでなければ作り直して保存する.
+  // ソースが見つからない(配布環境)ときは保存済みのものをそのまま使う. どちらもできなければ例外.
+  // Shader::IsPrecompiledMode なら GetPrecompiledPath のものを写像するだけ.
+  static std::shared_ptr<ShaderArchive> LoadOrBuild(const ShaderPermutationSet& set, const std::wstring& archiveFile,
+    std::shared_ptr<WorkerThreadPool> threadPool);
+  // 全バリアントを threadPool のスレッドで並列にコンパイルしてファイルへ書き出す. 失敗したら例外.
+  // 書き出せなくても(写像中で置き換えられない場合など)、メモリ上のアーカイブを返す.
+  static std::shared_ptr<ShaderArchive> Build(const ShaderPermutationSet& set, const std::wstring& archiveFile,
+    std::shared_ptr<WorkerThreadPool> threadPool);
+  // 写像するだけ. ファイルが無いか壊れていれば nullptr.
+  static std::shared_ptr<ShaderArchive> Open(const std::wstring& archiveFile);
+
+  // ソースが見つからなければ 0.
+  static uint64_t MakeBuildKey(const ShaderPermutationSet& set);
+  // 事前コンパイル時の格納先 (Shader::PrecompiledDirectory 以下).
+  static std::wstring GetPrecompiledPath(const std::wstring& archiveFile);
+
+  // 見つからなければ例外. Blob はアーカイブより長く使ってよい.
+  ComPtr<ID3DBlob> Find(Shader::Stage stage, const std::wstring& entryPoint, uint32_t key) const;
+
+  uint64_t GetBuildKey() const;
+  uint32_t GetVariantCount() const;
+  // false ならコンパイル直後のメモリ上のもの.
+  bool IsMapped() const;
+
+  struct Storage;
+private:
+  explicit ShaderArchive(std::shared_ptr<const Storage> storage);
+
+  std::shared_ptr<const Storage> m_storage;
+};
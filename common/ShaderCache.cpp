@@ -0,0 +1,157 @@
+﻿#include "ShaderCache.h"
+#include "CacheFileUtil.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  const char FileMagic[4] = { 'D', 'X', 'I', 'C' };
+  const uint32_t FileVersion = 1;
+
+  // ファイル先頭に置くヘッダ. 続けてキー文字列、コードの順に格納する.
+  struct FileHeader
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t codeSize;
+    uint64_t codeHash;
+  };
+}
+
+ShaderCache& ShaderCache::Get()
+{
+  static ShaderCache instance("ShaderCache");
+  return instance;
+}
+
+ShaderCache::ShaderCache(const std::string& directory, const std::string& extension)
+  : m_directory(directory), m_extension(extension), m_isEnabled(true), m_isReadOnly(false), m_stats()
+{
+}
+
+void ShaderCache::SetDirectory(const std::string& directory)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_directory = directory;
+}
+
+std::string ShaderCache::ToHex(uint64_t value)
+{
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(value));
+  return buf;
+}
+
+std::string ShaderCache::GetFilePath(const std::string& key) const
+{
+  return m_directory + "/" + ToHex(StableHasher::Hash(key.data(), key.size())) + m_extension;
+}
+
+bool ShaderCache::Load(const std::string& key, std::vector<char>& code)
+{
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    path = GetFilePath(key);
+  }
+
+  bool isCorrupted = false;
+  bool isHit = false;
+  std::ifstream infile(path, std::ios::binary);
+  if (infile)
+  {
+    infile.seekg(0, std::ios::end);
+    const auto fileSize = uint64_t(infile.tellg());
+    infile.seekg(0, std::ios::beg);
+
+    FileHeader header{};
+    std::string storedKey;
+    infile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    // 大きさをファイルの長さと照らし合わせてから確保する.
+    const bool isValidHeader = infile &&
+      memcmp(header.magic, FileMagic, sizeof(FileMagic)) == 0 && header.version == FileVersion &&
+      sizeof(header) + uint64_t(header.keySize) + uint64_t(header.codeSize) == fileSize;
+    if (isValidHeader)
+    {
+      storedKey.resize(header.keySize);
+      infile.read(&storedKey[0], header.keySize);
+      code.resize(header.codeSize);
+      infile.read(code.data(), header.codeSize);
+      if (infile && storedKey == key && StableHasher::Hash(code.data(), code.size()) == header.codeHash)
+      {
+        isHit = true;
+      }
+      else
+      {
+        // ハッシュの衝突によるキーの不一致は壊れたものとは扱わない.
+        isCorrupted = !infile || (storedKey == key);
+      }
+    }
+    else
+    {
+      isCorrupted = true;
+    }
+  }
+  if (isCorrupted && !m_isReadOnly)
+  {
+    infile.close();
+    std::remove(path.c_str());
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (isHit)
+  {
+    m_stats.hits++;
+    return true;
+  }
+  code.clear();
+  m_stats.misses++;
+  if (isCorrupted)
+  {
+    m_stats.corrupted++;
+  }
+  return false;
+}
+
+bool ShaderCache::Store(const std::string& key, const void* code, size_t size)
+{
+  if (m_isReadOnly)
+  {
+    return false;
+  }
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cache_file::CreateDirectoryIfNeeded(m_directory);
+    path = GetFilePath(key);
+  }
+
+  FileHeader header{};
+  memcpy(header.magic, FileMagic, sizeof(FileMagic));
+  header.version = FileVersion;
+  header.keySize = uint32_t(key.size());
+  header.codeSize = uint32_t(size);
+  header.codeHash = StableHasher::Hash(code, size);
+
+  std::vector<char> data;
+  data.reserve(sizeof(header) + key.size() + size);
+  data.insert(data.end(), reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header) + sizeof(header));
+  data.insert(data.end(), key.begin(), key.end());
+  data.insert(data.end(), static_cast<const char*>(code), static_cast<const char*>(code) + size);
+  if (!cache_file::WriteAtomically(path, data.data(), data.size()))
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.writes++;
+  return true;
+}
+
+ShaderCache::Statistics ShaderCache::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// コンパイル済みシェーダー(DXIL)をディスクに保存し、次回起動時のコンパイルを省く.
+// ファイル名はキーのハッシュ値で、ファイル内にもキーを持たせて取り違えを防ぐ.
+// 書き込みは一時ファイルから置き換えるため、途中で終了しても壊れたファイルは残らない.
+class ShaderCache
+{
+public:
+  // 実行時のコンパイル結果のキャッシュ. ディレクトリは "ShaderCache".
+  static ShaderCache& Get();
+  // 別の用途(事前コンパイル済みシェーダーの格納先など)に使う場合は個別に作る.
+  // extension を変えると、同じキーのものを同じディレクトリに並べて置ける.
+  explicit ShaderCache(const std::string& directory, const std::string& extension = ".dxil");
+
+  void SetDirectory(const std::string& directory);
+  void SetEnabled(bool enabled) { m_isEnabled = enabled; }
+  bool IsEnabled() const { return m_isEnabled; }
+  // 読み取り専用(事前コンパイル済みシェーダーの格納先)では、壊れたファイルを消さず Store も失敗する.
+  void SetReadOnly(bool readOnly) { m_isReadOnly = readOnly; }
+  bool IsReadOnly() const { return m_isReadOnly; }
+
+  // 見つからない、または内容が壊れていれば false.
+  // 壊れていたファイルは次の Store で作り直せるよう削除する(読み取り専用なら残す).
+  bool Load(const std::string& key, std::vector<char>& code);
+  bool Store(const std::string& key, const void* code, size_t size);
+
+  struct Statistics
+  {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t corrupted; // 読み込めたが検証に失敗したもの. misses にも数える.
+    uint32_t writes;
+  };
+  Statistics GetStatistics() const;
+
+  static std::string ToHex(uint64_t value);
+
+private:
+  std::string GetFilePath(const std::string& key) const;
+
+  std::string m_directory;
+  std::string m_extension;
+  bool m_isEnabled;
+  bool m_isReadOnly;
+  mutable std::mutex m_mutex;
+  Statistics m_stats;
+};
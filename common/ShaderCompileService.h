@@ -0,0 +1,115 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CpuProfiler.h"
+#include "ShaderTypes.h"
+#include "WorkerThreadPool.h"
+
+// コンパイルの要求をまとめて受け取り、 WorkerThreadPool のスレッドで並列にコンパイルする.
+// 同じ要求(ファイル、ステージ、エントリ、フラグ、マクロ、シェーダーモデル)は 1 度だけコンパイルし、結果を共有する.
+// コンパイル処理は生成時に受け取るため、このヘッダは D3D12 や DXC に依存しない. T はコンパイル結果の型.
+template<class T>
+class BasicShaderCompileService
+{
+public:
+  using Request = ShaderCompileRequest;
+  using Result = std::shared_future<T>;
+  using CompileFunc = std::function<T(const Request&)>;
+
+  // コンパイルは threadPool に積む. threadPool はこのオブジェクトより長く生かしておくこと.
+  BasicShaderCompileService(std::shared_ptr<WorkerThreadPool> threadPool, CompileFunc compileFunc)
+    : m_threadPool(threadPool), m_compileFunc(compileFunc), m_requestCount(0), m_compileCount(0)
+  {
+  }
+
+  // 結果の取得(get)でコンパイルの完了を待つ. 失敗した場合は get で例外が投げられる.
+  Result Compile(const Request& request)
+  {
+    auto key = MakeKey(request);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requestCount++;
+    auto itr = m_results.find(key);
+    if (itr != m_results.end())
+    {
+      return itr->second;
+    }
+
+    // 処理はプールに残るので、このオブジェクトではなくコンパイル処理の複製を持たせる.
+    auto compileFunc = m_compileFunc;
+    auto task = std::make_shared<std::packaged_task<T()>>([compileFunc, request]() {
+      CPU_PROFILE_SCOPE("CompileShader");
+      return compileFunc(request);
+    });
+    Result result = task->get_future().share();
+    m_results.emplace(key, result);
+    m_compileCount++;
+    m_threadPool->Submit([task]() { (*task)(); });
+    return result;
+  }
+
+  std::vector<Result> Compile(const std::vector<Request>& requests)
+  {
+    std::vector<Result> results;
+    results.reserve(requests.size());
+    for (const auto& v : requests)
+    {
+      results.push_back(Compile(v));
+    }
+    return results;
+  }
+
+  // 重複除去用に保持している結果を捨てる. 以降の要求は改めてコンパイルする.
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_results.clear();
+  }
+
+  uint32_t GetRequestCount() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requestCount;
+  }
+  uint32_t GetCompileCount() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_compileCount;
+  }
+  uint32_t GetThreadCount() const { return m_threadPool->GetThreadCount(); }
+
+  static std::wstring MakeKey(const Request& request)
+  {
+    // 区切りはファイル名や引数に現れない文字を使う.
+    const wchar_t sep = L'\x1f';
+    std::wstring key = request.fileName + sep + std::to_wstring(int(request.stage)) + sep + request.entryPoint + sep + request.shaderModel;
+    for (const auto& v : request.flags)
+    {
+      key += sep + v;
+    }
+    key += sep;
+    for (const auto& v : request.defines)
+    {
+      key += sep + v.Name + L'=' + v.Value;
+    }
+    return key;
+  }
+private:
+  std::shared_ptr<WorkerThreadPool> m_threadPool;
+  CompileFunc m_compileFunc;
+  mutable std::mutex m_mutex;
+  std::map<std::wstring, Result> m_results;
+  uint32_t m_requestCount;
+  uint32_t m_compileCount;
+};
+
+// Shader::load でコンパイルするもの. Shader::Compile を渡して作る.
+class Shader;
+using ShaderCompileService = BasicShaderCompileService<Shader>;
@@ -0,0 +1,550 @@
+﻿#if _MSC_VER > 1922 && !defined(_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING)
+#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
+#endif
+#include "ShaderCompiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <experimental/filesystem>
+
+#if defined(_WIN32)
+#include "D3D12BookUtil.h"
+#pragma comment(lib, "dxcompiler.lib")
+#else
+#include <codecvt>
+#include <locale>
+#include <stdexcept>
+// D3D12BookUtil.h は d3d12.h を必要とするため、同じ使い方ができるものを用意する.
+#define ThrowIfFailed(hr, msg) do { if (FAILED(hr)) { throw std::runtime_error(msg); } } while (0)
+#endif
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+#if defined(_WIN32)
+  // 定数バッファのうち変数が使っている範囲を 32bit 単位で求める. (末尾のパディングは含めない)
+  UINT GetConstantCount(ID3D12ShaderReflection* reflection, const char* name)
+  {
+    auto buffer = reflection->GetConstantBufferByName(name);
+    D3D12_SHADER_BUFFER_DESC bufferDesc{};
+    if (buffer == nullptr || FAILED(buffer->GetDesc(&bufferDesc)))
+    {
+      return 0;
+    }
+    UINT size = 0;
+    for (UINT i = 0; i < bufferDesc.Variables; ++i)
+    {
+      D3D12_SHADER_VARIABLE_DESC variableDesc{};
+      if (SUCCEEDED(buffer->GetVariableByIndex(i)->GetDesc(&variableDesc)))
+      {
+        size = (std::max)(size, variableDesc.StartOffset + variableDesc.Size);
+      }
+    }
+    return (size + 3) / 4;
+  }
+#endif
+
+  std::string ToUtf8(const std::wstring& text)
+  {
+    if (text.empty())
+    {
+      return std::string();
+    }
+#if defined(_WIN32)
+    auto size = WideCharToMultiByte(CP_UTF8, 0, text.data(), int(text.size()), nullptr, 0, nullptr, nullptr);
+    std::string ret(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text.data(), int(text.size()), &ret[0], size, nullptr, nullptr);
+    return ret;
+#else
+    // wchar_t は UTF-32.
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
+    return converter.to_bytes(text);
+#endif
+  }
+
+  bool ParseNumber(const std::string& text, uint32_t& value)
+  {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+    {
+      return false;
+    }
+    value = uint32_t(std::stoul(text));
+    return true;
+  }
+
+  const char* GetSeverityName(ShaderDiagnostic::Severity severity)
+  {
+    switch (severity)
+    {
+    case ShaderDiagnostic::Error: return "error";
+    case ShaderDiagnostic::Warning: return "warning";
+    default: return "note";
+    }
+  }
+}
+
+// DXC から呼ばれるインクルードハンドラ. ソースキャッシュから読み、参照されたファイルを記録する.
+// 渡したブロブはキャッシュのメモリを指すため、コンパイルが終わるまで参照を保持しておく.
+class ShaderIncludeHandler : public IDxcIncludeHandler
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  explicit ShaderIncludeHandler(ComPtr<IDxcUtils> utils) : m_refCount(1), m_utils(utils) {}
+  virtual ~ShaderIncludeHandler() {}
+
+  HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override
+  {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+    {
+      return E_INVALIDARG;
+    }
+    *ppIncludeSource = nullptr;
+    auto source = ShaderSourceCache::Get().Load(pFilename);
+    if (!source)
+    {
+      return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+    ComPtr<IDxcBlobEncoding> blob;
+    auto hr = m_utils->CreateBlobFromPinned(source->data(), UINT32(source->size()), DXC_CP_UTF8, &blob);
+    if (FAILED(hr))
+    {
+      return hr;
+    }
+    m_pinned.push_back(source);
+    m_includedFiles.push_back(ShaderSourceCache::NormalizePath(pFilename));
+    *ppIncludeSource = blob.Detach();
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+  {
+    if (ppvObject == nullptr)
+    {
+      return E_POINTER;
+    }
+    if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+    {
+      *ppvObject = static_cast<IDxcIncludeHandler*>(this);
+      AddRef();
+      return S_OK;
+    }
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+  ULONG STDMETHODCALLTYPE AddRef() override { return ++m_refCount; }
+  ULONG STDMETHODCALLTYPE Release() override
+  {
+    auto count = --m_refCount;
+    if (count == 0)
+    {
+      delete this;
+    }
+    return count;
+  }
+
+  // コンパイル毎の記録を取り出して空にする.
+  std::vector<std::wstring> Finish()
+  {
+    m_pinned.clear();
+    std::vector<std::wstring> ret;
+    ret.swap(m_includedFiles);
+    return ret;
+  }
+private:
+  std::atomic<ULONG> m_refCount;
+  ComPtr<IDxcUtils> m_utils;
+  std::vector<ShaderSourceCache::Source> m_pinned;
+  std::vector<std::wstring> m_includedFiles;
+};
+
+ShaderSourceCache& ShaderSourceCache::Get()
+{
+  static ShaderSourceCache instance;
+  return instance;
+}
+
+ShaderSourceCache::ShaderSourceCache() : m_stats()
+{
+}
+
+ShaderSourceCache::Source ShaderSourceCache::Load(const std::wstring& fileName)
+{
+  const auto key = NormalizePath(fileName);
+  std::error_code ec;
+  auto writeTime = fs::last_write_time(fs::path(key), ec);
+  if (ec)
+  {
+    return nullptr;
+  }
+  const auto ticks = int64_t(writeTime.time_since_epoch().count());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto itr = m_entries.find(key);
+    if (itr != m_entries.end() && itr->second.writeTime == ticks)
+    {
+      m_stats.hits++;
+      return itr->second.source;
+    }
+  }
+
+  // 読み込みはロックの外で行う. 同時に読まれた場合は後の方が残るだけで内容は同じ.
+  std::ifstream infile(fs::path(key), std::ios::binary);
+  if (!infile)
+  {
+    return nullptr;
+  }
+  auto source = std::make_shared<std::vector<char>>(
+    (std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries[key] = Entry{ source, ticks };
+  m_stats.loads++;
+  return source;
+}
+
+void ShaderSourceCache::Invalidate(const std::wstring& fileName)
+{
+  const auto key = NormalizePath(fileName);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.erase(key);
+}
+
+void ShaderSourceCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+}
+
+ShaderSourceCache::Statistics ShaderSourceCache::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+std::wstring ShaderSourceCache::NormalizePath(const std::wstring& fileName)
+{
+  auto full = fs::absolute(fs::path(fileName)).wstring();
+#if defined(_WIN32)
+  const wchar_t separator = L'\\';
+  // ドライブ名(またはサーバー名)より上には戻らない.
+  const size_t rootCount = 1;
+  std::replace(full.begin(), full.end(), L'/', L'\\');
+
+  // UNC パスの先頭はそのまま残す.
+  std::wstring ret;
+  size_t pos = 0;
+  if (full.compare(0, 2, L"\\\\") == 0)
+  {
+    ret = L"\\\\";
+    pos = 2;
+  }
+#else
+  const wchar_t separator = L'/';
+  const size_t rootCount = 0;
+  std::wstring ret = L"/";
+  size_t pos = 1;
+#endif
+  std::vector<std::wstring> parts;
+  while (pos <= full.size())
+  {
+    auto next = full.find(separator, pos);
+    if (next == std::wstring::npos)
+    {
+      next = full.size();
+    }
+    auto part = full.substr(pos, next - pos);
+    if (part == L"..")
+    {
+      if (parts.size() > rootCount)
+      {
+        parts.pop_back();
+      }
+    }
+    else if (!part.empty() && part != L".")
+    {
+      parts.push_back(part);
+    }
+    pos = next + 1;
+  }
+  for (size_t i = 0; i < parts.size(); ++i)
+  {
+    if (i > 0)
+    {
+      ret += separator;
+    }
+    ret += parts[i];
+  }
+  return ret;
+}
+
+bool ShaderCompiler::Result::HasErrors() const
+{
+  return std::any_of(diagnostics.begin(), diagnostics.end(),
+    [](const ShaderDiagnostic& v) { return v.severity == ShaderDiagnostic::Error; });
+}
+
+std::string ShaderCompiler::Result::FormatDiagnostics() const
+{
+  // Visual Studio の出力ウィンドウから該当行へ移動できる書式にする.
+  std::string ret;
+  for (const auto& v : diagnostics)
+  {
+    if (!v.fileName.empty())
+    {
+      ret += v.fileName;
+      if (v.line > 0)
+      {
+        ret += "(" + std::to_string(v.line) + "," + std::to_string(v.column) + ")";
+      }
+      ret += ": ";
+    }
+    ret += GetSeverityName(v.severity);
+    ret += ": " + v.message + "\n";
+  }
+  return ret;
+}
+
+ShaderCompiler& ShaderCompiler::GetForCurrentThread()
+{
+  thread_local std::unique_ptr<ShaderCompiler> instance;
+  if (!instance)
+  {
+    instance.reset(new ShaderCompiler());
+  }
+  return *instance;
+}
+
+ShaderCompiler::ShaderCompiler()
+{
+  HRESULT hr;
+  hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&m_utils));
+  ThrowIfFailed(hr, "DxcCreateInstance failed.(DxcUtils)");
+  hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_compiler));
+  ThrowIfFailed(hr, "DxcCreateInstance failed.(DxcCompiler)");
+  m_includeHandler.Attach(new ShaderIncludeHandler(m_utils));
+
+  ComPtr<IDxcVersionInfo> info;
+  UINT32 major = 0, minor = 0;
+  if (SUCCEEDED(m_compiler.As(&info)))
+  {
+    info->GetVersion(&major, &minor);
+  }
+  m_version = std::to_string(major) + "." + std::to_string(minor);
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+}
+
+#if defined(_WIN32)
+ShaderCompiler::ComPtr<ID3D12ShaderReflection> ShaderCompiler::Reflect(ID3DBlob* code)
+{
+  ComPtr<ID3D12ShaderReflection> reflection;
+  if (code == nullptr)
+  {
+    return reflection;
+  }
+  DxcBuffer buffer{};
+  buffer.Ptr = code->GetBufferPointer();
+  buffer.Size = code->GetBufferSize();
+  buffer.Encoding = DXC_CP_ACP;
+  if (FAILED(m_utils->CreateReflection(&buffer, IID_PPV_ARGS(&reflection))))
+  {
+    reflection.Reset();
+  }
+  return reflection;
+}
+
+bool ShaderCompiler::ReflectBindings(ID3DBlob* code, ShaderReflectionData& data)
+{
+  data = ShaderReflectionData();
+  auto reflection = Reflect(code);
+  D3D12_SHADER_DESC shaderDesc{};
+  if (!reflection || FAILED(reflection->GetDesc(&shaderDesc)))
+  {
+    return false;
+  }
+  data.shaderVersion = shaderDesc.Version;
+  data.inputParameters = shaderDesc.InputParameters;
+  for (UINT i = 0; i < shaderDesc.BoundResources; ++i)
+  {
+    D3D12_SHADER_INPUT_BIND_DESC bindDesc{};
+    HRESULT hr = reflection->GetResourceBindingDesc(i, &bindDesc);
+    ThrowIfFailed(hr, "ID3D12ShaderReflection::GetResourceBindingDesc failed.");
+
+    ShaderReflectionData::Resource resource{};
+    resource.name = bindDesc.Name;
+    resource.type = bindDesc.Type;
+    resource.bindPoint = bindDesc.BindPoint;
+    resource.bindCount = bindDesc.BindCount;
+    resource.space = bindDesc.Space;
+    if (bindDesc.Type == D3D_SIT_CBUFFER)
+    {
+      resource.constantCount = GetConstantCount(reflection.Get(), bindDesc.Name);
+    }
+    data.resources.push_back(resource);
+  }
+  return true;
+}
+#endif
+
+ShaderCompiler::ComPtr<ID3DBlob> ShaderCompiler::CreateBlob(const void* data, size_t size)
+{
+  ComPtr<IDxcBlobEncoding> blob;
+  ComPtr<ID3DBlob> ret;
+  if (SUCCEEDED(m_utils->CreateBlob(data, UINT32(size), DXC_CP_ACP, &blob)))
+  {
+    // IDxcBlob は ID3DBlob と同じ並びのインタフェースなのでそのまま扱う.
+    ret.Attach(reinterpret_cast<ID3DBlob*>(blob.Detach()));
+  }
+  return ret;
+}
+
+ShaderCompiler::Result ShaderCompiler::Compile(const Desc& desc, ShaderSourceCache::Source source)
+{
+  Result result;
+  if (!source)
+  {
+    source = ShaderSourceCache::Get().Load(desc.fileName);
+  }
+  if (!source)
+  {
+    result.diagnostics.push_back(ShaderDiagnostic{ ShaderDiagnostic::Error, ToUtf8(desc.fileName), 0, 0, "shader not found." });
+    return result;
+  }
+
+  std::vector<LPCWSTR> arguments;
+  for (const auto& v : desc.arguments)
+  {
+    arguments.push_back(v.c_str());
+  }
+  std::vector<DxcDefine> defines;
+  for (const auto& v : desc.defines)
+  {
+    defines.push_back(DxcDefine{ v.first.c_str(), v.second.c_str() });
+  }
+
+  ComPtr<IDxcCompilerArgs> compilerArgs;
+  ComPtr<IDxcResult> dxcResult;
+  HRESULT hr = m_utils->BuildArguments(
+    desc.fileName.c_str(), desc.entryPoint.c_str(), desc.profile.c_str(),
+    arguments.data(), UINT32(arguments.size()),
+    defines.data(), UINT32(defines.size()),
+    &compilerArgs);
+  if (SUCCEEDED(hr))
+  {
+    DxcBuffer buffer{ source->data(), source->size(), DXC_CP_UTF8 };
+    hr = m_compiler->Compile(
+      &buffer,
+      compilerArgs->GetArguments(), compilerArgs->GetCount(),
+      m_includeHandler.Get(),
+      IID_PPV_ARGS(&dxcResult));
+  }
+  result.includedFiles = m_includeHandler->Finish();
+  if (FAILED(hr))
+  {
+    result.diagnostics.push_back(ShaderDiagnostic{ ShaderDiagnostic::Error, ToUtf8(desc.fileName), 0, 0, "IDxcCompiler3::Compile failed." });
+    return result;
+  }
+
+  ComPtr<IDxcBlobUtf8> errors;
+  if (SUCCEEDED(dxcResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr)) &&
+    errors && errors->GetStringLength() > 0)
+  {
+    result.log.assign(errors->GetStringPointer(), errors->GetStringLength());
+    result.diagnostics = ParseDiagnostics(result.log);
+  }
+
+  HRESULT status = E_FAIL;
+  dxcResult->GetStatus(&status);
+  if (SUCCEEDED(status))
+  {
+    // IDxcBlob は ID3DBlob と同じ並びのインタフェースなのでそのまま扱う.
+    dxcResult->GetOutput(DXC_OUT_OBJECT, __uuidof(IDxcBlob),
+      reinterpret_cast<void**>(result.code.GetAddressOf()), nullptr);
+  }
+  if (!result.IsSucceeded() && !result.HasErrors())
+  {
+    result.diagnostics.push_back(ShaderDiagnostic{ ShaderDiagnostic::Error, ToUtf8(desc.fileName), 0, 0,
+      result.log.empty() ? "shader compile failed." : result.log });
+  }
+  return result;
+}
+
+std::vector<ShaderDiagnostic> ShaderCompiler::ParseDiagnostics(const std::string& log)
+{
+  // "file:line:col: error: message" の行を拾う. ソースの抜粋やキャレットの行は読み飛ばす.
+  static const struct
+  {
+    const char* tag;
+    ShaderDiagnostic::Severity severity;
+  } tags[] = {
+    { ": fatal error: ", ShaderDiagnostic::Error },
+    { ": error: ", ShaderDiagnostic::Error },
+    { ": warning: ", ShaderDiagnostic::Warning },
+    { ": note: ", ShaderDiagnostic::Note },
+  };
+
+  std::vector<ShaderDiagnostic> ret;
+  size_t lineStart = 0;
+  while (lineStart < log.size())
+  {
+    auto lineEnd = log.find('\n', lineStart);
+    if (lineEnd == std::string::npos)
+    {
+      lineEnd = log.size();
+    }
+    auto line = log.substr(lineStart, lineEnd - lineStart);
+    lineStart = lineEnd + 1;
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+
+    for (const auto& tag : tags)
+    {
+      const auto tagLength = strlen(tag.tag);
+      std::string location;
+      size_t messageStart = 0;
+      if (line.compare(0, tagLength - 2, tag.tag + 2) == 0)
+      {
+        // 位置を持たないもの ("error: validation errors" など).
+        messageStart = tagLength - 2;
+      }
+      else
+      {
+        auto pos = line.find(tag.tag);
+        if (pos == std::string::npos)
+        {
+          continue;
+        }
+        location = line.substr(0, pos);
+        messageStart = pos + tagLength;
+      }
+
+      ShaderDiagnostic diagnostic{ tag.severity, location, 0, 0, line.substr(messageStart) };
+      // ファイル名にドライブの ':' を含むことがあるので、後ろから列と行を取り出す.
+      auto colonCol = location.rfind(':');
+      if (colonCol != std::string::npos && colonCol > 0)
+      {
+        auto colonLine = location.rfind(':', colonCol - 1);
+        uint32_t lineNumber = 0, column = 0;
+        if (colonLine != std::string::npos &&
+          ParseNumber(location.substr(colonLine + 1, colonCol - colonLine - 1), lineNumber) &&
+          ParseNumber(location.substr(colonCol + 1), column))
+        {
+          diagnostic.fileName = location.substr(0, colonLine);
+          diagnostic.line = lineNumber;
+          diagnostic.column = column;
+        }
+      }
+      ret.push_back(diagnostic);
+      break;
+    }
+  }
+  return ret;
+}
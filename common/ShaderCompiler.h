@@ -0,0 +1,120 @@
+﻿#pragma once
+#include "ShaderPlatform.h"
+#include "ShaderReflectionData.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// コンパイラが出力したメッセージを 1 件ずつに分けたもの.
+struct ShaderDiagnostic
+{
+  enum Severity
+  {
+    Error, Warning, Note,
+  };
+  Severity severity;
+  std::string fileName; // 位置を持たないメッセージでは空.
+  uint32_t line;        // 1 始まり. 不明なら 0.
+  uint32_t column;
+  std::string message;
+};
+
+// シェーダーソースと #include で参照されるファイルをメモリに保持する. 複数スレッドから使ってよい.
+// 取得の度に更新日時を確かめ、変更されていれば読み直す.
+class ShaderSourceCache
+{
+public:
+  using Source = std::shared_ptr<const std::vector<char>>;
+
+  static ShaderSourceCache& Get();
+
+  // 見つからなければ nullptr.
+  Source Load(const std::wstring& fileName);
+  void Invalidate(const std::wstring& fileName);
+  void Clear();
+
+  struct Statistics
+  {
+    uint32_t hits;
+    uint32_t loads;
+  };
+  Statistics GetStatistics() const;
+
+  // 絶対パスにし、区切り文字の統一と "." ".." の除去を行う. キャッシュのキーに使う.
+  static std::wstring NormalizePath(const std::wstring& fileName);
+private:
+  ShaderSourceCache();
+  struct Entry
+  {
+    Source source;
+    int64_t writeTime;
+  };
+  std::unordered_map<std::wstring, Entry> m_entries;
+  mutable std::mutex m_mutex;
+  Statistics m_stats;
+};
+
+class ShaderIncludeHandler;
+
+// DXC の Utils/Compiler とインクルードハンドラを使い回してシェーダーをコンパイルする.
+// DXC のインスタンスはスレッド間で共有できないため、 GetForCurrentThread でスレッド毎に 1 つ持つ.
+// 失敗しても例外は投げず、結果の diagnostics にエラーを返す.
+class ShaderCompiler
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  struct Desc
+  {
+    std::wstring fileName;
+    std::wstring entryPoint;
+    std::wstring profile;     // "ps_6_0" など.
+    std::vector<std::wstring> arguments;
+    std::vector<std::pair<std::wstring, std::wstring>> defines;
+  };
+  struct Result
+  {
+    ComPtr<ID3DBlob> code;    // 失敗時は nullptr.
+    std::vector<ShaderDiagnostic> diagnostics;
+    std::string log;          // コンパイラの出力そのまま.
+    std::vector<std::wstring> includedFiles;
+    bool IsSucceeded() const { return code != nullptr; }
+    bool HasErrors() const;
+    // エラーと警告を 1 つの文字列にまとめる. 例外のメッセージやログ出力に使う.
+    std::string FormatDiagnostics() const;
+  };
+
+  static ShaderCompiler& GetForCurrentThread();
+  ~ShaderCompiler();
+
+  // source を省略するとソースキャッシュから読み込む.
+  Result Compile(const Desc& desc, ShaderSourceCache::Source source = nullptr);
+
+#if defined(_WIN32)
+  // DXIL に含まれるリフレクション情報を取り出す. 含まれていなければ nullptr.
+  ComPtr<ID3D12ShaderReflection> Reflect(ID3DBlob* code);
+  // ルートシグネチャを作るのに必要な分だけを取り出す. リフレクション情報が無ければ false.
+  bool ReflectBindings(ID3DBlob* code, ShaderReflectionData& data);
+#endif
+  // data をコピーした Blob. d3dcompiler が無い環境で D3DCreateBlob の代わりに使う.
+  ComPtr<ID3DBlob> CreateBlob(const void* data, size_t size);
+
+  // キャッシュのキーに含めるコンパイラのバージョン ("1.7" など).
+  const std::string& GetVersion() const { return m_version; }
+
+  static std::vector<ShaderDiagnostic> ParseDiagnostics(const std::string& log);
+private:
+  ShaderCompiler();
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ComPtr<IDxcUtils> m_utils;
+  ComPtr<IDxcCompiler3> m_compiler;
+  ComPtr<ShaderIncludeHandler> m_includeHandler;
+  std::string m_version;
+};
@@ -0,0 +1,135 @@
+﻿#if _MSC_VER > 1922 && !defined(_SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING)
+#define _SILENCE_EXPERIMENTAL_FILESYSTEM_DEPRECATION_WARNING
+#endif
+#include "ShaderHotReload.h"
+#include "CpuProfiler.h"
+#include <experimental/filesystem>
+
+namespace fs = std::experimental::filesystem;
+
+ShaderHotReload::ShaderHotReload(bool isEnabled, uint32_t pollIntervalMs)
+  : m_isEnabled(isEnabled), m_pollIntervalMs(pollIntervalMs), m_status(), m_isTerminating(false)
+{
+  if (m_isEnabled)
+  {
+    m_thread = std::thread([this]() {
+      CPU_PROFILE_THREAD_NAME("ShaderHotReload");
+      WatcherMain();
+    });
+  }
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+  Stop();
+}
+
+void ShaderHotReload::Watch(const std::vector<std::wstring>& files, BuildFunc build)
+{
+  if (!m_isEnabled)
+  {
+    return;
+  }
+  auto entry = std::make_shared<Entry>();
+  entry->files = files;
+  entry->writeTimes = GetWriteTimes(files);
+  entry->build = build;
+  entry->isPending = false;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.push_back(entry);
+}
+
+void ShaderHotReload::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isTerminating = true;
+  }
+  m_wake.notify_all();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+ShaderHotReload::Pipelines ShaderHotReload::TakeCompleted()
+{
+  Pipelines ret;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ret.swap(m_completed);
+  return ret;
+}
+
+ShaderHotReload::Status ShaderHotReload::GetStatus() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_status;
+}
+
+std::vector<int64_t> ShaderHotReload::GetWriteTimes(const std::vector<std::wstring>& files)
+{
+  std::vector<int64_t> ret;
+  for (const auto& v : files)
+  {
+    std::error_code ec;
+    auto writeTime = fs::last_write_time(fs::path(v), ec);
+    // 保存中で一時的に見えない場合も変化として扱い、落ち着くのを待つ.
+    ret.push_back(ec ? -1 : int64_t(writeTime.time_since_epoch().count()));
+  }
+  return ret;
+}
+
+void ShaderHotReload::WatcherMain()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_wake.wait_for(lock, std::chrono::milliseconds(m_pollIntervalMs), [this]() { return m_isTerminating; });
+    if (m_isTerminating)
+    {
+      break;
+    }
+    // エントリの中身はこのスレッドだけが触る.
+    auto entries = m_entries;
+    lock.unlock();
+
+    for (auto& entry : entries)
+    {
+      auto writeTimes = GetWriteTimes(entry->files);
+      if (writeTimes != entry->writeTimes)
+      {
+        entry->writeTimes = writeTimes;
+        entry->isPending = true;
+        continue;
+      }
+      if (!entry->isPending)
+      {
+        continue;
+      }
+      entry->isPending = false;
+
+      CPU_PROFILE_SCOPE("ShaderHotReload");
+      try
+      {
+        auto pipelines = entry->build();
+        std::lock_guard<std::mutex> guard(m_mutex);
+        for (auto& v : pipelines)
+        {
+          m_completed[v.first] = v.second;
+        }
+        m_status.reloadCount++;
+        m_status.lastError.clear();
+      }
+      catch (const std::exception& e)
+      {
+        OutputDebugStringA(e.what());
+        OutputDebugStringA("\n");
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_status.failureCount++;
+        m_status.lastError = e.what();
+      }
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// シェーダーソースの更新を監視し、バックグラウンドで PSO を作り直す.
+// 更新日時を一定間隔で調べ、変化が落ち着いた(次の確認で変わっていない)時点で再構築する.
+// 作り直した PSO は TakeCompleted で受け取り、フレームの区切りで差し替える.
+// 再構築に失敗した場合は古い PSO を使い続け、エラーを GetStatus で返す.
+class ShaderHotReload
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+  using Pipelines = std::unordered_map<std::string, ComPtr<ID3D12PipelineState>>;
+  // 監視スレッドで呼ばれる. シェーダーのコンパイルと PSO の生成を行い、名前と組で返す.
+  using BuildFunc = std::function<Pipelines()>;
+
+  explicit ShaderHotReload(bool isEnabled, uint32_t pollIntervalMs = 250);
+  ~ShaderHotReload();
+
+  // files のどれかが更新されたら build を呼ぶ. 無効なら何もしない.
+  void Watch(const std::vector<std::wstring>& files, BuildFunc build);
+  // 監視を止める. 実行中の再構築は終わるのを待つ.
+  void Stop();
+
+  Pipelines TakeCompleted();
+
+  struct Status
+  {
+    uint32_t reloadCount;
+    uint32_t failureCount;
+    std::string lastError;
+  };
+  Status GetStatus() const;
+  bool IsEnabled() const { return m_isEnabled; }
+private:
+  struct Entry
+  {
+    std::vector<std::wstring> files;
+    std::vector<int64_t> writeTimes;
+    BuildFunc build;
+    bool isPending;
+  };
+  void WatcherMain();
+  static std::vector<int64_t> GetWriteTimes(const std::vector<std::wstring>& files);
+
+  bool m_isEnabled;
+  uint32_t m_pollIntervalMs;
+  std::vector<std::shared_ptr<Entry>> m_entries;
+  Pipelines m_completed;
+  Status m_status;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::thread m_thread;
+  bool m_isTerminating;
+};
@@ -0,0 +1,16 @@
+﻿#pragma once
+#include "ShaderArchive.h"
+#include "ShaderTypes.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// ShaderBuild が事前にコンパイルするもののうち、 *.hlsl のエントリポイントを既定の条件でコンパイルするもの以外.
+// アプリの宣言と食い違わないよう、各サンプルの <サンプル名>Shaders.h でアプリと同じ関数から作り、
+// ShaderBuild はそのヘッダを include して使う.
+struct ShaderManifest
+{
+  std::vector<ShaderCompileRequest> shaders;
+  // アーカイブのファイル名と宣言.
+  std::vector<std::pair<std::wstring, ShaderPermutationSet>> archives;
+};
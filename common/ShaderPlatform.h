@@ -0,0 +1,118 @@
+﻿#pragma once
+// シェーダーのビルド(ShaderCompiler, Shader, ShaderArchive)が使う DXC と COM の型.
+// Windows では Windows SDK のヘッダをそのまま使う.
+// Linux では DXC のリリースに含まれる dxcapi.h (WinAdapter.h) だけを使い、ShaderBuild をビルドできるようにする.
+// d3d12.h は無いので、必要な分(ComPtr, ID3DBlob, D3D_SHADER_MODEL)をここで補う.
+#if defined(_WIN32)
+#include <d3d12.h>
+#include <dxcapi.h>
+#include <d3d12shader.h>
+#include <wrl.h>
+#else
+#include <dxc/dxcapi.h>
+#include <cstddef>
+#include <utility>
+
+// IDxcBlob は ID3DBlob と同じ並びのインタフェース.
+using ID3DBlob = IDxcBlob;
+
+enum D3D_SHADER_MODEL
+{
+  D3D_SHADER_MODEL_5_1 = 0x51,
+  D3D_SHADER_MODEL_6_0 = 0x60,
+  D3D_SHADER_MODEL_6_1 = 0x61,
+  D3D_SHADER_MODEL_6_2 = 0x62,
+  D3D_SHADER_MODEL_6_3 = 0x63,
+  D3D_SHADER_MODEL_6_4 = 0x64,
+  D3D_SHADER_MODEL_6_5 = 0x65,
+  D3D_SHADER_MODEL_6_6 = 0x66,
+  D3D_SHADER_MODEL_6_7 = 0x67,
+};
+
+namespace Microsoft
+{
+  namespace WRL
+  {
+    // WRL の ComPtr のうち、シェーダーのビルドで使う分.
+    template<class T>
+    class ComPtr
+    {
+    public:
+      ComPtr() : m_ptr(nullptr) {}
+      ComPtr(std::nullptr_t) : m_ptr(nullptr) {}
+      template<class U>
+      ComPtr(U* ptr) : m_ptr(ptr) { InternalAddRef(); }
+      ComPtr(const ComPtr& rhs) : m_ptr(rhs.m_ptr) { InternalAddRef(); }
+      template<class U>
+      ComPtr(const ComPtr<U>& rhs) : m_ptr(rhs.Get()) { InternalAddRef(); }
+      ComPtr(ComPtr&& rhs) : m_ptr(rhs.m_ptr) { rhs.m_ptr = nullptr; }
+      ~ComPtr() { Reset(); }
+
+      ComPtr& operator=(ComPtr rhs)
+      {
+        std::swap(m_ptr, rhs.m_ptr);
+        return *this;
+      }
+
+      T* Get() const { return m_ptr; }
+      T* operator->() const { return m_ptr; }
+      explicit operator bool() const { return m_ptr != nullptr; }
+
+      T** GetAddressOf() { return &m_ptr; }
+      T** ReleaseAndGetAddressOf()
+      {
+        Reset();
+        return &m_ptr;
+      }
+      // IID_PPV_ARGS(&ptr) で受け取れるよう、保持しているものを解放してから渡す.
+      T** operator&() { return ReleaseAndGetAddressOf(); }
+
+      void Attach(T* ptr)
+      {
+        Reset();
+        m_ptr = ptr;
+      }
+      T* Detach()
+      {
+        auto ptr = m_ptr;
+        m_ptr = nullptr;
+        return ptr;
+      }
+      void Reset()
+      {
+        if (m_ptr)
+        {
+          auto ptr = m_ptr;
+          m_ptr = nullptr;
+          ptr->Release();
+        }
+      }
+      template<class U>
+      HRESULT As(ComPtr<U>* other) const
+      {
+        return m_ptr->QueryInterface(__uuidof(U), reinterpret_cast<void**>(other->ReleaseAndGetAddressOf()));
+      }
+      // As(&ptr) の形. operator& で解放済みのアドレスを受け取る.
+      template<class U>
+      HRESULT As(U** other) const
+      {
+        return m_ptr->QueryInterface(__uuidof(U), reinterpret_cast<void**>(other));
+      }
+    private:
+      void InternalAddRef()
+      {
+        if (m_ptr)
+        {
+          m_ptr->AddRef();
+        }
+      }
+      T* m_ptr;
+    };
+
+    template<class T>
+    bool operator==(const ComPtr<T>& lhs, std::nullptr_t) { return lhs.Get() == nullptr; }
+    template<class T>
+    bool operator!=(const ComPtr<T>& lhs, std::nullptr_t) { return lhs.Get() != nullptr; }
+  }
+}
+#endif
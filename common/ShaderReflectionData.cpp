@@ -0,0 +1,111 @@
+﻿#include "ShaderReflectionData.h"
+#include <cstring>
+
+namespace
+{
+  const char FileMagic[4] = { 'R', 'E', 'F', 'L' };
+  const uint32_t FileVersion = 1;
+
+  void WriteU32(std::vector<char>& data, uint32_t value)
+  {
+    auto p = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), p, p + sizeof(value));
+  }
+
+  // 範囲外を読もうとしたら以降は全て失敗する.
+  class Reader
+  {
+  public:
+    explicit Reader(const std::vector<char>& data) : m_data(data), m_offset(0), m_isValid(true) {}
+    bool Bytes(void* dst, size_t size)
+    {
+      if (!m_isValid || m_data.size() - m_offset < size)
+      {
+        m_isValid = false;
+        return false;
+      }
+      memcpy(dst, m_data.data() + m_offset, size);
+      m_offset += size;
+      return true;
+    }
+    uint32_t U32() { uint32_t v = 0; Bytes(&v, sizeof(v)); return v; }
+    bool String(std::string& dst, uint32_t size)
+    {
+      if (!m_isValid || m_data.size() - m_offset < size)
+      {
+        m_isValid = false;
+        return false;
+      }
+      dst.assign(m_data.data() + m_offset, size);
+      m_offset += size;
+      return true;
+    }
+    // 残りの長さ. 要素数を信じて確保する前に照らし合わせる.
+    size_t GetRemaining() const { return m_data.size() - m_offset; }
+    bool IsValid() const { return m_isValid; }
+    bool IsEnd() const { return m_offset == m_data.size(); }
+  private:
+    const std::vector<char>& m_data;
+    size_t m_offset;
+    bool m_isValid;
+  };
+
+  // 名前以外のメンバ (type, bindPoint, bindCount, space, constantCount) と名前の長さ.
+  const size_t ResourceHeaderSize = sizeof(uint32_t) * 6;
+}
+
+std::vector<char> ShaderReflectionData::Serialize() const
+{
+  std::vector<char> data(FileMagic, FileMagic + sizeof(FileMagic));
+  WriteU32(data, FileVersion);
+  WriteU32(data, shaderVersion);
+  WriteU32(data, inputParameters);
+  WriteU32(data, uint32_t(resources.size()));
+  for (const auto& v : resources)
+  {
+    WriteU32(data, v.type);
+    WriteU32(data, v.bindPoint);
+    WriteU32(data, v.bindCount);
+    WriteU32(data, v.space);
+    WriteU32(data, v.constantCount);
+    WriteU32(data, uint32_t(v.name.size()));
+    data.insert(data.end(), v.name.begin(), v.name.end());
+  }
+  return data;
+}
+
+bool ShaderReflectionData::Deserialize(const std::vector<char>& data)
+{
+  *this = ShaderReflectionData();
+  Reader reader(data);
+  char magic[sizeof(FileMagic)];
+  if (!reader.Bytes(magic, sizeof(magic)) || memcmp(magic, FileMagic, sizeof(FileMagic)) != 0 ||
+    reader.U32() != FileVersion)
+  {
+    return false;
+  }
+  shaderVersion = reader.U32();
+  inputParameters = reader.U32();
+  const auto count = reader.U32();
+  if (!reader.IsValid() || count > reader.GetRemaining() / ResourceHeaderSize)
+  {
+    *this = ShaderReflectionData();
+    return false;
+  }
+  resources.resize(count);
+  for (auto& v : resources)
+  {
+    v.type = reader.U32();
+    v.bindPoint = reader.U32();
+    v.bindCount = reader.U32();
+    v.space = reader.U32();
+    v.constantCount = reader.U32();
+    reader.String(v.name, reader.U32());
+  }
+  if (!reader.IsValid() || !reader.IsEnd())
+  {
+    *this = ShaderReflectionData();
+    return false;
+  }
+  return true;
+}
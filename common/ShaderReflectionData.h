@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ルートシグネチャを作るのに必要な分だけのリフレクション. D3D12 や DXC に依存しない.
+// 実行時にコンパイルしたものは ShaderCompiler::ReflectBindings で DXIL から作る.
+// 事前コンパイル済みのものは ShaderBuild が .refl に書き出し、 DXC を使わずに読み込む.
+struct ShaderReflectionData
+{
+  struct Resource
+  {
+    std::string name;
+    uint32_t type;            // D3D_SHADER_INPUT_TYPE.
+    uint32_t bindPoint;
+    uint32_t bindCount;       // 非有界配列は 0 または UINT_MAX.
+    uint32_t space;
+    uint32_t constantCount;   // 定数バッファのうち変数が使っている 32bit 値の数. 定数バッファ以外は 0.
+  };
+
+  uint32_t shaderVersion = 0;     // D3D12_SHADER_DESC::Version.
+  uint32_t inputParameters = 0;   // 頂点シェーダーなら入力レイアウトの要素数.
+  std::vector<Resource> resources;
+
+  std::vector<char> Serialize() const;
+  // 形式が異なる、壊れている場合は false.
+  bool Deserialize(const std::vector<char>& data);
+};
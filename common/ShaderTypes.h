@@ -0,0 +1,31 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+
+// シェーダーの種類とマクロ. D3D12 や DXC のヘッダを必要としない.
+// Shader はこれを継承するので、 Shader::Vertex や Shader::DefineMacro としても使える.
+struct ShaderTypes
+{
+  enum Stage
+  {
+    Vertex, Geometry, Pixel,
+    Domain, Hull,
+    Compute,
+  };
+
+  struct DefineMacro {
+    std::wstring Name;
+    std::wstring Value;
+  };
+};
+
+// Shader::load に渡す内容を 1 つにまとめたもの. ShaderCompileService が受け付ける.
+struct ShaderCompileRequest
+{
+  std::wstring fileName;
+  ShaderTypes::Stage stage;
+  std::wstring entryPoint;
+  std::vector<std::wstring> flags;
+  std::vector<ShaderTypes::DefineMacro> defines;
+  std::wstring shaderModel = L"6_0";
+};
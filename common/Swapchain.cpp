@@ -1,9 +1,10 @@
 #include "Swapchain.h"
+#include "CpuProfiler.h"
 
 Swapchain::Swapchain(
   ComPtr<IDXGISwapChain1> swapchain,
   std::shared_ptr<DescriptorManager>& heapRTV,
-  bool useHDR)
+  bool useHDR) : m_heapRTV(heapRTV)
 {
   swapchain.As(&m_swapchain); // IDXGISwapChain4 擾
   m_swapchain->GetDesc1(&m_desc);
@@ -13,18 +14,10 @@ Swapchain::Swapchain(
 
   m_images.resize(m_desc.BufferCount);
   m_imageRTV.resize(m_desc.BufferCount);
-  m_fences.resize(m_desc.BufferCount);
-  m_fenceValues.resize(m_desc.BufferCount);
-  m_waitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 
   HRESULT hr;
   for (UINT i = 0; i < m_desc.BufferCount; ++i)
   {
-    hr = device->CreateFence(
-      0, D3D12_FENCE_FLAG_NONE,
-      IID_PPV_ARGS(&m_fences[i]));
-    ThrowIfFailed(hr, "CreateFence s");
-
     m_imageRTV[i] = heapRTV->Alloc();
 
     // Swapchain C[W RTV .
@@ -62,7 +55,6 @@ Swapchain::~Swapchain() {
   {
     m_swapchain->SetFullscreenState(FALSE, nullptr);
   }
-  CloseHandle(m_waitEvent);
 }
 
 DescriptorHandle Swapchain::GetCurrentRTV() const
@@ -72,42 +64,40 @@ DescriptorHandle Swapchain::GetCurrentRTV() const
 
 HRESULT Swapchain::Present(UINT SyncInterval, UINT Flags)
 {
+  CPU_PROFILE_SCOPE("Present");
   return m_swapchain->Present(SyncInterval, Flags);
 }
 
 
-void Swapchain::WaitPreviousFrame(ComPtr<ID3D12CommandQueue> commandQueue, int frameIndex, DWORD timeout)
-{
-  auto fence = m_fences[frameIndex];
-  // ݂̃tFX GPU Bݒ肳lZbg.
-  auto value = ++m_fenceValues[frameIndex];
-  commandQueue->Signal(fence.Get(), value);
-
-  // t[ŏR}h̎sҋ@.
-  auto nextIndex = GetCurrentBackBufferIndex();
-  auto finishValue = m_fenceValues[nextIndex];
-  fence = m_fences[nextIndex];
-  value = fence->GetCompletedValue();
-  if (value < finishValue)
-  {
-    // ̂߃Cxgőҋ@.
-    fence->SetEventOnCompletion(finishValue, m_waitEvent);
-    WaitForSingleObject(m_waitEvent, timeout);
-  }
-}
-
-void Swapchain::ResizeBuffers(UINT width, UINT height)
+void Swapchain::ResizeBuffers(UINT width, UINT height, UINT bufferCount)
 {
   // TCŶ߂ɂ.
   for (auto& v : m_images) {
     v.Reset();
   }
+  if (bufferCount == 0)
+  {
+    bufferCount = m_desc.BufferCount;
+  }
   HRESULT hr = m_swapchain->ResizeBuffers(
-    m_desc.BufferCount,
+    bufferCount,
     width, height, m_desc.Format, m_desc.Flags
   );
   ThrowIfFailed(hr, "ResizeBuffers s");
 
+  // obt@̕ύXɍ킹 RTV 𑝌.
+  while (m_imageRTV.size() > bufferCount)
+  {
+    m_heapRTV->Free(m_imageRTV.back());
+    m_imageRTV.pop_back();
+  }
+  while (m_imageRTV.size() < bufferCount)
+  {
+    m_imageRTV.push_back(m_heapRTV->Alloc());
+  }
+  m_images.resize(bufferCount);
+  m_desc.BufferCount = bufferCount;
+
   // C[W蒼 RTV Đ.
   ComPtr<ID3D12Device> device;
   m_swapchain->GetDevice(IID_PPV_ARGS(&device));
@@ -30,12 +30,9 @@ public:
 
   HRESULT Present(UINT SyncInterval, UINT Flags);
 
-  // ̃R}hς߂悤ɂȂ܂őҋ@.
-  void WaitPreviousFrame(
-    ComPtr<ID3D12CommandQueue> commandQueue, 
-    int frameIndex, DWORD timeout);
-
-  void ResizeBuffers(UINT width, UINT height);
+  // bufferCount  0 ̎̓obt@ύXȂ.
+  void ResizeBuffers(UINT width, UINT height, UINT bufferCount = 0);
+  UINT GetBufferCount() const { return m_desc.BufferCount; }
 
   // ݂̃C[Wɑ΂ĕ`\oAݒ̎擾.
   CD3DX12_RESOURCE_BARRIER GetBarrierToRenderTarget();
@@ -55,11 +52,7 @@ private:
   ComPtr<IDXGISwapChain4> m_swapchain;
   std::vector<ComPtr<ID3D12Resource1>> m_images;
   std::vector<DescriptorHandle> m_imageRTV;
-
-  std::vector<UINT64> m_fenceValues;
-  std::vector<ComPtr<ID3D12Fence1>> m_fences;
+  std::shared_ptr<DescriptorManager> m_heapRTV;
 
   DXGI_SWAP_CHAIN_DESC1 m_desc;
-
-  HANDLE m_waitEvent;
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+﻿#include "TimelineFence.h"
+
+TimelineFence::TimelineFence(ComPtr<ID3D12Device> device, const wchar_t* name)
+  : m_lastSignaled(0), m_lastCompleted(0)
+{
+  HRESULT hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+  ThrowIfFailed(hr, "CreateFence failed.(TimelineFence)");
+  if (name)
+  {
+    m_fence->SetName(name);
+  }
+}
+
+UINT64 TimelineFence::Signal(ComPtr<ID3D12CommandQueue> commandQueue)
+{
+  const auto value = ++m_lastSignaled;
+  HRESULT hr = commandQueue->Signal(m_fence.Get(), value);
+  ThrowIfFailed(hr, "Signal failed.(TimelineFence)");
+  return value;
+}
+
+void TimelineFence::Wait(UINT64 value, DWORD timeout)
+{
+  if (IsCompleted(value))
+  {
+    return;
+  }
+  // 複数のスレッドが同時に待てるよう、イベントは待機毎に作る.
+  HANDLE waitEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (waitEvent == NULL)
+  {
+    throw book_util::DX12Exception("CreateEvent failed.(TimelineFence)");
+  }
+  HRESULT hr = m_fence->SetEventOnCompletion(value, waitEvent);
+  DWORD result = SUCCEEDED(hr) ? WaitForSingleObject(waitEvent, timeout) : WAIT_FAILED;
+  CloseHandle(waitEvent);
+  ThrowIfFailed(hr, "SetEventOnCompletion failed.(TimelineFence)");
+
+  // 完了したものとして戻ると、 GPU が使用中のアロケータやリングの領域を再利用してしまう.
+  if (result != WAIT_OBJECT_0 || !IsCompleted(value))
+  {
+    throw book_util::DX12Exception(result == WAIT_TIMEOUT ?
+      "fence wait timed out.(TimelineFence)" : "fence wait failed.(TimelineFence)");
+  }
+}
+
+void TimelineFence::WaitOnQueue(ComPtr<ID3D12CommandQueue> commandQueue, UINT64 value)
+{
+  commandQueue->Wait(m_fence.Get(), value);
+}
+
+bool TimelineFence::IsCompleted(UINT64 value)
+{
+  if (value <= m_lastCompleted)
+  {
+    return true;
+  }
+  return GetCompletedValue() >= value;
+}
+
+UINT64 TimelineFence::GetCompletedValue()
+{
+  const auto completed = m_fence->GetCompletedValue();
+  // 別のスレッドがより新しい値を書いていれば戻さない.
+  auto last = m_lastCompleted.load();
+  while (last < completed && !m_lastCompleted.compare_exchange_weak(last, completed))
+  {
+  }
+  return completed;
+}
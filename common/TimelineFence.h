@@ -0,0 +1,78 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <atomic>
+#include <deque>
+
+#include "D3D12BookUtil.h"
+
+// キュー毎に 1 つ持つ、単調増加する値で進行を表すフェンス.
+// 待機はイベントで行い、 CPU をスピンさせない. 完了の確認と待機は複数のスレッドから呼んでよい.
+class TimelineFence
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  TimelineFence(ComPtr<ID3D12Device> device, const wchar_t* name = nullptr);
+
+  // 次の値でキューに Signal を積み、その値を返す.
+  UINT64 Signal(ComPtr<ID3D12CommandQueue> commandQueue);
+
+  // 指定値に到達するまで CPU を待機させる. 時間切れや失敗では例外を投げる.
+  void Wait(UINT64 value, DWORD timeout = INFINITE);
+  // 指定値に到達するまで別キューの GPU 側を待機させる.
+  void WaitOnQueue(ComPtr<ID3D12CommandQueue> commandQueue, UINT64 value);
+
+  bool IsCompleted(UINT64 value);
+  UINT64 GetCompletedValue();
+
+  UINT64 GetLastSignaledValue() const { return m_lastSignaled; }
+  // これから Signal される値. 発行前のコマンドが参照するリソースの解放待ちに使う.
+  UINT64 GetNextValue() const { return m_lastSignaled + 1; }
+
+  ComPtr<ID3D12Fence1> GetFence() const { return m_fence; }
+private:
+  ComPtr<ID3D12Fence1> m_fence;
+  std::atomic<UINT64> m_lastSignaled;
+  std::atomic<UINT64> m_lastCompleted;
+};
+
+// フェンス値をキーにしてオブジェクトの解放を遅延させるキュー.
+// GPU が参照し終えるまで ComPtr の参照を保持する.
+class DeferredReleaseQueue
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  // fenceValue は単調増加で積むこと.
+  void Push(ComPtr<IUnknown> object, UINT64 fenceValue)
+  {
+    m_entries.push_back(Entry{ fenceValue, object });
+  }
+  template<class T>
+  void Push(const ComPtr<T>& object, UINT64 fenceValue)
+  {
+    ComPtr<IUnknown> unknown;
+    object.As(&unknown);
+    Push(unknown, fenceValue);
+  }
+
+  void Collect(UINT64 completedValue)
+  {
+    while (!m_entries.empty() && m_entries.front().fenceValue <= completedValue)
+    {
+      m_entries.pop_front();
+    }
+  }
+
+  size_t GetCount() const { return m_entries.size(); }
+private:
+  struct Entry
+  {
+    UINT64 fenceValue;
+    ComPtr<IUnknown> object;
+  };
+  std::deque<Entry> m_entries;
+};
@@ -0,0 +1,102 @@
+﻿#include "TrackedResource.h"
+#include <vector>
+
+TrackedResource::TrackedResource(ComPtr<ID3D12Resource1> resource, std::shared_ptr<ResourceStateTracker> tracker, D3D12_RESOURCE_STATES initialState)
+  : m_resource(resource), m_tracker(tracker)
+{
+  ComPtr<ID3D12Device> device;
+  m_resource->GetDevice(IID_PPV_ARGS(&device));
+  CD3DX12_RESOURCE_DESC desc(m_resource->GetDesc());
+  m_tracker->Register(m_resource.Get(), desc.Subresources(device.Get()), initialState);
+}
+
+TrackedResource::~TrackedResource()
+{
+  Reset();
+}
+
+TrackedResource::TrackedResource(TrackedResource&& other) noexcept
+  : m_resource(std::move(other.m_resource)), m_tracker(std::move(other.m_tracker))
+{
+}
+
+TrackedResource& TrackedResource::operator=(TrackedResource&& other) noexcept
+{
+  if (this != &other)
+  {
+    Reset();
+    m_resource = std::move(other.m_resource);
+    m_tracker = std::move(other.m_tracker);
+  }
+  return *this;
+}
+
+void TrackedResource::Reset()
+{
+  if (m_tracker && m_resource)
+  {
+    m_tracker->Unregister(m_resource.Get());
+  }
+  m_resource.Reset();
+  m_tracker.reset();
+}
+
+UINT TrackedResource::GetSubresource(UINT mipSlice, UINT arraySlice, UINT planeSlice) const
+{
+  auto desc = m_resource->GetDesc();
+  const UINT arraySize = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+  return D3D12CalcSubresource(mipSlice, arraySlice, planeSlice, desc.MipLevels, arraySize);
+}
+
+UINT TrackedResource::GetSubresourceCount() const
+{
+  return m_tracker->GetSubresourceCount(m_resource.Get());
+}
+
+void TrackedResource::Transition(D3D12_RESOURCE_STATES state, UINT subresource)
+{
+  m_tracker->Transition(m_resource.Get(), subresource, state);
+}
+
+void TrackedResource::UAVBarrier()
+{
+  m_tracker->UAVBarrier(m_resource.Get());
+}
+
+D3D12_RESOURCE_STATES TrackedResource::GetState(UINT subresource) const
+{
+  return D3D12_RESOURCE_STATES(m_tracker->GetState(m_resource.Get(), subresource));
+}
+
+void TrackedResource::SetState(D3D12_RESOURCE_STATES state, UINT subresource)
+{
+  m_tracker->SetState(m_resource.Get(), subresource, state);
+}
+
+void TrackedResource::FlushBarriers(ResourceStateTracker& tracker, ID3D12GraphicsCommandList* command)
+{
+  if (!tracker.HasPending())
+  {
+    return;
+  }
+  std::vector<D3D12_RESOURCE_BARRIER> barriers;
+  for (const auto& v : tracker.Flush())
+  {
+    // キーは登録したリソースのポインタ.
+    auto resource = static_cast<ID3D12Resource*>(const_cast<void*>(v.resource));
+    if (v.type == ResourceStateTracker::Barrier_UAV)
+    {
+      barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+      continue;
+    }
+    barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+      resource,
+      D3D12_RESOURCE_STATES(v.before),
+      D3D12_RESOURCE_STATES(v.after),
+      v.subresource));
+  }
+  if (!barriers.empty())
+  {
+    command->ResourceBarrier(UINT(barriers.size()), barriers.data());
+  }
+}
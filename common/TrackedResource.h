@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <memory>
+
+#include "d3dx12.h"
+#include "ResourceStateTracker.h"
+
+// 状態を ResourceStateTracker に記録するリソース.
+// Transition で必要な遷移だけが積まれ、FlushBarriers でまとめて発行される.
+class TrackedResource
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+  static const UINT AllSubresources = ResourceStateTracker::AllSubresources;
+
+  TrackedResource() = default;
+  TrackedResource(ComPtr<ID3D12Resource1> resource, std::shared_ptr<ResourceStateTracker> tracker, D3D12_RESOURCE_STATES initialState);
+  ~TrackedResource();
+
+  TrackedResource(const TrackedResource&) = delete;
+  TrackedResource& operator=(const TrackedResource&) = delete;
+  TrackedResource(TrackedResource&& other) noexcept;
+  TrackedResource& operator=(TrackedResource&& other) noexcept;
+
+  // 追跡をやめてリソースを手放す.
+  void Reset();
+
+  ID3D12Resource1* Get() const { return m_resource.Get(); }
+  const ComPtr<ID3D12Resource1>& GetResource() const { return m_resource; }
+  explicit operator bool() const { return m_resource != nullptr; }
+
+  // サブリソース番号は D3D12CalcSubresource (キューブマップの各面は配列スライス)で求める.
+  UINT GetSubresource(UINT mipSlice, UINT arraySlice, UINT planeSlice = 0) const;
+  UINT GetSubresourceCount() const;
+
+  void Transition(D3D12_RESOURCE_STATES state, UINT subresource = AllSubresources);
+  void UAVBarrier();
+  D3D12_RESOURCE_STATES GetState(UINT subresource = 0) const;
+  // 他所で記録したバリアによる状態の変化を反映する.
+  void SetState(D3D12_RESOURCE_STATES state, UINT subresource = AllSubresources);
+
+  // tracker に積まれた遷移を 1 回の ResourceBarrier で記録する.
+  static void FlushBarriers(ResourceStateTracker& tracker, ID3D12GraphicsCommandList* command);
+private:
+  ComPtr<ID3D12Resource1> m_resource;
+  std::shared_ptr<ResourceStateTracker> m_tracker;
+};
@@ -0,0 +1,122 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 寿命(使用するパスの区間)が重ならないリソース同士で同じメモリを共有させる配置計画.
+// 結果のオフセットは 1 つのヒープ先頭からの位置で、 GPU リソースには依存しない.
+class TransientAliasPlanner
+{
+public:
+  struct Request
+  {
+    uint64_t size;
+    uint64_t alignment;
+    uint32_t firstPass; // 最初に使用するパス番号.
+    uint32_t lastPass;  // 最後に使用するパス番号.
+  };
+
+  // 登録順のインデックスを返す.
+  uint32_t Add(const Request& request)
+  {
+    m_requests.push_back(request);
+    return uint32_t(m_requests.size() - 1);
+  }
+
+  // 各リクエストのオフセットを決定し、必要なヒープサイズを返す.
+  uint64_t Plan()
+  {
+    m_offsets.assign(m_requests.size(), 0);
+    std::vector<uint32_t> order(m_requests.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+      order[i] = i;
+    }
+    // 大きいものから配置する.
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return m_requests[a].size > m_requests[b].size;
+    });
+
+    std::vector<uint32_t> placed;
+    uint64_t heapSize = 0;
+    for (auto index : order)
+    {
+      const auto& req = m_requests[index];
+      // 寿命が重なる配置済みリソースを避けた、最も低いオフセットを探す.
+      uint64_t offset = 0;
+      bool moved = true;
+      while (moved)
+      {
+        moved = false;
+        offset = AlignUp(offset, req.alignment);
+        for (auto other : placed)
+        {
+          const auto& o = m_requests[other];
+          const bool overlapLifetime = req.firstPass <= o.lastPass && o.firstPass <= req.lastPass;
+          const bool overlapMemory = offset < m_offsets[other] + o.size && m_offsets[other] < offset + req.size;
+          if (overlapLifetime && overlapMemory)
+          {
+            offset = m_offsets[other] + o.size;
+            moved = true;
+          }
+        }
+      }
+      m_offsets[index] = offset;
+      placed.push_back(index);
+      heapSize = std::max(heapSize, offset + req.size);
+    }
+    return heapSize;
+  }
+
+  uint64_t GetOffset(uint32_t index) const { return m_offsets[index]; }
+
+  // 他で決めた配置が登録済みのリクエストを満たすか調べる.
+  // 境界に合っていて heapSize に収まり、寿命が重なるもの同士でメモリが重ならないこと.
+  bool IsValidPlacement(const std::vector<uint64_t>& offsets, uint64_t heapSize) const
+  {
+    if (offsets.size() != m_requests.size())
+    {
+      return false;
+    }
+    for (size_t i = 0; i < m_requests.size(); ++i)
+    {
+      const auto& req = m_requests[i];
+      if (offsets[i] % req.alignment != 0 || offsets[i] + req.size > heapSize)
+      {
+        return false;
+      }
+      for (size_t j = 0; j < i; ++j)
+      {
+        const auto& o = m_requests[j];
+        const bool overlapLifetime = req.firstPass <= o.lastPass && o.firstPass <= req.lastPass;
+        const bool overlapMemory = offsets[i] < offsets[j] + o.size && offsets[j] < offsets[i] + req.size;
+        if (overlapLifetime && overlapMemory)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+  size_t GetCount() const { return m_requests.size(); }
+
+  // エイリアスせずに個別に確保した場合の合計サイズ.
+  uint64_t GetUnaliasedSize() const
+  {
+    uint64_t total = 0;
+    for (const auto& v : m_requests)
+    {
+      total = AlignUp(total, v.alignment) + v.size;
+    }
+    return total;
+  }
+
+private:
+  static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  std::vector<Request> m_requests;
+  std::vector<uint64_t> m_offsets;
+};
@@ -0,0 +1,154 @@
+﻿#include "UploadQueue.h"
+#include <algorithm>
+#include <cstring>
+
+UploadQueue::UploadQueue(ComPtr<ID3D12Device> device)
+  : m_device(device), m_fence(device, L"UploadQueueFence"), m_isRecording(false)
+{
+  HRESULT hr;
+  D3D12_COMMAND_QUEUE_DESC queueDesc{
+    D3D12_COMMAND_LIST_TYPE_COPY,
+    0,
+    D3D12_COMMAND_QUEUE_FLAG_NONE,
+    0
+  };
+  hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue));
+  ThrowIfFailed(hr, "CreateCommandQueue failed.(Copy)");
+  m_copyQueue->SetName(L"UploadQueue");
+}
+
+UploadQueue::~UploadQueue()
+{
+  if (m_isRecording)
+  {
+    m_commandList->Close();
+  }
+  WaitOnCpu(m_fence.GetLastSignaledValue());
+}
+
+void UploadQueue::UploadBuffer(ID3D12Resource* destination, const void* data, UINT64 size)
+{
+  auto staging = CreateStagingBuffer(size);
+  void* mapped;
+  HRESULT hr = staging->Map(0, nullptr, &mapped);
+  ThrowIfFailed(hr, "Map failed.(UploadQueue)");
+  memcpy(mapped, data, size_t(size));
+  staging->Unmap(0, nullptr);
+
+  BeginRecording();
+  m_commandList->CopyBufferRegion(destination, 0, staging.Get(), 0, size);
+  m_recordingStaging.push_back(staging);
+}
+
+void UploadQueue::UploadTexture(ID3D12Resource* destination, const D3D12_SUBRESOURCE_DATA* subresources, UINT subresourceCount)
+{
+  const auto totalBytes = GetRequiredIntermediateSize(destination, 0, subresourceCount);
+  auto staging = CreateStagingBuffer(totalBytes);
+
+  BeginRecording();
+  UpdateSubresources(m_commandList.Get(),
+    destination, staging.Get(), 0, 0, subresourceCount, subresources);
+  m_recordingStaging.push_back(staging);
+}
+
+UploadQueue::Token UploadQueue::Submit()
+{
+  ReleaseCompleted();
+  if (!m_isRecording)
+  {
+    return m_fence.GetLastSignaledValue();
+  }
+
+  m_commandList->Close();
+  ID3D12CommandList* lists[] = { m_commandList.Get() };
+  m_copyQueue->ExecuteCommandLists(1, lists);
+
+  const auto token = m_fence.Signal(m_copyQueue);
+
+  m_allocators.push_back(InFlightAllocator{ m_currentAllocator, token });
+  m_currentAllocator.Reset();
+  for (auto& v : m_recordingStaging)
+  {
+    m_stagingRelease.Push(v, token);
+  }
+  m_recordingStaging.clear();
+  m_isRecording = false;
+  return token;
+}
+
+void UploadQueue::WaitOnQueue(ComPtr<ID3D12CommandQueue> commandQueue, Token token)
+{
+  m_fence.WaitOnQueue(commandQueue, token);
+}
+
+void UploadQueue::WaitOnCpu(Token token)
+{
+  m_fence.Wait(token);
+  ReleaseCompleted();
+}
+
+bool UploadQueue::IsCompleted(Token token)
+{
+  return m_fence.IsCompleted(token);
+}
+
+void UploadQueue::ReleaseCompleted()
+{
+  m_stagingRelease.Collect(m_fence.GetCompletedValue());
+}
+
+void UploadQueue::BeginRecording()
+{
+  if (m_isRecording)
+  {
+    return;
+  }
+
+  // 完了済みのアロケータがあれば再利用する.
+  const auto completed = m_fence.GetCompletedValue();
+  auto itr = std::find_if(m_allocators.begin(), m_allocators.end(),
+    [=](const InFlightAllocator& v) { return v.token <= completed; });
+  HRESULT hr;
+  if (itr != m_allocators.end())
+  {
+    m_currentAllocator = itr->allocator;
+    m_allocators.erase(itr);
+    m_currentAllocator->Reset();
+  }
+  else
+  {
+    hr = m_device->CreateCommandAllocator(
+      D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_currentAllocator));
+    ThrowIfFailed(hr, "CreateCommandAllocator failed.(Copy)");
+  }
+
+  if (!m_commandList)
+  {
+    hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY,
+      m_currentAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList));
+    ThrowIfFailed(hr, "CreateCommandList failed.(Copy)");
+    m_commandList->SetName(L"UploadCommand");
+  }
+  else
+  {
+    m_commandList->Reset(m_currentAllocator.Get(), nullptr);
+  }
+  m_isRecording = true;
+}
+
+UploadQueue::ComPtr<ID3D12Resource1> UploadQueue::CreateStagingBuffer(UINT64 size)
+{
+  ComPtr<ID3D12Resource1> staging;
+  const auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  const auto resDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+  HRESULT hr = m_device->CreateCommittedResource(
+    &heapProps,
+    D3D12_HEAP_FLAG_NONE,
+    &resDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    nullptr,
+    IID_PPV_ARGS(&staging)
+  );
+  ThrowIfFailed(hr, "CreateCommittedResource failed.(Staging)");
+  return staging;
+}
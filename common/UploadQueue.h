@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+
+#include "D3D12BookUtil.h"
+#include "TimelineFence.h"
+
+// COPY キューを使ってバッファ・テクスチャの転送をまとめて発行するクラス.
+// 転送先リソースは COMMON (またはCOPY_DEST) で作成しておくこと.
+// COPY キューで扱ったリソースは完了後に COMMON へ戻るため、
+// DIRECT キュー側では暗黙のステート昇格で SRV や頂点バッファとして使える.
+class UploadQueue
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  // 発行した転送の完了を表すトークン(フェンス値).
+  using Token = UINT64;
+
+  UploadQueue(ComPtr<ID3D12Device> device);
+  ~UploadQueue();
+
+  // データはステージングバッファへ即座にコピーされるため、呼び出し後に破棄してよい.
+  void UploadBuffer(ID3D12Resource* destination, const void* data, UINT64 size);
+  void UploadTexture(ID3D12Resource* destination,
+    const D3D12_SUBRESOURCE_DATA* subresources, UINT subresourceCount);
+
+  // 記録済みの転送を COPY キューへ発行する.
+  Token Submit();
+
+  // 指定キューの GPU 側で転送完了を待たせる. CPU はブロックしない.
+  void WaitOnQueue(ComPtr<ID3D12CommandQueue> commandQueue, Token token);
+  void WaitOnCpu(Token token);
+  bool IsCompleted(Token token);
+
+  // 転送の完了したステージングバッファを解放する.
+  void ReleaseCompleted();
+
+  bool HasPendingUploads() const { return m_isRecording; }
+  Token GetLastSubmittedToken() const { return m_fence.GetLastSignaledValue(); }
+
+  ComPtr<ID3D12CommandQueue> GetCommandQueue() const { return m_copyQueue; }
+private:
+  void BeginRecording();
+  ComPtr<ID3D12Resource1> CreateStagingBuffer(UINT64 size);
+
+  struct InFlightAllocator
+  {
+    ComPtr<ID3D12CommandAllocator> allocator;
+    Token token;
+  };
+
+  ComPtr<ID3D12Device> m_device;
+  ComPtr<ID3D12CommandQueue> m_copyQueue;
+  ComPtr<ID3D12GraphicsCommandList> m_commandList;
+  ComPtr<ID3D12CommandAllocator> m_currentAllocator;
+  std::vector<InFlightAllocator> m_allocators;
+  std::vector<ComPtr<ID3D12Resource1>> m_recordingStaging;
+
+  TimelineFence m_fence;
+  DeferredReleaseQueue m_stagingRelease;
+  bool m_isRecording;
+};
@@ -0,0 +1,78 @@
+﻿#include "UploadRingBuffer.h"
+#include <cstring>
+
+UploadRingBuffer::UploadRingBuffer(ComPtr<ID3D12Device> device, UINT64 size, std::shared_ptr<TimelineFence> fence)
+  : m_fence(fence), m_mapped(nullptr), m_allocator(size)
+{
+  HRESULT hr;
+  const auto heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  const auto resDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+  hr = device->CreateCommittedResource(
+    &heapProps,
+    D3D12_HEAP_FLAG_NONE,
+    &resDesc,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    nullptr,
+    IID_PPV_ARGS(&m_buffer)
+  );
+  ThrowIfFailed(hr, "CreateCommittedResource failed.(UploadRingBuffer)");
+  m_buffer->SetName(L"UploadRingBuffer");
+
+  // アップロードヒープは Map したままでよいので、破棄まで Unmap しない.
+  CD3DX12_RANGE readRange(0, 0);
+  hr = m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_mapped));
+  ThrowIfFailed(hr, "Map failed.(UploadRingBuffer)");
+  m_gpuAddress = m_buffer->GetGPUVirtualAddress();
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+  if (m_mapped)
+  {
+    m_buffer->Unmap(0, nullptr);
+  }
+}
+
+UploadRingBuffer::Allocation UploadRingBuffer::Allocate(UINT64 size, UINT64 alignment)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_allocator.ReleaseCompleted(m_fence->GetCompletedValue());
+
+  auto offset = m_allocator.Allocate(size, alignment);
+  while (offset == RingAllocator::InvalidOffset)
+  {
+    // 空きが無いので、最も古いフレームの完了を待つ.
+    WaitForSpace();
+    offset = m_allocator.Allocate(size, alignment);
+  }
+
+  Allocation ret;
+  ret.cpuAddress = m_mapped + offset;
+  ret.gpuAddress = m_gpuAddress + offset;
+  ret.offset = offset;
+  ret.size = size;
+  return ret;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS UploadRingBuffer::Write(const void* data, UINT64 size)
+{
+  auto allocation = Allocate(size);
+  memcpy(allocation.cpuAddress, data, size_t(size));
+  return allocation.gpuAddress;
+}
+
+void UploadRingBuffer::FinishFrame(UINT64 fenceValue)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_allocator.FinishFrame(fenceValue);
+}
+
+void UploadRingBuffer::WaitForSpace()
+{
+  if (!m_allocator.HasPendingFrames())
+  {
+    throw std::runtime_error("UploadRingBuffer overflow.");
+  }
+  m_fence->Wait(m_allocator.GetOldestPendingFenceValue());
+  m_allocator.ReleaseCompleted(m_fence->GetCompletedValue());
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <memory>
+#include <mutex>
+
+#include "RingAllocator.h"
+#include "TimelineFence.h"
+#include "D3D12BookUtil.h"
+
+// 常時 Map したままのアップロードヒープから定数バッファ等を切り出すクラス.
+// 毎フレームの Map/Unmap とフレーム数分のバッファ生成を不要にする.
+class UploadRingBuffer
+{
+public:
+  template<class T>
+  using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+  struct Allocation
+  {
+    void* cpuAddress;
+    D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+    UINT64 offset;
+    UINT64 size;
+  };
+
+  // fence には描画に使うキューのタイムラインフェンスを渡す.
+  UploadRingBuffer(ComPtr<ID3D12Device> device, UINT64 size, std::shared_ptr<TimelineFence> fence);
+  ~UploadRingBuffer();
+
+  // 定数バッファとして使えるよう 256 バイト境界で確保する.
+  // 並列記録中のワーカースレッドから呼び出してよい.
+  Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+  // データを書き込んで GPU アドレスを返す.
+  D3D12_GPU_VIRTUAL_ADDRESS Write(const void* data, UINT64 size);
+  template<class T>
+  D3D12_GPU_VIRTUAL_ADDRESS Write(const T& data)
+  {
+    return Write(&data, sizeof(T));
+  }
+
+  // フレームのコマンド発行後に呼び出し、確保済み領域を Signal したフェンス値に紐付ける.
+  void FinishFrame(UINT64 fenceValue);
+
+  ComPtr<ID3D12Resource1> GetResource() const { return m_buffer; }
+  UINT64 GetUsedSize() const { return m_allocator.GetUsedSize(); }
+  UINT64 GetCapacity() const { return m_allocator.GetCapacity(); }
+
+private:
+  void WaitForSpace();
+
+  ComPtr<ID3D12Resource1> m_buffer;
+  std::shared_ptr<TimelineFence> m_fence;
+
+  UINT8* m_mapped;
+  D3D12_GPU_VIRTUAL_ADDRESS m_gpuAddress;
+  RingAllocator m_allocator;
+  std::mutex m_mutex;
+};
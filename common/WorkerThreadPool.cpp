@@ -0,0 +1,133 @@
+﻿#include "WorkerThreadPool.h"
+#include "CpuProfiler.h"
+
+WorkerThreadPool::WorkerThreadPool(uint32_t threadCount)
+  : m_func(nullptr), m_count(0), m_next(0), m_finished(0), m_isTerminating(false)
+{
+  if (threadCount == 0)
+  {
+    const auto cores = std::thread::hardware_concurrency();
+    threadCount = cores > 1 ? cores - 1 : 1;
+  }
+  for (uint32_t i = 0; i < threadCount; ++i)
+  {
+    m_threads.emplace_back([this, i]() {
+      CPU_PROFILE_THREAD_NAME("Worker " + std::to_string(i));
+      WorkerMain();
+    });
+  }
+}
+
+WorkerThreadPool::~WorkerThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isTerminating = true;
+  }
+  m_wakeWorkers.notify_all();
+  for (auto& v : m_threads)
+  {
+    v.join();
+  }
+}
+
+void WorkerThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_func = &func;
+  m_count = count;
+  m_next = 0;
+  m_finished = 0;
+  m_exception = nullptr;
+  m_wakeWorkers.notify_all();
+
+  // 呼び出し元も処理に加わる.
+  while (RunOne(lock))
+  {
+  }
+  m_jobFinished.wait(lock, [this]() { return m_finished == m_count; });
+
+  m_func = nullptr;
+  m_count = 0;
+  auto exception = m_exception;
+  m_exception = nullptr;
+  lock.unlock();
+
+  if (exception)
+  {
+    std::rethrow_exception(exception);
+  }
+}
+
+void WorkerThreadPool::Submit(std::function<void()> job)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(job));
+  }
+  m_wakeWorkers.notify_one();
+}
+
+void WorkerThreadPool::WorkerMain()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_wakeWorkers.wait(lock, [this]() { return m_isTerminating || m_next < m_count || !m_jobs.empty(); });
+    // 完了を待っている呼び出し元がいる ParallelFor を先に片付ける.
+    if (RunOne(lock))
+    {
+      continue;
+    }
+    if (!m_jobs.empty())
+    {
+      auto job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      lock.unlock();
+      job();
+      lock.lock();
+      continue;
+    }
+    // 終了要求があっても、積まれた分は処理してから抜ける.
+    if (m_isTerminating)
+    {
+      break;
+    }
+  }
+}
+
+bool WorkerThreadPool::RunOne(std::unique_lock<std::mutex>& lock)
+{
+  if (m_func == nullptr || m_next >= m_count)
+  {
+    return false;
+  }
+  const auto index = m_next++;
+  const auto& func = *m_func;
+
+  lock.unlock();
+  std::exception_ptr exception;
+  try
+  {
+    func(index);
+  }
+  catch (...)
+  {
+    exception = std::current_exception();
+  }
+  lock.lock();
+
+  if (exception && !m_exception)
+  {
+    m_exception = exception;
+  }
+  if (++m_finished == m_count)
+  {
+    m_jobFinished.notify_all();
+  }
+  return true;
+}
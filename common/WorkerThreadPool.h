@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数のワーカースレッドで処理を分担するスレッドプール.
+// ParallelFor は呼び出し元のスレッドも処理に加わり、全ての完了を待って戻る.
+// Submit は待たずに戻り、空いたワーカーが積まれた順に処理する.
+class WorkerThreadPool
+{
+public:
+  // threadCount が 0 の時は (論理コア数 - 1) とする.
+  explicit WorkerThreadPool(uint32_t threadCount = 0);
+  ~WorkerThreadPool();
+
+  // func(index) を index = 0 ～ count-1 について並列に実行する.
+  // 処理中に投げられた例外は最初の 1 つを呼び出し元で再送出する.
+  void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+  // job を後で実行する. 完了の通知や例外の受け渡しは job の側で行うこと(std::packaged_task など).
+  // 破棄する時は積まれている分を全て実行してから終わる.
+  void Submit(std::function<void()> job);
+
+  uint32_t GetThreadCount() const { return uint32_t(m_threads.size()); }
+
+private:
+  void WorkerMain();
+  // 未処理の項目を 1 つ取り出して実行する. 残りが無ければ false.
+  bool RunOne(std::unique_lock<std::mutex>& lock);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeWorkers;
+  std::condition_variable m_jobFinished;
+
+  const std::function<void(uint32_t)>* m_func;
+  uint32_t m_count;
+  uint32_t m_next;
+  uint32_t m_finished;
+  std::exception_ptr m_exception;
+  std::deque<std::function<void()>> m_jobs;
+  bool m_isTerminating;
+};
@@ -0,0 +1,94 @@
+﻿#include "TestUtil.h"
+#include "BuddyAllocator.h"
+
+TEST_CASE(SplitsAndCoalescesBlocks)
+{
+  BuddyAllocator allocator(1024, 64);
+  auto a = allocator.Allocate(64, 64);
+  auto b = allocator.Allocate(64, 64);
+  auto c = allocator.Allocate(200, 64);  // 256 のブロック.
+  CHECK_EQUAL(0ull, a);
+  CHECK_EQUAL(64ull, b);
+  CHECK_EQUAL(256ull, c);
+  CHECK_EQUAL(384ull, allocator.GetUsedSize());
+  CHECK_EQUAL(328ull, allocator.GetRequestedSize());
+  CHECK_EQUAL(512ull, allocator.GetLargestFreeBlock());
+
+  allocator.Free(a);
+  allocator.Free(b);
+  allocator.Free(c);
+  CHECK(allocator.IsEmpty());
+  // 全て結合されて 1 つのブロックに戻る.
+  CHECK_EQUAL(1024ull, allocator.GetLargestFreeBlock());
+  CHECK_EQUAL(0.0f, allocator.GetFragmentation());
+  CHECK_EQUAL(384ull, allocator.GetPeakUsedSize());
+}
+
+TEST_CASE(HonorsAlignment)
+{
+  BuddyAllocator allocator(4096, 64);
+  allocator.Allocate(64, 64);
+  // 小さくてもアライメント分のブロックを使うので、境界に揃う.
+  auto offset = allocator.Allocate(64, 1024);
+  CHECK_EQUAL(1024ull, offset);
+  CHECK_EQUAL(0ull, offset % 1024);
+}
+
+TEST_CASE(ReportsFragmentation)
+{
+  BuddyAllocator allocator(1024, 256);
+  auto a = allocator.Allocate(256, 256);
+  auto b = allocator.Allocate(256, 256);
+  auto c = allocator.Allocate(256, 256);
+  allocator.Allocate(256, 256);
+  allocator.Free(a);
+  allocator.Free(c);
+  // 空きは 512 だが、連続した最大は 256.
+  CHECK_EQUAL(256ull, allocator.GetLargestFreeBlock());
+  CHECK_EQUAL(0.5f, allocator.GetFragmentation());
+  CHECK_EQUAL(BuddyAllocator::InvalidOffset, allocator.Allocate(512, 256));
+  allocator.Free(b);
+  CHECK_EQUAL(0ull, allocator.Allocate(512, 256));
+}
+
+TEST_CASE(FailsWhenFull)
+{
+  BuddyAllocator allocator(256, 64);
+  CHECK_EQUAL(BuddyAllocator::InvalidOffset, allocator.Allocate(0, 64));
+  CHECK_EQUAL(BuddyAllocator::InvalidOffset, allocator.Allocate(512, 64));
+  CHECK_EQUAL(0ull, allocator.Allocate(256, 64));
+  CHECK_EQUAL(BuddyAllocator::InvalidOffset, allocator.Allocate(64, 64));
+  // 確保していないオフセットの解放は無視する.
+  allocator.Free(128);
+  CHECK_EQUAL(1u, allocator.GetAllocationCount());
+}
+
+TEST_CASE(HandlesNonPowerOfTwoCapacity)
+{
+  // 6 ブロック分は 256 + 128 の 2 つのブロックとして管理し、範囲外には配置しない.
+  BuddyAllocator allocator(384 + 32, 64);
+  CHECK_EQUAL(384ull, allocator.GetCapacity());
+  CHECK_EQUAL(256ull, allocator.GetLargestFreeBlock());
+  CHECK_EQUAL(BuddyAllocator::InvalidOffset, allocator.Allocate(384, 64));
+
+  std::vector<uint64_t> offsets;
+  for (;;)
+  {
+    auto offset = allocator.Allocate(64, 64);
+    if (offset == BuddyAllocator::InvalidOffset)
+    {
+      break;
+    }
+    CHECK(offset + 64 <= 384);
+    offsets.push_back(offset);
+  }
+  CHECK_EQUAL(size_t(6), offsets.size());
+  for (auto v : offsets)
+  {
+    allocator.Free(v);
+  }
+  // 容量を越えて結合しない.
+  CHECK_EQUAL(256ull, allocator.GetLargestFreeBlock());
+  CHECK_EQUAL(256ull, allocator.Allocate(128, 64));
+  CHECK_EQUAL(0ull, allocator.Allocate(256, 64));
+}
@@ -0,0 +1,89 @@
+﻿#include "TestUtil.h"
+#include "CpuProfiler.h"
+#include <thread>
+
+namespace
+{
+  size_t CountOccurrences(const std::string& text, const std::string& pattern)
+  {
+    size_t count = 0;
+    for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+    {
+      count++;
+    }
+    return count;
+  }
+}
+
+TEST_CASE(ComputesPercentilesPerZone)
+{
+  auto& profiler = CpuProfiler::Get();
+  profiler.Clear();
+  const auto base = CpuProfiler::Now();
+  for (uint64_t i = 1; i <= 100; ++i)
+  {
+    profiler.Record("Update", base, base + i * 1000000);
+  }
+  profiler.Record("Draw", base, base + 500000);
+
+  auto stats = profiler.ComputeStats();
+  CHECK_EQUAL(size_t(2), stats.size());
+  // 名前順.
+  CHECK(stats[0].name == "Draw");
+  CHECK_EQUAL(1ull, stats[0].count);
+  CHECK_EQUAL(0.5, stats[0].maxMs);
+  CHECK(stats[1].name == "Update");
+  CHECK_EQUAL(100ull, stats[1].count);
+  CHECK_EQUAL(50.0, stats[1].p50Ms);
+  CHECK_EQUAL(95.0, stats[1].p95Ms);
+  CHECK_EQUAL(99.0, stats[1].p99Ms);
+  CHECK_EQUAL(100.0, stats[1].maxMs);
+}
+
+TEST_CASE(ExportsChromeTraceEvents)
+{
+  auto& profiler = CpuProfiler::Get();
+  profiler.Clear();
+  CPU_PROFILE_THREAD_NAME("Main \"render\"");
+  const auto base = CpuProfiler::Now();
+  profiler.Record("Frame", base, base + 2250000);
+  {
+    CPU_PROFILE_SCOPE("Scope");
+  }
+
+  std::thread worker([] {
+    CPU_PROFILE_THREAD_NAME("Worker");
+    CPU_PROFILE_SCOPE("Job");
+  });
+  worker.join();
+
+  const auto json = profiler.ExportChromeTrace();
+  CHECK(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+  CHECK(json.compare(json.size() - 2, 2, "]}") == 0);
+  // スレッド名はエスケープしてメタデータとして出力する.
+  CHECK(json.find("\"args\":{\"name\":\"Main \\\"render\\\"\"}") != std::string::npos);
+  CHECK(json.find("\"args\":{\"name\":\"Worker\"}") != std::string::npos);
+  // 区間は完了イベントで、時間はマイクロ秒.
+  CHECK(json.find("{\"name\":\"Frame\",\"ph\":\"X\"") != std::string::npos);
+  CHECK(json.find("\"dur\":2250.0}") != std::string::npos);
+  CHECK_EQUAL(size_t(1), CountOccurrences(json, "\"name\":\"Scope\""));
+  CHECK_EQUAL(size_t(1), CountOccurrences(json, "\"name\":\"Job\""));
+}
+
+TEST_CASE(KeepsNewestEventsWhenRingOverflows)
+{
+  auto& profiler = CpuProfiler::Get();
+  profiler.Clear();
+  const auto base = CpuProfiler::Now();
+  profiler.Record("Old", base, base + 1000);
+  for (size_t i = 0; i < CpuProfiler::RingSize; ++i)
+  {
+    profiler.Record("New", base, base + 1000);
+  }
+
+  auto stats = profiler.ComputeStats();
+  CHECK_EQUAL(size_t(1), stats.size());
+  CHECK(stats[0].name == "New");
+  CHECK_EQUAL(uint64_t(CpuProfiler::RingSize), stats[0].count);
+  CHECK(profiler.ExportChromeTrace().find("\"name\":\"Old\"") == std::string::npos);
+}
@@ -0,0 +1,157 @@
+﻿// LockFreeDescriptorFreeList と、置き換え前の DescriptorManager が使っていた std::list の空きリストの比較.
+// ctest には登録しない. Release でビルドして直接実行する.
+//
+//   cmake -S tests -B build-tests -DCMAKE_BUILD_TYPE=Release
+//   cmake --build build-tests --target DescriptorFreeListBench
+//   ./build-tests/DescriptorFreeListBench
+#include "DescriptorFreeList.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const uint32_t Capacity = 4096;
+  const uint32_t BatchSize = 256;
+  const uint32_t Rounds = 20000;
+  const uint32_t IncrementSize = 32;
+
+  // 置き換え前の DescriptorHandle 相当(CPU/GPU のハンドル).
+  struct Handle
+  {
+    uint64_t cpu;
+    uint64_t gpu;
+  };
+
+  // 置き換え前の実装. 解放したハンドルを std::list に積み、無ければ先頭から切り出す.
+  class ListFreeList
+  {
+  public:
+    bool Alloc(Handle& handle)
+    {
+      if (!m_freeList.empty())
+      {
+        handle = m_freeList.front();
+        m_freeList.pop_front();
+        return true;
+      }
+      if (m_index >= Capacity)
+      {
+        return false;
+      }
+      const auto use = m_index++;
+      handle = Handle{ uint64_t(use) * IncrementSize, uint64_t(use) * IncrementSize };
+      return true;
+    }
+    void Free(const Handle& handle)
+    {
+      m_freeList.push_back(handle);
+    }
+  private:
+    std::list<Handle> m_freeList;
+    uint32_t m_index = 0;
+  };
+
+  // 複数スレッドから使う場合は、呼び出し側でロックを取る必要がある.
+  class LockedListFreeList
+  {
+  public:
+    bool Alloc(Handle& handle)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_list.Alloc(handle);
+    }
+    void Free(const Handle& handle)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_list.Free(handle);
+    }
+  private:
+    std::mutex m_mutex;
+    ListFreeList m_list;
+  };
+
+  class IndexFreeList
+  {
+  public:
+    IndexFreeList() : m_list(Capacity) { }
+    bool Alloc(Handle& handle)
+    {
+      const auto index = m_list.Alloc();
+      if (index == LockFreeDescriptorFreeList::InvalidIndex)
+      {
+        return false;
+      }
+      handle = Handle{ uint64_t(index) * IncrementSize, uint64_t(index) * IncrementSize };
+      return true;
+    }
+    void Free(const Handle& handle)
+    {
+      m_list.Free(uint32_t(handle.cpu / IncrementSize));
+    }
+  private:
+    LockFreeDescriptorFreeList m_list;
+  };
+
+  // BatchSize 個を確保して逆順に解放することを繰り返す. 1 回の確保と解放の組あたりの時間を返す.
+  template<class FreeList>
+  double Run(FreeList& freeList, uint32_t threadCount)
+  {
+    const auto rounds = Rounds / threadCount;
+    auto worker = [&]() {
+      std::vector<Handle> handles(BatchSize);
+      for (uint32_t r = 0; r < rounds; ++r)
+      {
+        for (auto& v : handles)
+        {
+          if (!freeList.Alloc(v))
+          {
+            std::fprintf(stderr, "out of descriptors.\n");
+            std::exit(1);
+          }
+        }
+        for (auto itr = handles.rbegin(); itr != handles.rend(); ++itr)
+        {
+          freeList.Free(*itr);
+        }
+      }
+    };
+
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+      threads.emplace_back(worker);
+    }
+    for (auto& v : threads)
+    {
+      v.join();
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    return elapsed / (double(rounds) * threadCount * BatchSize);
+  }
+
+  template<class FreeList>
+  void Report(const char* name, uint32_t threadCount)
+  {
+    FreeList freeList;
+    Run(freeList, threadCount); // 初回の確保を含めないよう、一度回しておく.
+    std::printf("%-28s threads=%u  %8.2f ns/op\n", name, threadCount, Run(freeList, threadCount));
+  }
+}
+
+int main()
+{
+  Report<ListFreeList>("std::list", 1);
+  Report<IndexFreeList>("LockFreeDescriptorFreeList", 1);
+
+  const uint32_t threadCount = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+  Report<LockedListFreeList>("std::list + mutex", threadCount);
+  Report<IndexFreeList>("LockFreeDescriptorFreeList", threadCount);
+  return 0;
+}
@@ -0,0 +1,108 @@
+﻿#include "TestUtil.h"
+#include "DescriptorFreeList.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE(AllocatesEachIndexOnce)
+{
+  LockFreeDescriptorFreeList list(4);
+  std::vector<uint32_t> indices;
+  for (int i = 0; i < 4; ++i)
+  {
+    indices.push_back(list.Alloc());
+  }
+  CHECK_EQUAL(LockFreeDescriptorFreeList::InvalidIndex, list.Alloc());
+  std::sort(indices.begin(), indices.end());
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    CHECK_EQUAL(i, indices[i]);
+  }
+
+  // 解放したものから再利用する.
+  list.Free(2);
+  CHECK_EQUAL(2u, list.Alloc());
+  CHECK_EQUAL(LockFreeDescriptorFreeList::InvalidIndex, list.Alloc());
+}
+
+TEST_CASE(ConcurrentAllocFreeKeepsIndicesUnique)
+{
+  // 容量より多くを同時に持とうとさせ、空きリストが空の状態も通す.
+  const uint32_t Capacity = 64;
+  const int ThreadCount = 8;
+  const int HoldCount = 12;
+  const int Iterations = 20000;
+  LockFreeDescriptorFreeList list(Capacity);
+  std::vector<std::atomic<int>> owners(Capacity);
+  for (auto& v : owners)
+  {
+    v.store(-1);
+  }
+  std::atomic<int> duplicateCount(0);
+  std::atomic<int> invalidCount(0);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < ThreadCount; ++t)
+  {
+    threads.emplace_back([&, t]() {
+      std::vector<uint32_t> held;
+      for (int i = 0; i < Iterations; ++i)
+      {
+        if (held.size() < HoldCount && (i % 3) != 2)
+        {
+          const auto index = list.Alloc();
+          if (index == LockFreeDescriptorFreeList::InvalidIndex)
+          {
+            continue;
+          }
+          if (index >= Capacity)
+          {
+            invalidCount++;
+            continue;
+          }
+          // 他のスレッドが持っているインデックスを受け取ったら重複.
+          int expected = -1;
+          if (!owners[index].compare_exchange_strong(expected, t))
+          {
+            duplicateCount++;
+          }
+          held.push_back(index);
+        }
+        else if (!held.empty())
+        {
+          const auto index = held.back();
+          held.pop_back();
+          owners[index].store(-1);
+          list.Free(index);
+        }
+      }
+      for (auto index : held)
+      {
+        owners[index].store(-1);
+        list.Free(index);
+      }
+    });
+  }
+  for (auto& v : threads)
+  {
+    v.join();
+  }
+  CHECK_EQUAL(0, duplicateCount.load());
+  CHECK_EQUAL(0, invalidCount.load());
+  CHECK(list.GetTouchedCount() <= Capacity);
+
+  // 全てのインデックスが空きリストへ戻っている.
+  std::vector<bool> seen(Capacity, false);
+  for (uint32_t i = 0; i < Capacity; ++i)
+  {
+    const auto index = list.Alloc();
+    CHECK(index < Capacity);
+    if (index < Capacity)
+    {
+      CHECK(!seen[index]);
+      seen[index] = true;
+    }
+  }
+  CHECK_EQUAL(LockFreeDescriptorFreeList::InvalidIndex, list.Alloc());
+}
@@ -0,0 +1,68 @@
+﻿#include "TestUtil.h"
+#include "DescriptorId.h"
+
+TEST_CASE(EncodesHeapIndexAndGeneration)
+{
+  DescriptorId id(3, 1234, 5);
+  CHECK(id.IsValid());
+  CHECK_EQUAL(3u, id.GetHeapId());
+  CHECK_EQUAL(1234u, id.GetIndex());
+  CHECK_EQUAL(5u, id.GetGeneration());
+
+  // 各フィールドの最大値が隣に溢れない.
+  DescriptorId max(DescriptorId::MaxHeapId, DescriptorId::MaxIndex, 0xFE);
+  CHECK_EQUAL(DescriptorId::MaxHeapId, max.GetHeapId());
+  CHECK_EQUAL(DescriptorId::MaxIndex, max.GetIndex());
+  CHECK_EQUAL(0xFEu, max.GetGeneration());
+  // 世代は下位 8bit だけを使う.
+  CHECK_EQUAL(1u, DescriptorId(0, 0, 0x101).GetGeneration());
+
+  CHECK(!DescriptorId().IsValid());
+  CHECK(DescriptorId(1, 2, 3) == DescriptorId(1, 2, 3));
+  CHECK(DescriptorId(1, 2, 3) != DescriptorId(1, 2, 5));
+}
+
+TEST_CASE(GenerationIsOddWhileInUse)
+{
+  DescriptorGenerationTable table(4);
+  CHECK_EQUAL(0, int(table.Get(2)));
+  const auto generation = table.Acquire(2);
+  CHECK_EQUAL(1, int(generation));
+  CHECK(table.IsCurrent(2, generation));
+  CHECK(table.Release(2, generation));
+  CHECK_EQUAL(2, int(table.Get(2)));
+  CHECK(!table.IsCurrent(2, generation));
+  // 他のスロットには影響しない.
+  CHECK_EQUAL(0, int(table.Get(1)));
+
+  // 8bit を一周しても偶奇は保たれる.
+  for (int i = 0; i < 127; ++i)
+  {
+    CHECK(table.Release(2, table.Acquire(2)));
+  }
+  CHECK_EQUAL(0, int(table.Get(2)));
+  CHECK_EQUAL(1, int(table.Acquire(2)));
+}
+
+TEST_CASE(RejectsStaleAndDoubleFree)
+{
+  DescriptorGenerationTable table(1);
+  const auto first = table.Acquire(0);
+  CHECK(table.Release(0, first));
+  // 二重解放.
+  CHECK(!table.Release(0, first));
+
+  // スロットが再利用された後の古い参照では解放できず、新しい参照も壊さない.
+  const auto second = table.Acquire(0);
+  CHECK(second != first);
+  CHECK(!table.Release(0, first));
+  CHECK(!table.IsCurrent(0, first));
+  CHECK(table.IsCurrent(0, second));
+  CHECK(table.Release(0, second));
+
+  // DescriptorId を経由しても同じ.
+  DescriptorId stale(0, 0, first);
+  DescriptorId current(0, 0, table.Acquire(0));
+  CHECK(!table.Release(stale.GetIndex(), uint8_t(stale.GetGeneration())));
+  CHECK(table.Release(current.GetIndex(), uint8_t(current.GetGeneration())));
+}
@@ -0,0 +1,133 @@
+﻿#include "TestUtil.h"
+#include "PipelineCacheFile.h"
+#include <cstring>
+
+namespace
+{
+  const PipelineCacheAdapterIdentity Adapter{ 0x10de, 0x1b80, 0x1, 0xa1, 0x001b000e0d0a1234ull };
+
+  PipelineCacheFile MakeBlobs()
+  {
+    PipelineCacheFile file;
+    file.Reset(PipelineCacheFile::Blobs, Adapter);
+    file.SetBlob(0x1234, "first", 5);
+    file.SetBlob(0x5678, "second blob", 11);
+    file.SetBlob(0x9abc, "", 0);
+    return file;
+  }
+
+  // 末尾のハッシュを付け直す. 中身だけを壊したデータを作るのに使う.
+  void Rehash(std::vector<char>& data)
+  {
+    const auto bodySize = data.size() - sizeof(uint64_t);
+    const auto hash = StableHasher::Hash(data.data(), bodySize);
+    memcpy(data.data() + bodySize, &hash, sizeof(hash));
+  }
+
+  // magic, version, format, アダプタ(u32 x4, u64)の後にブロブの数が続く.
+  const size_t BlobCountOffset = 4 + 4 + 4 + 16 + 8;
+}
+
+TEST_CASE(RoundTripsBlobs)
+{
+  const auto data = MakeBlobs().Serialize();
+  PipelineCacheFile loaded;
+  CHECK(loaded.Deserialize(data, PipelineCacheFile::Blobs, Adapter));
+  CHECK_EQUAL(size_t(3), loaded.GetBlobCount());
+  auto blob = loaded.FindBlob(0x5678);
+  CHECK(blob != nullptr && std::string(blob->begin(), blob->end()) == "second blob");
+  CHECK(loaded.FindBlob(0x9abc) != nullptr && loaded.FindBlob(0x9abc)->empty());
+  CHECK(loaded.FindBlob(0x1) == nullptr);
+  // 同じ内容なら同じバイト列になる.
+  CHECK(loaded.Serialize() == data);
+}
+
+TEST_CASE(RoundTripsLibrary)
+{
+  PipelineCacheFile file;
+  file.Reset(PipelineCacheFile::Library, Adapter);
+  file.SetLibraryData(std::vector<char>(1000, 'L'));
+  const auto data = file.Serialize();
+
+  PipelineCacheFile loaded;
+  CHECK(loaded.Deserialize(data, PipelineCacheFile::Library, Adapter));
+  CHECK(loaded.GetLibraryData() == std::vector<char>(1000, 'L'));
+  // 形式が異なれば使わない.
+  CHECK(!loaded.Deserialize(data, PipelineCacheFile::Blobs, Adapter));
+  CHECK(loaded.GetLibraryData().empty());
+}
+
+TEST_CASE(RejectsOtherAdapterOrDriver)
+{
+  const auto data = MakeBlobs().Serialize();
+  auto other = Adapter;
+  other.driverVersion++;
+  PipelineCacheFile loaded;
+  CHECK(!loaded.Deserialize(data, PipelineCacheFile::Blobs, other));
+  CHECK_EQUAL(size_t(0), loaded.GetBlobCount());
+  other = Adapter;
+  other.deviceId++;
+  CHECK(!loaded.Deserialize(data, PipelineCacheFile::Blobs, other));
+  // 読み込みに失敗しても、渡したアダプタで書き直せる状態になる.
+  CHECK(loaded.GetAdapter() == other);
+}
+
+TEST_CASE(RejectsCorruptedData)
+{
+  const auto data = MakeBlobs().Serialize();
+  PipelineCacheFile loaded;
+  CHECK(!loaded.Deserialize(std::vector<char>(), PipelineCacheFile::Blobs, Adapter));
+
+  // どの 1 バイトを壊しても読み込まない.
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    auto broken = data;
+    broken[i] ^= 0x20;
+    CHECK(!loaded.Deserialize(broken, PipelineCacheFile::Blobs, Adapter));
+  }
+  // 途中で切れている.
+  for (size_t size = 0; size < data.size(); size += 7)
+  {
+    CHECK(!loaded.Deserialize(std::vector<char>(data.begin(), data.begin() + size), PipelineCacheFile::Blobs, Adapter));
+  }
+  CHECK_EQUAL(size_t(0), loaded.GetBlobCount());
+}
+
+TEST_CASE(RejectsInconsistentContentWithValidHash)
+{
+  const auto data = MakeBlobs().Serialize();
+  PipelineCacheFile loaded;
+
+  // ブロブの数が実際より多い.
+  auto broken = data;
+  const uint32_t hugeCount = 0x7fffffff;
+  memcpy(broken.data() + BlobCountOffset, &hugeCount, sizeof(hugeCount));
+  Rehash(broken);
+  CHECK(!loaded.Deserialize(broken, PipelineCacheFile::Blobs, Adapter));
+  CHECK_EQUAL(size_t(0), loaded.GetBlobCount());
+
+  // 最初のブロブの大きさが範囲を越える.
+  broken = data;
+  const uint64_t hugeSize = ~0ull;
+  memcpy(broken.data() + BlobCountOffset + 4 + 8, &hugeSize, sizeof(hugeSize));
+  Rehash(broken);
+  CHECK(!loaded.Deserialize(broken, PipelineCacheFile::Blobs, Adapter));
+
+  // 末尾に余分なデータがある.
+  broken = data;
+  broken.insert(broken.end() - sizeof(uint64_t), 'x');
+  Rehash(broken);
+  CHECK(!loaded.Deserialize(broken, PipelineCacheFile::Blobs, Adapter));
+}
+
+TEST_CASE(WritesAndReadsFiles)
+{
+  const std::string fileName = "PipelineCacheFileTest.bin";
+  const auto data = MakeBlobs().Serialize();
+  CHECK(PipelineCacheFile::WriteFile(fileName, data));
+  std::vector<char> read;
+  CHECK(PipelineCacheFile::ReadFile(fileName, read));
+  CHECK(read == data);
+  CHECK(!PipelineCacheFile::ReadFile("missing/PipelineCacheFileTest.bin", read));
+  CHECK(!PipelineCacheFile::WriteFile("missing/PipelineCacheFileTest.bin", data));
+}
@@ -0,0 +1,92 @@
+﻿#include "TestUtil.h"
+#include "PipelineStateHash.h"
+#include <climits>
+#include <string>
+
+namespace
+{
+  const char VertexShader[] = "vertex shader bytecode";
+  const char PixelShader[] = "pixel shader bytecode";
+
+  D3D12_GRAPHICS_PIPELINE_STATE_DESC MakeDesc(const D3D12_INPUT_ELEMENT_DESC* elements, UINT count)
+  {
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc{};
+    desc.VS = D3D12_SHADER_BYTECODE{ VertexShader, sizeof(VertexShader) };
+    desc.PS = D3D12_SHADER_BYTECODE{ PixelShader, sizeof(PixelShader) };
+    desc.InputLayout = D3D12_INPUT_LAYOUT_DESC{ elements, count };
+    desc.SampleMask = UINT_MAX;
+    desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+    desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+    desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    desc.NumRenderTargets = 1;
+    desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+    desc.SampleDesc.Count = 1;
+    return desc;
+  }
+}
+
+TEST_CASE(HashesContentNotPointers)
+{
+  // 同じ内容を別のメモリに置いても同じ値になる.
+  std::string semantic0 = "POSITION", semantic1 = "POSITION";
+  D3D12_INPUT_ELEMENT_DESC elements0[] = {
+    { semantic0.c_str(), 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+  };
+  D3D12_INPUT_ELEMENT_DESC elements1[] = {
+    { semantic1.c_str(), 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+  };
+  auto desc0 = MakeDesc(elements0, 1);
+  auto desc1 = MakeDesc(elements1, 1);
+  const std::string vs(VertexShader, sizeof(VertexShader));
+  desc1.VS = D3D12_SHADER_BYTECODE{ vs.data(), vs.size() };
+  CHECK_EQUAL(pipeline_hash::Hash(desc0, 1), pipeline_hash::Hash(desc1, 1));
+
+  // CachedPSO は含めない.
+  desc1.CachedPSO = D3D12_CACHED_PIPELINE_STATE{ PixelShader, sizeof(PixelShader) };
+  CHECK_EQUAL(pipeline_hash::Hash(desc0, 1), pipeline_hash::Hash(desc1, 1));
+}
+
+TEST_CASE(DistinguishesStateChanges)
+{
+  D3D12_INPUT_ELEMENT_DESC elements[] = {
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+  };
+  const auto base = MakeDesc(elements, 1);
+  const auto baseHash = pipeline_hash::Hash(base, 1);
+  CHECK(pipeline_hash::Hash(base, 2) != baseHash);
+
+  auto desc = base;
+  desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+  CHECK(pipeline_hash::Hash(desc, 1) != baseHash);
+  desc = base;
+  desc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+  CHECK(pipeline_hash::Hash(desc, 1) != baseHash);
+  desc = base;
+  desc.PS = D3D12_SHADER_BYTECODE{};
+  CHECK(pipeline_hash::Hash(desc, 1) != baseHash);
+
+  D3D12_INPUT_ELEMENT_DESC otherElements[] = {
+    { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+  };
+  desc = base;
+  desc.InputLayout = D3D12_INPUT_LAYOUT_DESC{ otherElements, 1 };
+  CHECK(pipeline_hash::Hash(desc, 1) != baseHash);
+
+  // -0.0 と 0.0 は同じ.
+  desc = base;
+  desc.RasterizerState.SlopeScaledDepthBias = -0.0f;
+  CHECK_EQUAL(baseHash, pipeline_hash::Hash(desc, 1));
+}
+
+TEST_CASE(SeparatesGraphicsAndCompute)
+{
+  D3D12_COMPUTE_PIPELINE_STATE_DESC compute{};
+  compute.CS = D3D12_SHADER_BYTECODE{ VertexShader, sizeof(VertexShader) };
+  D3D12_GRAPHICS_PIPELINE_STATE_DESC graphics{};
+  graphics.VS = compute.CS;
+  CHECK(pipeline_hash::Hash(compute, 1) != pipeline_hash::Hash(graphics, 1));
+  auto other = compute;
+  other.CS = D3D12_SHADER_BYTECODE{ PixelShader, sizeof(PixelShader) };
+  CHECK(pipeline_hash::Hash(compute, 1) != pipeline_hash::Hash(other, 1));
+}
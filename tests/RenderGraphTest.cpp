@@ -0,0 +1,293 @@
+﻿#include "TestUtil.h"
+#include "RenderGraph.h"
+#include <stdexcept>
+
+namespace
+{
+  using Barriers = std::vector<RenderGraph::Barrier>;
+
+  size_t CountBarriers(const Barriers& barriers, RenderGraph::BarrierType type)
+  {
+    size_t count = 0;
+    for (const auto& v : barriers)
+    {
+      count += v.type == type ? 1 : 0;
+    }
+    return count;
+  }
+
+  const RenderGraph::CompileOptions NoSplit{ false, true };
+}
+
+TEST_CASE(InsertsUavBarrierBeforeReadingUavWrite)
+{
+  RenderGraph graph;
+  auto buffer = graph.ImportResource("buffer", RenderGraph::State_UnorderedAccess, RenderGraph::State_UnorderedAccess);
+  auto p0 = graph.AddPass("write", true);
+  auto p1 = graph.AddPass("read", true);
+  auto p2 = graph.AddPass("read again", true);
+  graph.Write(p0, buffer, RenderGraph::State_UnorderedAccess);
+  graph.Read(p1, buffer, RenderGraph::State_UnorderedAccess);
+  graph.Read(p2, buffer, RenderGraph::State_UnorderedAccess);
+  graph.Compile(NoSplit);
+
+  const auto& schedule = graph.GetSchedule();
+  CHECK_EQUAL(size_t(0), schedule[0].barriers.size());
+  CHECK_EQUAL(size_t(1), schedule[1].barriers.size());
+  CHECK_EQUAL(size_t(1), CountBarriers(schedule[1].barriers, RenderGraph::Barrier_UAV));
+  // 読み込み同士の間は同期しない.
+  CHECK_EQUAL(size_t(0), schedule[2].barriers.size());
+}
+
+TEST_CASE(InsertsUavBarrierBetweenUavWrites)
+{
+  RenderGraph graph;
+  auto buffer = graph.ImportResource("buffer", RenderGraph::State_UnorderedAccess, RenderGraph::State_UnorderedAccess);
+  for (int i = 0; i < 3; ++i)
+  {
+    graph.Write(graph.AddPass("write", true), buffer, RenderGraph::State_UnorderedAccess);
+  }
+  graph.Compile(NoSplit);
+
+  const auto& schedule = graph.GetSchedule();
+  CHECK_EQUAL(size_t(0), schedule[0].barriers.size());
+  CHECK_EQUAL(size_t(1), CountBarriers(schedule[1].barriers, RenderGraph::Barrier_UAV));
+  CHECK_EQUAL(size_t(1), CountBarriers(schedule[2].barriers, RenderGraph::Barrier_UAV));
+  CHECK_EQUAL(2u, graph.GetBarrierCount());
+}
+
+TEST_CASE(TransitionResetsUavWrite)
+{
+  RenderGraph graph;
+  auto texture = graph.ImportResource("texture", RenderGraph::State_UnorderedAccess, RenderGraph::State_UnorderedAccess);
+  auto p0 = graph.AddPass("write", true);
+  auto p1 = graph.AddPass("sample", true);
+  auto p2 = graph.AddPass("write again", true);
+  graph.Write(p0, texture, RenderGraph::State_UnorderedAccess);
+  graph.Read(p1, texture, RenderGraph::State_PixelShaderResource);
+  graph.Write(p2, texture, RenderGraph::State_UnorderedAccess);
+  graph.Compile(NoSplit);
+
+  // 遷移が書き込みの完了を待つので、UAV バリアは要らない.
+  const auto& schedule = graph.GetSchedule();
+  CHECK_EQUAL(size_t(1), CountBarriers(schedule[1].barriers, RenderGraph::Barrier_Transition));
+  CHECK_EQUAL(size_t(1), CountBarriers(schedule[2].barriers, RenderGraph::Barrier_Transition));
+  CHECK_EQUAL(size_t(0), CountBarriers(schedule[2].barriers, RenderGraph::Barrier_UAV));
+  CHECK_EQUAL(uint32_t(RenderGraph::State_UnorderedAccess), schedule[2].barriers[0].after);
+  CHECK_EQUAL(size_t(0), graph.GetFinalBarriers().size());
+}
+
+TEST_CASE(MergesReadStatesInOnePass)
+{
+  RenderGraph graph;
+  auto texture = graph.ImportResource("texture", RenderGraph::State_Common, RenderGraph::State_Common);
+  auto pass = graph.AddPass("read", true);
+  graph.Read(pass, texture, RenderGraph::State_PixelShaderResource);
+  graph.Read(pass, texture, RenderGraph::State_NonPixelShaderResource);
+  graph.Compile(NoSplit);
+
+  const auto& barriers = graph.GetSchedule()[0].barriers;
+  CHECK_EQUAL(size_t(1), barriers.size());
+  CHECK_EQUAL(uint32_t(RenderGraph::State_PixelShaderResource | RenderGraph::State_NonPixelShaderResource), barriers[0].after);
+}
+
+TEST_CASE(RejectsWriteMergedWithOtherState)
+{
+  RenderGraph graph;
+  auto texture = graph.ImportResource("texture", RenderGraph::State_Common, RenderGraph::State_Common);
+  auto pass = graph.AddPass("invalid", true);
+  graph.Write(pass, texture, RenderGraph::State_UnorderedAccess);
+  graph.Read(pass, texture, RenderGraph::State_PixelShaderResource);
+  CHECK_THROWS(graph.Compile(NoSplit));
+
+  // 同じ状態での読み書きはまとめられる.
+  RenderGraph same;
+  auto buffer = same.ImportResource("buffer", RenderGraph::State_UnorderedAccess, RenderGraph::State_UnorderedAccess);
+  auto p0 = same.AddPass("read write", true);
+  same.Read(p0, buffer, RenderGraph::State_UnorderedAccess);
+  same.Write(p0, buffer, RenderGraph::State_UnorderedAccess);
+  same.Compile(NoSplit);
+  CHECK_EQUAL(0u, same.GetBarrierCount());
+}
+
+TEST_CASE(CombinesConsecutiveReads)
+{
+  RenderGraph graph;
+  auto target = graph.ImportResource("target", RenderGraph::State_RenderTarget, RenderGraph::State_RenderTarget);
+  auto p0 = graph.AddPass("draw", true);
+  auto p1 = graph.AddPass("pixel read", true);
+  auto p2 = graph.AddPass("compute read", true);
+  graph.Write(p0, target, RenderGraph::State_RenderTarget);
+  graph.Read(p1, target, RenderGraph::State_PixelShaderResource);
+  graph.Read(p2, target, RenderGraph::State_NonPixelShaderResource);
+  graph.Compile(NoSplit);
+
+  // 2 つの読み込みをまとめて 1 回で遷移させる.
+  const auto& schedule = graph.GetSchedule();
+  CHECK_EQUAL(size_t(1), schedule[1].barriers.size());
+  CHECK_EQUAL(uint32_t(RenderGraph::State_PixelShaderResource | RenderGraph::State_NonPixelShaderResource), schedule[1].barriers[0].after);
+  CHECK_EQUAL(size_t(0), schedule[2].barriers.size());
+  CHECK_EQUAL(size_t(1), graph.GetFinalBarriers().size());
+}
+
+TEST_CASE(TransitionsReadToCommon)
+{
+  RenderGraph graph;
+  auto texture = graph.ImportResource("texture", RenderGraph::State_RenderTarget, RenderGraph::State_Common);
+  auto p0 = graph.AddPass("draw", true);
+  auto p1 = graph.AddPass("sample", true);
+  auto p2 = graph.AddPass("present", true);
+  graph.Write(p0, texture, RenderGraph::State_RenderTarget);
+  graph.Read(p1, texture, RenderGraph::State_PixelShaderResource);
+  graph.Read(p2, texture, RenderGraph::State_Common);
+  graph.Compile(NoSplit);
+
+  // COMMON は読み込み状態に含まれないので、前の読み込みとまとめずに遷移させる.
+  const auto& schedule = graph.GetSchedule();
+  CHECK_EQUAL(size_t(1), schedule[1].barriers.size());
+  CHECK_EQUAL(uint32_t(RenderGraph::State_PixelShaderResource), schedule[1].barriers[0].after);
+  CHECK_EQUAL(size_t(1), schedule[2].barriers.size());
+  if (schedule[2].barriers.size() == 1)
+  {
+    CHECK_EQUAL(uint32_t(RenderGraph::State_PixelShaderResource), schedule[2].barriers[0].before);
+    CHECK_EQUAL(uint32_t(RenderGraph::State_Common), schedule[2].barriers[0].after);
+  }
+  CHECK_EQUAL(size_t(0), graph.GetFinalBarriers().size());
+
+  // 同じパスで COMMON と読み込み状態を合わせることはできない.
+  RenderGraph mixed;
+  auto buffer = mixed.ImportResource("buffer", RenderGraph::State_Common, RenderGraph::State_Common);
+  auto pass = mixed.AddPass("invalid", true);
+  mixed.Read(pass, buffer, RenderGraph::State_PixelShaderResource);
+  mixed.Read(pass, buffer, RenderGraph::State_Common);
+  CHECK_THROWS(mixed.Compile(NoSplit));
+}
+
+TEST_CASE(SplitsTransitionsAcrossIdlePasses)
+{
+  RenderGraph graph;
+  auto a = graph.ImportResource("a", RenderGraph::State_RenderTarget, RenderGraph::State_PixelShaderResource);
+  auto b = graph.ImportResource("b", RenderGraph::State_RenderTarget, RenderGraph::State_RenderTarget);
+  auto p0 = graph.AddPass("draw a", true);
+  auto p1 = graph.AddPass("draw b", true);
+  auto p2 = graph.AddPass("read a", true);
+  graph.Write(p0, a, RenderGraph::State_RenderTarget);
+  graph.Write(p1, b, RenderGraph::State_RenderTarget);
+  graph.Read(p2, a, RenderGraph::State_PixelShaderResource);
+  graph.Compile();
+
+  const auto& schedule = graph.GetSchedule();
+  CHECK_EQUAL(size_t(1), schedule[1].barriers.size());
+  CHECK(schedule[1].barriers[0].split == RenderGraph::Split_Begin);
+  CHECK_EQUAL(size_t(1), schedule[2].barriers.size());
+  CHECK(schedule[2].barriers[0].split == RenderGraph::Split_End);
+}
+
+TEST_CASE(CullsUnusedPasses)
+{
+  RenderGraph graph;
+  auto output = graph.ImportResource("output", RenderGraph::State_RenderTarget, RenderGraph::State_RenderTarget);
+  auto unused = graph.CreateTransient("unused", RenderGraph::TransientDesc{ 256, 256 }, RenderGraph::State_RenderTarget);
+  auto p0 = graph.AddPass("unused");
+  auto p1 = graph.AddPass("draw");
+  graph.Write(p0, unused, RenderGraph::State_RenderTarget);
+  graph.Write(p1, output, RenderGraph::State_RenderTarget);
+  graph.Compile();
+
+  CHECK(graph.IsCulled(p0));
+  CHECK(!graph.IsCulled(p1));
+  CHECK_EQUAL(size_t(1), graph.GetSchedule().size());
+  CHECK_EQUAL(RenderGraph::InvalidId, graph.GetFirstUse(unused));
+  CHECK_EQUAL(0ull, graph.GetTransientHeapSize());
+}
+
+TEST_CASE(AliasesTransientsWithDisjointLifetimes)
+{
+  RenderGraph graph;
+  auto output = graph.ImportResource("output", RenderGraph::State_RenderTarget, RenderGraph::State_RenderTarget);
+  auto t0 = graph.CreateTransient("t0", RenderGraph::TransientDesc{ 1024, 256 }, RenderGraph::State_RenderTarget);
+  auto t1 = graph.CreateTransient("t1", RenderGraph::TransientDesc{ 1024, 256 }, RenderGraph::State_RenderTarget);
+  auto t2 = graph.CreateTransient("t2", RenderGraph::TransientDesc{ 1024, 256 }, RenderGraph::State_RenderTarget);
+  auto p0 = graph.AddPass("p0");
+  auto p1 = graph.AddPass("p1");
+  auto p2 = graph.AddPass("p2");
+  auto p3 = graph.AddPass("p3");
+  graph.Write(p0, t0, RenderGraph::State_RenderTarget);
+  graph.Read(p1, t0, RenderGraph::State_PixelShaderResource);
+  graph.Write(p1, t1, RenderGraph::State_RenderTarget);
+  graph.Read(p2, t1, RenderGraph::State_PixelShaderResource);
+  graph.Write(p2, t2, RenderGraph::State_RenderTarget);
+  graph.Read(p3, t2, RenderGraph::State_PixelShaderResource);
+  graph.Write(p3, output, RenderGraph::State_RenderTarget);
+  graph.Compile();
+
+  // 同時に生きるのは 2 つまでなので、t2 は t0 のメモリを使う.
+  CHECK_EQUAL(2048ull, graph.GetTransientHeapSize());
+  CHECK_EQUAL(graph.GetTransientOffset(t0), graph.GetTransientOffset(t2));
+  CHECK(graph.GetTransientOffset(t0) != graph.GetTransientOffset(t1));
+
+  const auto& barriers = graph.GetSchedule()[2].barriers;
+  bool found = false;
+  for (const auto& v : barriers)
+  {
+    if (v.type == RenderGraph::Barrier_Aliasing && v.resource == t2)
+    {
+      CHECK_EQUAL(t0, v.aliasBefore);
+      found = true;
+    }
+  }
+  CHECK(found);
+  // 一時リソースは生成時の状態へ戻して終わる.
+  for (const auto& v : graph.GetFinalBarriers())
+  {
+    CHECK(v.resource == t2 || v.resource == output);
+  }
+}
+
+TEST_CASE(TransientPlanMatchesAllocatorPlan)
+{
+  // RenderGraphExecutor はグラフの配置をそのまま ResourceAllocator へ渡す.
+  // アロケータが自分で計画した場合と同じ配置になり、アロケータの検査も通ること.
+  RenderGraph graph;
+  auto output = graph.ImportResource("output", RenderGraph::State_RenderTarget, RenderGraph::State_RenderTarget);
+  const RenderGraph::TransientDesc descs[] = {
+    { 4096, 4096 }, { 65536, 65536 }, { 8192, 4096 }, { 65536, 65536 }, { 4096, 4096 },
+  };
+  std::vector<RenderGraph::ResourceId> transients;
+  for (const auto& v : descs)
+  {
+    transients.push_back(graph.CreateTransient("t" + std::to_string(transients.size()), v, RenderGraph::State_RenderTarget));
+  }
+  std::vector<RenderGraph::PassId> passes;
+  for (size_t i = 0; i < transients.size(); ++i)
+  {
+    passes.push_back(graph.AddPass("p" + std::to_string(i)));
+    graph.Write(passes[i], transients[i], RenderGraph::State_RenderTarget);
+    if (i > 0)
+    {
+      graph.Read(passes[i], transients[i - 1], RenderGraph::State_PixelShaderResource);
+    }
+  }
+  auto last = graph.AddPass("output");
+  graph.Read(last, transients.back(), RenderGraph::State_PixelShaderResource);
+  graph.Write(last, output, RenderGraph::State_RenderTarget);
+  graph.Compile();
+
+  // ResourceAllocator::CreateTransientResources と同じく、登録順に計画する.
+  TransientAliasPlanner planner;
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i < transients.size(); ++i)
+  {
+    const auto id = transients[i];
+    planner.Add(TransientAliasPlanner::Request{ descs[i].size, descs[i].alignment, graph.GetFirstUse(id), graph.GetLastUse(id) });
+    offsets.push_back(graph.GetTransientOffset(id));
+  }
+  CHECK_EQUAL(planner.Plan(), graph.GetTransientHeapSize());
+  for (uint32_t i = 0; i < uint32_t(transients.size()); ++i)
+  {
+    CHECK_EQUAL(planner.GetOffset(i), offsets[i]);
+  }
+  CHECK(planner.IsValidPlacement(offsets, graph.GetTransientHeapSize()));
+  // 寿命の重ならないものがメモリを共有している.
+  CHECK(graph.GetTransientHeapSize() < planner.GetUnaliasedSize());
+}
@@ -0,0 +1,166 @@
+﻿#include "TestUtil.h"
+#include "ResourceStateTracker.h"
+#include <stdexcept>
+
+namespace
+{
+  const uint32_t Common = 0x0;
+  const uint32_t RenderTarget = 0x4;
+  const uint32_t UnorderedAccess = 0x8;
+  const uint32_t NonPixelShaderResource = 0x40;
+  const uint32_t PixelShaderResource = 0x80;
+  const uint32_t CopyDest = 0x400;
+
+  int g_resources[4];
+}
+
+TEST_CASE(SkipsRedundantTransitions)
+{
+  ResourceStateTracker tracker;
+  const void* texture = &g_resources[0];
+  tracker.Register(texture, 1, PixelShaderResource | NonPixelShaderResource);
+  // 既に含んでいる読み込み状態への遷移は不要.
+  tracker.Transition(texture, 0, PixelShaderResource);
+  CHECK(!tracker.HasPending());
+
+  tracker.Transition(texture, 0, RenderTarget);
+  auto barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(1), barriers.size());
+  CHECK_EQUAL(uint32_t(PixelShaderResource | NonPixelShaderResource), barriers[0].before);
+  CHECK_EQUAL(RenderTarget, barriers[0].after);
+  CHECK_EQUAL(ResourceStateTracker::AllSubresources, barriers[0].subresource);
+  CHECK(!tracker.HasPending());
+}
+
+TEST_CASE(TransitionsFromReadStatesToCommon)
+{
+  ResourceStateTracker tracker;
+  const void* backBuffer = &g_resources[0];
+  const void* buffer = &g_resources[1];
+  // PRESENT は COMMON と同じ 0.
+  tracker.Register(backBuffer, 1, PixelShaderResource);
+  tracker.Register(buffer, 1, NonPixelShaderResource);
+  tracker.Transition(backBuffer, 0, Common);
+  tracker.Transition(buffer, 0, Common);
+  auto barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(2), barriers.size());
+  if (barriers.size() != 2)
+  {
+    return;
+  }
+  CHECK_EQUAL(PixelShaderResource, barriers[0].before);
+  CHECK_EQUAL(Common, barriers[0].after);
+  CHECK_EQUAL(NonPixelShaderResource, barriers[1].before);
+  CHECK_EQUAL(Common, barriers[1].after);
+  CHECK_EQUAL(Common, tracker.GetState(backBuffer, 0));
+}
+
+TEST_CASE(CollapsesAndCancelsPendingTransitions)
+{
+  ResourceStateTracker tracker;
+  const void* texture = &g_resources[0];
+  tracker.Register(texture, 1, Common);
+  tracker.Transition(texture, 0, CopyDest);
+  tracker.Transition(texture, 0, PixelShaderResource);
+  auto barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(1), barriers.size());
+  CHECK_EQUAL(Common, barriers[0].before);
+  CHECK_EQUAL(PixelShaderResource, barriers[0].after);
+
+  // 元の状態へ戻ったものは発行しない.
+  tracker.Transition(texture, 0, RenderTarget);
+  tracker.Transition(texture, 0, PixelShaderResource);
+  CHECK(!tracker.HasPending());
+  CHECK_EQUAL(size_t(0), tracker.Flush().size());
+}
+
+TEST_CASE(TracksSubresourcesIndividually)
+{
+  ResourceStateTracker tracker;
+  const void* texture = &g_resources[0];
+  tracker.Register(texture, 4, PixelShaderResource);
+  tracker.Transition(texture, 2, RenderTarget);
+  uint32_t state = 0;
+  CHECK(!tracker.GetUniformState(texture, state));
+  CHECK_EQUAL(RenderTarget, tracker.GetState(texture, 2));
+  CHECK_EQUAL(PixelShaderResource, tracker.GetState(texture, 1));
+
+  auto barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(1), barriers.size());
+  CHECK_EQUAL(2u, barriers[0].subresource);
+
+  // 全サブリソースが同じ遷移なら 1 つにまとめる.
+  tracker.Transition(texture, 2, PixelShaderResource);
+  tracker.Flush();
+  tracker.Transition(texture, ResourceStateTracker::AllSubresources, CopyDest);
+  barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(1), barriers.size());
+  CHECK_EQUAL(ResourceStateTracker::AllSubresources, barriers[0].subresource);
+  CHECK(tracker.GetUniformState(texture, state));
+  CHECK_EQUAL(CopyDest, state);
+}
+
+TEST_CASE(SplitsMixedSubresourceTransitions)
+{
+  ResourceStateTracker tracker;
+  const void* texture = &g_resources[0];
+  tracker.Register(texture, 2, PixelShaderResource);
+  tracker.Transition(texture, 0, RenderTarget);
+  tracker.Flush();
+  // 遷移前の状態が異なるので、サブリソース毎に発行する.
+  tracker.Transition(texture, ResourceStateTracker::AllSubresources, CopyDest);
+  auto barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(2), barriers.size());
+  CHECK_EQUAL(RenderTarget, barriers[0].before);
+  CHECK_EQUAL(PixelShaderResource, barriers[1].before);
+}
+
+TEST_CASE(FlushesInRegistrationOrderWithUavLast)
+{
+  ResourceStateTracker tracker;
+  const void* a = &g_resources[0];
+  const void* b = &g_resources[1];
+  const void* c = &g_resources[2];
+  tracker.Register(a, 1, Common);
+  tracker.Register(b, 1, Common);
+  tracker.Register(c, 1, UnorderedAccess);
+  tracker.UAVBarrier(c);
+  tracker.UAVBarrier(c);
+  tracker.Transition(b, 0, CopyDest);
+  tracker.Transition(a, 0, CopyDest);
+
+  auto barriers = tracker.Flush();
+  CHECK_EQUAL(size_t(3), barriers.size());
+  CHECK(barriers[0].resource == b);
+  CHECK(barriers[1].resource == a);
+  CHECK(barriers[2].type == ResourceStateTracker::Barrier_UAV);
+  CHECK(barriers[2].resource == c);
+}
+
+TEST_CASE(SetStateRewritesPendingTarget)
+{
+  ResourceStateTracker tracker;
+  const void* texture = &g_resources[0];
+  tracker.Register(texture, 1, Common);
+  tracker.Transition(texture, 0, CopyDest);
+  tracker.SetState(texture, 0, Common);
+  CHECK(!tracker.HasPending());
+  CHECK_EQUAL(Common, tracker.GetState(texture, 0));
+
+  tracker.SetState(texture, ResourceStateTracker::AllSubresources, PixelShaderResource);
+  CHECK_EQUAL(size_t(0), tracker.Flush().size());
+  CHECK_EQUAL(PixelShaderResource, tracker.GetState(texture, 0));
+}
+
+TEST_CASE(RejectsUnregisteredResources)
+{
+  ResourceStateTracker tracker;
+  const void* texture = &g_resources[0];
+  CHECK_THROWS(tracker.Transition(texture, 0, CopyDest));
+  tracker.Register(texture, 1, Common);
+  tracker.Transition(texture, 0, CopyDest);
+  tracker.Unregister(texture);
+  CHECK(!tracker.IsRegistered(texture));
+  CHECK(!tracker.HasPending());
+  CHECK_THROWS(tracker.GetState(texture, 0));
+}
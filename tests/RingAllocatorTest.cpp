@@ -0,0 +1,77 @@
+﻿#include "TestUtil.h"
+#include "RingAllocator.h"
+
+TEST_CASE(AllocatesAlignedOffsets)
+{
+  RingAllocator ring(1024);
+  CHECK_EQUAL(0ull, ring.Allocate(10, 256));
+  CHECK_EQUAL(256ull, ring.Allocate(10, 256));
+  CHECK_EQUAL(512ull, ring.Allocate(256, 256));
+  // 末尾に収まらない確保は失敗し、状態を変えない.
+  CHECK_EQUAL(RingAllocator::InvalidOffset, ring.Allocate(512, 256));
+  CHECK_EQUAL(768ull, ring.GetUsedSize());
+}
+
+TEST_CASE(RejectsInvalidSizes)
+{
+  RingAllocator ring(1024);
+  CHECK_EQUAL(RingAllocator::InvalidOffset, ring.Allocate(0, 256));
+  CHECK_EQUAL(RingAllocator::InvalidOffset, ring.Allocate(2048, 256));
+  CHECK_EQUAL(0ull, ring.GetUsedSize());
+}
+
+TEST_CASE(ReleasesFramesInFenceOrder)
+{
+  RingAllocator ring(1024);
+  ring.Allocate(256, 256);
+  ring.FinishFrame(1);
+  ring.Allocate(512, 256);
+  ring.FinishFrame(2);
+  CHECK_EQUAL(768ull, ring.GetUsedSize());
+  CHECK_EQUAL(1ull, ring.GetOldestPendingFenceValue());
+
+  ring.ReleaseCompleted(0);
+  CHECK_EQUAL(768ull, ring.GetUsedSize());
+  ring.ReleaseCompleted(1);
+  CHECK_EQUAL(512ull, ring.GetUsedSize());
+  ring.ReleaseCompleted(5);
+  CHECK_EQUAL(0ull, ring.GetUsedSize());
+  CHECK(!ring.HasPendingFrames());
+}
+
+TEST_CASE(WrapsAroundAfterRelease)
+{
+  RingAllocator ring(1024);
+  ring.Allocate(512, 256);
+  ring.FinishFrame(1);
+  ring.Allocate(256, 256);
+  ring.FinishFrame(2);
+  ring.ReleaseCompleted(1);
+
+  // 末尾には 256 しか無いので、先頭に折り返す. 捨てた末尾も使用量に含む.
+  CHECK_EQUAL(0ull, ring.Allocate(512, 256));
+  CHECK_EQUAL(1024ull, ring.GetUsedSize());
+  // 満杯.
+  CHECK_EQUAL(RingAllocator::InvalidOffset, ring.Allocate(1, 1));
+  ring.FinishFrame(3);
+
+  // 捨てた末尾は折り返したフレームの分として、そのフレームの完了まで解放されない.
+  ring.ReleaseCompleted(2);
+  CHECK_EQUAL(768ull, ring.GetUsedSize());
+  ring.ReleaseCompleted(3);
+  CHECK_EQUAL(0ull, ring.GetUsedSize());
+}
+
+TEST_CASE(DoesNotOverwritePendingRegion)
+{
+  RingAllocator ring(1024);
+  ring.Allocate(256, 256);
+  ring.FinishFrame(1);
+  ring.Allocate(256, 256);
+  ring.FinishFrame(2);
+  ring.ReleaseCompleted(1);
+  ring.Allocate(512, 256);  // [512, 1024)
+  // 空きは [0, 256) のみ. 256 を超える要求は使用中の [256, 512) と重なるので失敗する.
+  CHECK_EQUAL(RingAllocator::InvalidOffset, ring.Allocate(257, 1));
+  CHECK_EQUAL(0ull, ring.Allocate(256, 256));
+}
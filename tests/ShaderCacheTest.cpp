@@ -0,0 +1,164 @@
+﻿#include "TestUtil.h"
+#include "ShaderCache.h"
+#include "CacheFileUtil.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+  const char* Directory = "ShaderCacheTestData";
+
+  std::string GetPath(const std::string& key)
+  {
+    return std::string(Directory) + "/" + ShaderCache::ToHex(StableHasher::Hash(key.data(), key.size())) + ".dxil";
+  }
+
+  std::vector<char> ReadAll(const std::string& path)
+  {
+    std::vector<char> data;
+    cache_file::ReadAll(path, data);
+    return data;
+  }
+
+  void WriteAll(const std::string& path, const std::vector<char>& data)
+  {
+    std::ofstream outfile(path, std::ios::binary | std::ios::trunc);
+    outfile.write(data.data(), data.size());
+  }
+
+  // ヘッダの keySize, codeSize の位置.
+  const size_t KeySizeOffset = 8;
+  const size_t CodeSizeOffset = 12;
+}
+
+TEST_CASE(StoresAndLoadsCode)
+{
+  ShaderCache cache(Directory);
+  const std::string key = "VSMain:vs_6_0:shader.hlsl";
+  const char code[] = "DXIL code";
+  CHECK(cache.Store(key, code, sizeof(code)));
+
+  std::vector<char> loaded;
+  CHECK(cache.Load(key, loaded));
+  CHECK_EQUAL(sizeof(code), loaded.size());
+  CHECK(memcmp(loaded.data(), code, sizeof(code)) == 0);
+  CHECK(!cache.Load("missing", loaded));
+  CHECK(loaded.empty());
+
+  const auto stats = cache.GetStatistics();
+  CHECK_EQUAL(1u, stats.hits);
+  CHECK_EQUAL(1u, stats.misses);
+  CHECK_EQUAL(0u, stats.corrupted);
+  CHECK_EQUAL(1u, stats.writes);
+}
+
+TEST_CASE(RejectsSizesBeyondFileLength)
+{
+  ShaderCache cache(Directory);
+  const std::string key = "PSMain:ps_6_0:shader.hlsl";
+  const char code[] = "DXIL code";
+
+  // 巨大な大きさを書き込まれたヘッダでも確保せずに壊れたものとして扱う.
+  const size_t offsets[] = { KeySizeOffset, CodeSizeOffset };
+  for (auto offset : offsets)
+  {
+    CHECK(cache.Store(key, code, sizeof(code)));
+    auto data = ReadAll(GetPath(key));
+    if (data.size() < CodeSizeOffset + sizeof(uint32_t))
+    {
+      CHECK(!"cache file was not written");
+      return;
+    }
+    const uint32_t hugeSize = 0xFFFFFFF0u;
+    memcpy(&data[offset], &hugeSize, sizeof(hugeSize));
+    WriteAll(GetPath(key), data);
+
+    std::vector<char> loaded;
+    CHECK(!cache.Load(key, loaded));
+    CHECK(loaded.empty());
+    // 壊れたファイルは削除される.
+    CHECK(!std::ifstream(GetPath(key)).good());
+  }
+  CHECK_EQUAL(2u, cache.GetStatistics().corrupted);
+}
+
+TEST_CASE(RejectsTruncatedAndModifiedFiles)
+{
+  ShaderCache cache(Directory);
+  const std::string key = "CSMain:cs_6_0:filter.hlsl";
+  const char code[] = "DXIL code";
+
+  CHECK(cache.Store(key, code, sizeof(code)));
+  auto data = ReadAll(GetPath(key));
+  data.pop_back();
+  WriteAll(GetPath(key), data);
+  std::vector<char> loaded;
+  CHECK(!cache.Load(key, loaded));
+
+  CHECK(cache.Store(key, code, sizeof(code)));
+  data = ReadAll(GetPath(key));
+  data.back() ^= 0x1;
+  WriteAll(GetPath(key), data);
+  CHECK(!cache.Load(key, loaded));
+  CHECK_EQUAL(2u, cache.GetStatistics().corrupted);
+
+  // 作り直せば読める.
+  CHECK(cache.Store(key, code, sizeof(code)));
+  CHECK(cache.Load(key, loaded));
+}
+
+TEST_CASE(KeepsCorruptedFilesWhenReadOnly)
+{
+  ShaderCache cache(Directory);
+  const std::string key = "GSMain:gs_6_0:readonly.hlsl";
+  const char code[] = "DXIL code";
+
+  CHECK(cache.Store(key, code, sizeof(code)));
+  auto data = ReadAll(GetPath(key));
+  data.back() ^= 0x1;
+  WriteAll(GetPath(key), data);
+
+  // 読み取り専用では壊れていても消さず、書き込みもしない.
+  cache.SetReadOnly(true);
+  std::vector<char> loaded;
+  CHECK(!cache.Load(key, loaded));
+  CHECK(std::ifstream(GetPath(key)).good());
+  CHECK_EQUAL(1u, cache.GetStatistics().corrupted);
+  CHECK(!cache.Store(key, code, sizeof(code)));
+  CHECK(ReadAll(GetPath(key)) == data);
+
+  cache.SetReadOnly(false);
+  CHECK(!cache.Load(key, loaded));
+  CHECK(!std::ifstream(GetPath(key)).good());
+}
+
+TEST_CASE(HashesIncrementally)
+{
+  const char text[] = "abcdef";
+  // FNV-1a (64bit) の既知の値.
+  CHECK_EQUAL(0xcbf29ce484222325ull, StableHasher::Hash(text, 0));
+  CHECK_EQUAL(0xaf63dc4c8601ec8cull, StableHasher::Hash(text, 1));
+  // 続けて積んだものと連結したものは同じ.
+  const auto first = StableHasher::Hash(text, 3);
+  CHECK_EQUAL(StableHasher::Hash(text, 6), StableHasher::Hash(text + 3, 3, first));
+
+  StableHasher a, b;
+  a.AddFloat(0.0f);
+  b.AddFloat(-0.0f);
+  CHECK_EQUAL(a.GetValue(), b.GetValue());
+  StableHasher nullText, emptyText;
+  nullText.AddString(nullptr);
+  emptyText.AddString("");
+  CHECK(nullText.GetValue() != emptyText.GetValue());
+}
+
+TEST_CASE(HashesWideTextAsUtf16)
+{
+  // Windows と Linux (wchar_t が 32bit) で同じキーになること.
+  const char16_t name[] = u"mainPS";
+  CHECK_EQUAL(StableHasher::Hash(name, 6 * sizeof(char16_t)), StableHasher::HashUtf16(L"mainPS"));
+  const char16_t pair[] = u"\U0001F600";
+  // Windows では 2 つの wchar_t、 Linux では 1 つになる文字.
+  CHECK_EQUAL(StableHasher::Hash(pair, 2 * sizeof(char16_t)), StableHasher::HashUtf16(L"\U0001F600"));
+}
@@ -0,0 +1,133 @@
+﻿#include "TestUtil.h"
+#include "ShaderCompileService.h"
+#include <atomic>
+#include <stdexcept>
+
+namespace
+{
+  // コンパイル結果の代わりに、要求の中身と何番目のコンパイルかを返す.
+  struct FakeShader
+  {
+    std::wstring entryPoint;
+    int serial;
+  };
+  using FakeCompileService = BasicShaderCompileService<FakeShader>;
+
+  ShaderCompileRequest MakeRequest(const std::wstring& entryPoint)
+  {
+    ShaderCompileRequest request;
+    request.fileName = L"shader.hlsl";
+    request.stage = ShaderTypes::Pixel;
+    request.entryPoint = entryPoint;
+    return request;
+  }
+}
+
+TEST_CASE(CompilesDuplicatedRequestsOnce)
+{
+  auto threadPool = std::make_shared<WorkerThreadPool>(2);
+  std::atomic<int> callCount(0);
+  FakeCompileService service(threadPool, [&](const ShaderCompileRequest& request) {
+    return FakeShader{ request.entryPoint, ++callCount };
+  });
+
+  auto results = service.Compile({ MakeRequest(L"mainPS"), MakeRequest(L"mainVS"), MakeRequest(L"mainPS") });
+  CHECK(results[0].get().entryPoint == L"mainPS");
+  CHECK(results[1].get().entryPoint == L"mainVS");
+  // 同じ要求には同じ結果が返る.
+  CHECK_EQUAL(results[0].get().serial, results[2].get().serial);
+  CHECK_EQUAL(2, callCount.load());
+  CHECK_EQUAL(3u, service.GetRequestCount());
+  CHECK_EQUAL(2u, service.GetCompileCount());
+  CHECK_EQUAL(2u, service.GetThreadCount());
+}
+
+TEST_CASE(DistinguishesDefinesAndFlags)
+{
+  auto threadPool = std::make_shared<WorkerThreadPool>(1);
+  FakeCompileService service(threadPool, [](const ShaderCompileRequest& request) {
+    return FakeShader{ request.entryPoint, 0 };
+  });
+
+  auto withDefine = MakeRequest(L"mainPS");
+  withDefine.defines.push_back({ L"USE_FOG", L"1" });
+  auto withFlag = MakeRequest(L"mainPS");
+  withFlag.flags.push_back(L"-enable-16bit-types");
+  auto withModel = MakeRequest(L"mainPS");
+  withModel.shaderModel = L"6_2";
+  service.Compile({ MakeRequest(L"mainPS"), withDefine, withFlag, withModel });
+  CHECK_EQUAL(4u, service.GetCompileCount());
+
+  // 区切りをまたいで同じ文字列にならないこと.
+  auto a = MakeRequest(L"main");
+  a.flags = { L"A", L"B" };
+  auto b = MakeRequest(L"main");
+  b.flags = { L"A" };
+  b.defines.push_back({ L"B", L"" });
+  CHECK(FakeCompileService::MakeKey(a) != FakeCompileService::MakeKey(b));
+}
+
+TEST_CASE(ClearCompilesAgain)
+{
+  auto threadPool = std::make_shared<WorkerThreadPool>(1);
+  std::atomic<int> callCount(0);
+  FakeCompileService service(threadPool, [&](const ShaderCompileRequest& request) {
+    return FakeShader{ request.entryPoint, ++callCount };
+  });
+
+  service.Compile(MakeRequest(L"mainPS")).wait();
+  service.Clear();
+  CHECK_EQUAL(2, service.Compile(MakeRequest(L"mainPS")).get().serial);
+  CHECK_EQUAL(2u, service.GetCompileCount());
+}
+
+TEST_CASE(FailureIsThrownFromGet)
+{
+  auto threadPool = std::make_shared<WorkerThreadPool>(1);
+  FakeCompileService service(threadPool, [](const ShaderCompileRequest& request) -> FakeShader {
+    if (request.entryPoint == L"broken")
+    {
+      throw std::runtime_error("shader compile failed.");
+    }
+    return FakeShader{ request.entryPoint, 0 };
+  });
+
+  auto broken = service.Compile(MakeRequest(L"broken"));
+  auto ok = service.Compile(MakeRequest(L"mainPS"));
+  CHECK_THROWS(broken.get());
+  // 重複した要求にも同じ例外が返り、他の要求には影響しない.
+  CHECK_THROWS(service.Compile(MakeRequest(L"broken")).get());
+  CHECK(ok.get().entryPoint == L"mainPS");
+}
+
+TEST_CASE(ServiceSharesPoolWithParallelFor)
+{
+  auto threadPool = std::make_shared<WorkerThreadPool>(2);
+  FakeCompileService service(threadPool, [](const ShaderCompileRequest& request) {
+    return FakeShader{ request.entryPoint, 0 };
+  });
+
+  auto result = service.Compile(MakeRequest(L"mainPS"));
+  std::atomic<uint32_t> sum(0);
+  threadPool->ParallelFor(100, [&](uint32_t index) { sum += index; });
+  CHECK_EQUAL(4950u, sum.load());
+  CHECK(result.get().entryPoint == L"mainPS");
+}
+
+TEST_CASE(PendingJobsRunBeforePoolIsDestroyed)
+{
+  std::atomic<int> callCount(0);
+  std::vector<FakeCompileService::Result> results;
+  {
+    auto threadPool = std::make_shared<WorkerThreadPool>(1);
+    FakeCompileService service(threadPool, [&](const ShaderCompileRequest& request) {
+      return FakeShader{ request.entryPoint, ++callCount };
+    });
+    for (int i = 0; i < 8; ++i)
+    {
+      results.push_back(service.Compile(MakeRequest(L"main" + std::to_wstring(i))));
+    }
+  }
+  CHECK_EQUAL(8, callCount.load());
+  CHECK(results[7].get().entryPoint == L"main7");
+}
@@ -0,0 +1,67 @@
+﻿#include "TestUtil.h"
+#include "ShaderReflectionData.h"
+#include <climits>
+#include <cstring>
+
+namespace
+{
+  ShaderReflectionData MakeData()
+  {
+    ShaderReflectionData data;
+    data.shaderVersion = 0x10060;
+    data.inputParameters = 2;
+    data.resources.push_back({ "SceneParameters", 0, 0, 1, 0, 20 });
+    data.resources.push_back({ "textures", 2, 0, UINT_MAX, 1, 0 });
+    data.resources.push_back({ "", 3, 1, 1, 0, 0 });
+    return data;
+  }
+}
+
+TEST_CASE(RoundTripsResources)
+{
+  const auto data = MakeData();
+  ShaderReflectionData loaded;
+  CHECK(loaded.Deserialize(data.Serialize()));
+  CHECK_EQUAL(data.shaderVersion, loaded.shaderVersion);
+  CHECK_EQUAL(data.inputParameters, loaded.inputParameters);
+  CHECK_EQUAL(data.resources.size(), loaded.resources.size());
+  for (size_t i = 0; i < data.resources.size() && i < loaded.resources.size(); ++i)
+  {
+    const auto& a = data.resources[i];
+    const auto& b = loaded.resources[i];
+    CHECK(a.name == b.name);
+    CHECK_EQUAL(a.type, b.type);
+    CHECK_EQUAL(a.bindPoint, b.bindPoint);
+    CHECK_EQUAL(a.bindCount, b.bindCount);
+    CHECK_EQUAL(a.space, b.space);
+    CHECK_EQUAL(a.constantCount, b.constantCount);
+  }
+}
+
+TEST_CASE(RejectsBrokenData)
+{
+  const auto serialized = MakeData().Serialize();
+  ShaderReflectionData loaded;
+
+  // 途中で切れたもの、余分があるものは読まず、空になる.
+  for (size_t size = 0; size < serialized.size(); ++size)
+  {
+    std::vector<char> truncated(serialized.begin(), serialized.begin() + size);
+    CHECK(!loaded.Deserialize(truncated));
+    CHECK(loaded.resources.empty());
+  }
+  auto extended = serialized;
+  extended.push_back(0);
+  CHECK(!loaded.Deserialize(extended));
+
+  auto wrongMagic = serialized;
+  wrongMagic[0] = 'X';
+  CHECK(!loaded.Deserialize(wrongMagic));
+
+  // 巨大な要素数でも確保しない. (要素数はマジック、形式、シェーダーのバージョン、入力の数の後)
+  auto hugeCount = serialized;
+  const uint32_t count = 0xFFFFFFF0u;
+  memcpy(&hugeCount[16], &count, sizeof(count));
+  CHECK(!loaded.Deserialize(hugeCount));
+  CHECK_EQUAL(0u, loaded.shaderVersion);
+}
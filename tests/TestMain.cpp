@@ -0,0 +1,27 @@
+﻿#include "TestUtil.h"
+#include <exception>
+
+int main()
+{
+  int failedCases = 0;
+  for (const auto& test : test_util::GetTestCases())
+  {
+    int before = test_util::GetFailureCount();
+    try
+    {
+      test.func();
+    }
+    catch (std::exception& e)
+    {
+      test_util::ReportFailure(__FILE__, __LINE__, std::string(test.name) + " threw: " + e.what());
+    }
+    bool isPassed = test_util::GetFailureCount() == before;
+    std::printf("[%s] %s\n", isPassed ? "  OK  " : "FAILED", test.name);
+    if (!isPassed)
+    {
+      ++failedCases;
+    }
+  }
+  std::printf("%d / %d passed.\n", int(test_util::GetTestCases().size()) - failedCases, int(test_util::GetTestCases().size()));
+  return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// デバイスを使わないロジックの単体テスト用の最小限の仕組み.
+// TEST_CASE で登録した関数を TestMain.cpp の main がすべて実行する.
+namespace test_util
+{
+  struct TestCase
+  {
+    const char* name;
+    void (*func)();
+  };
+
+  inline std::vector<TestCase>& GetTestCases()
+  {
+    static std::vector<TestCase> cases;
+    return cases;
+  }
+  inline int& GetFailureCount()
+  {
+    static int count = 0;
+    return count;
+  }
+
+  struct Registrar
+  {
+    Registrar(const char* name, void (*func)())
+    {
+      GetTestCases().push_back(TestCase{ name, func });
+    }
+  };
+
+  inline void ReportFailure(const char* file, int line, const std::string& message)
+  {
+    std::printf("%s(%d): failed: %s\n", file, line, message.c_str());
+    ++GetFailureCount();
+  }
+}
+
+#define TEST_CASE(name) \
+  static void name(); \
+  static test_util::Registrar name##_registrar(#name, name); \
+  static void name()
+
+#define CHECK(expr) \
+  do { if (!(expr)) { test_util::ReportFailure(__FILE__, __LINE__, #expr); } } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+  do { \
+    const auto expected_ = (expected); \
+    const auto actual_ = (actual); \
+    if (!(expected_ == actual_)) { \
+      test_util::ReportFailure(__FILE__, __LINE__, #actual " == " #expected \
+        " (actual " + std::to_string(actual_) + ", expected " + std::to_string(expected_) + ")"); \
+    } \
+  } while (0)
+
+#define CHECK_THROWS(expr) \
+  do { \
+    bool thrown_ = false; \
+    try { expr; } catch (...) { thrown_ = true; } \
+    if (!thrown_) { test_util::ReportFailure(__FILE__, __LINE__, #expr " did not throw"); } \
+  } while (0)
@@ -0,0 +1,75 @@
+﻿#include "TestUtil.h"
+#include "TransientAliasPlanner.h"
+
+TEST_CASE(AliasesDisjointLifetimes)
+{
+  TransientAliasPlanner planner;
+  auto a = planner.Add({ 1024, 256, 0, 1 });
+  auto b = planner.Add({ 512, 256, 2, 3 });
+  auto c = planner.Add({ 512, 256, 2, 2 });
+  auto heapSize = planner.Plan();
+
+  // b, c は a の後にしか使わないので a の領域に重ねられ、互いには重ならない.
+  CHECK_EQUAL(1024ull, heapSize);
+  CHECK_EQUAL(0ull, planner.GetOffset(a));
+  CHECK(planner.GetOffset(b) != planner.GetOffset(c));
+  CHECK(planner.GetOffset(b) + 512 <= 1024);
+  CHECK(planner.GetOffset(c) + 512 <= 1024);
+  CHECK_EQUAL(2048ull, planner.GetUnaliasedSize());
+}
+
+TEST_CASE(KeepsOverlappingLifetimesApart)
+{
+  // CubemapRenderingApp の描画先(パス 0-1)とデプス(パス 0)の組. 寿命が重なるので共有しない.
+  TransientAliasPlanner planner;
+  auto color = planner.Add({ 4096, 1024, 0, 1 });
+  auto depth = planner.Add({ 2048, 1024, 0, 0 });
+  CHECK_EQUAL(6144ull, planner.Plan());
+  CHECK_EQUAL(0ull, planner.GetOffset(color));
+  CHECK_EQUAL(4096ull, planner.GetOffset(depth));
+}
+
+TEST_CASE(RespectsAlignment)
+{
+  TransientAliasPlanner planner;
+  planner.Add({ 100, 64, 0, 0 });
+  auto b = planner.Add({ 64, 256, 0, 0 });
+  planner.Plan();
+  CHECK_EQUAL(0ull, planner.GetOffset(b) % 256);
+  CHECK(planner.GetOffset(b) >= 100 || planner.GetOffset(b) + 64 <= planner.GetOffset(0));
+}
+
+TEST_CASE(ReusesMemoryAcrossPassChain)
+{
+  // ピンポンするような連鎖: 各リソースは隣のパスとだけ寿命が重なる.
+  TransientAliasPlanner planner;
+  for (uint32_t i = 0; i < 6; ++i)
+  {
+    planner.Add({ 256, 256, i, i + 1 });
+  }
+  // 同時に生きるのは 2 つまでなので 2 つ分で足りる.
+  CHECK_EQUAL(512ull, planner.Plan());
+  for (uint32_t i = 0; i + 1 < 6; ++i)
+  {
+    CHECK(planner.GetOffset(i) != planner.GetOffset(i + 1));
+  }
+}
+
+TEST_CASE(ValidatesExternalPlacement)
+{
+  TransientAliasPlanner planner;
+  planner.Add({ 1024, 256, 0, 1 });
+  planner.Add({ 512, 256, 1, 2 });
+  planner.Add({ 512, 256, 2, 3 });
+  planner.Plan();
+  CHECK(planner.IsValidPlacement({ planner.GetOffset(0), planner.GetOffset(1), planner.GetOffset(2) }, 1536));
+
+  // 寿命の重ならない 0 と 2 は重ねてよい.
+  CHECK(planner.IsValidPlacement({ 0, 1024, 0 }, 1536));
+  // 寿命の重なる 0 と 1 は重ねられない.
+  CHECK(!planner.IsValidPlacement({ 0, 512, 1024 }, 1536));
+  // 境界に合わない、ヒープに収まらない、数が合わない.
+  CHECK(!planner.IsValidPlacement({ 0, 1100, 0 }, 1612));
+  CHECK(!planner.IsValidPlacement({ 0, 1024, 0 }, 1500));
+  CHECK(!planner.IsValidPlacement({ 0, 1024 }, 1536));
+}